@@ -87,11 +87,16 @@
 #include "common/globals.h"
 #include "common/Timer.h"
 #include "common/compileInfo.h"
-#include "common/SyncQOverflow.h"
+#include "common/SyncQRing.h"
+#include "common/regexCache.h"
+#include "common/RequestArena.h"
 
 #include "orionTypes/EntityTypeVectorResponse.h"
 #include "ngsi/ParseData.h"
 #include "ngsiNotify/QueueNotifier.h"
+#include "ngsiNotify/SenderPool.h"
+#include "ngsiNotify/NotificationCoalescer.h"
+#include "rest/httpPool.h"
 #include "ngsiNotify/QueueWorkers.h"
 #include "ngsiNotify/senderThread.h"
 #include "serviceRoutines/logTraceTreat.h"
@@ -203,6 +208,7 @@
 #include "serviceRoutinesV2/semStateTreat.h"
 #include "serviceRoutinesV2/getMetrics.h"
 #include "serviceRoutinesV2/deleteMetrics.h"
+#include "serviceRoutinesV2/postTypesCatalog.h"
 
 #include "contextBroker/version.h"
 #include "common/string.h"
@@ -258,10 +264,18 @@ int             dbPoolSize;
 char            reqMutexPolicy[16];
 int             writeConcern;
 unsigned int    cprForwardLimit;
+long            cprForwardDeadline;
 int             subCacheInterval;
 char            notificationMode[64];
 int             notificationQueueSize;
 int             notificationThreadNum;
+bool            notificationDropWhenBusy;
+int             httpPoolMaxPerHost;
+int             httpPoolIdleTimeout;
+int             notifQueueQuota;
+int             regexCacheSize;
+bool            reqArena;
+bool            noCreateFastPath;
 bool            noCache;
 unsigned int    connectionMemory;
 unsigned int    maxConnections;
@@ -271,11 +285,15 @@ bool            statCounters;
 bool            statSemWait;
 bool            statTiming;
 bool            statNotifQueue;
+bool            statHttpPool;
+bool            statRegexCache;
+bool            statReqArena;
 int             lsPeriod;
 bool            relogAlarms;
 bool            strictIdv1;
 bool            disableCusNotif;
 bool            logForHumans;
+int             logAsyncRing;
 bool            disableMetrics;
 int             reqTimeout;
 bool            insecureNotif;
@@ -313,11 +331,12 @@ bool            insecureNotif;
 #define HTTP_TMO_DESC          "timeout in milliseconds for forwards and notifications"
 #define DBPS_DESC              "database connection pool size"
 #define MAX_L                  900000
-#define MUTEX_POLICY_DESC      "mutex policy (none/read/write/all)"
+#define MUTEX_POLICY_DESC      "mutex policy (none/read/write/all/rw)"
 #define WRITE_CONCERN_DESC     "db write concern (0:unacknowledged, 1:acknowledged)"
-#define CPR_FORWARD_LIMIT_DESC "maximum number of forwarded requests to Context Providers for a single client request"
+#define CPR_FORWARD_LIMIT_DESC "maximum number of forwarded requests to Context Providers for a single client request (all of them concurrent)"
+#define CPR_FORWARD_DL_DESC    "deadline in milliseconds for all the forwards of a single client request (0: no deadline)"
 #define SUB_CACHE_IVAL_DESC    "interval in seconds between calls to Subscription Cache refresh (0: no refresh)"
-#define NOTIFICATION_MODE_DESC "notification mode (persistent|transient|threadpool:q:n)"
+#define NOTIFICATION_MODE_DESC "notification mode (persistent|transient:n:block/drop|threadpool:q:n|async:q:n)"
 #define NO_CACHE               "disable subscription cache for lookups"
 #define CONN_MEMORY_DESC       "maximum memory size per connection (in kilobytes)"
 #define MAX_CONN_DESC          "maximum number of simultaneous connections"
@@ -327,15 +346,25 @@ bool            insecureNotif;
 #define STAT_SEM_WAIT          "enable semaphore waiting time statistics"
 #define STAT_TIMING            "enable request-time-measuring statistics"
 #define STAT_NOTIF_QUEUE       "enable thread pool notifications queue statistics"
+#define STAT_HTTP_POOL         "enable outgoing HTTP connection pool statistics"
+#define STAT_REGEX_CACHE       "enable compiled regex cache statistics"
+#define STAT_REQ_ARENA         "enable request arena allocation statistics"
 #define LOG_SUMMARY_DESC       "log summary period in seconds (defaults to 0, meaning 'off')"
 #define RELOGALARMS_DESC       "log messages for existing alarms beyond the raising alarm log message itself"
 #define CHECK_v1_ID_DESC       "additional checks for id fields in the NGSIv1 API"
 #define DISABLE_CUSTOM_NOTIF   "disable NGSIv2 custom notifications"
 #define LOG_TO_SCREEN_DESC     "log to screen"
 #define LOG_FOR_HUMANS_DESC    "human readible log to screen"
+#define LOG_ASYNC_RING_DESC    "size (in lines) of the ring of the asynchronous log writer (0: synchronous log)"
 #define METRICS_DESC           "turn off the 'metrics' feature"
 #define REQ_TMO_DESC           "connection timeout for REST requests (in seconds)"
 #define INSECURE_NOTIF         "allow HTTPS notifications to peers which certificate cannot be authenticated with known CA certificates"
+#define HTTP_POOL_MAX_DESC     "maximum number of outgoing connections per endpoint (0: no connection pool)"
+#define HTTP_POOL_IDLE_DESC    "time in seconds an idle outgoing connection is kept in the connection pool"
+#define REGEX_CACHE_SIZE_DESC  "maximum number of compiled regular expressions kept in cache (0: no cache)"
+#define REQ_ARENA_DESC         "allocate the NGSI objects of each request from a per-request arena"
+#define NO_CREATE_FAST_DESC    "create entities (POST /v2/entities) through the generic update path"
+#define NOTIF_QUEUE_QUOTA_DESC "maximum number of queued notifications per destination, with fair queuing among destinations (0: one shared queue)"
 
 
 
@@ -381,6 +410,7 @@ PaArgument paArgs[] =
 
   { "-corsOrigin",       allowedOrigin,     "ALLOWED_ORIGIN",    PaString, PaOpt, _i "",          PaNL,  PaNL,     ALLOWED_ORIGIN_DESC    },
   { "-cprForwardLimit",  &cprForwardLimit,  "CPR_FORWARD_LIMIT", PaUInt,   PaOpt, 1000,           0,     UINT_MAX, CPR_FORWARD_LIMIT_DESC },
+  { "-cprForwardDeadline", &cprForwardDeadline, "CPR_FORWARD_DEADLINE", PaLong, PaOpt, 0,          0,     PaNL,     CPR_FORWARD_DL_DESC    },
   { "-subCacheIval",     &subCacheInterval, "SUBCACHE_IVAL",     PaInt,    PaOpt, 60,             0,     3600,     SUB_CACHE_IVAL_DESC    },
   { "-noCache",          &noCache,          "NOCACHE",           PaBool,   PaOpt, false,          false, true,     NO_CACHE               },
   { "-connectionMemory", &connectionMemory, "CONN_MEMORY",       PaUInt,   PaOpt, 64,             0,     1024,     CONN_MEMORY_DESC       },
@@ -394,6 +424,9 @@ PaArgument paArgs[] =
   { "-statSemWait",    &statSemWait,    "STAT_SEM_WAIT",    PaBool, PaOpt, false, false, true, STAT_SEM_WAIT     },
   { "-statTiming",     &statTiming,     "STAT_TIMING",      PaBool, PaOpt, false, false, true, STAT_TIMING       },
   { "-statNotifQueue", &statNotifQueue, "STAT_NOTIF_QUEUE", PaBool, PaOpt, false, false, true, STAT_NOTIF_QUEUE  },
+  { "-statHttpPool",   &statHttpPool,   "STAT_HTTP_POOL",   PaBool, PaOpt, false, false, true, STAT_HTTP_POOL    },
+  { "-statRegexCache", &statRegexCache, "STAT_REGEX_CACHE", PaBool, PaOpt, false, false, true, STAT_REGEX_CACHE  },
+  { "-statReqArena",   &statReqArena,   "STAT_REQ_ARENA",   PaBool, PaOpt, false, false, true, STAT_REQ_ARENA    },
 
   { "-logSummary",     &lsPeriod,       "LOG_SUMMARY_PERIOD", PaInt,  PaOpt, 0,     0,     ONE_MONTH_PERIOD, LOG_SUMMARY_DESC },
   { "-relogAlarms",    &relogAlarms,    "RELOG_ALARMS",       PaBool, PaOpt, false, false, true,             RELOGALARMS_DESC },
@@ -406,6 +439,16 @@ PaArgument paArgs[] =
 
   { "-insecureNotif", &insecureNotif, "INSECURE_NOTIF", PaBool, PaOpt, false, false, true, INSECURE_NOTIF },
 
+  { "-httpPoolMaxPerHost",  &httpPoolMaxPerHost,  "HTTP_POOL_MAX",  PaInt, PaOpt,  0, 0, PaNL,            HTTP_POOL_MAX_DESC  },
+  { "-httpPoolIdleTimeout", &httpPoolIdleTimeout, "HTTP_POOL_IDLE", PaInt, PaOpt, 30, 1, ONE_MONTH_PERIOD, HTTP_POOL_IDLE_DESC },
+
+  { "-notifQueueQuota", &notifQueueQuota, "NOTIF_QUEUE_QUOTA", PaInt, PaOpt, 0, 0, PaNL, NOTIF_QUEUE_QUOTA_DESC },
+
+  { "-regexCacheSize", &regexCacheSize, "REGEX_CACHE_SIZE", PaInt, PaOpt, REGEX_CACHE_DEFAULT_SIZE, 0, PaNL, REGEX_CACHE_SIZE_DESC },
+  { "-reqArena",       &reqArena,       "REQ_ARENA",        PaBool, PaOpt, false, false, true, REQ_ARENA_DESC        },
+  { "-noCreateFastPath", &noCreateFastPath, "NO_CREATE_FAST_PATH", PaBool, PaOpt, false, false, true, NO_CREATE_FAST_DESC },
+  { "-logAsyncRing",   &logAsyncRing,   "LOG_ASYNC_RING",   PaInt,  PaOpt, 0,     0,     1048576, LOG_ASYNC_RING_DESC   },
+
   PA_END_OF_ARGS
 };
 
@@ -750,6 +793,14 @@ static const char* validLogLevels[] =
 #define METRICS_COMPS      2, { "admin", "metrics"                       }
 
 
+
+//
+// Entity types catalog
+//
+#define TYPES_CATALOG        TypesCatalogRequest
+#define TYPES_CATALOG_COMPS  2, { "admin", "typesCatalog"                  }
+
+
 //
 // Unversioned requests
 //
@@ -1159,6 +1210,10 @@ static const char* validLogLevels[] =
   { "DELETE", METRICS, METRICS_COMPS,   "", deleteMetrics                         }, \
   { "*",      METRICS, METRICS_COMPS,   "", badVerbGetDeleteOnly                  }
 
+#define TYPES_CATALOG_REQUESTS                                                       \
+  { "POST",   TYPES_CATALOG, TYPES_CATALOG_COMPS, "", postTypesCatalog            }, \
+  { "*",      TYPES_CATALOG, TYPES_CATALOG_COMPS, "", badVerbPostOnly             }
+
 
 
 /* ****************************************************************************
@@ -1198,6 +1253,7 @@ RestService restServiceV[] =
   LOGLEVEL_REQUESTS_V2,
   SEM_STATE_REQUESTS,
   METRICS_REQUESTS,
+  TYPES_CATALOG_REQUESTS,
 
 #ifdef DEBUG
   EXIT_REQUESTS,
@@ -1353,6 +1409,12 @@ void exitFunc(void)
   subCacheDestroy();
 #endif
 
+  // Pending coalesced notifications are sent before exiting
+  if (notificationCoalescerGet() != NULL)
+  {
+    notificationCoalescerGet()->stop();
+  }
+
   metricsMgr.release();
 
   curl_context_cleanup();
@@ -1362,6 +1424,9 @@ void exitFunc(void)
   {
     LM_T(LmtSoftError, ("error removing PID file '%s': %s", pidPath, strerror(errno)));
   }
+
+  // Pending log lines are written before exiting
+  lmAsyncStop();
 }
 
 
@@ -1391,10 +1456,13 @@ static void contextBrokerInit(std::string dbPrefix, bool multitenant)
 
   Notifier* pNotifier = NULL;
 
+  /* Outgoing connection pool, to be ready before any notification worker starts */
+  httpPoolInit(httpPoolMaxPerHost, httpPoolIdleTimeout);
+
   /* If we use a queue for notifications, start worker threads */
   if (strcmp(notificationMode, "threadpool") == 0)
   {
-    QueueNotifier*  pQNotifier = new QueueNotifier(notificationQueueSize, notificationThreadNum);
+    QueueNotifier*  pQNotifier = new QueueNotifier(notificationQueueSize, notificationThreadNum, false, notifQueueQuota);
     int rc = pQNotifier->start();
     if (rc != 0)
     {
@@ -1402,6 +1470,28 @@ static void contextBrokerInit(std::string dbPrefix, bool multitenant)
     }
     pNotifier = pQNotifier;
   }
+  else if (strcmp(notificationMode, "async") == 0)
+  {
+    QueueNotifier*  pQNotifier = new QueueNotifier(notificationQueueSize, notificationThreadNum, true, notifQueueQuota);
+    int             rc         = pQNotifier->start();
+
+    if (rc != 0)
+    {
+      LM_X(1,("Runtime Error starting async notification workers (%d)", rc));
+    }
+    pNotifier = pQNotifier;
+  }
+  else if (strcmp(notificationMode, "transient") == 0)
+  {
+    SenderPool*  pSenderPool = new SenderPool(notificationThreadNum, notificationDropWhenBusy);
+    int          rc          = pSenderPool->start();
+
+    if (rc != 0)
+    {
+      LM_X(1,("Runtime Error starting notification sender threads (%d)", rc));
+    }
+    pNotifier = new Notifier(pSenderPool);
+  }
   else
   {
     pNotifier = new Notifier();
@@ -1410,6 +1500,15 @@ static void contextBrokerInit(std::string dbPrefix, bool multitenant)
   /* Set notifier object (singleton) */
   setNotifier(pNotifier);
 
+  /* Coalescing of the notifications of subscriptions with notification.coalesceMs */
+  NotificationCoalescer*  pCoalescer = new NotificationCoalescer(pNotifier);
+
+  if (pCoalescer->start() != 0)
+  {
+    LM_X(1, ("Runtime Error starting notification coalescer"));
+  }
+  notificationCoalescerSet(pCoalescer);
+
   /* Set HTTP timeout */
   httpRequestInit(httpTimeout);
 }
@@ -1523,6 +1622,10 @@ static SemOpType policyGet(std::string mutexPolicy)
   {
     return SemNoneOp;
   }
+  else if (mutexPolicy == "rw")
+  {
+    return SemSharedOp;
+  }
 
   //
   // Default is to protect both reads and writes
@@ -1534,12 +1637,43 @@ static SemOpType policyGet(std::string mutexPolicy)
 *
 * notificationModeParse -
 */
-static void notificationModeParse(char *notifModeArg, int *pQueueSize, int *pNumThreads)
+static void notificationModeParse(char *notifModeArg, int *pQueueSize, int *pNumThreads, bool *pDropWhenBusy)
 {
   char* mode;
   char* first_colon;
   int   flds_num;
 
+  *pDropWhenBusy = false;
+
+  // transient mode has its own syntax (transient:n:block|drop), as the last field is not a number
+  if (strncmp(notifModeArg, "transient", strlen("transient")) == 0)
+  {
+    char policy[16] = "block";
+
+    flds_num = sscanf(notifModeArg, "transient:%d:%15s", pNumThreads, policy);
+    if (strcmp(notifModeArg, "transient") == 0)
+    {
+      *pNumThreads = DEFAULT_NOTIF_TRANSIENT_TN;
+    }
+    else if (flds_num < 1 || *pNumThreads <= 0)
+    {
+      LM_X(1, ("Fatal Error parsing notification mode: invalid number of threads (%s)", notifModeArg));
+    }
+    else if (strcmp(policy, "drop") == 0)
+    {
+      *pDropWhenBusy = true;
+    }
+    else if (strcmp(policy, "block") != 0)
+    {
+      LM_X(1, ("Fatal Error parsing notification mode: invalid policy (%s)", policy));
+    }
+
+    *pQueueSize = 0;
+    notifModeArg[strlen("transient")] = '\0';
+
+    return;
+  }
+
   errno = 0;
   // notifModeArg is a char[64], pretty sure not a huge input to break sscanf
   // cppcheck-suppress invalidscanf
@@ -1564,6 +1698,29 @@ static void notificationModeParse(char *notifModeArg, int *pQueueSize, int *pNum
     *pQueueSize = DEFAULT_NOTIF_QS;
     *pNumThreads = DEFAULT_NOTIF_TN;
   }
+  else if (strcmp(mode, "async") == 0 && flds_num >= 1 && flds_num <= 3)
+  {
+    // async, async:n (threads) or async:q:n
+    if (flds_num == 1)
+    {
+      *pQueueSize  = DEFAULT_NOTIF_QS;
+      *pNumThreads = DEFAULT_NOTIF_ASYNC_TN;
+    }
+    else if (flds_num == 2)
+    {
+      *pNumThreads = *pQueueSize;
+      *pQueueSize  = DEFAULT_NOTIF_QS;
+    }
+
+    if (*pQueueSize <= 0)
+    {
+      LM_X(1, ("Fatal Error parsing notification mode: invalid queue size (%d)", *pQueueSize));
+    }
+    if (*pNumThreads <= 0)
+    {
+      LM_X(1, ("Fatal Error parsing notification mode: invalid number of threads (%d)", *pNumThreads));
+    }
+  }
   else if (!(
              flds_num == 1 &&
              (strcmp(mode, "transient") == 0 || strcmp(mode, "persistent") == 0)
@@ -1702,8 +1859,9 @@ int main(int argC, char* argV[])
     }
   }
 
-  notificationModeParse(notificationMode, &notificationQueueSize, &notificationThreadNum); // This should be called before contextBrokerInit()
-  LM_T(LmtNotifier, ("notification mode: '%s', queue size: %d, num threads %d", notificationMode, notificationQueueSize, notificationThreadNum));
+  notificationModeParse(notificationMode, &notificationQueueSize, &notificationThreadNum, &notificationDropWhenBusy); // This should be called before contextBrokerInit()
+  LM_T(LmtNotifier, ("notification mode: '%s', queue size: %d, num threads %d, drop when busy: %s",
+                     notificationMode, notificationQueueSize, notificationThreadNum, notificationDropWhenBusy? "yes" : "no"));
   LM_I(("Orion Context Broker is running"));
 
   if (fg == false)
@@ -1711,6 +1869,12 @@ int main(int argC, char* argV[])
     daemonize();
   }
 
+  // The writer thread is started after daemonize(), as threads don't survive fork()
+  if ((logAsyncRing > 0) && (lmAsyncStart(logAsyncRing) != LmsOk))
+  {
+    LM_X(1, ("Fatal Error (error starting the asynchronous log writer)"));
+  }
+
 #if 0
   //
   // This 'almost always outdeffed' piece of code is used whenever a change is done to the
@@ -1742,7 +1906,9 @@ int main(int argC, char* argV[])
 
   pidFile();
   SemOpType policy = policyGet(reqMutexPolicy);
-  orionInit(orionExit, ORION_VERSION, policy, statCounters, statSemWait, statTiming, statNotifQueue, strictIdv1);
+  orionInit(orionExit, ORION_VERSION, policy, statCounters, statSemWait, statTiming, statNotifQueue, statHttpPool, statRegexCache, statReqArena, strictIdv1);
+  regexCacheInit(regexCacheSize);
+  requestArenaInit(reqArena);
   mongoInit(dbHost, rplSet, dbName, user, pwd, mtenant, dbTimeout, writeConcern, dbPoolSize, statSemWait);
   alarmMgr.init(relogAlarms);
   metricsMgr.init(!disableMetrics, statSemWait);
@@ -28,6 +28,7 @@
 
 #include "logMsg/traceLevels.h"
 #include "logMsg/logMsg.h"
+#include "common/RequestArena.h"
 #include "ngsi10/QueryContextResponse.h"
 #include "apiTypesV2/Entities.h"
 
@@ -171,3 +172,138 @@ void Entities::fill(QueryContextResponse* qcrsP)
     }
   }
 }
+
+
+
+/* ****************************************************************************
+*
+* heapEntity -
+*
+* The entity with all its objects allocated from the heap: the entity itself if its
+* attributes are, otherwise a copy of it (freeing the entity).
+*/
+static Entity* heapEntity(Entity* eP)
+{
+  bool inArena = false;
+
+  for (unsigned int aIx = 0; aIx < eP->attributeVector.size(); ++aIx)
+  {
+    if (requestArenaObjectInArena(eP->attributeVector[aIx]))
+    {
+      inArena = true;
+      break;
+    }
+  }
+
+  if (!inArena)
+  {
+    // The compound values may still come from the arena, see ContextAttribute copy constructor
+    eP->attributeVector.compoundValuesToHeap();
+    return eP;
+  }
+
+  Entity*        copyP  = new Entity();
+  RequestArena*  arenaP = requestArenaGet();
+
+  requestArenaSet(NULL);
+  copyP->fill(eP->id, eP->type, eP->isPattern, &eP->attributeVector, eP->creDate, eP->modDate);
+  requestArenaSet(arenaP);
+
+  copyP->attributeVector.compoundValuesToHeap();
+
+  copyP->isTypePattern = eP->isTypePattern;
+  copyP->servicePath   = eP->servicePath;
+  copyP->typeGiven     = eP->typeGiven;
+  copyP->renderId      = eP->renderId;
+
+  eP->release();
+  delete eP;
+
+  return copyP;
+}
+
+
+
+/* ****************************************************************************
+*
+* EntitiesStream::EntitiesStream -
+*
+* The stream outlives the request and its arena (entities are rendered while MHD sends
+* them), so all its objects must come from the heap: the ones from the arena are copied
+* here. Filling the entities without arena saves copying their attributes twice.
+*/
+EntitiesStream::EntitiesStream
+(
+  Entities*                                   entitiesP,
+  const std::map<std::string, bool>&         _uriParamOptions,
+  const std::map<std::string, std::string>&  _uriParam
+):
+  ix(0),
+  ended(false),
+  uriParamOptions(_uriParamOptions),
+  uriParam(_uriParam)
+{
+  vec.vec.swap(entitiesP->vec.vec);
+
+  for (unsigned int eIx = 0; eIx < vec.size(); ++eIx)
+  {
+    vec.vec[eIx] = heapEntity(vec.vec[eIx]);
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* EntitiesStream::~EntitiesStream -
+*/
+EntitiesStream::~EntitiesStream()
+{
+  // The entities before 'ix' have been released already (if the response was not completely sent)
+  for (unsigned int eIx = ix; eIx < vec.size(); ++eIx)
+  {
+    vec.vec[eIx]->release();
+    delete vec.vec[eIx];
+  }
+
+  vec.vec.clear();
+}
+
+
+
+/* ****************************************************************************
+*
+* EntitiesStream::next -
+*
+* The first chunk is the opening bracket, then one chunk per entity (with its trailing
+* comma, if any) and the last one is the closing bracket.
+*/
+bool EntitiesStream::next(std::string* chunkP)
+{
+  if (ended)
+  {
+    return false;
+  }
+
+  *chunkP = (ix == 0)? "[" : "";
+
+  if (ix == vec.size())
+  {
+    *chunkP += "]";
+    ended    = true;
+
+    return true;
+  }
+
+  Entity* eP = vec.vec[ix];
+
+  *chunkP += eP->render(uriParamOptions, uriParam, ix != vec.size() - 1);
+
+  eP->release();
+  delete eP;
+  vec.vec[ix] = NULL;
+
+  ++ix;
+
+  return true;
+}
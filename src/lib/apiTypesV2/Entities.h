@@ -31,6 +31,7 @@
 
 #include "apiTypesV2/EntityVector.h"
 #include "rest/OrionError.h"
+#include "rest/ResponseStream.h"
 
 
 
@@ -64,4 +65,32 @@ class Entities
   void         fill(QueryContextResponse* qcrsP);
 };
 
+
+
+/* ****************************************************************************
+*
+* EntitiesStream -
+*
+* Renders the entities of an Entities object one by one, as they are sent. It takes
+* the entities from the Entities object, and each entity is released as soon as it
+* has been rendered, so the response is never completely rendered in memory.
+*/
+class EntitiesStream : public ResponseStream
+{
+ public:
+  EntitiesStream(Entities*                                   entitiesP,
+                 const std::map<std::string, bool>&         _uriParamOptions,
+                 const std::map<std::string, std::string>&  _uriParam);
+  ~EntitiesStream();
+
+  bool  next(std::string* chunkP);
+
+ private:
+  EntityVector                        vec;
+  unsigned int                        ix;
+  bool                                ended;
+  std::map<std::string, bool>         uriParamOptions;
+  std::map<std::string, std::string>  uriParam;
+};
+
 #endif  // SRC_LIB_APITYPESV2_ENTITIES_H_
@@ -50,7 +50,7 @@ namespace ngsiv2
 *
 * HttpInfo::HttpInfo - 
 */
-HttpInfo::HttpInfo() : verb(NOVERB), custom(false)
+HttpInfo::HttpInfo() : verb(NOVERB), custom(false), templatesP(NULL)
 {
 }
 
@@ -60,12 +60,135 @@ HttpInfo::HttpInfo() : verb(NOVERB), custom(false)
 *
 * HttpInfo::HttpInfo - 
 */
-HttpInfo::HttpInfo(const std::string& _url) : url(_url), verb(NOVERB), custom(false)
+HttpInfo::HttpInfo(const std::string& _url) : url(_url), verb(NOVERB), custom(false), templatesP(NULL)
 {
 }
 
 
 
+/* ****************************************************************************
+*
+* HttpInfo::HttpInfo - 
+*/
+HttpInfo::HttpInfo(const HttpInfo& httpInfo) :
+  url(httpInfo.url),
+  verb(httpInfo.verb),
+  qs(httpInfo.qs),
+  headers(httpInfo.headers),
+  payload(httpInfo.payload),
+  custom(httpInfo.custom),
+  templatesP(httpInfo.templatesP)
+{
+  if (templatesP != NULL)
+  {
+    __sync_fetch_and_add(&templatesP->refs, 1);
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* HttpInfo::~HttpInfo - 
+*/
+HttpInfo::~HttpInfo()
+{
+  templatesRelease();
+}
+
+
+
+/* ****************************************************************************
+*
+* HttpInfo::operator= - 
+*/
+HttpInfo& HttpInfo::operator=(const HttpInfo& httpInfo)
+{
+  if (this == &httpInfo)
+  {
+    return *this;
+  }
+
+  if (httpInfo.templatesP != NULL)
+  {
+    __sync_fetch_and_add(&httpInfo.templatesP->refs, 1);
+  }
+
+  templatesRelease();
+
+  url        = httpInfo.url;
+  verb       = httpInfo.verb;
+  qs         = httpInfo.qs;
+  headers    = httpInfo.headers;
+  payload    = httpInfo.payload;
+  custom     = httpInfo.custom;
+  templatesP = httpInfo.templatesP;
+
+  return *this;
+}
+
+
+
+/* ****************************************************************************
+*
+* HttpInfo::templatesCompile - 
+*/
+void HttpInfo::templatesCompile(void)
+{
+  templatesRelease();
+
+  if (!custom)
+  {
+    return;
+  }
+
+  templatesP = new HttpInfoTemplates();
+  templatesP->fill(*this);
+}
+
+
+
+/* ****************************************************************************
+*
+* HttpInfo::templatesRelease - 
+*/
+void HttpInfo::templatesRelease(void)
+{
+  if ((templatesP != NULL) && (__sync_sub_and_fetch(&templatesP->refs, 1) == 0))
+  {
+    delete templatesP;
+  }
+
+  templatesP = NULL;
+}
+
+
+
+/* ****************************************************************************
+*
+* HttpInfoTemplates::fill - 
+*/
+void HttpInfoTemplates::fill(const HttpInfo& httpInfo)
+{
+  url.compile(httpInfo.url);
+  payload.compile(httpInfo.payload);
+
+  qs.clear();
+  headers.clear();
+
+  for (std::map<std::string, std::string>::const_iterator it = httpInfo.qs.begin(); it != httpInfo.qs.end(); ++it)
+  {
+    qs.push_back(std::make_pair(MacroTemplate(it->first), MacroTemplate(it->second)));
+  }
+
+  for (std::map<std::string, std::string>::const_iterator it = httpInfo.headers.begin(); it != httpInfo.headers.end(); ++it)
+  {
+    headers.push_back(std::make_pair(MacroTemplate(it->first), MacroTemplate(it->second)));
+  }
+}
+
+
+
 /* ****************************************************************************
 *
 * HttpInfo::toJson -
@@ -110,6 +233,9 @@ std::string HttpInfo::toJson()
 */
 void HttpInfo::fill(const BSONObj& bo)
 {
+  // The compiled templates (if any) would not correspond to the new content
+  templatesRelease();
+
   this->url    = bo.hasField(CSUB_REFERENCE)? getStringFieldF(bo, CSUB_REFERENCE) : "";
   this->custom = bo.hasField(CSUB_CUSTOM)?    getBoolFieldF(bo,   CSUB_CUSTOM)    : false;
 
@@ -27,17 +27,49 @@
 */
 #include <string>
 #include <map>
+#include <vector>
+#include <utility>
 
 #include "mongo/client/dbclient.h"
+#include "common/macroSubstitute.h"
 #include "rest/Verb.h"
 
 
 
 namespace ngsiv2
 {
+struct HttpInfo;
+
+
+
+/* ****************************************************************************
+*
+* HttpInfoTemplates -
+*
+* The url, payload, qs and headers of a custom notification, compiled. The qs and
+* headers (key and value templates) keep the order of the maps they come from.
+*/
+struct HttpInfoTemplates
+{
+  MacroTemplate                                           url;
+  MacroTemplate                                           payload;
+  std::vector<std::pair<MacroTemplate, MacroTemplate> >  qs;
+  std::vector<std::pair<MacroTemplate, MacroTemplate> >  headers;
+  volatile int                                            refs;
+
+  HttpInfoTemplates(): refs(1) {}
+  void  fill(const HttpInfo& httpInfo);
+};
+
+
+
 /* ****************************************************************************
 *
 * HttpInfo - 
+*
+* templatesP is only set (by templatesCompile()) in the httpInfo of cached subscriptions,
+* once the httpInfo is complete. Copies of the httpInfo share the compiled templates, that
+* are reference counted, so they outlive the cached subscription if needed.
 */
 struct HttpInfo
 {
@@ -47,12 +79,18 @@ struct HttpInfo
   std::map<std::string, std::string>  headers;
   std::string                         payload;
   bool                                custom;
+  HttpInfoTemplates*                  templatesP;
 
   HttpInfo();
   explicit HttpInfo(const std::string& _url);
+  HttpInfo(const HttpInfo& httpInfo);
+  ~HttpInfo();
 
+  HttpInfo&    operator=(const HttpInfo& httpInfo);
   std::string  toJson();
   void         fill(const mongo::BSONObj& bo);
+  void         templatesCompile(void);
+  void         templatesRelease(void);
 };
 }
 
@@ -145,6 +145,11 @@ std::string Notification::toJson(const std::string& attrsFormat)
     jh.addRaw("metadata", vectorToJson(this->metadata));
   }
 
+  if (this->coalesceMs > 0)
+  {
+    jh.addNumber("coalesceMs", this->coalesceMs);
+  }
+
   if (this->lastFailure > 0)
   {
     jh.addDate("lastFailure", this->lastFailure);
@@ -101,6 +101,7 @@ struct Notification
   std::string              toJson(const std::string& attrsFormat);
   int                      lastFailure;
   int                      lastSuccess;
+  long long                coalesceMs;   // 0 means no coalescing
   Notification():
     attributes(),
     blacklist(false),
@@ -108,7 +109,8 @@ struct Notification
     lastNotification(-1),
     httpInfo(),
     lastFailure(-1),
-    lastSuccess(-1)
+    lastSuccess(-1),
+    coalesceMs(0)
   {}
 };
 
@@ -28,6 +28,7 @@
 #include <string>
 
 #include "rest/StringFilter.h"
+#include "orionTypes/GeoFilter.h"
 
 
 
@@ -39,6 +40,8 @@
 *   This struct contains both 'q' and stringFilter.
 *   q is the 'plain string' of the stringFilter and it is used in parsing of V2 Subscriptions
 *   and when the q-string is read from the database.
+*   In the same way, geoFilter is the compiled version of geometry, coords and georel,
+*   only used by the subscription cache.
 */
 struct SubscriptionExpression
 {
@@ -53,6 +56,7 @@ struct SubscriptionExpression
 
   StringFilter              stringFilter;
   StringFilter              mdStringFilter;
+  orion::GeoFilter          geoFilter;
   bool                      isSet;
 };
 
@@ -27,12 +27,18 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
+#include <algorithm>
 
 #include "logMsg/logMsg.h"
 #include "logMsg/traceLevels.h"
 
 #include "common/sem.h"
 #include "common/string.h"
+#include "common/statistics.h"
+#include "common/clockFunctions.h"
+#include "common/ServicePathTrie.h"
+#include "common/regexCache.h"
 #include "apiTypesV2/HttpInfo.h"
 #include "apiTypesV2/Subscription.h"
 #include "mongoBackend/MongoGlobal.h"
@@ -85,49 +91,33 @@ EntityInfo::EntityInfo
 :
 entityId(_entityId), entityType(_entityType), isTypePattern(_isTypePattern)
 {
-  isPattern    = (_isPattern == "true") || (_isPattern == "TRUE") || (_isPattern == "True");
+  isPattern         = (_isPattern == "true") || (_isPattern == "TRUE") || (_isPattern == "True");
+  entityIdPattern   = NULL;
+  entityTypePattern = NULL;
 
   if (isPattern)
   {
     // FIXME P5: recomp error should be captured? have a look to other usages of regcomp()
     // in order to see how it works
-    if (regcomp(&entityIdPattern, _entityId.c_str(), REG_EXTENDED) != 0)
+    if ((entityIdPattern = regexCacheGet(_entityId, REG_EXTENDED)) == NULL)
     {
       alarmMgr.badInput(clientIp, "invalid regular expression for idPattern");
       isPattern = false;  // FIXME P6: this entity should not be let into the system. Must be stopped before.
                           //           Right here, best thing to do is simply to say it is not a regex
-      entityIdPatternToBeFreed = false;
-    }
-    else
-    {
-      entityIdPatternToBeFreed = true;
     }
   }
-  else
-  {
-    entityIdPatternToBeFreed = false;
-  }
 
   if (isTypePattern)
   {
     // FIXME P5: recomp error should be captured? have a look to other usages of regcomp()
     // in order to see how it works
-    if (regcomp(&entityTypePattern, _entityType.c_str(), REG_EXTENDED) != 0)
+    if ((entityTypePattern = regexCacheGet(_entityType, REG_EXTENDED)) == NULL)
     {
       alarmMgr.badInput(clientIp, "invalid regular expression for typePattern");
       isTypePattern = false;  // FIXME P6: this entity should not be let into the system. Must be stopped before.
                           //           Right here, best thing to do is simply to say it is not a regex
-      entityTypePatternToBeFreed = false;
-    }
-    else
-    {
-      entityTypePatternToBeFreed = true;
     }
   }
-  else
-  {
-    entityTypePatternToBeFreed = false;
-  }
 }
 
 
@@ -149,7 +139,7 @@ bool EntityInfo::match
   if (isPattern)
   {
     // REGEX-comparison this->entityIdPattern VS id
-    matchedId =  (regexec(&entityIdPattern, id.c_str(), 0, NULL, 0) == 0);
+    matchedId =  (regexec(entityIdPattern, id.c_str(), 0, NULL, 0) == 0);
   }
   else if (id == entityId)
   {
@@ -167,7 +157,7 @@ bool EntityInfo::match
     if (isTypePattern)
     {
       // REGEX-comparison this->entityTypePattern VS type
-      matchedType = (regexec(&entityTypePattern, type.c_str(), 0, NULL, 0) == 0);
+      matchedType = (regexec(entityTypePattern, type.c_str(), 0, NULL, 0) == 0);
     }
     else if ((type != "")  && (entityType != "") && (entityType != type))
     {
@@ -190,16 +180,16 @@ bool EntityInfo::match
 */
 void EntityInfo::release(void)
 {
-  if (entityIdPatternToBeFreed)
+  if (entityIdPattern != NULL)
   {
-    regfree(&entityIdPattern);  // If regcomp fails it frees up itself (see glibc sources for details)
-    entityIdPatternToBeFreed = false;
+    regexCacheRelease(entityIdPattern);
+    entityIdPattern = NULL;
   }
 
-  if (entityTypePatternToBeFreed)
+  if (entityTypePattern != NULL)
   {
-    regfree(&entityTypePattern);  // If regcomp fails it frees up itself (see glibc sources for details)
-    entityTypePatternToBeFreed = false;
+    regexCacheRelease(entityTypePattern);
+    entityTypePattern = NULL;
   }
 }
 
@@ -237,13 +227,77 @@ typedef struct SubCache
 
 
 
+/* ****************************************************************************
+*
+* SubCacheEntityNode -
+*
+* Leaf level of the subscription cache index.
+* Subscriptions with a plain entity id are kept in 'idMap', keyed by the id,
+* while subscriptions with an idPattern are kept in 'patternV' (as they may match any id).
+*/
+typedef struct SubCacheEntityNode
+{
+  std::map<std::string, std::vector<CachedSubscription*> >  idMap;
+  std::vector<CachedSubscription*>                          patternV;
+} SubCacheEntityNode;
+
+
+
+/* ****************************************************************************
+*
+* SubCacheServicePathNode -
+*
+* Subscriptions of one service path, indexed by entity type.
+* A subscription without entity type is kept in typeMap[""], as it matches any type.
+* Subscriptions with a typePattern are kept in 'typePatternNode'.
+*/
+typedef struct SubCacheServicePathNode
+{
+  std::map<std::string, SubCacheEntityNode>  typeMap;
+  SubCacheEntityNode                         typePatternNode;
+} SubCacheServicePathNode;
+
+
+
+/* ****************************************************************************
+*
+* SubCacheTenantNode - subscriptions of one tenant, indexed by the service path of the subscription
+*/
+typedef ServicePathTrie<SubCacheServicePathNode>  SubCacheTenantNode;
+
+
+
 /* ****************************************************************************
 *
 * subCache -
+*
+* The linked list 'subCache.head' keeps all subscriptions of the cache.
+* On top of that list, 'subCacheIndex' indexes the very same subscriptions
+* (tenant -> servicePath -> entity type -> entity id) so that subCacheMatch
+* only needs to look at the candidate subscriptions of an update, not the entire list.
+* The service paths of a tenant are kept in a trie, so the service paths (wildcard or not)
+* matching the one of an update are found walking the trie once.
 */
-static SubCache  subCache            = { NULL, NULL, 0, 0, 0, 0 };
-bool             subCacheActive      = false;
-bool             subCacheMultitenant = false;
+static SubCache                                    subCache            = { NULL, NULL, 0, 0, 0, 0 };
+static std::map<std::string, SubCacheTenantNode*>  subCacheIndex;
+bool                                               subCacheActive      = false;
+bool                                               subCacheMultitenant = false;
+
+
+
+/* ****************************************************************************
+*
+* subCacheIndexClear -
+*/
+static void subCacheIndexClear(void)
+{
+  for (std::map<std::string, SubCacheTenantNode*>::iterator it = subCacheIndex.begin(); it != subCacheIndex.end(); ++it)
+  {
+    delete it->second;
+  }
+
+  subCacheIndex.clear();
+}
 
 
 
@@ -258,6 +312,7 @@ void subCacheInit(bool multitenant)
 
   subCache.head   = NULL;
   subCache.tail   = NULL;
+  subCacheIndexClear();
 
   subCacheStatisticsReset("subCacheInit");
 
@@ -327,81 +382,6 @@ static bool attributeMatch(CachedSubscription* cSubP, const std::vector<std::str
 
 
 
-/* ****************************************************************************
-*
-* servicePathMatch -
-*/
-static bool servicePathMatch(CachedSubscription* cSubP, char* servicePath)
-{
-  const char*  spath;
-
-  // Special case. "/#" matches EVERYTHING
-  if ((strlen(servicePath) == 2) && (servicePath[0] == '/') && (servicePath[1] == '#') && (servicePath[2] == 0))
-  {
-    return true;
-  }
-
-  //
-  // Empty service path?
-  //
-  if ((strlen(servicePath) == 0) && (strlen(cSubP->servicePath) == 0))
-  {
-    return true;
-  }
-
-  //
-  // Default service path for a subscription is "/".
-  // So, if empty, set it to "/"
-  //
-  if (servicePath[0] == 0)
-  {
-    servicePath = (char*) "/";
-  }
-
-  spath = cSubP->servicePath;
-
-  //
-  // No wildcard - exact match
-  //
-  if (spath[strlen(spath) - 1] != '#')
-  {
-    return (strcmp(servicePath, cSubP->servicePath) == 0);
-  }
-
-
-  //
-  // Wildcard - remove '#' and compare to the length of _servicePath.
-  //            If equal upto the length of _servicePath, then it is a match
-  //
-  // Actually, there is more than one way to match here:
-  // If we have a servicePath of the subscription as
-  // "/a/b/#", then the following service-paths must match:
-  //   1. /a/b
-  //   2. /a/b/ AND /a/b/.+  (any path below /a/b/)
-  //
-  // What should NOT match is "/a/b2".
-  //
-  unsigned int len = strlen(spath) - 2;
-
-  // 1. /a/b - (removing 2 chars from the cache-subscription removes "/#"
-
-  if ((spath[len] == '/') && (strlen(servicePath) == len) && (strncmp(spath, servicePath, len) == 0))
-  {
-    return true;
-  }
-
-  // 2. /a/b/.+
-  len = strlen(spath) - 1;
-  if (strncmp(spath, servicePath, len) == 0)
-  {
-    return true;
-  }
-
-  return false;
-}
-
-
-
 /* ****************************************************************************
 *
 * subMatch -
@@ -442,12 +422,10 @@ static bool subMatch
     }
   }
 
-  if (servicePathMatch(cSubP, (char*) servicePath) == false)
-  {
-    LM_T(LmtSubCacheMatch, ("No match due to servicePath"));
-    return false;
-  }
-
+  //
+  // No need to check the servicePath here, the candidates come from the nodes of the
+  // servicePath trie matching the servicePath (see subCacheCandidatesGet)
+  //
 
   //
   // If ONCHANGE and one of the attribute names in the scope vector
@@ -479,39 +457,340 @@ static bool subMatch
 
 /* ****************************************************************************
 *
-* subCacheMatch -
+* subCacheIndexTenant -
+*
+* The tenant is only taken into account if the broker has started with -multiservice option.
+* NULL tenant and empty tenant are the same thing.
 */
-void subCacheMatch
+static std::string subCacheIndexTenant(const char* tenant)
+{
+  if ((subCacheMultitenant == false) || (tenant == NULL))
+  {
+    return "";
+  }
+
+  return tenant;
+}
+
+
+
+/* ****************************************************************************
+*
+* subCacheIndexEntityNode - the leaf node where an EntityInfo of a subscription is indexed
+*/
+static SubCacheEntityNode* subCacheIndexEntityNode(CachedSubscription* cSubP, EntityInfo* eiP)
+{
+  SubCacheTenantNode*& tNodeP = subCacheIndex[subCacheIndexTenant(cSubP->tenant)];
+
+  if (tNodeP == NULL)
+  {
+    tNodeP = new SubCacheTenantNode();
+  }
+
+  SubCacheServicePathNode* spNodeP = tNodeP->entryGet(cSubP->servicePath, true);
+
+  if (eiP->isTypePattern)
+  {
+    return &spNodeP->typePatternNode;
+  }
+
+  return &spNodeP->typeMap[eiP->entityType];
+}
+
+
+
+/* ****************************************************************************
+*
+* subCacheIndexInsert -
+*
+* A subscription is indexed once per EntityInfo. Subscriptions with more than one
+* EntityInfo may thus be found more than once as candidates for the same update
+* (see subCacheCandidatesUnique).
+*/
+static void subCacheIndexInsert(CachedSubscription* cSubP)
+{
+  for (unsigned int ix = 0; ix < cSubP->entityIdInfos.size(); ++ix)
+  {
+    EntityInfo*          eiP    = cSubP->entityIdInfos[ix];
+    SubCacheEntityNode*  nodeP  = subCacheIndexEntityNode(cSubP, eiP);
+
+    if (eiP->isPattern)
+    {
+      nodeP->patternV.push_back(cSubP);
+    }
+    else
+    {
+      nodeP->idMap[eiP->entityId].push_back(cSubP);
+    }
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* subCacheIndexVectorRemove -
+*/
+static void subCacheIndexVectorRemove(std::vector<CachedSubscription*>* subVecP, CachedSubscription* cSubP)
+{
+  std::vector<CachedSubscription*>::iterator it = std::find(subVecP->begin(), subVecP->end(), cSubP);
+
+  if (it != subVecP->end())
+  {
+    subVecP->erase(it);
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* servicePathNodeEmpty -
+*/
+static bool servicePathNodeEmpty(const SubCacheServicePathNode& spNode)
+{
+  return (spNode.typeMap.size() == 0) &&
+         (spNode.typePatternNode.idMap.size() == 0) &&
+         (spNode.typePatternNode.patternV.size() == 0);
+}
+
+
+
+/* ****************************************************************************
+*
+* subCacheIndexRemove -
+*
+* Nodes of the index that are left empty are removed, so that the index doesn't
+* keep growing with tenants/servicePaths/types/ids of already removed subscriptions.
+*/
+static void subCacheIndexRemove(CachedSubscription* cSubP)
+{
+  std::string                                           tenant = subCacheIndexTenant(cSubP->tenant);
+  std::map<std::string, SubCacheTenantNode*>::iterator  tIter  = subCacheIndex.find(tenant);
+
+  if (tIter == subCacheIndex.end())
+  {
+    return;
+  }
+
+  SubCacheTenantNode*       tNodeP  = tIter->second;
+  SubCacheServicePathNode*  spNodeP = tNodeP->entryGet(cSubP->servicePath, false);
+
+  if (spNodeP == NULL)
+  {
+    return;
+  }
+
+  for (unsigned int ix = 0; ix < cSubP->entityIdInfos.size(); ++ix)
+  {
+    EntityInfo*          eiP   = cSubP->entityIdInfos[ix];
+    SubCacheEntityNode*  nodeP = NULL;
+
+    if (eiP->isTypePattern)
+    {
+      nodeP = &spNodeP->typePatternNode;
+    }
+    else
+    {
+      std::map<std::string, SubCacheEntityNode>::iterator typeIter = spNodeP->typeMap.find(eiP->entityType);
+
+      if (typeIter == spNodeP->typeMap.end())
+      {
+        continue;
+      }
+
+      nodeP = &typeIter->second;
+    }
+
+    if (eiP->isPattern)
+    {
+      subCacheIndexVectorRemove(&nodeP->patternV, cSubP);
+    }
+    else
+    {
+      std::map<std::string, std::vector<CachedSubscription*> >::iterator idIter = nodeP->idMap.find(eiP->entityId);
+
+      if (idIter != nodeP->idMap.end())
+      {
+        subCacheIndexVectorRemove(&idIter->second, cSubP);
+
+        if (idIter->second.size() == 0)
+        {
+          nodeP->idMap.erase(idIter);
+        }
+      }
+    }
+
+    if ((eiP->isTypePattern == false) && (nodeP->idMap.size() == 0) && (nodeP->patternV.size() == 0))
+    {
+      spNodeP->typeMap.erase(eiP->entityType);
+    }
+  }
+
+  if (servicePathNodeEmpty(*spNodeP))
+  {
+    tNodeP->prune(cSubP->servicePath, servicePathNodeEmpty);
+
+    if ((tNodeP->size() == 1) &&
+        servicePathNodeEmpty(*tNodeP->entryGet("", false)) &&
+        servicePathNodeEmpty(*tNodeP->entryGet("/", false)) &&
+        servicePathNodeEmpty(*tNodeP->entryGet("/#", false)))
+    {
+      delete tNodeP;
+      subCacheIndex.erase(tIter);
+    }
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* entityNodeCandidatesGet -
+*/
+static void entityNodeCandidatesGet
 (
-  const char*                        tenant,
-  const char*                        servicePath,
+  const SubCacheEntityNode*          nodeP,
+  const char*                        entityId,
+  std::vector<CachedSubscription*>*  candidateVecP
+)
+{
+  std::map<std::string, std::vector<CachedSubscription*> >::const_iterator idIter = nodeP->idMap.find(entityId);
+
+  if (idIter != nodeP->idMap.end())
+  {
+    candidateVecP->insert(candidateVecP->end(), idIter->second.begin(), idIter->second.end());
+  }
+
+  candidateVecP->insert(candidateVecP->end(), nodeP->patternV.begin(), nodeP->patternV.end());
+}
+
+
+
+/* ****************************************************************************
+*
+* servicePathNodeCandidatesGet -
+*
+* An empty entity type in the update matches subscriptions of any type (see EntityInfo::match),
+* so, in that case all the type nodes are visited.
+*/
+static void servicePathNodeCandidatesGet
+(
+  const SubCacheServicePathNode*     spNodeP,
   const char*                        entityId,
   const char*                        entityType,
-  const char*                        attr,
-  std::vector<CachedSubscription*>*  subVecP
+  std::vector<CachedSubscription*>*  candidateVecP
 )
 {
-  CachedSubscription* cSubP = subCache.head;
+  if (entityType[0] == 0)
+  {
+    std::map<std::string, SubCacheEntityNode>::const_iterator typeIter;
 
-  while (cSubP != NULL)
+    for (typeIter = spNodeP->typeMap.begin(); typeIter != spNodeP->typeMap.end(); ++typeIter)
+    {
+      entityNodeCandidatesGet(&typeIter->second, entityId, candidateVecP);
+    }
+  }
+  else
   {
-    std::vector<std::string> attrV;
+    std::map<std::string, SubCacheEntityNode>::const_iterator typeIter;
 
-    attrV.push_back(attr);
+    if ((typeIter = spNodeP->typeMap.find(entityType)) != spNodeP->typeMap.end())
+    {
+      entityNodeCandidatesGet(&typeIter->second, entityId, candidateVecP);
+    }
 
-    if (subMatch(cSubP, tenant, servicePath, entityId, entityType, attrV))
+    if ((typeIter = spNodeP->typeMap.find("")) != spNodeP->typeMap.end())
     {
-      subVecP->push_back(cSubP);
-      LM_T(LmtSubCache, ("added subscription '%s': lastNotificationTime: %lu",
-                         cSubP->subscriptionId, cSubP->lastNotificationTime));
+      entityNodeCandidatesGet(&typeIter->second, entityId, candidateVecP);
     }
+  }
 
-    cSubP = cSubP->next;
+  entityNodeCandidatesGet(&spNodeP->typePatternNode, entityId, candidateVecP);
+}
+
+
+
+/* ****************************************************************************
+*
+* subCacheCandidatesGet -
+*
+* Get the subscriptions of the cache that *may* match an update. The final decision
+* is taken by subMatch(), so this function may give false positives, but never
+* false negatives. The service path, however, is fully resolved here.
+*
+* The service paths of the subscriptions that match the service path of the update, /a/b/c, are:
+*   - /a/b/c    (exact match)
+*   - /#, /a/#, /a/b/#, /a/b/c/#   (wildcard subscriptions)
+*
+* all of them in the way from the root of the trie to the node of /a/b/c (see ServicePathTrie::match).
+* The special service path "/#" matches every subscription of the tenant.
+*/
+static void subCacheCandidatesGet
+(
+  const char*                        tenant,
+  const char*                        servicePath,
+  const char*                        entityId,
+  const char*                        entityType,
+  std::vector<CachedSubscription*>*  candidateVecP
+)
+{
+  std::map<std::string, SubCacheTenantNode*>::const_iterator tIter = subCacheIndex.find(subCacheIndexTenant(tenant));
+
+  if (tIter == subCacheIndex.end())
+  {
+    return;
+  }
+
+  std::vector<SubCacheServicePathNode*> spNodeV;
+
+  tIter->second->match(servicePath, &spNodeV);
+
+  for (unsigned int ix = 0; ix < spNodeV.size(); ++ix)
+  {
+    servicePathNodeCandidatesGet(spNodeV[ix], entityId, entityType, candidateVecP);
   }
 }
 
 
 
+/* ****************************************************************************
+*
+* subCacheCandidatesUnique -
+*
+* A subscription with more than one EntityInfo can be found more than once among the candidates.
+*/
+static void subCacheCandidatesUnique(std::vector<CachedSubscription*>* candidateVecP)
+{
+  std::sort(candidateVecP->begin(), candidateVecP->end());
+  candidateVecP->erase(std::unique(candidateVecP->begin(), candidateVecP->end()), candidateVecP->end());
+}
+
+
+
+/* ****************************************************************************
+*
+* subCacheMatch -
+*/
+void subCacheMatch
+(
+  const char*                        tenant,
+  const char*                        servicePath,
+  const char*                        entityId,
+  const char*                        entityType,
+  const char*                        attr,
+  std::vector<CachedSubscription*>*  subVecP
+)
+{
+  std::vector<std::string> attrV;
+
+  attrV.push_back(attr);
+
+  subCacheMatch(tenant, servicePath, entityId, entityType, attrV, subVecP);
+}
+
+
+
 /* ****************************************************************************
 *
 * subCacheMatch -
@@ -526,18 +805,23 @@ void subCacheMatch
   std::vector<CachedSubscription*>*  subVecP
 )
 {
-  CachedSubscription* cSubP = subCache.head;
+  std::vector<CachedSubscription*> candidateVec;
 
-  while (cSubP != NULL)
+  subCacheCandidatesGet(tenant, servicePath, entityId, entityType, &candidateVec);
+  subCacheCandidatesUnique(&candidateVec);
+
+  LM_T(LmtSubCacheMatch, ("%d candidate subscriptions in cache", (int) candidateVec.size()));
+
+  for (unsigned int ix = 0; ix < candidateVec.size(); ++ix)
   {
+    CachedSubscription* cSubP = candidateVec[ix];
+
     if (subMatch(cSubP, tenant, servicePath, entityId, entityType, attrV))
     {
       subVecP->push_back(cSubP);
       LM_T(LmtSubCache, ("added subscription '%s': lastNotificationTime: %lu",
                          cSubP->subscriptionId, cSubP->lastNotificationTime));
     }
-
-    cSubP = cSubP->next;
   }
 }
 
@@ -619,6 +903,7 @@ void subCacheDestroy(void)
 
   subCache.head  = NULL;
   subCache.tail  = NULL;
+  subCacheIndexClear();
 }
 
 
@@ -704,7 +989,9 @@ void subCacheUpdateStatisticsIncrement(void)
 * calls this function.
 *
 * So, the subscription itself is untouched by this function, is it ONLY inserted
-* in the list (only the 'next' field is modified).
+* in the list (only the 'next' field is modified) and in the index used by subCacheMatch.
+* Note that this implies that tenant, servicePath and entityIdInfos of a cached subscription
+* must not be modified once inserted (remove it and insert it again instead).
 *
 */
 void subCacheItemInsert(CachedSubscription* cSubP)
@@ -716,6 +1003,8 @@ void subCacheItemInsert(CachedSubscription* cSubP)
 
   ++subCache.noOfInserts;
 
+  subCacheIndexInsert(cSubP);
+
   // First insertion?
   if ((subCache.head == NULL) && (subCache.tail == NULL))
   {
@@ -763,7 +1052,8 @@ void subCacheItemInsert
   const std::string&                 geometry,
   const std::string&                 coords,
   const std::string&                 georel,
-  bool                               blacklist
+  bool                               blacklist,
+  int64_t                            coalesceMs
 )
 {
   //
@@ -785,6 +1075,7 @@ void subCacheItemInsert
   cSubP->lastNotificationTime  = lastNotificationTime;
   cSubP->lastFailure           = lastNotificationFailureTime;
   cSubP->lastSuccess           = lastNotificationSuccessTime;
+  cSubP->modDate               = 0;
   cSubP->renderFormat          = renderFormat;
   cSubP->next                  = NULL;
   cSubP->count                 = (notificationDone == true)? 1 : 0;
@@ -794,6 +1085,7 @@ void subCacheItemInsert
   cSubP->expression.coords     = coords;
   cSubP->expression.georel     = georel;
   cSubP->blacklist             = blacklist;
+  cSubP->coalesceMs            = coalesceMs;
   cSubP->httpInfo              = httpInfo;
   cSubP->notifyConditionV      = conditionAttrs;
   cSubP->attributes            = attributes;
@@ -824,6 +1116,18 @@ void subCacheItemInsert
   }
 
 
+  //
+  // Custom notification templates
+  //
+  cSubP->httpInfo.templatesCompile();
+
+
+  //
+  // Geo filter (if it can't be compiled, the georel is checked against the DB on each notification)
+  //
+  cSubP->expression.geoFilter.compile(geometry, coords, georel);
+
+
 
   //
   // Convert all EntIds to EntityInfo
@@ -1071,6 +1375,8 @@ int subCacheItemRemove(CachedSubscription* cSubP)
       LM_T(LmtSubCache, ("in subCacheItemRemove, REMOVING '%s'", cSubP->subscriptionId));
       ++subCache.noOfRemoves;
 
+      subCacheIndexRemove(cSubP);
+
       subCacheItemDestroy(cSubP);
       delete cSubP;
 
@@ -1130,15 +1436,87 @@ void subCacheRefresh(void)
 
 /* ****************************************************************************
 *
-* CachedSubSaved -
+* subCacheSyncKey - key of a subscription in the maps used by subCacheSync
 */
-typedef struct CachedSubSaved
+static std::string subCacheSyncKey(const char* tenant, const char* subscriptionId)
 {
-  int64_t  lastNotificationTime;
-  int64_t  count;
-  int64_t  lastFailure;
-  int64_t  lastSuccess;
-} CachedSubSaved;
+  return std::string((tenant == NULL)? "" : tenant) + "|" + subscriptionId;
+}
+
+
+
+/* ****************************************************************************
+*
+* subCacheSyncLiveMap - map of the subscriptions currently in the cache, by subCacheSyncKey
+*
+* Must be called with the cache semaphore taken.
+*
+* FIXME P7: For some reason, sometimes the same subscription is found twice in the cache (Issue 2216)
+*           Only the first one is taken. Once the issue 2216 is fixed, this comment must be removed.
+*/
+static void subCacheSyncLiveMap(std::map<std::string, CachedSubscription*>* liveMapP)
+{
+  for (CachedSubscription* cSubP = subCache.head; cSubP != NULL; cSubP = cSubP->next)
+  {
+    std::string key = subCacheSyncKey(cSubP->tenant, cSubP->subscriptionId);
+
+    if (liveMapP->find(key) == liveMapP->end())
+    {
+      (*liveMapP)[key] = cSubP;
+    }
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* subCacheSyncCounters -
+*
+* Reconcile the counters of a cached subscription with those in DB:
+*   - the accumulated 'count' is flushed and reset to zero
+*   - each timestamp is flushed only if it is newer in cache than in DB (otherwise
+*     the cache takes the value in DB, written by another broker)
+*
+* Must be called with the cache semaphore taken.
+*/
+static void subCacheSyncCounters
+(
+  CachedSubscription*             cSubP,
+  const SubCacheDbState&          state,
+  std::vector<SubCountersDelta>*  flushV
+)
+{
+  SubCountersDelta flush;
+
+  flush.subscriptionId       = cSubP->subscriptionId;
+  flush.count                = cSubP->count;
+  flush.lastNotificationTime = (cSubP->lastNotificationTime > state.lastNotificationTime)? cSubP->lastNotificationTime : 0;
+  flush.lastFailure          = (cSubP->lastFailure          > state.lastFailure)?          cSubP->lastFailure          : 0;
+  flush.lastSuccess          = (cSubP->lastSuccess          > state.lastSuccess)?          cSubP->lastSuccess          : 0;
+
+  cSubP->count = 0;
+
+  if (flush.lastNotificationTime == 0)
+  {
+    cSubP->lastNotificationTime = state.lastNotificationTime;
+  }
+
+  if (flush.lastFailure == 0)
+  {
+    cSubP->lastFailure = state.lastFailure;
+  }
+
+  if (flush.lastSuccess == 0)
+  {
+    cSubP->lastSuccess = state.lastSuccess;
+  }
+
+  if ((flush.count != 0) || (flush.lastNotificationTime != 0) || (flush.lastFailure != 0) || (flush.lastSuccess != 0))
+  {
+    flushV->push_back(flush);
+  }
+}
 
 
 
@@ -1146,24 +1524,38 @@ typedef struct CachedSubSaved
 *
 * subCacheSync -
 *
-* 1. Save subscriptionId, lastNotificationTime, count, lastFailure, and lastSuccess for all items in cache (savedSubV)
-* 2. Refresh cache (count set to 0)
-* 3. Compare lastNotificationTime/lastFailure/lastSuccess in savedSubV with the new cache-contents and:
-*    3.1 Update cache-items where 'saved lastNotificationTime' > 'cached lastNotificationTime'
-*    3.2 Remember this more correct lastNotificationTime (must be flushed to mongo) -
-*        by clearing out (set to 0) those lastNotificationTimes that are newer in cache
-*    Same same with lastFailure and lastSuccess.
-* 4. Update 'count' for each item in savedSubV where non-zero
-* 5. Update 'lastNotificationTime/lastFailure/lastSuccess' for each item in savedSubV where non-zero
-* 6. Free the vector created in step 1 - savedSubV
+* Instead of destroying the cache and reloading all subscriptions from DB (see subCacheRefresh,
+* only used at startup), only the differences are applied, and the cache semaphore is only
+* taken for the (short) steps that need the cache, not while waiting for the DB:
+*
+* 1. With the semaphore: take a snapshot of the cache (the modDate of every subscription, by
+*    tenant and subscription id)
+* 2. Without the semaphore: for each tenant, get the state of its subscriptions in DB (only _id,
+*    modDate and timestamps). Subscriptions not in the snapshot or with a different modDate (i.e.
+*    created/updated by another broker) are loaded from DB and built as CachedSubscriptions.
+* 3. With the semaphore, apply the differences:
+*    3.1 Subscriptions in the snapshot that are no longer in DB are removed
+*    3.2 Subscriptions loaded in step 2 replace the ones in the cache, or are inserted if new
+*    3.3 The counters of all the subscriptions are reconciled with those in DB (subCacheSyncCounters)
+*    If a subscription has been inserted/updated/removed in the cache by a request thread since the
+*    snapshot was taken, the cache is more recent than what was read from DB and it is left untouched
+*    (but for the counters). A subscription is taken as untouched since the snapshot if it is
+*    still in the cache with the same modDate, as every update of a subscription sets a new
+*    modDate (see setModDate). Pointers are not compared, as an updated subscription may be
+*    allocated at the address of the one it replaces.
+* 4. Without the semaphore: flush the counters collected in step 3.3 to DB, with a bulk write
+*    per tenant (only for the subscriptions whose counters have changed since the previous sync)
+*
+* The subscriptions of a tenant whose DB queries fail (either getting the state or loading the
+* new/modified subscriptions) are not touched at all.
 *
 * NOTE
-*   This function runs in a separate thread and it allocates temporal objects (in savedSubV).
+*   This function runs in a separate thread and it allocates temporal objects.
 *   If the broker dies when this function is executing, all these temporal objects will be reported
 *   as memory leaks.
 *   We see this in our valgrind tests, where we force the broker to die.
 *   This is of course not a real leak, we only see this as a leak as the function hasn't finished to
-*   execute until the point where the temporal objects are deleted (See '6. Free the vector savedSubV').
+*   execute until the point where the temporal objects are deleted.
 *   To fix this little problem, we have created a variable 'subCacheState' that is set to ScsSynchronizing while
 *   the sub-cache synchronization is working.
 *   In serviceRoutines/exitTreat.cpp this variable is checked and if iot is set to ScsSynchronizing, then a
@@ -1171,123 +1563,204 @@ typedef struct CachedSubSaved
 */
 void subCacheSync(void)
 {
-  std::map<std::string, CachedSubSaved*> savedSubV;
+  std::map<std::string, int64_t>                         snapshot;        // key -> modDate of the cached sub at step 1
+  std::map<std::string, SubCacheDbState>                 dbState;         // key -> state in DB
+  std::map<std::string, std::string>                     dbTenant;        // key -> tenant
+  std::map<std::string, CachedSubscription*>             loaded;          // key -> sub loaded from DB at step 2
+  std::map<std::string, std::vector<SubCountersDelta> >  flushMap;        // tenant -> counters to flush at step 4
+  std::set<std::string>                                  failedTenants;
+  std::vector<std::string>                               databases;
+  int                                                    flushes = 0;
 
-  cacheSemTake(__FUNCTION__, "Synchronizing subscription cache");
   subCacheState = ScsSynchronizing;
 
 
   //
-  // 1. Save subscriptionId, lastNotificationTime, count, lastFailure, and lastSuccess for all items in cache
+  // 1. Snapshot of the cache
   //
-  CachedSubscription* cSubP = subCache.head;
-
-  while (cSubP != NULL)
-  {
-    //
-    // FIXME P7: For some reason, sometimes the same subscription is found twice in the cache (Issue 2216)
-    //           Once the issue 2216 is fixed, this if-block must be removed.
-    //
-    if (savedSubV[cSubP->subscriptionId] != NULL)
-    {
-      cSubP = cSubP->next;
-      continue;
-    }
-
-    CachedSubSaved* cssP       = new CachedSubSaved();
+  cacheSemTake(__FUNCTION__, "Synchronizing subscription cache (snapshot)");
 
-    cssP->lastNotificationTime = cSubP->lastNotificationTime;
-    cssP->count                = cSubP->count;
-    cssP->lastFailure          = cSubP->lastFailure;
-    cssP->lastSuccess          = cSubP->lastSuccess;
+  std::map<std::string, CachedSubscription*> cached;
 
-    savedSubV[cSubP->subscriptionId] = cssP;
-    cSubP = cSubP->next;
+  subCacheSyncLiveMap(&cached);
+  for (std::map<std::string, CachedSubscription*>::iterator it = cached.begin(); it != cached.end(); ++it)
+  {
+    snapshot[it->first] = it->second->modDate;
   }
 
-  LM_T(LmtCacheSync, ("Pushed back %d items to savedSubV", savedSubV.size()));
+  cacheSemGive(__FUNCTION__, "Synchronizing subscription cache (snapshot)");
 
-
-  //
-  // 2. Refresh cache (count set to 0)
-  //
-  subCacheRefresh();
+  LM_T(LmtCacheSync, ("%d subscriptions in snapshot", snapshot.size()));
 
 
   //
-  // 3. Compare lastNotificationTime/lastFailure/lastSuccess in savedSubV with the new cache-contents
+  // 2. State in DB and load of the new/modified subscriptions
   //
-  cSubP = subCache.head;
-  while (cSubP != NULL)
+  if (mongoMultitenant())
+  {
+    getOrionDatabases(&databases);
+  }
+  databases.push_back(getDbPrefix());
+
+  for (unsigned int ix = 0; ix < databases.size(); ++ix)
   {
-    CachedSubSaved* cssP = savedSubV[cSubP->subscriptionId];
+    std::string                       tenant = tenantFromDb(databases[ix]);
+    std::vector<SubCacheDbState>      stateV;
+    std::vector<std::string>          subIdV;
+    std::vector<CachedSubscription*>  cSubV;
 
-    if (cssP != NULL)
+    if (mongoSubCacheStateGet(databases[ix], &stateV) == false)
     {
-      if (cssP->lastNotificationTime <= cSubP->lastNotificationTime)
-      {
-        // cssP->lastNotificationTime is older than what's currently in DB => throw away
-        cssP->lastNotificationTime = 0;
-      }
+      failedTenants.insert(tenant);
+      continue;
+    }
 
-      if (cssP->lastFailure < cSubP->lastFailure)
-      {
-        // cssP->lastFailure is older than what's currently in DB => throw away
-        cssP->lastFailure = 0;
-      }
+    for (unsigned int sIx = 0; sIx < stateV.size(); ++sIx)
+    {
+      std::string                               key = subCacheSyncKey(tenant.c_str(), stateV[sIx].subscriptionId.c_str());
+      std::map<std::string, int64_t>::iterator  it  = snapshot.find(key);
 
-      if (cssP->lastSuccess < cSubP->lastSuccess)
+      dbState[key]  = stateV[sIx];
+      dbTenant[key] = tenant;
+
+      if ((it == snapshot.end()) || (it->second != stateV[sIx].modDate))
       {
-        // cssP->lastSuccess is older than what's currently in DB => throw away
-        cssP->lastSuccess = 0;
+        subIdV.push_back(stateV[sIx].subscriptionId);
       }
     }
 
-    cSubP = cSubP->next;
+    if (mongoSubCacheLoad(databases[ix], subIdV, &cSubV) == false)
+    {
+      failedTenants.insert(tenant);
+      continue;
+    }
+
+    for (unsigned int sIx = 0; sIx < cSubV.size(); ++sIx)
+    {
+      loaded[subCacheSyncKey(tenant.c_str(), cSubV[sIx]->subscriptionId)] = cSubV[sIx];
+    }
   }
 
 
   //
-  // 4. Update 'count' for each item in savedSubV where non-zero
-  // 5. Update 'lastNotificationTime/lastFailure/lastSuccess' for each item in savedSubV where non-zero
+  // 3. Apply the differences
   //
-  cSubP = subCache.head;
-  while (cSubP != NULL)
+  std::map<std::string, CachedSubscription*>  live;
+  int                                         removed  = 0;
+  int                                         replaced = 0;
+  int                                         inserted = 0;
+
+  cacheSemTake(__FUNCTION__, "Synchronizing subscription cache (apply)");
+
+  subCacheSyncLiveMap(&live);
+
+  // 3.1 Removed from DB (or modified in DB, but no longer valid for the cache)
+  for (std::map<std::string, int64_t>::iterator it = snapshot.begin(); it != snapshot.end(); ++it)
   {
-    CachedSubSaved* cssP = savedSubV[cSubP->subscriptionId];
+    std::string                                           tenant  = it->first.substr(0, it->first.find('|'));
+    std::map<std::string, SubCacheDbState>::iterator      stateIt = dbState.find(it->first);
+    std::map<std::string, CachedSubscription*>::iterator  liveIt  = live.find(it->first);
 
-    if (cssP != NULL)
+    if ((failedTenants.find(tenant) != failedTenants.end()) || (liveIt == live.end()) || (liveIt->second->modDate != it->second))
     {
-      std::string tenant = (cSubP->tenant == NULL)? "" : cSubP->tenant;
-
-      mongoSubCountersUpdate(tenant,
-                             cSubP->subscriptionId,
-                             cssP->count,
-                             cssP->lastNotificationTime,
-                             cssP->lastFailure,
-                             cssP->lastSuccess);
-
-      // Keeping lastFailure and lastSuccess in sub cache
-      cSubP->lastFailure = cssP->lastFailure;
-      cSubP->lastSuccess = cssP->lastSuccess;
+      continue;
     }
 
-    cSubP = cSubP->next;
+    bool goneFromDb  = (stateIt == dbState.end());
+    bool notLoadable = !goneFromDb && (it->second != stateIt->second.modDate) && (loaded.find(it->first) == loaded.end());
+
+    if (goneFromDb || notLoadable)
+    {
+      subCacheItemRemove(liveIt->second);
+      live.erase(it->first);
+      ++removed;
+    }
   }
 
+  // 3.2 Created/modified in DB
+  for (std::map<std::string, CachedSubscription*>::iterator it = loaded.begin(); it != loaded.end(); ++it)
+  {
+    std::map<std::string, CachedSubscription*>::iterator  liveIt     = live.find(it->first);
+    std::map<std::string, int64_t>::iterator              snapshotIt = snapshot.find(it->first);
+    CachedSubscription*                                   cSubP      = it->second;
+
+    if ((liveIt == live.end()) && (snapshotIt == snapshot.end()))
+    {
+      // New in DB
+      subCacheItemInsert(cSubP);
+      live[it->first] = cSubP;
+      ++inserted;
+    }
+    else if ((liveIt != live.end()) && (snapshotIt != snapshot.end()) && (liveIt->second->modDate == snapshotIt->second))
+    {
+      // Modified in DB - the new sub inherits the counters still to be flushed
+      CachedSubscription* oldP = liveIt->second;
+
+      cSubP->count                = oldP->count;
+      cSubP->lastNotificationTime = oldP->lastNotificationTime;
+      cSubP->lastFailure          = oldP->lastFailure;
+      cSubP->lastSuccess          = oldP->lastSuccess;
+
+      subCacheItemRemove(oldP);
+      subCacheItemInsert(cSubP);
+      live[it->first] = cSubP;
+      ++replaced;
+    }
+    else
+    {
+      // Inserted/updated/removed in the cache since the snapshot - the cache is more recent
+      subCacheItemDestroy(cSubP);
+      delete cSubP;
+    }
+  }
+
+  // 3.3 Counters
+  for (std::map<std::string, CachedSubscription*>::iterator it = live.begin(); it != live.end(); ++it)
+  {
+    std::map<std::string, SubCacheDbState>::iterator stateIt = dbState.find(it->first);
+
+    if (stateIt != dbState.end())
+    {
+      subCacheSyncCounters(it->second, stateIt->second, &flushMap[dbTenant[it->first]]);
+    }
+  }
+
+  ++subCache.noOfRefreshes;
+
+  cacheSemGive(__FUNCTION__, "Synchronizing subscription cache (apply)");
+
 
   //
-  // 6. Free the vector savedSubV
+  // 4. Flush the counters to DB
   //
-  for (std::map<std::string, CachedSubSaved*>::iterator it = savedSubV.begin(); it != savedSubV.end(); ++it)
+  struct timespec  flushStart;
+  struct timespec  flushEnd;
+  struct timespec  diff;
+
+  clock_gettime(CLOCK_REALTIME, &flushStart);
+
+  for (std::map<std::string, std::vector<SubCountersDelta> >::iterator it = flushMap.begin(); it != flushMap.end(); ++it)
   {
-    delete it->second;
+    if (it->second.size() > 0)
+    {
+      mongoSubCountersBulkUpdate(it->first, it->second);
+      flushes += it->second.size();
+    }
+  }
+
+  if ((timingStatistics) && (flushes > 0))
+  {
+    clock_gettime(CLOCK_REALTIME, &flushEnd);
+    clock_difftime(&flushEnd, &flushStart, &diff);
+    subCacheFlushTimeAdd(&diff);
   }
-  savedSubV.clear();
 
+  __sync_fetch_and_add(&noOfSubCacheFlushedDocs, flushes);
+
+  LM_T(LmtCacheSync, ("Synchronized subscription cache: %d inserted, %d replaced, %d removed, %d flushed",
+                      inserted, replaced, removed, flushes));
 
   subCacheState = ScsIdle;
-  cacheSemGive(__FUNCTION__, "Synchronizing subscription cache");
 }
 
 
@@ -67,16 +67,14 @@ struct EntityInfo
 {
   std::string   entityId;
   bool          isPattern;
-  regex_t       entityIdPattern;
-  bool          entityIdPatternToBeFreed;
+  regex_t*      entityIdPattern;     // From the regex cache, see common/regexCache.h
 
   std::string   entityType;
   bool          isTypePattern;
-  regex_t       entityTypePattern;
-  bool          entityTypePatternToBeFreed;
+  regex_t*      entityTypePattern;
 
 
-  EntityInfo() {}
+  EntityInfo(): isPattern(false), entityIdPattern(NULL), isTypePattern(false), entityTypePattern(NULL) {}
   EntityInfo(const std::string& _entityId, const std::string& _entityType, const std::string& _isPattern,
              bool _isTypePattern);
   ~EntityInfo() { release(); }
@@ -109,9 +107,11 @@ struct CachedSubscription
   RenderFormat                renderFormat;
   SubscriptionExpression      expression;
   bool                        blacklist;
+  int64_t                     coalesceMs;   // coalescing window of the notifications, 0 if none
   ngsiv2::HttpInfo            httpInfo;
   int64_t                     lastFailure;  // timestamp of last notification failure
   int64_t                     lastSuccess;  // timestamp of last successful notification
+  int64_t                     modDate;      // 'modDate' of the subscription in DB, 0 if unknown
   struct CachedSubscription*  next;
 };
 
@@ -221,7 +221,8 @@ extern void subCacheItemInsert
   const std::string&                 geometry,
   const std::string&                 coords,
   const std::string&                 georel,
-  bool                               blacklist
+  bool                               blacklist,
+  int64_t                            coalesceMs
 );
 
 
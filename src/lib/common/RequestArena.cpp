@@ -0,0 +1,274 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <stdlib.h>
+
+#include <new>
+#include <vector>
+
+#include "common/RequestArena.h"
+
+
+
+/* ****************************************************************************
+*
+* ARENA_ALIGN - alignment of the allocations (and size of the header before each object)
+*/
+#define ARENA_ALIGN  16
+
+
+
+/* ****************************************************************************
+*
+* ObjectHeader - the arena the object comes from, NULL if it comes from the heap
+*/
+typedef union ObjectHeader
+{
+  RequestArena*  arenaP;
+  char           pad[ARENA_ALIGN];
+} ObjectHeader;
+
+
+
+/* ****************************************************************************
+*
+* Global state -
+*/
+static bool                    arenaEnabled  = false;
+static __thread RequestArena*  threadArenaP  = NULL;
+static long long               arenaAllocs   = 0;
+static long long               heapAllocs    = 0;
+static long long               arenaCount    = 0;
+static long long               arenaPeakSize = 0;
+
+
+
+/* ****************************************************************************
+*
+* RequestArena::RequestArena -
+*/
+RequestArena::RequestArena(): current(NULL), left(0), used(0)
+{
+  __sync_fetch_and_add(&arenaCount, 1);
+}
+
+
+
+/* ****************************************************************************
+*
+* RequestArena::~RequestArena -
+*/
+RequestArena::~RequestArena()
+{
+  long long peak = arenaPeakSize;
+
+  while (((long long) used > peak) && !__sync_bool_compare_and_swap(&arenaPeakSize, peak, (long long) used))
+  {
+    peak = arenaPeakSize;
+  }
+
+  for (unsigned int ix = 0; ix < blockV.size(); ++ix)
+  {
+    free(blockV[ix]);
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* RequestArena::alloc -
+*/
+void* RequestArena::alloc(size_t size)
+{
+  size = (size + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1);
+
+  if (size > REQUEST_ARENA_BLOCK_SIZE / 4)
+  {
+    char* bigP = (char*) malloc(size);
+
+    if (bigP == NULL)
+    {
+      throw std::bad_alloc();
+    }
+
+    blockV.push_back(bigP);
+    used += size;
+    return bigP;
+  }
+
+  if (size > left)
+  {
+    if ((current = (char*) malloc(REQUEST_ARENA_BLOCK_SIZE)) == NULL)
+    {
+      throw std::bad_alloc();
+    }
+
+    blockV.push_back(current);
+    left = REQUEST_ARENA_BLOCK_SIZE;
+  }
+
+  void* p = current;
+
+  current += size;
+  left    -= size;
+  used    += size;
+
+  return p;
+}
+
+
+
+/* ****************************************************************************
+*
+* requestArenaInit -
+*/
+void requestArenaInit(bool enabled)
+{
+  arenaEnabled = enabled;
+}
+
+
+
+/* ****************************************************************************
+*
+* requestArenaEnabled -
+*/
+bool requestArenaEnabled(void)
+{
+  return arenaEnabled;
+}
+
+
+
+/* ****************************************************************************
+*
+* requestArenaSet -
+*/
+void requestArenaSet(RequestArena* arenaP)
+{
+  threadArenaP = arenaP;
+}
+
+
+
+/* ****************************************************************************
+*
+* requestArenaGet -
+*/
+RequestArena* requestArenaGet(void)
+{
+  return threadArenaP;
+}
+
+
+
+/* ****************************************************************************
+*
+* requestArenaObjectNew -
+*/
+void* requestArenaObjectNew(size_t size)
+{
+  ObjectHeader* headerP;
+
+  if (threadArenaP != NULL)
+  {
+    headerP = (ObjectHeader*) threadArenaP->alloc(sizeof(ObjectHeader) + size);
+    __sync_fetch_and_add(&arenaAllocs, 1);
+  }
+  else
+  {
+    if ((headerP = (ObjectHeader*) malloc(sizeof(ObjectHeader) + size)) == NULL)
+    {
+      throw std::bad_alloc();
+    }
+    __sync_fetch_and_add(&heapAllocs, 1);
+  }
+
+  headerP->arenaP = threadArenaP;
+
+  return headerP + 1;
+}
+
+
+
+/* ****************************************************************************
+*
+* requestArenaObjectDelete -
+*
+* Memory of an arena is freed with the arena itself.
+*/
+void requestArenaObjectDelete(void* p)
+{
+  if (p == NULL)
+  {
+    return;
+  }
+
+  ObjectHeader* headerP = ((ObjectHeader*) p) - 1;
+
+  if (headerP->arenaP == NULL)
+  {
+    free(headerP);
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* requestArenaObjectInArena -
+*/
+bool requestArenaObjectInArena(const void* p)
+{
+  return (((const ObjectHeader*) p) - 1)->arenaP != NULL;
+}
+
+
+
+/* ****************************************************************************
+*
+* requestArenaStatisticsGet -
+*/
+void requestArenaStatisticsGet(long long* arenaAllocsP, long long* heapAllocsP, long long* arenasP, long long* peakSizeP)
+{
+  *arenaAllocsP = __sync_fetch_and_add(&arenaAllocs, 0);
+  *heapAllocsP  = __sync_fetch_and_add(&heapAllocs, 0);
+  *arenasP      = __sync_fetch_and_add(&arenaCount, 0);
+  *peakSizeP    = __sync_fetch_and_add(&arenaPeakSize, 0);
+}
+
+
+
+/* ****************************************************************************
+*
+* requestArenaStatisticsReset -
+*/
+void requestArenaStatisticsReset(void)
+{
+  __sync_lock_test_and_set(&arenaAllocs,   0);
+  __sync_lock_test_and_set(&heapAllocs,    0);
+  __sync_lock_test_and_set(&arenaCount,    0);
+  __sync_lock_test_and_set(&arenaPeakSize, 0);
+}
@@ -0,0 +1,172 @@
+#ifndef SRC_LIB_COMMON_REQUESTARENA_H_
+#define SRC_LIB_COMMON_REQUESTARENA_H_
+
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <stddef.h>
+
+#include <vector>
+
+
+
+/* ****************************************************************************
+*
+* REQUEST_ARENA_BLOCK_SIZE - size of the memory blocks of an arena
+*
+* Allocations bigger than a quarter of the block get a block of their own.
+*/
+#define REQUEST_ARENA_BLOCK_SIZE  (16 * 1024)
+
+
+
+/* ****************************************************************************
+*
+* RequestArena -
+*
+* Memory of a request, owned by its ConnectionInfo, from which the objects of the NGSI
+* trees built while serving the request (see REQUEST_ARENA_ALLOCATED) are allocated.
+* Deleting such an object runs its destructor but gives no memory back: all of it is
+* freed at once when the arena is destroyed, at the end of the request.
+*
+* An arena is used by one thread at a time (the one serving the request), so it has
+* no lock.
+*/
+class RequestArena
+{
+ public:
+  RequestArena();
+  ~RequestArena();
+
+  void*    alloc(size_t size);
+  size_t   size(void) const  { return used; }
+
+ private:
+  std::vector<char*>  blockV;
+  char*               current;
+  size_t              left;
+  size_t              used;
+
+  RequestArena(const RequestArena&);
+  RequestArena& operator=(const RequestArena&);
+};
+
+
+
+/* ****************************************************************************
+*
+* requestArenaInit -
+*/
+extern void requestArenaInit(bool enabled);
+
+
+
+/* ****************************************************************************
+*
+* requestArenaEnabled -
+*/
+extern bool requestArenaEnabled(void);
+
+
+
+/* ****************************************************************************
+*
+* requestArenaSet -
+*
+* Sets the arena the REQUEST_ARENA_ALLOCATED objects created by the calling thread are
+* allocated from. NULL (no arena) for the regular heap.
+*/
+extern void requestArenaSet(RequestArena* arenaP);
+
+
+
+/* ****************************************************************************
+*
+* requestArenaGet - the arena of the calling thread, NULL if none
+*/
+extern RequestArena* requestArenaGet(void);
+
+
+
+/* ****************************************************************************
+*
+* requestArenaObjectNew -
+*
+* Allocates from the arena of the thread, if any, or from the heap otherwise. In both
+* cases the memory is preceded by a header telling where it comes from, so
+* requestArenaObjectDelete knows what to do with it, whatever the thread.
+*/
+extern void* requestArenaObjectNew(size_t size);
+
+
+
+/* ****************************************************************************
+*
+* requestArenaObjectDelete -
+*/
+extern void requestArenaObjectDelete(void* p);
+
+
+
+/* ****************************************************************************
+*
+* requestArenaObjectInArena -
+*
+* True if the object was allocated from an arena (and so its memory lasts what the
+* arena does), false if it comes from the heap.
+*/
+extern bool requestArenaObjectInArena(const void* p);
+
+
+
+/* ****************************************************************************
+*
+* requestArenaStatisticsGet -
+*
+* Number of objects allocated from arenas and from the heap, number of arenas and size
+* in bytes of the biggest arena.
+*/
+extern void requestArenaStatisticsGet(long long* arenaAllocsP, long long* heapAllocsP, long long* arenasP, long long* peakSizeP);
+
+
+
+/* ****************************************************************************
+*
+* requestArenaStatisticsReset -
+*/
+extern void requestArenaStatisticsReset(void);
+
+
+
+/* ****************************************************************************
+*
+* REQUEST_ARENA_ALLOCATED - class-specific new/delete for the objects of the per-request NGSI trees
+*
+* To be used in the declaration of the class (it is public).
+*/
+#define REQUEST_ARENA_ALLOCATED                                                  \
+  static void* operator new(size_t size)  { return requestArenaObjectNew(size); } \
+  static void  operator delete(void* p)   { requestArenaObjectDelete(p);        }
+
+#endif  // SRC_LIB_COMMON_REQUESTARENA_H_
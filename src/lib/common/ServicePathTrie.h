@@ -0,0 +1,337 @@
+#ifndef SRC_LIB_COMMON_SERVICEPATHTRIE_H_
+#define SRC_LIB_COMMON_SERVICEPATHTRIE_H_
+
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <string>
+#include <vector>
+#include <map>
+
+
+
+/* ****************************************************************************
+*
+* template class ServicePathTrie<> -
+*
+* Entries (of type Entry) indexed by service path, in a trie with one node per path
+* component. Each node keeps two entries: the one of its own service path ("/a/b") and the
+* one of its wildcard service path ("/a/b/#"). The root node is "/" (and "/#") and the empty
+* service path ("") has an entry of its own, outside the trie.
+*
+* The full service path of every node is kept in the node (interned), so it is allocated
+* once no matter how many subscriptions/queries use it.
+*
+* match() resolves all the entries whose (possibly wildcard) service path matches a given
+* service path by walking the trie once, from the root to the node of the service path:
+* the wildcard entries of all the nodes in the way, plus the own entry of the last one.
+*
+* Service paths are supposed to be valid (already checked by the caller), i.e. absolute,
+* without empty components and with '#' only as last component.
+*
+* Not thread safe, the caller must protect it.
+*
+* There are two independent kinds of tries: the per-tenant subscription index of the
+* subscription cache (protected by the cache semaphore, nodes removed along with the
+* subscriptions) and the cache of DB service path queries in MongoGlobal.cpp (tenant
+* independent, with a mutex of its own, bounded and never shrinking).
+*/
+template <typename Entry>
+class ServicePathTrie
+{
+public:
+  struct Node
+  {
+    std::string                   path;       // full service path of the node, without "/#"
+    Entry                         exact;      // entry of "path"
+    Entry                         wildcard;   // entry of "path/#"
+    Node*                         parentP;
+    std::map<std::string, Node*>  children;   // by path component
+  };
+
+private:
+  Entry         empty;
+  Node          root;
+  unsigned int  nodes;
+
+  ServicePathTrie(const ServicePathTrie&);
+  ServicePathTrie& operator=(const ServicePathTrie&);
+
+  Node*  nodeGet(const std::string& servicePath, bool create, bool* wildcardP);
+  void   nodeFree(Node* nodeP);
+  void   allEntries(Node* nodeP, std::vector<Entry*>* entryV);
+
+public:
+  ServicePathTrie();
+  ~ServicePathTrie();
+
+  Entry*        entryGet(const std::string& servicePath, bool create);
+  void          match(const std::string& servicePath, std::vector<Entry*>* entryV);
+  void          prune(const std::string& servicePath, bool (*isEmpty)(const Entry& entry));
+  unsigned int  size(void) const { return nodes; }
+};
+
+
+
+/* ****************************************************************************
+*
+* ServicePathTrie<Entry>::ServicePathTrie -
+*/
+template <typename Entry>
+ServicePathTrie<Entry>::ServicePathTrie(): empty(), nodes(1)
+{
+  root.path    = "/";
+  root.parentP = NULL;
+}
+
+
+
+/* ****************************************************************************
+*
+* ServicePathTrie<Entry>::~ServicePathTrie -
+*/
+template <typename Entry>
+ServicePathTrie<Entry>::~ServicePathTrie()
+{
+  for (typename std::map<std::string, Node*>::iterator it = root.children.begin(); it != root.children.end(); ++it)
+  {
+    nodeFree(it->second);
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* ServicePathTrie<Entry>::nodeFree -
+*/
+template <typename Entry>
+void ServicePathTrie<Entry>::nodeFree(Node* nodeP)
+{
+  for (typename std::map<std::string, Node*>::iterator it = nodeP->children.begin(); it != nodeP->children.end(); ++it)
+  {
+    nodeFree(it->second);
+  }
+
+  delete nodeP;
+}
+
+
+
+/* ****************************************************************************
+*
+* ServicePathTrie<Entry>::nodeGet -
+*
+* Returns the node of the service path ("/a/b" and "/a/b/#" are the same node, '*wildcardP'
+* tells which one it was), creating the missing nodes if 'create' is true. NULL if the node
+* doesn't exist (and 'create' is false) or for the empty service path.
+*/
+template <typename Entry>
+typename ServicePathTrie<Entry>::Node* ServicePathTrie<Entry>::nodeGet
+(
+  const std::string&  servicePath,
+  bool                create,
+  bool*               wildcardP
+)
+{
+  Node*   nodeP = &root;
+  size_t  start = 1;
+  size_t  end   = servicePath.size();
+
+  *wildcardP = false;
+
+  if (servicePath.empty())
+  {
+    return NULL;
+  }
+
+  if ((end >= 2) && (servicePath[end - 1] == '#') && (servicePath[end - 2] == '/'))
+  {
+    *wildcardP = true;
+    end       -= 2;
+  }
+
+  while (start < end)
+  {
+    size_t       slash     = servicePath.find('/', start);
+    size_t       compEnd   = ((slash == std::string::npos) || (slash > end))? end : slash;
+    std::string  component = servicePath.substr(start, compEnd - start);
+
+    typename std::map<std::string, Node*>::iterator it = nodeP->children.find(component);
+
+    if (it != nodeP->children.end())
+    {
+      nodeP = it->second;
+    }
+    else if (create)
+    {
+      Node* childP = new Node();
+
+      childP->path    = servicePath.substr(0, compEnd);
+      childP->parentP = nodeP;
+
+      nodeP->children[component] = childP;
+      nodeP = childP;
+      ++nodes;
+    }
+    else
+    {
+      return NULL;
+    }
+
+    start = compEnd + 1;
+  }
+
+  return nodeP;
+}
+
+
+
+/* ****************************************************************************
+*
+* ServicePathTrie<Entry>::entryGet - entry of a (possibly wildcard) service path
+*/
+template <typename Entry>
+Entry* ServicePathTrie<Entry>::entryGet(const std::string& servicePath, bool create)
+{
+  bool   wildcard;
+  Node*  nodeP;
+
+  if (servicePath.empty())
+  {
+    return &empty;
+  }
+
+  if ((nodeP = nodeGet(servicePath, create, &wildcard)) == NULL)
+  {
+    return NULL;
+  }
+
+  return wildcard? &nodeP->wildcard : &nodeP->exact;
+}
+
+
+
+/* ****************************************************************************
+*
+* ServicePathTrie<Entry>::allEntries -
+*/
+template <typename Entry>
+void ServicePathTrie<Entry>::allEntries(Node* nodeP, std::vector<Entry*>* entryV)
+{
+  entryV->push_back(&nodeP->exact);
+  entryV->push_back(&nodeP->wildcard);
+
+  for (typename std::map<std::string, Node*>::iterator it = nodeP->children.begin(); it != nodeP->children.end(); ++it)
+  {
+    allEntries(it->second, entryV);
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* ServicePathTrie<Entry>::match -
+*
+* Entries matching the service path:
+*   - "/a/b": "/#", "/a/#", "/a/b/#" and "/a/b"
+*   - "/#":   all the entries
+*   - "":     "", "/" and "/#" (no service path is the same as the default one)
+*/
+template <typename Entry>
+void ServicePathTrie<Entry>::match(const std::string& servicePath, std::vector<Entry*>* entryV)
+{
+  if (servicePath == "/#")
+  {
+    entryV->push_back(&empty);
+    allEntries(&root, entryV);
+    return;
+  }
+
+  if (servicePath.empty())
+  {
+    entryV->push_back(&empty);
+  }
+
+  Node*   nodeP = &root;
+  size_t  start = 1;
+  size_t  end   = servicePath.size();
+
+  entryV->push_back(&root.wildcard);
+
+  while (start < end)
+  {
+    size_t  slash   = servicePath.find('/', start);
+    size_t  compEnd = (slash == std::string::npos)? end : slash;
+
+    typename std::map<std::string, Node*>::iterator it = nodeP->children.find(servicePath.substr(start, compEnd - start));
+
+    if (it == nodeP->children.end())
+    {
+      return;
+    }
+
+    nodeP = it->second;
+    entryV->push_back(&nodeP->wildcard);
+
+    start = compEnd + 1;
+  }
+
+  entryV->push_back(&nodeP->exact);
+}
+
+
+
+/* ****************************************************************************
+*
+* ServicePathTrie<Entry>::prune -
+*
+* Remove the node of the service path, and then its ancestors, while they are left with
+* empty entries (according to 'isEmpty') and without children.
+*/
+template <typename Entry>
+void ServicePathTrie<Entry>::prune(const std::string& servicePath, bool (*isEmpty)(const Entry& entry))
+{
+  bool   wildcard;
+  Node*  nodeP = nodeGet(servicePath, false, &wildcard);
+
+  while ((nodeP != NULL) && (nodeP != &root))
+  {
+    if ((nodeP->children.size() != 0) || !isEmpty(nodeP->exact) || !isEmpty(nodeP->wildcard))
+    {
+      return;
+    }
+
+    Node* parentP = nodeP->parentP;
+
+    parentP->children.erase(nodeP->path.substr(parentP->path.size() + ((parentP == &root)? 0 : 1)));
+    delete nodeP;
+    --nodes;
+
+    nodeP = parentP;
+  }
+}
+
+#endif  // SRC_LIB_COMMON_SERVICEPATHTRIE_H_
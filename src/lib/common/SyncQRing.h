@@ -0,0 +1,292 @@
+#ifndef SRC_LIB_COMMON_SYNCQRING_H_
+#define SRC_LIB_COMMON_SYNCQRING_H_
+
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <stddef.h>
+#include <sched.h>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+
+
+/* ****************************************************************************
+*
+* SYNCQ_CACHE_LINE - size used to keep the hot counters in different cache lines
+*/
+#define SYNCQ_CACHE_LINE 64
+
+
+
+/* ****************************************************************************
+*
+* SYNCQ_POP_SPINS - number of failed attempts before a consumer goes to sleep
+*
+* The consumer yields the CPU between attempts, so the producers can make progress even
+* if there are more threads than cores.
+*/
+#define SYNCQ_POP_SPINS 64
+
+
+
+/* ****************************************************************************
+*
+* template class SyncQRing<>-
+*
+* Bounded multi-producer/multi-consumer queue, with the same contract as SyncQOverflow:
+* try_push() never blocks and fails if the queue is full, pop() blocks until there
+* is an element. try_pop() is the non-blocking version of pop(), for consumers that
+* have other things to do while the queue is empty.
+*
+* It is a ring of cells, each one with a sequence number telling whether the cell is
+* ready to be written or read in the current lap (D. Vyukov's bounded MPMC queue), so
+* producers and consumers only compete on a compare-and-swap of the enqueue/dequeue
+* positions, that are kept in different cache lines.
+*
+* The only lock is the one used by consumers to sleep when the queue is empty. Producers
+* only take it when some consumer is sleeping.
+*/
+template <typename Data>
+class SyncQRing
+{
+private:
+  struct Cell
+  {
+    volatile size_t  sequence;
+    Data             data;
+  };
+
+  char                       pad0[SYNCQ_CACHE_LINE];
+  volatile size_t            enqueuePos;
+  char                       pad1[SYNCQ_CACHE_LINE - sizeof(size_t)];
+  volatile size_t            dequeuePos;
+  char                       pad2[SYNCQ_CACHE_LINE - sizeof(size_t)];
+  volatile int               sleepers;
+  char                       pad3[SYNCQ_CACHE_LINE - sizeof(int)];
+
+  Cell*                      ring;
+  size_t                     max_size;
+  boost::mutex               mtx;
+  boost::condition_variable  addedElement;
+
+  SyncQRing(const SyncQRing&);
+  SyncQRing& operator=(const SyncQRing&);
+
+public:
+  explicit SyncQRing(size_t sz);
+  ~SyncQRing();
+  bool try_push(Data element);
+  bool try_pop(Data* elementP);
+  Data pop();
+  size_t size() const;
+};
+
+
+
+/* ****************************************************************************
+*
+* SyncQRing<Data>::SyncQRing -
+*/
+template <typename Data>
+SyncQRing<Data>::SyncQRing(size_t sz): enqueuePos(0), dequeuePos(0), sleepers(0), max_size(sz)
+{
+  ring = new Cell[max_size];
+
+  for (size_t ix = 0; ix < max_size; ++ix)
+  {
+    ring[ix].sequence = ix;
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* SyncQRing<Data>::~SyncQRing -
+*/
+template <typename Data>
+SyncQRing<Data>::~SyncQRing()
+{
+  delete[] ring;
+}
+
+
+
+/* ****************************************************************************
+*
+* SyncQRing<Data>::try_push -
+*
+* The cell for position 'pos' is free for this lap when its sequence is 'pos'. If it
+* is behind, the cell still holds an element of the previous lap, i.e. the queue is full.
+*/
+template <typename Data>
+bool SyncQRing<Data>::try_push(Data element)
+{
+  Cell*   cellP;
+  size_t  pos = enqueuePos;
+
+  for (;;)
+  {
+    cellP = &ring[pos % max_size];
+
+    long dif = (long) cellP->sequence - (long) pos;
+
+    if (dif == 0)
+    {
+      if (__sync_bool_compare_and_swap(&enqueuePos, pos, pos + 1))
+      {
+        break;
+      }
+      pos = enqueuePos;
+    }
+    else if (dif < 0)
+    {
+      return false;
+    }
+    else
+    {
+      pos = enqueuePos;
+    }
+  }
+
+  cellP->data = element;
+  __sync_synchronize();
+  cellP->sequence = pos + 1;
+
+  // The atomic read of 'sleepers' is a full barrier (as is the increment done by consumers
+  // before their last attempt), so either a consumer going to sleep sees the new element
+  // or we see the consumer in 'sleepers'
+  if (__sync_fetch_and_add(&sleepers, 0) > 0)
+  {
+    boost::mutex::scoped_lock lock(mtx);
+    addedElement.notify_one();
+  }
+
+  return true;
+}
+
+
+
+/* ****************************************************************************
+*
+* SyncQRing<Data>::try_pop -
+*
+* The cell for position 'pos' holds an element of this lap when its sequence is 'pos + 1'.
+*/
+template <typename Data>
+bool SyncQRing<Data>::try_pop(Data* elementP)
+{
+  Cell*   cellP;
+  size_t  pos = dequeuePos;
+
+  for (;;)
+  {
+    cellP = &ring[pos % max_size];
+
+    long dif = (long) cellP->sequence - (long) (pos + 1);
+
+    if (dif == 0)
+    {
+      if (__sync_bool_compare_and_swap(&dequeuePos, pos, pos + 1))
+      {
+        break;
+      }
+      pos = dequeuePos;
+    }
+    else if (dif < 0)
+    {
+      return false;
+    }
+    else
+    {
+      pos = dequeuePos;
+    }
+  }
+
+  *elementP = cellP->data;
+  __sync_synchronize();
+  cellP->sequence = pos + max_size;
+
+  return true;
+}
+
+
+
+/* ****************************************************************************
+*
+* SyncQRing<Data>::pop -
+*/
+template <typename Data>
+Data SyncQRing<Data>::pop()
+{
+  Data element;
+
+  for (int spin = 0; spin < SYNCQ_POP_SPINS; ++spin)
+  {
+    if (try_pop(&element))
+    {
+      return element;
+    }
+
+    sched_yield();
+  }
+
+  boost::mutex::scoped_lock lock(mtx);
+
+  __sync_fetch_and_add(&sleepers, 1);
+  while (!try_pop(&element))
+  {
+    addedElement.wait(lock);
+  }
+  __sync_fetch_and_sub(&sleepers, 1);
+
+  return element;
+}
+
+
+
+/* ****************************************************************************
+*
+* SyncQRing<Data>::size -
+*
+* Approximate, as producers and consumers may be moving the positions while they are read.
+* It never takes a lock.
+*/
+template <typename Data>
+size_t SyncQRing<Data>::size() const
+{
+  size_t  dequeued = dequeuePos;
+  size_t  enqueued = enqueuePos;
+
+  if (enqueued <= dequeued)
+  {
+    return 0;
+  }
+
+  return ((enqueued - dequeued) > max_size)? max_size : (enqueued - dequeued);
+}
+
+#endif  // SRC_LIB_COMMON_SYNCQRING_H_
@@ -54,6 +54,9 @@ bool                   countersStatistics   = false;
 bool                   semWaitStatistics    = false;
 bool                   timingStatistics     = false;
 bool                   notifQueueStatistics = false;
+bool                   httpPoolStatistics   = false;
+bool                   regexCacheStatistics = false;
+bool                   reqArenaStatistics   = false;
 bool                   checkIdv1            = false;
 
 
@@ -150,6 +153,9 @@ void orionInit
   bool               _semWaitStatistics,
   bool               _timingStatistics,
   bool               _notifQueueStatistics,
+  bool               _httpPoolStatistics,
+  bool               _regexCacheStatistics,
+  bool               _reqArenaStatistics,
   bool               _checkIdv1
 )
 {
@@ -180,6 +186,9 @@ void orionInit
   countersStatistics   = _countersStatistics;
   timingStatistics     = _timingStatistics;
   notifQueueStatistics = _notifQueueStatistics;
+  httpPoolStatistics   = _httpPoolStatistics;
+  regexCacheStatistics = _regexCacheStatistics;
+  reqArenaStatistics   = _reqArenaStatistics;
 
   strncpy(transactionId, "N/A", sizeof(transactionId));
 
@@ -127,6 +127,7 @@
 #define OPT_DATE_CREATED    DATE_CREATED
 #define OPT_DATE_MODIFIED   DATE_MODIFIED
 #define OPT_NO_ATTR_DETAIL  "noAttrDetail"
+#define OPT_CURSOR          "cursor"
 
  
 /* ****************************************************************************
@@ -207,6 +208,8 @@ extern int                startTime;
 extern int                statisticsTime;
 extern OrionExitFunction  orionExitFunction;
 extern unsigned           cprForwardLimit;
+extern long               cprForwardDeadline;
+extern bool               noCreateFastPath;
 extern char               notificationMode[];
 extern bool               noCache;
 extern bool               simulatedNotification;
@@ -215,6 +218,9 @@ extern bool               semWaitStatistics;
 extern bool               timingStatistics;
 extern bool               countersStatistics;
 extern bool               notifQueueStatistics;
+extern bool               httpPoolStatistics;
+extern bool               regexCacheStatistics;
+extern bool               reqArenaStatistics;
 
 extern bool               checkIdv1;
 extern bool               disableCusNotif;
@@ -236,6 +242,9 @@ extern void orionInit
   bool               _semWaitStatistics,
   bool               _timingStatistics,
   bool               _notifQueueStatistics,
+  bool               _httpPoolStatistics,
+  bool               _regexCacheStatistics,
+  bool               _reqArenaStatistics,
   bool               _checkIdv1
 );
 
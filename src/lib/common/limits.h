@@ -59,6 +59,18 @@
 
 
 
+/* ****************************************************************************
+*
+* SERVICE_PATH_QUERIES_MAX_NODES -
+*
+* Max number of service paths (nodes of the trie) for which the DB queries are built once
+* and kept (see servicePathQueryGet in MongoGlobal.cpp). Service paths come from the clients,
+* so the number of them is bounded. Queries for other service paths are built every time.
+*/
+#define SERVICE_PATH_QUERIES_MAX_NODES    10000
+
+
+
 /* ****************************************************************************
 *
 * Others -
@@ -132,6 +144,19 @@
 
 
 
+/* ****************************************************************************
+*
+* Streamed responses -
+*
+* STREAM_RESPONSE_MIN_ENTITIES - entity lists with at least this number of entities are
+*                                streamed instead of rendered in a single string
+* STREAM_RESPONSE_BLOCK_SIZE   - size of the blocks in which a streamed response is sent
+*/
+#define STREAM_RESPONSE_MIN_ENTITIES  100
+#define STREAM_RESPONSE_BLOCK_SIZE    (32 * 1024)  // 32 KB
+
+
+
 /* ****************************************************************************
 *
 * HTTP header maximum lengths
@@ -211,6 +236,14 @@
 
 
 
+/* ****************************************************************************
+*
+* COALESCE_MAX_MS - max value of the coalescing window of a subscription (notification.coalesceMs)
+*/
+#define COALESCE_MAX_MS  60000
+
+
+
 /* ****************************************************************************
 *
 * Precision constants -
@@ -23,6 +23,7 @@
 * Author: Ken Zangelin
 */
 #include <string>
+#include <vector>
 
 #include "logMsg/logMsg.h"
 #include "ngsi/ContextElement.h"
@@ -36,211 +37,284 @@
 *
 * attributeValue - return value of attribute as a string
 */
-static void attributeValue(std::string* valueP, const std::vector<ContextAttribute*>& vec, const char* attrName)
+static void attributeValue(std::string* valueP, const ContextAttribute* caP)
 {
-  for (unsigned int ix = 0; ix < vec.size(); ++ix)
+  if (caP->valueType == orion::ValueTypeString)
   {
-    if (vec[ix]->name != attrName)
-    {
-      continue;
-    }
-
-    if (vec[ix]->valueType == orion::ValueTypeString)
-    {
-      *valueP = vec[ix]->stringValue;
-    }
-    else if (vec[ix]->valueType == orion::ValueTypeNumber)
-    {
-      *valueP = toString(vec[ix]->numberValue);
-    }
-    else if (vec[ix]->valueType == orion::ValueTypeBoolean)
-    {
-      *valueP = (vec[ix]->boolValue == true)? "true" : "false";
-    }
-    else if (vec[ix]->valueType == orion::ValueTypeNone)
-    {
-      *valueP = "null";
-    }
-    else if ((vec[ix]->valueType == orion::ValueTypeObject) || (vec[ix]->valueType == orion::ValueTypeVector))
+    *valueP = caP->stringValue;
+  }
+  else if (caP->valueType == orion::ValueTypeNumber)
+  {
+    *valueP = toString(caP->numberValue);
+  }
+  else if (caP->valueType == orion::ValueTypeBoolean)
+  {
+    *valueP = (caP->boolValue == true)? "true" : "false";
+  }
+  else if (caP->valueType == orion::ValueTypeNone)
+  {
+    *valueP = "null";
+  }
+  else if ((caP->valueType == orion::ValueTypeObject) || (caP->valueType == orion::ValueTypeVector))
+  {
+    if (caP->compoundValueP)
     {
-      if (vec[ix]->compoundValueP)
+      if (caP->compoundValueP->valueType == orion::ValueTypeVector)
+      {
+        *valueP = "[" + caP->compoundValueP->toJson(true) + "]";
+      }
+      else if (caP->compoundValueP->valueType == orion::ValueTypeObject)
       {
-        if (vec[ix]->compoundValueP->valueType == orion::ValueTypeVector)
-        {
-          *valueP = "[" + vec[ix]->compoundValueP->toJson(true) + "]";
-        }
-        else if (vec[ix]->compoundValueP->valueType == orion::ValueTypeObject)
-        {
-          *valueP = "{" + vec[ix]->compoundValueP->toJson(true) + "}";
-        }
-        else
-        {
-          LM_E(("Runtime Error (attribute is of object type but its compound is of invalid type)"));
-          *valueP = "";
-        }
+        *valueP = "{" + caP->compoundValueP->toJson(true) + "}";
       }
       else
       {
-        LM_E(("Runtime Error (attribute is of object type but has no compound)"));
+        LM_E(("Runtime Error (attribute is of object type but its compound is of invalid type)"));
         *valueP = "";
       }
     }
     else
     {
-      LM_E(("Runtime Error (unknown value type for attribute)"));
+      LM_E(("Runtime Error (attribute is of object type but has no compound)"));
       *valueP = "";
     }
+  }
+  else
+  {
+    LM_E(("Runtime Error (unknown value type for attribute)"));
+    *valueP = "";
+  }
+}
 
-    return;
+
+
+/* ****************************************************************************
+*
+* attributeLookup - first attribute with the given name, NULL if not found
+*/
+static const ContextAttribute* attributeLookup(const std::vector<ContextAttribute*>& vec, const std::string& attrName)
+{
+  for (unsigned int ix = 0; ix < vec.size(); ++ix)
+  {
+    if (vec[ix]->name == attrName)
+    {
+      return vec[ix];
+    }
   }
 
-  *valueP = "";
+  return NULL;
 }
 
 
 
 /* ****************************************************************************
 *
-* macroSubstitute - 
+* MacroTemplate::MacroTemplate -
+*/
+MacroTemplate::MacroTemplate(): size(0), valid(true)
+{
+}
+
+
+
+/* ****************************************************************************
 *
-* An old version of this function was based in char processing. However, we faced
-* weird crashing problems after fixing that implementation to support >1KB payloads.
+* MacroTemplate::MacroTemplate -
+*/
+MacroTemplate::MacroTemplate(const std::string& in): size(0), valid(true)
+{
+  compile(in);
+}
+
+
+
+/* ****************************************************************************
 *
-* We didn't know the actual cause of these problems but after changing the implementation
-* to the current one based on std::string, it seems stable. The most probable causes
-* of the problem were:
+* MacroTemplate::compile -
 *
-* 1) The old macroSubstitute() function had some bug managing memory which we weren't able
-*    to find.
-* 2) The old macroSubstitute() function was ok, but the way it managed the memory was in a way
-*    it makes more probable some memory corruption bug in other place, compared with the current
-*    implementation. If this theory is correct, we haven't been able to "raise" the memory corruption
-*    bug with the current implementation.
+* The macro syntax is the one of the old string based implementation: a macro starts
+* with '${' and ends with the first '}' after it, its name being what is in between.
+* Strings bigger than MAX_DYN_MSG_SIZE are not even scanned, as expand() rejects them.
+*/
+void MacroTemplate::compile(const std::string& in)
+{
+  size_t  literalStart = 0;
+  size_t  macroStart;
+
+  segmentV.clear();
+  size  = in.size();
+  valid = true;
+
+  if (size > MAX_DYN_MSG_SIZE)
+  {
+    return;
+  }
+
+  macroStart = in.find("${", 0);
+
+  while (macroStart != std::string::npos)
+  {
+    size_t macroEnd = in.find('}', macroStart);
+
+    if (macroEnd == std::string::npos)
+    {
+      segmentV.clear();
+      valid = false;
+      return;
+    }
+
+    if (macroStart > literalStart)
+    {
+      segmentV.push_back(MacroSegment());
+      segmentV.back().type = MacroLiteral;
+      segmentV.back().text.assign(in, literalStart, macroStart - literalStart);
+    }
+
+    segmentV.push_back(MacroSegment());
+
+    MacroSegment& macro = segmentV.back();
+
+    macro.text.assign(in, macroStart + 2, macroEnd - (macroStart + 2));
+    macro.type = (macro.text == "id")? MacroId : ((macro.text == "type")? MacroType : MacroAttr);
+
+    literalStart = macroEnd + 1;
+    macroStart   = in.find("${", literalStart);
+  }
+
+  if (literalStart < in.size())
+  {
+    segmentV.push_back(MacroSegment());
+    segmentV.back().type = MacroLiteral;
+    segmentV.back().text.assign(in, literalStart, std::string::npos);
+  }
+}
+
+
+
+/* ****************************************************************************
 *
-* However, the old version is still available at git repository, for the records.
-* It can be found checking out the following commit (the last one before chaning implementation):
+* MacroTemplate::expand -
 *
-*   commit f8c91bf16e192388824c3786a76b203b83354d13
-*   Date:   Mon Jun 19 16:33:29 2017 +0200
+* The value of each segment is resolved first (pointing to the strings in the context
+* element whenever possible, so only non-string attribute values are rendered), which gives
+* the final size before writing anything. Then the result is written in a single pass into
+* a buffer reserved with that size.
 *
+* Note that macros inside the substituted values are not expanded.
 */
-bool macroSubstitute(std::string* to, const std::string& from, const ContextElement& ce)
+bool MacroTemplate::expand(std::string* to, const ContextElement& ce) const
 {
   // Initial size check: is the string to convert too big?
   //
   // If the string to convert is bigger than the maximum allowed buffer size (MAX_DYN_MSG_SIZE),
   // then there is an important probability that the resulting string after substitution is also > MAX_DYN_MSG_SIZE.
   //
-  // This check avoids to copy 8MB to later only throw it away and return an error
-  // That is the advantage.
-  //
-  // There is an inconvenience as well.
+  // There is an inconvenience: buffers that are larger before substitution than they are after
+  // substitution aren't let through this check, and end up in an error. We assume that this second
+  // case is more than rare
   //
-  // The inconvenience is for buffers that are larger before substitution than they are after substitution.
-  // Those buffers aren't let through this check, and end up in an error.
-  //
-  // We assume that this second case is more than rare
-  //
-  if (from.size() > MAX_DYN_MSG_SIZE)
+  if (size > MAX_DYN_MSG_SIZE)
   {
     LM_W(("Runtime Error (too large initial string, before substitution)"));
     *to = "";
     return false;
   }
 
-  // Look for macros (using a hash map to count how many times each macro appears)
-  std::map<std::string, unsigned int>  macroNames;  // holds all the positions that each sub occur inside 'from'
-  size_t                               macroStart = from.find("${", 0);
-
-  while (macroStart != std::string::npos)
+  if (!valid)
   {
-    size_t macroEnd = from.find("}", macroStart);
-
-    if (macroEnd == std::string::npos)
-    {
-      LM_W(("Runtime Error (macro end not found, syntax error, aborting substitution)"));
-      *to = "";
-      return false;
-    }
-
-    std::string macroName = from.substr(macroStart + 2, macroEnd - (macroStart + 2));
-    if (macroNames.find(macroName) != macroNames.end())
-    {
-      macroNames[macroName]++;
-    }
-    else
-    {
-      macroNames[macroName] = 1;
-    }
-
-    macroStart = from.find("${", macroEnd + 1);
+    LM_W(("Runtime Error (macro end not found, syntax error, aborting substitution)"));
+    *to = "";
+    return false;
   }
 
-  // Calculate resulting size (if > MAX_DYN_MSG_SIZE, then reject)
-  unsigned long  toReduce = 0;
-  unsigned long  toAdd    = 0;
+  static const std::string          empty;
+  std::vector<const std::string*>  valueV(segmentV.size());
+  std::vector<std::string>         renderedV;     // non-string attribute values
+  size_t                           total = 0;
 
-  for (std::map<std::string, unsigned int>::iterator it = macroNames.begin(); it != macroNames.end(); ++it)
-  {
-    std::string   macroName = it->first;
-    unsigned int  times     = it->second;
+  // Reserved up front, so the pointers to its elements in valueV remain valid
+  renderedV.reserve(segmentV.size());
 
-    // The +3 is due to "${" and "}"
-    toReduce += (macroName.length() + 3) * times;
+  for (unsigned int ix = 0; ix < segmentV.size(); ++ix)
+  {
+    const MacroSegment& segment = segmentV[ix];
 
-    if (macroName == "id")
+    if (segment.type == MacroLiteral)
     {
-      toAdd += ce.entityId.id.length() * times;
+      valueV[ix] = &segment.text;
     }
-    else if (macroName == "type")
+    else if (segment.type == MacroId)
     {
-      toAdd += ce.entityId.type.length() * times;
+      valueV[ix] = &ce.entityId.id;
+    }
+    else if (segment.type == MacroType)
+    {
+      valueV[ix] = &ce.entityId.type;
     }
     else
     {
-      std::string value;
+      const ContextAttribute* caP = attributeLookup(ce.contextAttributeVector.vec, segment.text);
 
-      attributeValue(&value, ce.contextAttributeVector.vec, macroName.c_str());
-      toAdd += value.length() * times;
+      if (caP == NULL)
+      {
+        valueV[ix] = &empty;
+      }
+      else if (caP->valueType == orion::ValueTypeString)
+      {
+        valueV[ix] = &caP->stringValue;
+      }
+      else
+      {
+        renderedV.push_back("");
+        attributeValue(&renderedV.back(), caP);
+        valueV[ix] = &renderedV.back();
+      }
     }
+
+    total += valueV[ix]->size();
   }
 
-  if (from.length() + toAdd - toReduce > MAX_DYN_MSG_SIZE)
+  if (total > MAX_DYN_MSG_SIZE)
   {
     LM_W(("Runtime Error (too large final string, after substitution)"));
     *to = "";
     return false;
   }
 
-  // Macro replace
-  *to = from;
-  for (std::map<std::string, unsigned int>::iterator it = macroNames.begin(); it != macroNames.end(); ++it)
+  to->clear();
+  to->reserve(total);
+
+  for (unsigned int ix = 0; ix < valueV.size(); ++ix)
   {
-    std::string macroName = it->first;
-    unsigned int times    = it->second;
+    to->append(*valueV[ix]);
+  }
 
-    std::string macro = "${" + it->first + "}";
-    std::string value;
+  return true;
+}
 
-    if (macroName == "id")
-    {
-      value = ce.entityId.id;
-    }
-    else if (macroName == "type")
-    {
-      value = ce.entityId.type;
-    }
-    else
-    {
-      attributeValue(&value, ce.contextAttributeVector.vec, macroName.c_str());
-    }
 
-    // We have to do the replace operation as many times as macro occurrences
-    for (unsigned int ix = 0; ix < times; ix++)
-    {
-      to->replace(to->find(macro), macro.length(), value);
-    }
-  }
 
-  return true;
+/* ****************************************************************************
+*
+* macroSubstitute - 
+*
+* An old version of this function was based in char processing. However, we faced
+* weird crashing problems after fixing that implementation to support >1KB payloads.
+*
+* We didn't know the actual cause of these problems but after changing the implementation
+* to one based on std::string, it seemed stable. The old version is still available at git
+* repository, for the records. It can be found checking out the following commit (the last
+* one before chaning implementation):
+*
+*   commit f8c91bf16e192388824c3786a76b203b83354d13
+*   Date:   Mon Jun 19 16:33:29 2017 +0200
+*
+* Now the string is compiled into a MacroTemplate and expanded. Callers expanding the same
+* string many times should keep the MacroTemplate instead.
+*/
+bool macroSubstitute(std::string* to, const std::string& from, const ContextElement& ce)
+{
+  MacroTemplate macroTemplate(from);
+
+  return macroTemplate.expand(to, ce);
 }
@@ -26,11 +26,63 @@
 * Author: Ken Zangelin
 */
 #include <string>
+#include <vector>
 
 #include "ngsi/ContextElement.h"
 
 
 
+/* ****************************************************************************
+*
+* MacroSegmentType -
+*/
+typedef enum MacroSegmentType
+{
+  MacroLiteral,
+  MacroId,
+  MacroType,
+  MacroAttr
+} MacroSegmentType;
+
+
+
+/* ****************************************************************************
+*
+* MacroSegment -
+*/
+typedef struct MacroSegment
+{
+  MacroSegmentType  type;
+  std::string       text;    // the literal text, or the attribute name for MacroAttr
+} MacroSegment;
+
+
+
+/* ****************************************************************************
+*
+* MacroTemplate -
+*
+* A string with ${id}, ${type} and ${attrName} macros, split once in segments so it
+* can be expanded many times (e.g. for each notification of a subscription) in a single
+* pass, without looking for the macros again.
+*/
+class MacroTemplate
+{
+ private:
+  std::vector<MacroSegment>  segmentV;
+  size_t                     size;       // size of the template (before substitution)
+  bool                       valid;      // false if some macro is not closed
+
+ public:
+  MacroTemplate();
+  explicit MacroTemplate(const std::string& in);
+
+  void  compile(const std::string& in);
+  bool  expand(std::string* to, const ContextElement& ce) const;
+};
+
+
+
 /* ****************************************************************************
 *
 * macroSubstitute - 
@@ -0,0 +1,277 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <pthread.h>
+#include <regex.h>
+
+#include <string>
+#include <map>
+#include <list>
+#include <utility>
+
+#include "logMsg/logMsg.h"
+#include "logMsg/traceLevels.h"
+
+#include "common/regexCache.h"
+
+
+
+/* ****************************************************************************
+*
+* RegexKey - pattern and compile flags
+*/
+typedef std::pair<std::string, int> RegexKey;
+
+
+
+/* ****************************************************************************
+*
+* RegexEntry -
+*
+* The regex_t is the first field, so the pointer given by regexCacheGet is also the
+* pointer to its entry.
+*
+* An entry in use ('refs' > 0) may be evicted from the cache. In that case it is not
+* 'cached' any longer and it is freed by the last regexCacheRelease.
+*/
+typedef struct RegexEntry
+{
+  regex_t                                regex;
+  RegexKey                               key;
+  int                                    refs;
+  bool                                   cached;
+  std::list<struct RegexEntry*>::iterator  lruPos;
+} RegexEntry;
+
+
+
+/* ****************************************************************************
+*
+* Cache state -
+*
+* 'lru' holds the cached entries, most recently used first.
+*/
+static pthread_mutex_t                    cacheMutex     = PTHREAD_MUTEX_INITIALIZER;
+static std::map<RegexKey, RegexEntry*>    cache;
+static std::list<RegexEntry*>             lru;
+static int                                cacheMaxSize   = REGEX_CACHE_DEFAULT_SIZE;
+static int                                cacheHits      = 0;
+static int                                cacheMisses    = 0;
+static int                                cacheEvictions = 0;
+
+
+
+/* ****************************************************************************
+*
+* entryFree -
+*/
+static void entryFree(RegexEntry* entryP)
+{
+  regfree(&entryP->regex);
+  delete entryP;
+}
+
+
+
+/* ****************************************************************************
+*
+* lruTrim - evict the least recently used entries, to keep at most cacheMaxSize
+*
+* Must be called with the mutex taken. The entries not in use are freed right away.
+*/
+static void lruTrim(void)
+{
+  while ((int) lru.size() > cacheMaxSize)
+  {
+    RegexEntry* entryP = lru.back();
+
+    lru.pop_back();
+    cache.erase(entryP->key);
+    entryP->cached = false;
+    ++cacheEvictions;
+
+    if (entryP->refs == 0)
+    {
+      entryFree(entryP);
+    }
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* regexCacheInit -
+*/
+void regexCacheInit(int maxSize)
+{
+  pthread_mutex_lock(&cacheMutex);
+
+  cacheMaxSize = maxSize;
+  lruTrim();
+
+  pthread_mutex_unlock(&cacheMutex);
+}
+
+
+
+/* ****************************************************************************
+*
+* regexCacheGet -
+*
+* The pattern is compiled without the mutex, so a slow regcomp does not hold the
+* rest of threads. If another thread has cached the same pattern meanwhile, the
+* entry in the cache is used and ours is thrown away.
+*/
+regex_t* regexCacheGet(const std::string& pattern, int cflags)
+{
+  RegexKey                                   key(pattern, cflags);
+  std::map<RegexKey, RegexEntry*>::iterator  iter;
+
+  pthread_mutex_lock(&cacheMutex);
+
+  iter = cache.find(key);
+  if (iter != cache.end())
+  {
+    RegexEntry* entryP = iter->second;
+
+    lru.splice(lru.begin(), lru, entryP->lruPos);
+    ++entryP->refs;
+    ++cacheHits;
+
+    pthread_mutex_unlock(&cacheMutex);
+    return &entryP->regex;
+  }
+
+  ++cacheMisses;
+  pthread_mutex_unlock(&cacheMutex);
+
+  RegexEntry* newP = new RegexEntry();
+
+  if (regcomp(&newP->regex, pattern.c_str(), cflags) != 0)
+  {
+    // If regcomp fails it frees up itself (see glibc sources for details)
+    LM_T(LmtRegexCache, ("invalid regex: '%s'", pattern.c_str()));
+    delete newP;
+    return NULL;
+  }
+
+  newP->key    = key;
+  newP->refs   = 1;
+  newP->cached = false;
+
+  pthread_mutex_lock(&cacheMutex);
+
+  iter = cache.find(key);
+  if (iter != cache.end())
+  {
+    RegexEntry* entryP = iter->second;
+
+    lru.splice(lru.begin(), lru, entryP->lruPos);
+    ++entryP->refs;
+
+    pthread_mutex_unlock(&cacheMutex);
+
+    entryFree(newP);
+    return &entryP->regex;
+  }
+
+  if (cacheMaxSize > 0)
+  {
+    lru.push_front(newP);
+    newP->lruPos = lru.begin();
+    newP->cached = true;
+    cache[key]   = newP;
+
+    lruTrim();
+  }
+
+  pthread_mutex_unlock(&cacheMutex);
+
+  return &newP->regex;
+}
+
+
+
+/* ****************************************************************************
+*
+* regexCacheRelease -
+*/
+void regexCacheRelease(regex_t* regexP)
+{
+  if (regexP == NULL)
+  {
+    return;
+  }
+
+  RegexEntry* entryP = (RegexEntry*) regexP;
+  bool        toFree;
+
+  pthread_mutex_lock(&cacheMutex);
+
+  --entryP->refs;
+  toFree = (entryP->refs == 0) && (entryP->cached == false);
+
+  pthread_mutex_unlock(&cacheMutex);
+
+  if (toFree)
+  {
+    entryFree(entryP);
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* regexCacheStatisticsGet -
+*/
+void regexCacheStatisticsGet(int* hitsP, int* missesP, int* evictionsP, int* sizeP)
+{
+  pthread_mutex_lock(&cacheMutex);
+
+  *hitsP      = cacheHits;
+  *missesP    = cacheMisses;
+  *evictionsP = cacheEvictions;
+  *sizeP      = cache.size();
+
+  pthread_mutex_unlock(&cacheMutex);
+}
+
+
+
+/* ****************************************************************************
+*
+* regexCacheStatisticsReset -
+*/
+void regexCacheStatisticsReset(void)
+{
+  pthread_mutex_lock(&cacheMutex);
+
+  cacheHits      = 0;
+  cacheMisses    = 0;
+  cacheEvictions = 0;
+
+  pthread_mutex_unlock(&cacheMutex);
+}
@@ -0,0 +1,91 @@
+#ifndef SRC_LIB_COMMON_REGEXCACHE_H_
+#define SRC_LIB_COMMON_REGEXCACHE_H_
+
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <regex.h>
+
+#include <string>
+
+
+
+/* ****************************************************************************
+*
+* REGEX_CACHE_DEFAULT_SIZE - number of compiled regex kept if regexCacheInit is not called
+*/
+#define REGEX_CACHE_DEFAULT_SIZE  1000
+
+
+
+/* ****************************************************************************
+*
+* regexCacheInit -
+*
+* A 'maxSize' of zero disables the cache: regexCacheGet compiles the pattern every time
+* and regexCacheRelease frees it, as the call sites did before the cache existed.
+*/
+extern void regexCacheInit(int maxSize);
+
+
+
+/* ****************************************************************************
+*
+* regexCacheGet -
+*
+* Returns the pattern compiled with 'cflags' (REG_EXTENDED for all the patterns of the
+* API), compiling it only if it is not in the cache already. NULL if the pattern is not
+* a valid regex.
+*
+* The regex is valid until it is given back with regexCacheRelease, even if it is evicted
+* from the cache in the meanwhile. It can be used by several threads at the same time, as
+* glibc regexec() takes a lock of its own on the compiled regex.
+*/
+extern regex_t* regexCacheGet(const std::string& pattern, int cflags);
+
+
+
+/* ****************************************************************************
+*
+* regexCacheRelease -
+*/
+extern void regexCacheRelease(regex_t* regexP);
+
+
+
+/* ****************************************************************************
+*
+* regexCacheStatisticsGet -
+*/
+extern void regexCacheStatisticsGet(int* hitsP, int* missesP, int* evictionsP, int* sizeP);
+
+
+
+/* ****************************************************************************
+*
+* regexCacheStatisticsReset -
+*/
+extern void regexCacheStatisticsReset(void);
+
+#endif  // SRC_LIB_COMMON_REGEXCACHE_H_
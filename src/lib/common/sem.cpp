@@ -39,11 +39,31 @@
 *
 * Globals -
 */
-static sem_t      reqSem;
-static sem_t      transSem;
-static sem_t      cacheSem;
-static sem_t      timeStatSem;
-static SemOpType  reqPolicy;
+static sem_t             reqSem;
+static sem_t             transSem;
+static sem_t             cacheSem;
+static sem_t             timeStatSem;
+static SemOpType         reqPolicy;
+
+
+
+/* ****************************************************************************
+*
+* Read-write lock for the 'SemSharedOp' (-reqMutexPolicy rw) policy -
+*
+* In this policy, 'reqSem' is not used. Instead, read operations take 'reqRwLock' in
+* shared mode (so queries are executed concurrently) and write operations take it
+* in exclusive mode.
+*
+* As pthread_rwlock_t has no way to be inspected, the number of holders is kept in
+* reqRwReaders/reqRwWriters, for reqSemGet() to know whether the lock is taken or not.
+* reqRwStatMutex protects the wait time accumulators, as more than one thread may be
+* adding to them at the same time (which can't happen with an exclusive semaphore).
+*/
+static pthread_rwlock_t  reqRwLock;
+static int               reqRwReaders   = 0;
+static int               reqRwWriters   = 0;
+static pthread_mutex_t   reqRwStatMutex = PTHREAD_MUTEX_INITIALIZER;
 
 
 
@@ -51,10 +71,12 @@ static SemOpType  reqPolicy;
 *
 * Time measuring variables - 
 */
-static struct timespec accReqSemTime      = { 0, 0 };
-static struct timespec accTransSemTime    = { 0, 0 };
-static struct timespec accCacheSemTime    = { 0, 0 };
-static struct timespec accTimeStatSemTime = { 0, 0 };
+static struct timespec accReqSemTime          = { 0, 0 };
+static struct timespec accReqSemSharedTime    = { 0, 0 };
+static struct timespec accReqSemExclusiveTime = { 0, 0 };
+static struct timespec accTransSemTime        = { 0, 0 };
+static struct timespec accCacheSemTime        = { 0, 0 };
+static struct timespec accTimeStatSemTime     = { 0, 0 };
 
 
 
@@ -78,6 +100,24 @@ int semInit(SemOpType _reqPolicy, bool semTimeStat, int shared, int takenInitial
     return -1;
   }
 
+  //
+  // Writers are given preference, so a steady flow of queries can't starve updates
+  //
+  pthread_rwlockattr_t rwAttr;
+
+  pthread_rwlockattr_init(&rwAttr);
+  pthread_rwlockattr_setkind_np(&rwAttr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+
+  int s = pthread_rwlock_init(&reqRwLock, &rwAttr);
+
+  pthread_rwlockattr_destroy(&rwAttr);
+
+  if (s != 0)
+  {
+    LM_E(("Runtime Error (error initializing 'req' read-write lock: %s)", strerror(s)));
+    return -1;
+  }
+
   if (sem_init(&transSem, shared, takenInitially) == -1)
   {
     LM_E(("Runtime Error (error initializing 'transactionId' semaphore: %s)", strerror(errno)));
@@ -111,6 +151,17 @@ int semInit(SemOpType _reqPolicy, bool semTimeStat, int shared, int takenInitial
 */
 int reqSemTryToTake(void)
 {
+  if (reqPolicy == SemSharedOp)
+  {
+    if (pthread_rwlock_trywrlock(&reqRwLock) != 0)
+    {
+      return -1;
+    }
+
+    __sync_fetch_and_add(&reqRwWriters, 1);
+    return 0;
+  }
+
   int r = sem_trywait(&reqSem);
 
   return r;
@@ -118,6 +169,58 @@ int reqSemTryToTake(void)
 
 
 
+/* ****************************************************************************
+*
+* reqRwLockTake -
+*
+* Take the 'req' read-write lock, in shared mode for read operations and in
+* exclusive mode for anything else.
+* Waiting time is accumulated both in the accumulator of the lock mode and in
+* the accumulator of the 'req' semaphore.
+*/
+static int reqRwLockTake(const char* who, const char* what, SemOpType reqType)
+{
+  bool             shared = (reqType == SemReadOp);
+  struct timespec  startTime;
+  struct timespec  endTime;
+  struct timespec  diffTime;
+  int              r;
+
+  LM_T(LmtReqSem, ("%s taking the 'req' lock (%s) for '%s'", who, shared? "shared" : "exclusive", what));
+
+  if (semWaitStatistics)
+  {
+    clock_gettime(CLOCK_REALTIME, &startTime);
+  }
+
+  r = (shared)? pthread_rwlock_rdlock(&reqRwLock) : pthread_rwlock_wrlock(&reqRwLock);
+
+  if (r != 0)
+  {
+    LM_E(("Runtime Error (error taking 'req' read-write lock: %s)", strerror(r)));
+    return -1;
+  }
+
+  __sync_fetch_and_add((shared)? &reqRwReaders : &reqRwWriters, 1);
+
+  if (semWaitStatistics)
+  {
+    clock_gettime(CLOCK_REALTIME, &endTime);
+    clock_difftime(&endTime, &startTime, &diffTime);
+
+    pthread_mutex_lock(&reqRwStatMutex);
+    clock_addtime(&accReqSemTime, &diffTime);
+    clock_addtime((shared)? &accReqSemSharedTime : &accReqSemExclusiveTime, &diffTime);
+    pthread_mutex_unlock(&reqRwStatMutex);
+  }
+
+  LM_T(LmtReqSem, ("%s has the 'req' lock (%s)", who, shared? "shared" : "exclusive"));
+
+  return 0;
+}
+
+
+
 /* ****************************************************************************
 *
 * reqSemTake -
@@ -144,6 +247,14 @@ int reqSemTake(const char* who, const char* what, SemOpType reqType, bool* taken
     return -1;
   }
 
+  if (reqPolicy == SemSharedOp)
+  {
+    r = reqRwLockTake(who, what, reqType);
+
+    *taken = (r == 0);
+    return r;
+  }
+
   LM_T(LmtReqSem, ("%s taking the 'req' semaphore for '%s'", who, what));
 
   struct timespec startTime;
@@ -184,6 +295,39 @@ float semTimeReqGet(void)
 
 
 
+/* ****************************************************************************
+*
+* semTimeReqSharedGet - get accumulated req lock waiting time of read operations (rw policy)
+*/
+float semTimeReqSharedGet(void)
+{
+  return accReqSemSharedTime.tv_sec + ((float) accReqSemSharedTime.tv_nsec) / 1E9;
+}
+
+
+
+/* ****************************************************************************
+*
+* semTimeReqExclusiveGet - get accumulated req lock waiting time of write operations (rw policy)
+*/
+float semTimeReqExclusiveGet(void)
+{
+  return accReqSemExclusiveTime.tv_sec + ((float) accReqSemExclusiveTime.tv_nsec) / 1E9;
+}
+
+
+
+/* ****************************************************************************
+*
+* reqSemPolicyGet - 
+*/
+SemOpType reqSemPolicyGet(void)
+{
+  return reqPolicy;
+}
+
+
+
 /* ****************************************************************************
 *
 * semTimeTransGet - get accumulated trans semaphore waiting time
@@ -223,8 +367,12 @@ float semTimeTimeStatGet(void)
 */
 void semTimeReqReset(void)
 {
-  accReqSemTime.tv_sec  = 0;
-  accReqSemTime.tv_nsec = 0;
+  accReqSemTime.tv_sec           = 0;
+  accReqSemTime.tv_nsec          = 0;
+  accReqSemSharedTime.tv_sec     = 0;
+  accReqSemSharedTime.tv_nsec    = 0;
+  accReqSemExclusiveTime.tv_sec  = 0;
+  accReqSemExclusiveTime.tv_nsec = 0;
 }
 
 
@@ -357,6 +505,25 @@ int reqSemGive(const char* who, const char* what, bool semTaken)
     LM_T(LmtReqSem, ("%s gives the 'req' semaphore", who));
   }
 
+  if (reqPolicy == SemSharedOp)
+  {
+    //
+    // The lock is held by this thread either in shared or in exclusive mode, but not both.
+    // Whatever counter is non-zero before unlocking, is the one corresponding to this thread
+    // (if a writer holds the lock, there can be no readers and vice versa).
+    //
+    if (__sync_fetch_and_add(&reqRwWriters, 0) > 0)
+    {
+      __sync_fetch_and_sub(&reqRwWriters, 1);
+    }
+    else
+    {
+      __sync_fetch_and_sub(&reqRwReaders, 1);
+    }
+
+    return pthread_rwlock_unlock(&reqRwLock);
+  }
+
   return sem_post(&reqSem);
 }
 
@@ -466,6 +633,16 @@ const char* reqSemGet(void)
 {
   int value;
 
+  if (reqPolicy == SemSharedOp)
+  {
+    if ((__sync_fetch_and_add(&reqRwReaders, 0) == 0) && (__sync_fetch_and_add(&reqRwWriters, 0) == 0))
+    {
+      return "free";
+    }
+
+    return "taken";
+  }
+
   if (sem_getvalue(&reqSem, &value) == -1)
   {
     return "error";
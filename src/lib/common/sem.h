@@ -44,7 +44,8 @@ typedef enum SemOpType
   SemReadOp,
   SemWriteOp,
   SemReadWriteOp,
-  SemNoneOp
+  SemNoneOp,
+  SemSharedOp     // Only as policy: read ops share the 'req' lock, write ops take it exclusively
 } SemOpType;
 
 
@@ -121,12 +122,22 @@ extern const char* connectionSubContextSemGet(void);
 * semTimeXxxGet - get accumulated semaphore waiting time
 */
 extern float semTimeReqGet(void);
+extern float semTimeReqSharedGet(void);
+extern float semTimeReqExclusiveGet(void);
 extern float semTimeTransGet(void);
 extern float semTimeCacheGet(void);
 extern float semTimeTimeStatGet(void);
 
 
 
+/* ****************************************************************************
+*
+* reqSemPolicyGet - 
+*/
+extern SemOpType reqSemPolicyGet(void);
+
+
+
 /* ****************************************************************************
 *
 * semTimeXxxReset - 
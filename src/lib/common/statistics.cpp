@@ -40,6 +40,20 @@ __thread TimeStat  threadLastTimeStat;
 
 
 
+/* ****************************************************************************
+*
+* Notification time counters, one per notification mode -
+*
+* Protected by the timeStat semaphore, as accTimeStat.
+*/
+static struct timespec  accNotifTime[NotifTimeModes];
+static struct timespec  lastNotifTime[NotifTimeModes];
+static const char*      notifTimeName[NotifTimeModes] = { "notifTransient", "notifPersistent", "notifThreadpool", "notifAsync" };
+static struct timespec  accSubCacheFlushTime;
+static struct timespec  lastSubCacheFlushTime;
+
+
+
 /* ****************************************************************************
 *
 * Statistic counters for NGSI REST requests
@@ -159,6 +173,7 @@ int noOfIndividualSubscriptionRequest                    = -1;
 int noOfSimulatedNotifications                           = -1;
 int noOfBatchQueryRequest                                = -1;
 int noOfBatchUpdateRequest                               = -1;
+int noOfSubCacheFlushedDocs                              = -1;
 
 
 
@@ -188,6 +203,7 @@ inline float timeSpecToFloat(const struct timespec& t)
 * xxxWriteWaitTime     - 
 * xxxCommandWaitTime   - 
 * xxxRenderTime        - the time that the last render took to render the response
+* notifXxx             - the time that sending notifications took, per notification mode
 *
 */
 std::string renderTimingStatistics(void)
@@ -213,8 +229,20 @@ std::string renderTimingStatistics(void)
   bool lastRenderTime           = (lastTimeStat.renderTime.tv_sec != 0)           || (lastTimeStat.renderTime.tv_nsec != 0);
   bool lastReqTime              = (lastTimeStat.reqTime.tv_sec != 0)              || (lastTimeStat.reqTime.tv_nsec != 0);
 
-  bool last = lastJsonV1ParseTime || lastJsonV2ParseTime || lastMongoBackendTime || lastRenderTime || lastReqTime;
-  bool acc  = accJsonV1ParseTime || accJsonV2ParseTime || accMongoBackendTime || accRenderTime || accReqTime;
+  bool accNotif  = false;
+  bool lastNotif = false;
+
+  for (int mode = 0; mode < NotifTimeModes; ++mode)
+  {
+    accNotif  = accNotif  || (accNotifTime[mode].tv_sec != 0)  || (accNotifTime[mode].tv_nsec != 0);
+    lastNotif = lastNotif || (lastNotifTime[mode].tv_sec != 0) || (lastNotifTime[mode].tv_nsec != 0);
+  }
+
+  bool accSubCacheFlush  = (accSubCacheFlushTime.tv_sec != 0)  || (accSubCacheFlushTime.tv_nsec != 0);
+  bool lastSubCacheFlush = (lastSubCacheFlushTime.tv_sec != 0) || (lastSubCacheFlushTime.tv_nsec != 0);
+
+  bool last = lastJsonV1ParseTime || lastJsonV2ParseTime || lastMongoBackendTime || lastRenderTime || lastReqTime || lastNotif || lastSubCacheFlush;
+  bool acc  = accJsonV1ParseTime || accJsonV2ParseTime || accMongoBackendTime || accRenderTime || accReqTime || accNotif || accSubCacheFlush;
 
   if (!acc && !last)
   {
@@ -237,6 +265,16 @@ std::string renderTimingStatistics(void)
     if (accRenderTime)           accJh.addFloat("render",           timeSpecToFloat(accTimeStat.renderTime));
     if (accReqTime)              accJh.addFloat("total",            timeSpecToFloat(accTimeStat.reqTime));
 
+    for (int mode = 0; mode < NotifTimeModes; ++mode)
+    {
+      if ((accNotifTime[mode].tv_sec != 0) || (accNotifTime[mode].tv_nsec != 0))
+      {
+        accJh.addFloat(notifTimeName[mode], timeSpecToFloat(accNotifTime[mode]));
+      }
+    }
+
+    if (accSubCacheFlush) accJh.addFloat("subCacheFlush", timeSpecToFloat(accSubCacheFlushTime));
+
     jh.addRaw("accumulated", accJh.str());
   }
   if (last)
@@ -252,6 +290,16 @@ std::string renderTimingStatistics(void)
     if (lastRenderTime)           lastJh.addFloat("render",           timeSpecToFloat(lastTimeStat.renderTime));
     if (lastReqTime)              lastJh.addFloat("total",            timeSpecToFloat(lastTimeStat.reqTime));
 
+    for (int mode = 0; mode < NotifTimeModes; ++mode)
+    {
+      if ((lastNotifTime[mode].tv_sec != 0) || (lastNotifTime[mode].tv_nsec != 0))
+      {
+        lastJh.addFloat(notifTimeName[mode], timeSpecToFloat(lastNotifTime[mode]));
+      }
+    }
+
+    if (lastSubCacheFlush) lastJh.addFloat("subCacheFlush", timeSpecToFloat(lastSubCacheFlushTime));
+
     jh.addRaw("last", lastJh.str());
   }
 
@@ -267,7 +315,49 @@ std::string renderTimingStatistics(void)
 */
 void timingStatisticsReset(void)
 {
-  memset(&accTimeStat, 0, sizeof(accTimeStat));
+  memset(&accTimeStat,   0, sizeof(accTimeStat));
+  memset(&accNotifTime,  0, sizeof(accNotifTime));
+  memset(&lastNotifTime, 0, sizeof(lastNotifTime));
+  memset(&accSubCacheFlushTime,  0, sizeof(accSubCacheFlushTime));
+  memset(&lastSubCacheFlushTime, 0, sizeof(lastSubCacheFlushTime));
+}
+
+
+
+/* ****************************************************************************
+*
+* notifTimeAdd -
+*
+* Notifications are sent outside the request threads, so their times cannot be
+* part of threadLastTimeStat and are accumulated directly here.
+*/
+void notifTimeAdd(NotifTimeMode mode, const struct timespec* diffP)
+{
+  timeStatSemTake(__FUNCTION__, "notification time");
+
+  clock_addtime(&accNotifTime[mode], diffP);
+  lastNotifTime[mode] = *diffP;
+
+  timeStatSemGive(__FUNCTION__, "notification time");
+}
+
+
+
+/* ****************************************************************************
+*
+* subCacheFlushTimeAdd -
+*
+* As notifications, the flush is done outside the request threads (by the subscription
+* cache sync thread).
+*/
+void subCacheFlushTimeAdd(const struct timespec* diffP)
+{
+  timeStatSemTake(__FUNCTION__, "subscription cache flush time");
+
+  clock_addtime(&accSubCacheFlushTime, diffP);
+  lastSubCacheFlushTime = *diffP;
+
+  timeStatSemGive(__FUNCTION__, "subscription cache flush time");
 }
 
 
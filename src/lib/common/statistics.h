@@ -229,6 +229,37 @@ extern __thread TimeStat  threadLastTimeStat;
 
 
 
+/* ****************************************************************************
+*
+* NotifTimeMode - notification mode, used as index of the notification time counters
+*/
+typedef enum NotifTimeMode
+{
+  NotifTimeTransient = 0,
+  NotifTimePersistent,
+  NotifTimeThreadpool,
+  NotifTimeAsync,
+  NotifTimeModes
+} NotifTimeMode;
+
+
+
+/* ****************************************************************************
+*
+* notifTimeAdd - add the time that sending a notification took
+*/
+extern void notifTimeAdd(NotifTimeMode mode, const struct timespec* diffP);
+
+
+
+/* ****************************************************************************
+*
+* subCacheFlushTimeAdd - add the time that flushing the subscription counters to DB took
+*/
+extern void subCacheFlushTimeAdd(const struct timespec* diffP);
+
+
+
 /* ****************************************************************************
 *
 * Statistic counters for NGSI REST requests
@@ -306,6 +337,7 @@ extern int noOfRtSubscribeError;
 extern int noOfSimulatedNotifications;
 extern int noOfBatchQueryRequest;
 extern int noOfBatchUpdateRequest;
+extern int noOfSubCacheFlushedDocs;
 
 
 
@@ -289,7 +289,7 @@ void eatCompound
       LM_T(LmtCompoundValue, ("Added string '%s' (value: '%s') under '%s'",
                               nodeName.c_str(),
                               nodeValue.c_str(),
-                              containerP->cpath()));
+                              containerP->fullPath().c_str()));
     }
     else if ((nodeName == "") && (nodeValue == "") && (noOfChildren == 0))  // Unnamed String with EMPTY VALUE
     {
@@ -298,27 +298,27 @@ void eatCompound
     }
     else if ((nodeName != "") && (nodeValue == "") && (noOfChildren == 0))  // Named Empty string
     {
-      LM_T(LmtCompoundValue, ("Adding container '%s' under '%s'", nodeName.c_str(), containerP->cpath()));
+      LM_T(LmtCompoundValue, ("Adding container '%s' under '%s'", nodeName.c_str(), containerP->fullPath().c_str()));
       containerP = containerP->add(ValueTypeString, nodeName, "");
     }
     else if ((nodeName != "") && (nodeValue == ""))  // Named Container
     {
-      LM_T(LmtCompoundValue, ("Adding container '%s' under '%s'", nodeName.c_str(), containerP->cpath()));
+      LM_T(LmtCompoundValue, ("Adding container '%s' under '%s'", nodeName.c_str(), containerP->fullPath().c_str()));
       containerP = containerP->add(ValueTypeObject, nodeName, "");
     }
     else if ((nodeName == "") && (nodeValue == ""))  // Name-Less container
     {
-      LM_T(LmtCompoundValue, ("Adding name-less container under '%s' (parent may be a Vector!)", containerP->cpath()));
+      LM_T(LmtCompoundValue, ("Adding name-less container under '%s' (parent may be a Vector!)", containerP->fullPath().c_str()));
       containerP->valueType = ValueTypeVector;
       containerP = containerP->add(ValueTypeObject, "item", "");
     }
     else if ((nodeName == "") && (nodeValue != ""))  // Name-Less String + its container is a vector
     {
       containerP->valueType = ValueTypeVector;
-      LM_T(LmtCompoundValue, ("Set '%s' to be a vector", containerP->cpath()));
+      LM_T(LmtCompoundValue, ("Set '%s' to be a vector", containerP->fullPath().c_str()));
       containerP->add(orion::ValueTypeString, "item", nodeValue);
       LM_T(LmtCompoundValue, ("Added a name-less string (value: '%s') under '%s'",
-                              nodeValue.c_str(), containerP->cpath()));
+                              nodeValue.c_str(), containerP->fullPath().c_str()));
     }
     else
       LM_T(LmtCompoundValue, ("IMPOSSIBLE !!!"));
@@ -0,0 +1,141 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include "rapidjson/document.h"
+
+#include "parse/CompoundValueNode.h"
+#include "jsonParseV2/parseCompoundValue.h"
+
+
+
+/* ****************************************************************************
+*
+* compoundValueNodes -
+*/
+unsigned int compoundValueNodes(const rapidjson::Value& value)
+{
+  unsigned int nodes = 0;
+
+  if (value.IsObject())
+  {
+    for (rapidjson::Value::ConstMemberIterator iter = value.MemberBegin(); iter != value.MemberEnd(); ++iter)
+    {
+      nodes += 1 + compoundValueNodes(iter->value);
+    }
+  }
+  else if (value.IsArray())
+  {
+    for (rapidjson::Value::ConstValueIterator iter = value.Begin(); iter != value.End(); ++iter)
+    {
+      nodes += 1 + compoundValueNodes(*iter);
+    }
+  }
+
+  return nodes;
+}
+
+
+
+/* ****************************************************************************
+*
+* compoundValueNodeSet - type and value of a node, recursive call for objects and arrays
+*/
+static void compoundValueNodeSet
+(
+  const rapidjson::Value&    value,
+  orion::CompoundValueNode*  rootP,
+  orion::CompoundValueNode*  cvnP
+)
+{
+  if (value.IsString())
+  {
+    cvnP->valueType   = orion::ValueTypeString;
+    cvnP->stringValue = value.GetString();
+  }
+  else if (value.IsNumber())
+  {
+    cvnP->valueType   = orion::ValueTypeNumber;
+    cvnP->numberValue = value.GetDouble();
+  }
+  else if (value.IsBool())
+  {
+    cvnP->valueType   = orion::ValueTypeBoolean;
+    cvnP->boolValue   = value.GetBool();
+  }
+  else if (value.IsNull())
+  {
+    cvnP->valueType   = orion::ValueTypeNone;
+  }
+  else if (value.IsObject())
+  {
+    cvnP->valueType   = orion::ValueTypeObject;
+    parseCompoundValue(value, rootP, cvnP);
+  }
+  else if (value.IsArray())
+  {
+    cvnP->valueType   = orion::ValueTypeVector;
+    parseCompoundValue(value, rootP, cvnP);
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* parseCompoundValue -
+*
+* All the children of a node are taken from the node array before going down into any of
+* them, so they are contiguous in the array.
+*/
+void parseCompoundValue
+(
+  const rapidjson::Value&    value,
+  orion::CompoundValueNode*  rootP,
+  orion::CompoundValueNode*  parent
+)
+{
+  if (value.IsObject())
+  {
+    rootP->flatChildrenAdd(parent, value.MemberCount());
+
+    unsigned int ix = 0;
+    for (rapidjson::Value::ConstMemberIterator iter = value.MemberBegin(); iter != value.MemberEnd(); ++iter)
+    {
+      orion::CompoundValueNode* cvnP = parent->childV[ix++];
+
+      cvnP->name = iter->name.GetString();
+      compoundValueNodeSet(iter->value, rootP, cvnP);
+    }
+  }
+  else if (value.IsArray())
+  {
+    rootP->flatChildrenAdd(parent, value.Size());
+
+    unsigned int ix = 0;
+    for (rapidjson::Value::ConstValueIterator iter = value.Begin(); iter != value.End(); ++iter)
+    {
+      compoundValueNodeSet(*iter, rootP, parent->childV[ix++]);
+    }
+  }
+}
@@ -0,0 +1,56 @@
+#ifndef SRC_LIB_JSONPARSEV2_PARSECOMPOUNDVALUE_H_
+#define SRC_LIB_JSONPARSEV2_PARSECOMPOUNDVALUE_H_
+
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include "rapidjson/document.h"
+
+#include "parse/CompoundValueNode.h"
+
+
+
+/* ****************************************************************************
+*
+* compoundValueNodes - number of nodes under a JSON object or array
+*/
+extern unsigned int compoundValueNodes(const rapidjson::Value& value);
+
+
+
+/* ****************************************************************************
+*
+* parseCompoundValue -
+*
+* Builds the children of 'parent', out of the members/items of the JSON object/array 'value',
+* from the node array of the flat tree whose root is 'rootP' (see CompoundValueNode::nodeArrayP).
+*/
+extern void parseCompoundValue
+(
+  const rapidjson::Value&    value,
+  orion::CompoundValueNode*  rootP,
+  orion::CompoundValueNode*  parent
+);
+
+#endif  // SRC_LIB_JSONPARSEV2_PARSECOMPOUNDVALUE_H_
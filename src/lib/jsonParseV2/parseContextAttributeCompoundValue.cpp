@@ -30,6 +30,7 @@
 #include "ngsi/ContextAttribute.h"
 #include "parse/CompoundValueNode.h"
 #include "jsonParseV2/jsonParseTypeNames.h"
+#include "jsonParseV2/parseCompoundValue.h"
 #include "jsonParseV2/parseContextAttributeCompoundValue.h"
 
 
@@ -56,142 +57,9 @@ static orion::ValueType stringToCompoundType(std::string nodeType)
 /* ****************************************************************************
 *
 * parseContextAttributeCompoundValue -
-*/
-std::string parseContextAttributeCompoundValue
-(
-  const rapidjson::Value::ConstValueIterator&   node,
-  ContextAttribute*                             caP,
-  orion::CompoundValueNode*                     parent
-)
-{
-  if (node->IsObject())
-  {
-    int counter  = 0;
-
-    for (rapidjson::Value::ConstMemberIterator iter = node->MemberBegin(); iter != node->MemberEnd(); ++iter)
-    {
-      std::string                nodeType = jsonParseTypeNames[iter->value.GetType()];
-      orion::CompoundValueNode*  cvnP     = new orion::CompoundValueNode();
-
-      cvnP->valueType  = stringToCompoundType(nodeType);
-
-      cvnP->name       = iter->name.GetString();
-      cvnP->container  = parent;
-      cvnP->rootP      = parent->rootP;
-      cvnP->level      = parent->level + 1;
-      cvnP->siblingNo  = counter;
-      cvnP->path       = parent->path + cvnP->name;
-
-      if (nodeType == "String")
-      {
-        cvnP->stringValue       = iter->value.GetString();
-      }
-      else if (nodeType == "Number")
-      {
-        cvnP->numberValue = iter->value.GetDouble();
-      }
-      else if ((nodeType == "True") || (nodeType == "False"))
-      {
-        cvnP->boolValue   = (nodeType == "True")? true : false;
-      }
-      else if (nodeType == "Null")
-      {
-        cvnP->valueType = orion::ValueTypeNone;
-      }
-      else if (nodeType == "Object")
-      {
-        cvnP->path += "/";
-        cvnP->valueType = orion::ValueTypeObject;
-      }
-      else if (nodeType == "Array")
-      {
-        cvnP->path += "/";
-        cvnP->valueType = orion::ValueTypeVector;
-      }
-
-      parent->childV.push_back(cvnP);
-
-      //
-      // Recursive call if Object or Array
-      //
-      if ((nodeType == "Object") || (nodeType == "Array"))
-      {
-        parseContextAttributeCompoundValue(iter, caP, cvnP);
-      }
-
-      ++counter;
-    }
-  }
-  else if (node->IsArray())
-  {
-    int counter  = 0;
-
-    for (rapidjson::Value::ConstValueIterator iter = node->Begin(); iter != node->End(); ++iter)
-    {
-      std::string                nodeType  = jsonParseTypeNames[iter->GetType()];
-      orion::CompoundValueNode*  cvnP      = new orion::CompoundValueNode();
-      char                       itemNo[4];
-
-      snprintf(itemNo, sizeof(itemNo), "%03d", counter);
-
-      cvnP->valueType  = stringToCompoundType(nodeType);
-      cvnP->container  = parent;
-      cvnP->rootP      = parent->rootP;
-      cvnP->level      = parent->level + 1;
-      cvnP->siblingNo  = counter;
-      cvnP->path       = parent->path + "[" + itemNo + "]";
-
-
-      if (nodeType == "String")
-      {
-        cvnP->stringValue       = iter->GetString();
-      }
-      else if (nodeType == "Number")
-      {
-        cvnP->numberValue = iter->GetDouble();
-      }
-      else if ((nodeType == "True") || (nodeType == "False"))
-      {
-        cvnP->boolValue   = (nodeType == "True")? true : false;
-      }
-      else if (nodeType == "Null")
-      {
-        cvnP->valueType = orion::ValueTypeNone;
-      }
-      else if (nodeType == "Object")
-      {
-        cvnP->path += "/";
-        cvnP->valueType = orion::ValueTypeObject;
-      }
-      else if (nodeType == "Array")
-      {
-        cvnP->path += "/";
-        cvnP->valueType = orion::ValueTypeVector;
-      }
-
-      parent->childV.push_back(cvnP);
-
-      //
-      // Recursive call if Object or Array
-      //
-      if ((nodeType == "Object") || (nodeType == "Array"))
-      {
-        parseContextAttributeCompoundValue(iter, caP, cvnP);
-      }
-
-      ++counter;
-    }
-  }
-
-
-  return "OK";
-}
-
-
-
-/* ****************************************************************************
 *
-* parseContextAttributeCompoundValue -
+* The compound value is built as a flat tree (see CompoundValueNode::nodeArrayP): the nodes are
+* counted first and allocated in one go, when the toplevel node is created.
 */
 std::string parseContextAttributeCompoundValue
 (
@@ -208,12 +76,11 @@ std::string parseContextAttributeCompoundValue
     caP->compoundValueP->name      = "TOP";
     caP->compoundValueP->container = caP->compoundValueP;
     caP->compoundValueP->valueType = stringToCompoundType(type);
-    caP->compoundValueP->path      = "/";
     caP->compoundValueP->rootP     = caP->compoundValueP;
-    caP->compoundValueP->level     = 0;
     caP->compoundValueP->siblingNo = 0;
 
     parent = caP->compoundValueP;
+    parent->flatInit(compoundValueNodes(node->value));
 
     if (!caP->typeGiven)
     {
@@ -221,120 +88,7 @@ std::string parseContextAttributeCompoundValue
     }
   }
 
-
-  //
-  // Children of the node
-  //
-  if (type == "Array")
-  {
-    int counter  = 0;
-
-    for (rapidjson::Value::ConstValueIterator iter = node->value.Begin(); iter != node->value.End(); ++iter)
-    {
-      std::string                nodeType  = jsonParseTypeNames[iter->GetType()];
-      orion::CompoundValueNode*  cvnP      = new orion::CompoundValueNode();
-      char                       itemNo[4];
-
-      snprintf(itemNo, sizeof(itemNo), "%03d", counter);
-
-      cvnP->valueType  = stringToCompoundType(nodeType);
-      cvnP->container  = parent;
-      cvnP->rootP      = parent->rootP;
-      cvnP->level      = parent->level + 1;
-      cvnP->siblingNo  = counter;
-      cvnP->path       = parent->path + "[" + itemNo + "]";
-
-
-      if (nodeType == "String")
-      {
-        cvnP->stringValue       = iter->GetString();
-      }
-      else if (nodeType == "Number")
-      {
-        cvnP->numberValue = iter->GetDouble();
-      }
-      else if ((nodeType == "True") || (nodeType == "False"))
-      {
-        cvnP->boolValue   = (nodeType == "True")? true : false;
-      }
-      else if (nodeType == "Object")
-      {
-        cvnP->path += "/";
-        cvnP->valueType = orion::ValueTypeObject;
-      }
-      else if (nodeType == "Array")
-      {
-        cvnP->path += "/";
-        cvnP->valueType = orion::ValueTypeVector;
-      }
-
-      parent->childV.push_back(cvnP);
-
-      //
-      // Recursive call if Object or Array
-      //
-      if ((nodeType == "Object") || (nodeType == "Array"))
-      {
-        parseContextAttributeCompoundValue(iter, caP, cvnP);
-      }
-
-      ++counter;
-    }
-  }
-  else if (type == "Object")
-  {
-    int counter  = 0;
-
-    rapidjson::Value::ConstMemberIterator iter;
-    for (iter = node->value.MemberBegin(); iter != node->value.MemberEnd(); ++iter)
-    {
-      std::string                nodeType = jsonParseTypeNames[iter->value.GetType()];
-      orion::CompoundValueNode*  cvnP     = new orion::CompoundValueNode();
-
-      cvnP->name       = iter->name.GetString();
-      cvnP->valueType  = stringToCompoundType(nodeType);
-      cvnP->container  = parent;
-      cvnP->rootP      = parent->rootP;
-      cvnP->level      = parent->level + 1;
-      cvnP->siblingNo  = counter;
-      cvnP->path       = parent->path + cvnP->name;
-
-      if (nodeType == "String")
-      {
-        cvnP->stringValue       = iter->value.GetString();
-      }
-      else if (nodeType == "Number")
-      {
-        cvnP->numberValue = iter->value.GetDouble();
-      }
-      else if ((nodeType == "True") || (nodeType == "False"))
-      {
-        cvnP->boolValue   = (nodeType == "True")? true : false;
-      }
-      else if (nodeType == "Object")
-      {
-        cvnP->path += "/";
-        cvnP->valueType = orion::ValueTypeObject;
-      }
-      else if (nodeType == "Array")
-      {
-        cvnP->path += "/";
-        cvnP->valueType = orion::ValueTypeVector;
-      }
-
-      parent->childV.push_back(cvnP);
-
-      //
-      // Recursive call if Object or Array
-      //
-      if ((nodeType == "Object") || (nodeType == "Array"))
-      {
-        parseContextAttributeCompoundValue(iter, caP, cvnP);
-      }
-
-      ++counter;
-    }
-  }
+  parseCompoundValue(node->value, caP->compoundValueP, parent);
 
   return "OK";
 }
@@ -356,140 +110,26 @@ std::string parseContextAttributeCompoundValueStandAlone
   caP->compoundValueP->name      = "TOP";
   caP->compoundValueP->container = caP->compoundValueP;
   caP->compoundValueP->valueType = caP->valueType;  // Convert to other type?
-  caP->compoundValueP->path      = "/";
   caP->compoundValueP->rootP     = caP->compoundValueP;
-  caP->compoundValueP->level     = 0;
   caP->compoundValueP->siblingNo = 0;
 
   orion::CompoundValueNode*   parent  = caP->compoundValueP;
 
-
-  //
-  // Children of the node
-  //
-  if (caP->valueType == orion::ValueTypeVector)
+  if ((caP->valueType != orion::ValueTypeVector) && (caP->valueType != orion::ValueTypeObject))
   {
-    int counter  = 0;
-
-    for (rapidjson::Value::ConstValueIterator iter = document.Begin(); iter != document.End(); ++iter)
-    {
-      std::string                nodeType  = jsonParseTypeNames[iter->GetType()];
-      orion::CompoundValueNode*  cvnP      = new orion::CompoundValueNode();
-      char                       itemNo[4];
-
-      snprintf(itemNo, sizeof(itemNo), "%03d", counter);
-
-      cvnP->valueType  = stringToCompoundType(nodeType);
-      cvnP->container  = parent;
-      cvnP->rootP      = parent->rootP;
-      cvnP->level      = parent->level + 1;
-      cvnP->siblingNo  = counter;
-      cvnP->path       = parent->path + "[" + itemNo + "]";
-
-
-      if (nodeType == "String")
-      {
-        cvnP->stringValue = iter->GetString();
-      }
-      else if (nodeType == "Number")
-      {
-        cvnP->numberValue = iter->GetDouble();
-      }
-      else if ((nodeType == "True") || (nodeType == "False"))
-      {
-        cvnP->boolValue   = (nodeType == "True")? true : false;
-      }
-      else if (nodeType == "Null")
-      {
-        cvnP->valueType = orion::ValueTypeNone;
-      }
-      else if (nodeType == "Object")
-      {
-        cvnP->path += "/";
-        cvnP->valueType = orion::ValueTypeObject;
-      }
-      else if (nodeType == "Array")
-      {
-        cvnP->path += "/";
-        cvnP->valueType = orion::ValueTypeVector;
-      }
-
-      parent->childV.push_back(cvnP);
+    return "OK";
+  }
 
-      //
-      // Start recursive calls if Object or Array
-      //
-      if ((nodeType == "Object") || (nodeType == "Array"))
-      {
-        parseContextAttributeCompoundValue(iter, caP, cvnP);
-      }
-      else if (!caP->typeGiven)
-      {
-        caP->type = defaultType(caP->valueType);
-      }
+  parent->flatInit(compoundValueNodes(document));
+  parseCompoundValue(document, parent, parent);
 
-      ++counter;
-    }
-  }
-  else if (caP->valueType == orion::ValueTypeObject)
+  for (unsigned int ix = 0; ix < parent->childV.size(); ++ix)
   {
-    int counter  = 0;
+    orion::CompoundValueNode* cvnP = parent->childV[ix];
 
-    for (rapidjson::Value::ConstMemberIterator iter = document.MemberBegin(); iter != document.MemberEnd(); ++iter)
+    if ((cvnP->valueType != orion::ValueTypeObject) && (cvnP->valueType != orion::ValueTypeVector) && !caP->typeGiven)
     {
-      std::string                nodeType = jsonParseTypeNames[iter->value.GetType()];
-      orion::CompoundValueNode*  cvnP     = new orion::CompoundValueNode();
-
-      cvnP->name       = iter->name.GetString();
-      cvnP->valueType  = stringToCompoundType(nodeType);
-      cvnP->container  = parent;
-      cvnP->rootP      = parent->rootP;
-      cvnP->level      = parent->level + 1;
-      cvnP->siblingNo  = counter;
-      cvnP->path       = parent->path + cvnP->name;
-
-      if (nodeType == "String")
-      {
-        cvnP->stringValue = iter->value.GetString();
-      }
-      else if (nodeType == "Number")
-      {
-        cvnP->numberValue = iter->value.GetDouble();
-      }
-      else if ((nodeType == "True") || (nodeType == "False"))
-      {
-        cvnP->boolValue   = (nodeType == "True")? true : false;
-      }
-      else if (nodeType == "Null")
-      {
-        cvnP->valueType = orion::ValueTypeNone;
-      }
-      else if (nodeType == "Object")
-      {
-        cvnP->path += "/";
-        cvnP->valueType = orion::ValueTypeObject;
-      }
-      else if (nodeType == "Array")
-      {
-        cvnP->path += "/";
-        cvnP->valueType = orion::ValueTypeVector;
-      }
-
-      parent->childV.push_back(cvnP);
-
-      //
-      // Start recursive calls if Object or Array
-      //
-      if ((nodeType == "Object") || (nodeType == "Array"))
-      {
-        parseContextAttributeCompoundValue(iter, caP, cvnP);
-      }
-      else if (!caP->typeGiven)
-      {
-        caP->type = defaultType(caP->valueType);
-      }
-
-      ++counter;
+      caP->type = defaultType(caP->valueType);
     }
   }
 
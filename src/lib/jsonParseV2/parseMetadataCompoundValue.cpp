@@ -31,6 +31,7 @@
 #include "parse/CompoundValueNode.h"
 
 #include "jsonParseV2/jsonParseTypeNames.h"
+#include "jsonParseV2/parseCompoundValue.h"
 #include "jsonParseV2/parseMetadataCompoundValue.h"
 
 
@@ -57,140 +58,8 @@ static orion::ValueType stringToCompoundType(std::string nodeType)
 /* ****************************************************************************
 *
 * parseMetadataCompoundValue -
-*/
-std::string parseMetadataCompoundValue
-(
-  const rapidjson::Value::ConstValueIterator&   node,
-  Metadata*                                     mdP,
-  orion::CompoundValueNode*                     parent
-)
-{
-  if (node->IsObject())
-  {
-    int counter  = 0;
-
-    for (rapidjson::Value::ConstMemberIterator iter = node->MemberBegin(); iter != node->MemberEnd(); ++iter)
-    {
-      std::string                nodeType = jsonParseTypeNames[iter->value.GetType()];
-      orion::CompoundValueNode*  cvnP     = new orion::CompoundValueNode();
-
-      cvnP->valueType  = stringToCompoundType(nodeType);
-
-      cvnP->name       = iter->name.GetString();
-      cvnP->container  = parent;
-      cvnP->rootP      = parent->rootP;
-      cvnP->level      = parent->level + 1;
-      cvnP->siblingNo  = counter;
-      cvnP->path       = parent->path + cvnP->name;
-
-      if (nodeType == "String")
-      {
-        cvnP->stringValue       = iter->value.GetString();
-      }
-      else if (nodeType == "Number")
-      {
-        cvnP->numberValue = iter->value.GetDouble();
-      }
-      else if ((nodeType == "True") || (nodeType == "False"))
-      {
-        cvnP->boolValue   = (nodeType == "True")? true : false;
-      }
-      else if (nodeType == "Null")
-      {
-        cvnP->valueType = orion::ValueTypeNone;
-      }
-      else if (nodeType == "Object")
-      {
-        cvnP->path += "/";
-        cvnP->valueType = orion::ValueTypeObject;
-      }
-      else if (nodeType == "Array")
-      {
-        cvnP->path += "/";
-        cvnP->valueType = orion::ValueTypeVector;
-      }
-
-      parent->childV.push_back(cvnP);
-
-      //
-      // Recursive call if Object or Array
-      //
-      if ((nodeType == "Object") || (nodeType == "Array"))
-      {
-        parseMetadataCompoundValue(iter, mdP, cvnP);
-      }
-
-      ++counter;
-    }
-  }
-  else if (node->IsArray())
-  {
-    int counter  = 0;
-
-    for (rapidjson::Value::ConstValueIterator iter = node->Begin(); iter != node->End(); ++iter)
-    {
-      std::string                nodeType  = jsonParseTypeNames[iter->GetType()];
-      orion::CompoundValueNode*  cvnP      = new orion::CompoundValueNode();
-      char                       itemNo[4];
-
-      snprintf(itemNo, sizeof(itemNo), "%03d", counter);
-
-      cvnP->valueType  = stringToCompoundType(nodeType);
-      cvnP->container  = parent;
-      cvnP->rootP      = parent->rootP;
-      cvnP->level      = parent->level + 1;
-      cvnP->siblingNo  = counter;
-      cvnP->path       = parent->path + "[" + itemNo + "]";
-
-      if (nodeType == "String")
-      {
-        cvnP->stringValue = iter->GetString();
-      }
-      else if (nodeType == "Number")
-      {
-        cvnP->numberValue = iter->GetDouble();
-      }
-      else if ((nodeType == "True") || (nodeType == "False"))
-      {
-        cvnP->boolValue = (nodeType == "True")? true : false;
-      }
-      else if (nodeType == "Null")
-      {
-        cvnP->valueType = orion::ValueTypeNone;
-      }
-      else if (nodeType == "Object")
-      {
-        cvnP->path += "/";
-        cvnP->valueType = orion::ValueTypeObject;
-      }
-      else if (nodeType == "Array")
-      {
-        cvnP->path += "/";
-        cvnP->valueType = orion::ValueTypeVector;
-      }
-
-      parent->childV.push_back(cvnP);
-
-      //
-      // Recursive call if Object or Array
-      //
-      if ((nodeType == "Object") || (nodeType == "Array"))
-      {
-        parseMetadataCompoundValue(iter, mdP, cvnP);
-      }
-
-      ++counter;
-    }
-  }
-
-  return "OK";
-}
-
-
-
-/* ****************************************************************************
 *
-* parseMetadataCompoundValue -
+* Built as a flat tree, see parseContextAttributeCompoundValue.
 */
 std::string parseMetadataCompoundValue
 (
@@ -207,127 +76,14 @@ std::string parseMetadataCompoundValue
     mdP->compoundValueP->name      = "TOP";
     mdP->compoundValueP->container = mdP->compoundValueP;
     mdP->compoundValueP->valueType = stringToCompoundType(type);
-    mdP->compoundValueP->path      = "/";
     mdP->compoundValueP->rootP     = mdP->compoundValueP;
-    mdP->compoundValueP->level     = 0;
     mdP->compoundValueP->siblingNo = 0;
 
     parent = mdP->compoundValueP;
+    parent->flatInit(compoundValueNodes(node->value));
   }
 
-
-  //
-  // Children of the node
-  //
-  if (type == "Array")
-  {
-    int counter  = 0;
-
-    for (rapidjson::Value::ConstValueIterator iter = node->value.Begin(); iter != node->value.End(); ++iter)
-    {
-      std::string                nodeType  = jsonParseTypeNames[iter->GetType()];
-      orion::CompoundValueNode*  cvnP      = new orion::CompoundValueNode();
-      char                       itemNo[4];
-
-      snprintf(itemNo, sizeof(itemNo), "%03d", counter);
-
-      cvnP->valueType  = stringToCompoundType(nodeType);
-      cvnP->container  = parent;
-      cvnP->rootP      = parent->rootP;
-      cvnP->level      = parent->level + 1;
-      cvnP->siblingNo  = counter;
-      cvnP->path       = parent->path + "[" + itemNo + "]";
-
-      if (nodeType == "String")
-      {
-        cvnP->stringValue = iter->GetString();
-      }
-      else if (nodeType == "Number")
-      {
-        cvnP->numberValue = iter->GetDouble();
-      }
-      else if ((nodeType == "True") || (nodeType == "False"))
-      {
-        cvnP->boolValue = (nodeType == "True")? true : false;
-      }
-      else if (nodeType == "Object")
-      {
-        cvnP->path += "/";
-        cvnP->valueType = orion::ValueTypeObject;
-      }
-      else if (nodeType == "Array")
-      {
-        cvnP->path += "/";
-        cvnP->valueType = orion::ValueTypeVector;
-      }
-
-      parent->childV.push_back(cvnP);
-
-      //
-      // Recursive call if Object or Array
-      //
-      if ((nodeType == "Object") || (nodeType == "Array"))
-      {
-        parseMetadataCompoundValue(iter, mdP, cvnP);
-      }
-
-      ++counter;
-    }
-  }
-  else if (type == "Object")
-  {
-    int                                    counter  = 0;
-    rapidjson::Value::ConstMemberIterator  iter;
-
-    for (iter = node->value.MemberBegin(); iter != node->value.MemberEnd(); ++iter)
-    {
-      std::string                nodeType = jsonParseTypeNames[iter->value.GetType()];
-      orion::CompoundValueNode*  cvnP     = new orion::CompoundValueNode();
-
-      cvnP->name       = iter->name.GetString();
-      cvnP->valueType  = stringToCompoundType(nodeType);
-      cvnP->container  = parent;
-      cvnP->rootP      = parent->rootP;
-      cvnP->level      = parent->level + 1;
-      cvnP->siblingNo  = counter;
-      cvnP->path       = parent->path + cvnP->name;
-
-      if (nodeType == "String")
-      {
-        cvnP->stringValue       = iter->value.GetString();
-      }
-      else if (nodeType == "Number")
-      {
-        cvnP->numberValue = iter->value.GetDouble();
-      }
-      else if ((nodeType == "True") || (nodeType == "False"))
-      {
-        cvnP->boolValue   = (nodeType == "True")? true : false;
-      }
-      else if (nodeType == "Object")
-      {
-        cvnP->path += "/";
-        cvnP->valueType = orion::ValueTypeObject;
-      }
-      else if (nodeType == "Array")
-      {
-        cvnP->path += "/";
-        cvnP->valueType = orion::ValueTypeVector;
-      }
-
-      parent->childV.push_back(cvnP);
-
-      //
-      // Recursive call if Object or Array
-      //
-      if ((nodeType == "Object") || (nodeType == "Array"))
-      {
-        parseMetadataCompoundValue(iter, mdP, cvnP);
-      }
-
-      ++counter;
-    }
-  }
+  parseCompoundValue(node->value, mdP->compoundValueP, parent);
 
   return "OK";
 }
@@ -34,8 +34,10 @@
 #include "alarmMgr/alarmMgr.h"
 #include "common/globals.h"
 #include "common/errorMessages.h"
+#include "common/limits.h"
 #include "common/RenderFormat.h"
 #include "common/string.h"
+#include "common/regexCache.h"
 #include "rest/ConnectionInfo.h"
 #include "rest/OrionError.h"
 #include "rest/Verb.h"
@@ -381,13 +383,13 @@ static std::string parseEntitiesVector(ConnectionInfo* ciP, std::vector<EntID>*
 
         idPattern = idPatOpt.value;
 
-        // FIXME P5: Keep the regex and propagate to sub-cache
-        regex_t re;
-        if (regcomp(&re, idPattern.c_str(), REG_EXTENDED) != 0)
+        // Compiled through the regex cache, where the sub-cache finds it afterwards
+        regex_t* reP = regexCacheGet(idPattern, REG_EXTENDED);
+        if (reP == NULL)
         {
           return badInput(ciP, ERROR_DESC_BAD_REQUEST_INVALID_REGEX_ENTIDPATTERN);
         }
-        regfree(&re);  // If regcomp fails it frees up itself
+        regexCacheRelease(reP);
       }
     }
 
@@ -432,13 +434,13 @@ static std::string parseEntitiesVector(ConnectionInfo* ciP, std::vector<EntID>*
 
         typePattern = typePatOpt.value;
 
-        // FIXME P5: Keep the regex and propagate to sub-cache
-        regex_t re;
-        if (regcomp(&re, typePattern.c_str(), REG_EXTENDED) != 0)
+        // Compiled through the regex cache, where the sub-cache finds it afterwards
+        regex_t* reP = regexCacheGet(typePattern, REG_EXTENDED);
+        if (reP == NULL)
         {
           return badInput(ciP, ERROR_DESC_BAD_REQUEST_INVALID_REGEX_ENTTYPEPATTERN);
         }
-        regfree(&re);  // If regcomp fails it frees up itself
+        regexCacheRelease(reP);
       }
     }
 
@@ -693,6 +695,23 @@ static std::string parseNotification(ConnectionInfo* ciP, SubscriptionUpdate* su
     }
   }
 
+  // coalesceMs field
+  Opt<int64_t> coalesceMsOpt = getInt64Opt(notification, "coalesceMs");
+
+  if (!coalesceMsOpt.ok())
+  {
+    return badInput(ciP, coalesceMsOpt.error);
+  }
+  else if (coalesceMsOpt.given)
+  {
+    if ((coalesceMsOpt.value < 0) || (coalesceMsOpt.value > COALESCE_MAX_MS))
+    {
+      return badInput(ciP, "invalid coalesceMs (accepted values: 0 to " + toString(COALESCE_MAX_MS) + ")");
+    }
+
+    subsP->notification.coalesceMs = coalesceMsOpt.value;
+  }
+
   // attrsFormat field
   Opt<std::string>  attrsFormatOpt = getStringOpt(notification, "attrsFormat");
 
@@ -0,0 +1,195 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <stdlib.h>             // malloc, calloc, free
+#include <string.h>             // memcpy
+
+#include "logMsg/lmRing.h"      // Own interface
+
+
+
+/* ****************************************************************************
+*
+* lmRingInit -
+*/
+bool lmRingInit(LmRing* ringP, int size)
+{
+  unsigned long slots = 2;
+
+  while ((long) slots < size)
+  {
+    slots <<= 1;
+  }
+
+  ringP->slots = (LmRingSlot*) calloc(slots, sizeof(LmRingSlot));
+  if (ringP->slots == NULL)
+  {
+    return false;
+  }
+
+  for (unsigned long ix = 0; ix < slots; ix++)
+  {
+    ringP->slots[ix].seq = ix;
+  }
+
+  ringP->mask      = slots - 1;
+  ringP->head      = 0;
+  ringP->tail      = 0;
+  ringP->overflows = 0;
+
+  return true;
+}
+
+
+
+/* ****************************************************************************
+*
+* lmRingRelease -
+*/
+void lmRingRelease(LmRing* ringP)
+{
+  if (ringP->slots == NULL)
+  {
+    return;
+  }
+
+  for (unsigned long ix = 0; ix <= ringP->mask; ix++)
+  {
+    free(ringP->slots[ix].heapText);
+  }
+
+  free(ringP->slots);
+  ringP->slots = NULL;
+}
+
+
+
+/* ****************************************************************************
+*
+* lmRingPush -
+*
+* A slot is free for position 'pos' when its seq is 'pos'. The producer that wins the
+* CAS on 'head' owns it, copies the line and publishes it setting seq to 'pos + 1'.
+* A seq behind 'pos' means that the slot has not been given back by the consumer yet,
+* i.e. the ring is full.
+*/
+bool lmRingPush(LmRing* ringP, int index, const char* line, int len)
+{
+  unsigned long pos = ringP->head;
+
+  while (true)
+  {
+    LmRingSlot*  slotP = &ringP->slots[pos & ringP->mask];
+    long         diff  = (long) slotP->seq - (long) pos;
+
+    if (diff == 0)
+    {
+      if (__sync_bool_compare_and_swap(&ringP->head, pos, pos + 1))
+      {
+        char* text = slotP->text;
+
+        if (len >= LM_RING_TEXT_SIZE)
+        {
+          if ((text = (char*) malloc(len + 1)) == NULL)
+          {
+            // The slot is already ours, so it is published as an empty line
+            len = 0;
+            text = slotP->text;
+          }
+        }
+
+        memcpy(text, line, len);
+        text[len] = 0;
+
+        slotP->index    = index;
+        slotP->len      = len;
+        slotP->heapText = (text == slotP->text)? NULL : text;
+
+        __sync_synchronize();
+        slotP->seq = pos + 1;
+
+        return true;
+      }
+    }
+    else if (diff < 0)
+    {
+      __sync_fetch_and_add(&ringP->overflows, 1);
+      return false;
+    }
+
+    pos = ringP->head;
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* lmRingTake -
+*/
+int lmRingTake(LmRing* ringP, LmRingSlot** slotV, int max)
+{
+  int n = 0;
+
+  while (n < max)
+  {
+    LmRingSlot* slotP = &ringP->slots[ringP->tail & ringP->mask];
+
+    if ((long) slotP->seq - (long) (ringP->tail + 1) < 0)
+    {
+      break;  // empty (or the line is not completely copied yet)
+    }
+
+    __sync_synchronize();
+    slotV[n++] = slotP;
+    ++ringP->tail;
+  }
+
+  return n;
+}
+
+
+
+/* ****************************************************************************
+*
+* lmRingGive -
+*
+* The seq of a taken slot is 'pos + 1', the one for the next lap is 'pos + slots'.
+*/
+void lmRingGive(LmRing* ringP, LmRingSlot** slotV, int n)
+{
+  for (int ix = 0; ix < n; ix++)
+  {
+    LmRingSlot* slotP = slotV[ix];
+
+    if (slotP->heapText != NULL)
+    {
+      free(slotP->heapText);
+      slotP->heapText = NULL;
+    }
+
+    __sync_synchronize();
+    slotP->seq = slotP->seq + ringP->mask;
+  }
+}
@@ -0,0 +1,126 @@
+#ifndef SRC_LIB_LOGMSG_LMRING_H_
+#define SRC_LIB_LOGMSG_LMRING_H_
+
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+
+
+
+/* ****************************************************************************
+*
+* LM_RING_TEXT_SIZE - bytes of a line stored in the ring itself (terminating zero included)
+*
+* Longer lines are allocated on the heap (and freed when their slot is released).
+*/
+#define LM_RING_TEXT_SIZE  512
+
+
+
+/* ****************************************************************************
+*
+* LmRingSlot - a line in the ring
+*/
+typedef struct LmRingSlot
+{
+  volatile unsigned long  seq;
+  int                     index;                    // fds index the line is for
+  int                     len;                      // without the terminating zero
+  char*                   heapText;                 // NULL if the line is in 'text'
+  char                    text[LM_RING_TEXT_SIZE];
+} LmRingSlot;
+
+
+
+/* ****************************************************************************
+*
+* LmRing - bounded lock-free queue of log lines, with a sequence number per slot
+*
+* Any number of threads may push lines. There must be a single consumer at a time
+* (the log semaphore is used for that in logMsg.cpp).
+*/
+typedef struct LmRing
+{
+  LmRingSlot*                  slots;
+  unsigned long                mask;         // number of slots - 1 (a power of 2)
+  volatile unsigned long       head;         // next slot to fill (producers)
+  unsigned long                tail;         // next slot to take (consumer)
+  volatile unsigned long long  overflows;    // lines not pushed as the ring was full
+} LmRing;
+
+
+
+/* ****************************************************************************
+*
+* lmRingInit - allocate a ring of (at least) 'size' lines, false if out of memory
+*/
+extern bool lmRingInit(LmRing* ringP, int size);
+
+
+
+/* ****************************************************************************
+*
+* lmRingRelease - free the slots (and the lines still in them) of a ring
+*/
+extern void lmRingRelease(LmRing* ringP);
+
+
+
+/* ****************************************************************************
+*
+* lmRingPush - copy a line into the ring, false (and overflow counted) if full
+*/
+extern bool lmRingPush(LmRing* ringP, int index, const char* line, int len);
+
+
+
+/* ****************************************************************************
+*
+* lmRingTake - take up to 'max' lines from the ring, in order
+*
+* The slots are returned in 'slotV' and are still owned by the consumer (they can't
+* be filled by producers) until lmRingGive is called for them.
+*/
+extern int lmRingTake(LmRing* ringP, LmRingSlot** slotV, int max);
+
+
+
+/* ****************************************************************************
+*
+* lmRingGive - give back to the producers the slots obtained with lmRingTake
+*/
+extern void lmRingGive(LmRing* ringP, LmRingSlot** slotV, int n);
+
+
+
+/* ****************************************************************************
+*
+* lmRingSlotLine - the line in a slot
+*/
+inline char* lmRingSlotLine(LmRingSlot* slotP)
+{
+  return (slotP->heapText != NULL)? slotP->heapText : slotP->text;
+}
+
+#endif  // SRC_LIB_LOGMSG_LMRING_H_
@@ -45,12 +45,15 @@
 #include <sys/time.h>           /* gettimeofday                              */
 #include <time.h>               /* time, gmtime_r, ...                       */
 #include <sys/timeb.h>          /* timeb, ftime, ...                         */
+#include <sys/uio.h>            /* writev, iovec                             */
+#include <pthread.h>            /* pthread_create, pthread_key_create, ...   */
 
 #undef NDEBUG
 #include <assert.h>
 #include <string>
 
 #include "logMsg/time.h"
+#include "logMsg/lmRing.h"
 #include "logMsg/logMsg.h"      /* Own interface                             */
 
 #include "common/limits.h"      // FIXME: this should be removed if this library wants to be generic again
@@ -278,6 +281,8 @@ do                                                \
 #define AUX_LEN          16
 #define LOG_PERM         0666
 #define LOG_MASK         0
+#define ASYNC_BATCH      64        /* lines per writev (below IOV_MAX)       */
+#define ASYNC_IDLE_MS    10        /* max sleep of an idle async writer      */
 
 
 
@@ -2266,6 +2271,523 @@ LmStatus lmPathRegister
 
 
 
+/* ****************************************************************************
+*
+* fdSkip - true if the messages of this type are not written to fds[index]
+*/
+static bool fdSkip(int index, char type)
+{
+  if (fds[index].state != Occupied)
+  {
+    return true;
+  }
+
+  if ((fds[index].type == Stdout) && (fds[index].onlyErrorAndVerbose == true))
+  {
+    if ((type == 'T') ||
+        (type == 'D') ||
+        (type == 'H') ||
+        (type == 'M') ||
+        (type == 't')
+      )
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+
+/* ****************************************************************************
+*
+* lmLineBuild - builds in 'line' the line of a message for fds[index]
+*
+* 'format' is a buffer of FORMAT_LEN + 1 bytes, 'line' one of LINE_MAX bytes.
+* Returns false if nothing is to be written.
+*/
+static bool lmLineBuild
+(
+  int          index,
+  char*        line,
+  char*        format,
+  char*        text,
+  char         type,
+  const char*  file,
+  int          lineNo,
+  const char*  fName,
+  int          tLev,
+  const char*  stre
+)
+{
+  if (type == 'R')
+  {
+    if (text[1] != ':')
+    {
+      snprintf(line, LINE_MAX, "R: %s\n%c", text, 0);
+    }
+    else
+    {
+      snprintf(line, LINE_MAX, "%s\n%c", text, 0);
+    }
+  }
+  else
+  {
+    /* Danger: 'format' might be too short ... */
+    if (lmLineFix(index, format, FORMAT_LEN, type, file, lineNo, fName, tLev) == NULL)
+    {
+      return false;
+    }
+
+    if ((strlen(format) + strlen(text) + strlen(line)) > LINE_MAX)
+    {
+      snprintf(line, LINE_MAX, "%s[%d]: %s\n%c", file, lineNo, "LM ERROR: LINE TOO LONG", 0);
+    }
+    else
+    {
+      snprintf(line, LINE_MAX, format, text);
+    }
+  }
+
+  if (stre != NULL)
+  {
+    strncat(line, stre, LINE_MAX - strlen(stre) - 1);
+  }
+
+  return true;
+}
+
+
+
+/* ****************************************************************************
+*
+* Asynchronous log writer
+*
+* With lmAsyncStart(), the calling threads no longer take the log semaphore nor
+* write to the log fds. Each thread formats its lines in buffers of its own and
+* copies them into a lock-free ring (see lmRing.h), from where a writer thread
+* takes them in batches and writes them with writev(), straight from the ring
+* storage, holding the log semaphore only while doing so.
+*
+* If the ring is full the line is dropped and counted (lmAsyncOverflowsGet). The
+* writer reports the lines lost in the log.
+*
+* Fatal messages (LM_X) and messages with a hook/warning/error function attached
+* are still written synchronously, after flushing the ring.
+*/
+typedef struct AsyncBuffers
+{
+  char  line[LINE_MAX];
+  char  format[FORMAT_LEN + 1];
+} AsyncBuffers;
+
+static LmRing                       asyncRing;                /* consumer: with the log sem      */
+static volatile bool                asyncOn         = false;
+static volatile bool                asyncStopping   = false;
+static volatile int                 asyncWriterIdle = 0;
+static unsigned long long           asyncReported   = 0;      /* overflows already logged        */
+static sem_t                        asyncWakeSem;
+static pthread_t                    asyncWriter;
+static pthread_key_t                asyncBuffersKey;
+static pthread_once_t               asyncBuffersOnce = PTHREAD_ONCE_INIT;
+
+
+
+/* ****************************************************************************
+*
+* asyncBuffersKeyCreate -
+*/
+static void asyncBuffersKeyCreate(void)
+{
+  pthread_key_create(&asyncBuffersKey, free);
+}
+
+
+
+/* ****************************************************************************
+*
+* asyncBuffersGet - formatting buffers of the calling thread, freed at thread exit
+*/
+static AsyncBuffers* asyncBuffersGet(void)
+{
+  AsyncBuffers* bufP;
+
+  pthread_once(&asyncBuffersOnce, asyncBuffersKeyCreate);
+
+  bufP = (AsyncBuffers*) pthread_getspecific(asyncBuffersKey);
+  if (bufP == NULL)
+  {
+    bufP = (AsyncBuffers*) malloc(sizeof(AsyncBuffers));
+    if (bufP != NULL)
+    {
+      pthread_setspecific(asyncBuffersKey, bufP);
+    }
+  }
+
+  return bufP;
+}
+
+
+
+/* ****************************************************************************
+*
+* asyncWritev - writes all the iovecs, retrying on partial writes
+*/
+static void asyncWritev(int fd, struct iovec* iov, int iovcnt)
+{
+  while (iovcnt > 0)
+  {
+    ssize_t nb = writev(fd, iov, iovcnt);
+
+    if (nb == -1)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+
+      printf("LOG error: writev(%d): %s\n", fd, strerror(errno));
+      return;
+    }
+
+    while ((iovcnt > 0) && (nb >= (ssize_t) iov->iov_len))
+    {
+      nb -= iov->iov_len;
+      ++iov;
+      --iovcnt;
+    }
+
+    if (iovcnt > 0)
+    {
+      iov->iov_base  = (char*) iov->iov_base + nb;
+      iov->iov_len  -= nb;
+    }
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* asyncOverflowReport - logs the lines lost since the last report, if any
+*
+* To be called with the log semaphore taken.
+*/
+static void asyncOverflowReport(void)
+{
+  unsigned long long  overflows = asyncRing.overflows;
+  AsyncBuffers*       bufP;
+  char                text[128];
+
+  if ((overflows == asyncReported) || ((bufP = asyncBuffersGet()) == NULL))
+  {
+    return;
+  }
+
+  snprintf(text, sizeof(text), "%llu log lines lost (asynchronous log ring full)", overflows - asyncReported);
+  asyncReported = overflows;
+
+  for (int i = 0; i < FDS_MAX; i++)
+  {
+    if (fdSkip(i, 'W'))
+    {
+      continue;
+    }
+
+    bufP->line[0] = 0;
+    if (lmLineBuild(i, bufP->line, bufP->format, text, 'W', "logMsg.cpp", __LINE__, __FUNCTION__, 0, NULL) == false)
+    {
+      continue;
+    }
+
+    if (fds[i].write != NULL)
+    {
+      fds[i].write(bufP->line);
+    }
+    else
+    {
+      struct iovec iov;
+
+      iov.iov_base = bufP->line;
+      iov.iov_len  = strlen(bufP->line);
+
+      lseek(fds[i].fd, 0, SEEK_END);
+      asyncWritev(fds[i].fd, &iov, 1);
+    }
+  }
+
+  ++logLines;
+}
+
+
+
+/* ****************************************************************************
+*
+* asyncDrain - writes all the lines in the ring
+*
+* To be called with the log semaphore taken, which makes the caller the only
+* consumer of the ring. Returns the number of lines written.
+*/
+static int asyncDrain(void)
+{
+  int total = 0;
+
+  asyncOverflowReport();
+
+  while (true)
+  {
+    LmRingSlot*  batch[ASYNC_BATCH];
+    int          n = lmRingTake(&asyncRing, batch, ASYNC_BATCH);
+
+    if (n == 0)
+    {
+      break;
+    }
+
+    for (int i = 0; i < FDS_MAX; i++)
+    {
+      struct iovec  iov[ASYNC_BATCH];
+      int           iovcnt = 0;
+
+      if (fds[i].state != Occupied)
+      {
+        continue;
+      }
+
+      for (int ix = 0; ix < n; ix++)
+      {
+        if (batch[ix]->index != i)
+        {
+          continue;
+        }
+
+        if (fds[i].write != NULL)
+        {
+          fds[i].write(lmRingSlotLine(batch[ix]));
+          continue;
+        }
+
+        iov[iovcnt].iov_base = lmRingSlotLine(batch[ix]);
+        iov[iovcnt].iov_len  = batch[ix]->len;
+        ++iovcnt;
+      }
+
+      if (iovcnt > 0)
+      {
+        lseek(fds[i].fd, 0, SEEK_END);
+        asyncWritev(fds[i].fd, iov, iovcnt);
+      }
+    }
+
+    // The lines are written from the ring storage, so the slots are given back only now
+    lmRingGive(&asyncRing, batch, n);
+
+    total += n;
+  }
+
+  logLines += total;
+
+  return total;
+}
+
+
+
+/* ****************************************************************************
+*
+* asyncWriterMain - the writer thread
+*/
+static void* asyncWriterMain(void* vP)
+{
+  while (true)
+  {
+    int written;
+
+    semTake();
+    written = asyncDrain();
+    semGive();
+
+    if (written != 0)
+    {
+      if ((doClear == true) && (logLines >= atLines))
+      {
+        for (int i = 0; i < FDS_MAX; i++)
+        {
+          if ((fds[i].state == Occupied) && (fds[i].type == Fichero))
+          {
+            lmClear(i, keepLines, lastLines);
+          }
+        }
+      }
+
+      continue;
+    }
+
+    if (asyncStopping)
+    {
+      break;
+    }
+
+    //
+    // Nothing to write: sleep until a producer wakes us up. The timeout covers a
+    // line pushed between the ring check and the setting of asyncWriterIdle
+    //
+    struct timespec  deadline;
+
+    asyncWriterIdle = 1;
+    __sync_synchronize();
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += ASYNC_IDLE_MS * 1000000;
+    if (deadline.tv_nsec >= 1000000000)
+    {
+      deadline.tv_sec  += 1;
+      deadline.tv_nsec -= 1000000000;
+    }
+
+    sem_timedwait(&asyncWakeSem, &deadline);
+    asyncWriterIdle = 0;
+  }
+
+  return NULL;
+}
+
+
+
+/* ****************************************************************************
+*
+* lmOutAsync - formats a message for each log fd and pushes the lines into the ring
+*/
+static LmStatus lmOutAsync
+(
+  char*        text,
+  char         type,
+  const char*  file,
+  int          lineNo,
+  const char*  fName,
+  int          tLev,
+  const char*  stre
+)
+{
+  AsyncBuffers* bufP = asyncBuffersGet();
+
+  if (bufP == NULL)
+  {
+    return LmsMalloc;
+  }
+
+  for (int i = 0; i < FDS_MAX; i++)
+  {
+    if (fdSkip(i, type))
+    {
+      continue;
+    }
+
+    bufP->line[0] = 0;
+    if (lmLineBuild(i, bufP->line, bufP->format, text, type, file, lineNo, fName, tLev, stre) == false)
+    {
+      continue;
+    }
+
+    // Lost if the ring is full (counted in asyncRing.overflows)
+    lmRingPush(&asyncRing, i, bufP->line, strlen(bufP->line));
+  }
+
+  if ((asyncWriterIdle == 1) && __sync_bool_compare_and_swap(&asyncWriterIdle, 1, 0))
+  {
+    sem_post(&asyncWakeSem);
+  }
+
+  return LmsOk;
+}
+
+
+
+/* ****************************************************************************
+*
+* lmAsyncStart - starts the asynchronous log writer, with a ring of (at least) ringSize lines
+*
+* To be called once, after the log fds are registered and after any fork().
+*/
+LmStatus lmAsyncStart(int ringSize)
+{
+  if (asyncRing.slots != NULL)
+  {
+    return LmsOk;
+  }
+
+  if (lmRingInit(&asyncRing, ringSize) == false)
+  {
+    return LmsMalloc;
+  }
+
+  sem_init(&asyncWakeSem, 0, 0);
+
+  if (pthread_create(&asyncWriter, NULL, asyncWriterMain, NULL) != 0)
+  {
+    lmRingRelease(&asyncRing);
+    return LmsNull;
+  }
+
+  asyncOn = true;
+
+  return LmsOk;
+}
+
+
+
+/* ****************************************************************************
+*
+* lmAsyncFlush - writes the lines in the ring of the asynchronous log writer, if any
+*/
+void lmAsyncFlush(void)
+{
+  if (asyncRing.slots == NULL)
+  {
+    return;
+  }
+
+  semTake();
+  asyncDrain();
+  semGive();
+}
+
+
+
+/* ****************************************************************************
+*
+* lmAsyncStop - stops the asynchronous log writer, writing what is in its ring
+*
+* Lines logged after this are written synchronously.
+*/
+void lmAsyncStop(void)
+{
+  if ((asyncRing.slots == NULL) || (asyncOn == false))
+  {
+    return;
+  }
+
+  asyncOn       = false;
+  asyncStopping = true;
+  sem_post(&asyncWakeSem);
+  pthread_join(asyncWriter, NULL);
+
+  lmAsyncFlush();
+}
+
+
+
+/* ****************************************************************************
+*
+* lmAsyncOverflowsGet - lines dropped because the ring of the asynchronous log writer was full
+*/
+unsigned long long lmAsyncOverflowsGet(void)
+{
+  return asyncRing.overflows;
+}
+
+
+
 /* ****************************************************************************
 *
 * lmOut -
@@ -2286,19 +2808,11 @@ LmStatus lmOut
   POINTER_CHECK(text);
 
   int   i;
-  char* line = (char*) calloc(1, LINE_MAX);
+  char* line;
   int   sz;
-  char* format = (char*) calloc(1, FORMAT_LEN + 1);
+  char* format;
   char* tmP;
 
-  if ((line == NULL) || (format == NULL))
-  {
-    if (line   != NULL)   free(line);
-    if (format != NULL)   free(format);
-
-    return LmsNull;
-  }
-
   tmP = strrchr((char*) file, '/');
   if (tmP != NULL)
   {
@@ -2308,16 +2822,37 @@ LmStatus lmOut
   if (inSigHandler && (type != 'X' || type != 'x'))
   {
     lmAddMsgBuf(text, type, file, lineNo, fName, tLev, (char*) stre);
-    free(line);
-    free(format);
-
     return LmsOk;
   }
 
+  if ((asyncOn == true) && (type != 'X') && (type != 'x') && (lmOutHook == NULL) &&
+      !((type == 'W') && (warningFunction != NULL)) &&
+      !(((type == 'E') || (type == 'P')) && (errorFunction != NULL)))
+  {
+    return lmOutAsync(text, type, file, lineNo, fName, tLev, stre);
+  }
+
+  line   = (char*) calloc(1, LINE_MAX);
+  format = (char*) calloc(1, FORMAT_LEN + 1);
+
+  if ((line == NULL) || (format == NULL))
+  {
+    if (line   != NULL)   free(line);
+    if (format != NULL)   free(format);
+
+    return LmsNull;
+  }
+
   memset(format, 0, FORMAT_LEN + 1);
 
   semTake();
 
+  // Lines pending in the asynchronous writer ring go first (always for LM_X)
+  if (asyncRing.slots != NULL)
+  {
+    asyncDrain();
+  }
+
   if ((type != 'H') && lmOutHook && lmOutHookActive == true)
   {
     time_t secondsNow = time(NULL);
@@ -2329,56 +2864,14 @@ LmStatus lmOut
 
   for (i = 0; i < FDS_MAX; i++)
   {
-    if (fds[i].state != Occupied)
+    if (fdSkip(i, type))
     {
       continue;
     }
 
-    if ((fds[i].type == Stdout) && (fds[i].onlyErrorAndVerbose == true))
+    if (lmLineBuild(i, line, format, text, type, file, lineNo, fName, tLev, stre) == false)
     {
-      if ((type == 'T') ||
-          (type == 'D') ||
-          (type == 'H') ||
-          (type == 'M') ||
-          (type == 't')
-        )
-      {
-        continue;
-      }
-    }
-
-    if (type == 'R')
-    {
-      if (text[1] != ':')
-      {
-        snprintf(line, LINE_MAX, "R: %s\n%c", text, 0);
-      }
-      else
-      {
-        snprintf(line, LINE_MAX, "%s\n%c", text, 0);
-      }
-    }
-    else
-    {
-      /* Danger: 'format' might be too short ... */
-      if (lmLineFix(i, format, FORMAT_LEN, type, file, lineNo, fName, tLev) == NULL)
-      {
-        continue;
-      }
-
-      if ((strlen(format) + strlen(text) + strlen(line)) > LINE_MAX)
-      {
-        snprintf(line, LINE_MAX, "%s[%d]: %s\n%c", file, lineNo, "LM ERROR: LINE TOO LONG", 0);
-      }
-      else
-      {
-        snprintf(line, LINE_MAX, format, text);
-      }
-    }
-
-    if (stre != NULL)
-    {
-      strncat(line, stre, LINE_MAX - strlen(stre) - 1);
+      continue;
     }
 
     sz = strlen(line);
@@ -1925,4 +1925,36 @@ inline void lmTransactionEnd()
 */
 extern const char* lmSemGet(void);
 
+
+
+/* ****************************************************************************
+*
+* lmAsyncStart - start the asynchronous log writer (ring of ringSize lines)
+*/
+extern LmStatus lmAsyncStart(int ringSize);
+
+
+
+/* ****************************************************************************
+*
+* lmAsyncFlush - write the lines pending in the asynchronous log writer
+*/
+extern void lmAsyncFlush(void);
+
+
+
+/* ****************************************************************************
+*
+* lmAsyncStop - stop the asynchronous log writer, writing its pending lines
+*/
+extern void lmAsyncStop(void);
+
+
+
+/* ****************************************************************************
+*
+* lmAsyncOverflowsGet - lines lost as the asynchronous log writer ring was full
+*/
+extern unsigned long long lmAsyncOverflowsGet(void);
+
 #endif  // SRC_LIB_LOGMSG_LOGMSG_H_
@@ -121,6 +121,7 @@ typedef enum TraceLevels
   LmtSubCache = 210,
   LmtSubCacheMatch,
   LmtCacheSync,
+  LmtRegexCache,
 
   /* Others (>=230) */
   LmtCm = 230,
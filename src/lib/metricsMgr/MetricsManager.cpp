@@ -24,6 +24,7 @@
 */
 #include <stdint.h>   // int64_t et al
 #include <sys/time.h>
+#include <string.h>
 
 #include <utility>
 #include <string>
@@ -48,11 +49,112 @@
 
 
 
+/* ****************************************************************************
+*
+* metricNameV - the metrics, the index of a metric in this vector is its counter in MetricsBlock
+*/
+static const char* metricNameV[] =
+{
+  METRIC_TRANS_IN,
+  METRIC_TRANS_IN_REQ_SIZE,
+  METRIC_TRANS_IN_RESP_SIZE,
+  METRIC_TRANS_IN_ERRORS,
+  _METRIC_TOTAL_SERVICE_TIME,
+  METRIC_TRANS_OUT,
+  METRIC_TRANS_OUT_REQ_SIZE,
+  METRIC_TRANS_OUT_RESP_SIZE,
+  METRIC_TRANS_OUT_ERRORS
+};
+
+#define METRIC_NAMES (sizeof(metricNameV) / sizeof(metricNameV[0]))
+
+
+
+/* ****************************************************************************
+*
+* MetricsThreadCacheItem - a block recently used by the thread
+*/
+typedef struct MetricsThreadCacheItem
+{
+  MetricsBlock*  blockP;
+  unsigned int   generation;
+} MetricsThreadCacheItem;
+
+static __thread MetricsThreadCacheItem threadCache[METRICS_THREAD_CACHE];
+
+
+
+/* ****************************************************************************
+*
+* metricsGeneration -
+*
+* Source of the generations of all the managers, so a block cached by a thread is never
+* taken as belonging to another manager (or to the same one after release()).
+*/
+static unsigned int metricsGeneration = 0;
+
+
+
+/* ****************************************************************************
+*
+* generationNew -
+*/
+static unsigned int generationNew(void)
+{
+  return __sync_add_and_fetch(&metricsGeneration, 1);
+}
+
+
+
+/* ****************************************************************************
+*
+* metricIndex - index of the counter of a metric, -1 if not a known metric
+*/
+static int metricIndex(const std::string& metric)
+{
+  for (unsigned int ix = 0; ix < METRIC_NAMES; ++ix)
+  {
+    if (strcmp(metric.c_str(), metricNameV[ix]) == 0)
+    {
+      return ix;
+    }
+  }
+
+  return -1;
+}
+
+
+
+/* ****************************************************************************
+*
+* blockHash - hash (FNV-1a) of the raw service/subservice of a block
+*/
+static unsigned int blockHash(const std::string& srv, const std::string& subServ)
+{
+  unsigned int h = 2166136261U;
+
+  for (const char* cP = srv.c_str(); *cP != 0; ++cP)
+  {
+    h = (h ^ (unsigned char) *cP) * 16777619U;
+  }
+
+  h = (h ^ '|') * 16777619U;
+
+  for (const char* cP = subServ.c_str(); *cP != 0; ++cP)
+  {
+    h = (h ^ (unsigned char) *cP) * 16777619U;
+  }
+
+  return h;
+}
+
+
+
 /* ****************************************************************************
 *
 * MetricsManager::MetricsManager -
 */
-MetricsManager::MetricsManager(): on(false), semWaitStatistics(false), semWaitTime(0)
+MetricsManager::MetricsManager(): generation(generationNew()), on(false), semWaitStatistics(false), semWaitTime(0)
 {
 }
 
@@ -99,8 +201,8 @@ bool MetricsManager::subServiceValid(const std::string& subsrv)
 * MetricsManager::init -
 *
 * NOTE
-*   The semaphore is created even though the metrics manager is not turned on.
-*   It's only one sys-call, and this way, the broker is prepared to receive 'on/off'
+*   The semaphores are created even though the metrics manager is not turned on.
+*   It's only a few sys-calls, and this way, the broker is prepared to receive 'on/off'
 *   via REST.
 */
 bool MetricsManager::init(bool _on, bool _semWaitStatistics)
@@ -108,10 +210,13 @@ bool MetricsManager::init(bool _on, bool _semWaitStatistics)
   on                 = _on;
   semWaitStatistics  = _semWaitStatistics;
 
-  if (sem_init(&sem, 0, 1) == -1)
+  for (int ix = 0; ix < METRICS_SHARDS; ++ix)
   {
-    LM_E(("Runtime Error (error initializing 'metrics mgr' semaphore: %s)", strerror(errno)));
-    return false;
+    if (sem_init(&shard[ix].sem, 0, 1) == -1)
+    {
+      LM_E(("Runtime Error (error initializing 'metrics mgr' semaphore: %s)", strerror(errno)));
+      return false;
+    }
   }
 
   return true;
@@ -123,7 +228,7 @@ bool MetricsManager::init(bool _on, bool _semWaitStatistics)
 *
 * MetricsManager::semTake - 
 */
-void MetricsManager::semTake(void)
+void MetricsManager::semTake(MetricsShard* shardP)
 {
   if (semWaitStatistics)
   {
@@ -131,15 +236,15 @@ void MetricsManager::semTake(void)
     struct timeval end;
 
     gettimeofday(&start, NULL);
-    sem_wait(&sem);
+    sem_wait(&shardP->sem);
     gettimeofday(&end, NULL);
 
     // Add semaphore waiting time to the accumulator (semWaitTime is in microseconds)
-    semWaitTime += (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_usec - start.tv_usec);
+    __sync_fetch_and_add(&semWaitTime, (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_usec - start.tv_usec));
   }
   else
   {
-    sem_wait(&sem);
+    sem_wait(&shardP->sem);
   }
 }
 
@@ -149,9 +254,9 @@ void MetricsManager::semTake(void)
 *
 * MetricsManager::semGive - 
 */
-void MetricsManager::semGive(void)
+void MetricsManager::semGive(MetricsShard* shardP)
 {
-  sem_post(&sem);
+  sem_post(&shardP->sem);
 }
 
 
@@ -232,66 +337,113 @@ bool MetricsManager::servicePathForMetrics(const std::string& spathIn, std::stri
 
 /* ****************************************************************************
 *
-* MetricsManager::add -
+* MetricsManager::blockLookup -
+*
+* Returns the counter block of a service/subservice, creating it if needed, or NULL if
+* they are not valid for metrics. The semaphore of the shard is only taken if the block
+* is not among the ones recently used by the calling thread.
 *
 * FIXME P4: About the calls to serviceValid and subServiceValid:
 *   we check that 'srv' and 'subServ' are legal names, and if not, metrics are skipped.
-*   Doing this each time add() is called is not optimal for performance.
+*   This is only done when the block is created, but invalid names are checked each time.
 *   The github issue #2781 is about better solutions for this.
 *   Note that the call to subServiceValid is inside servicePathForMetrics()
 */
-void MetricsManager::add(const std::string& srv, const std::string& subServ, const std::string& metric, uint64_t value)
+MetricsBlock* MetricsManager::blockLookup(const std::string& srv, const std::string& subServ)
 {
-  std::string subService = "not-set";
+  unsigned int             h      = blockHash(srv, subServ);
+  MetricsThreadCacheItem*  itemP  = &threadCache[h % METRICS_THREAD_CACHE];
+  MetricsShard*            shardP = &shard[(h / METRICS_THREAD_CACHE) % METRICS_SHARDS];
+  MetricsBlock*            blockP = itemP->blockP;
 
-  if (on == false)
+  if ((blockP != NULL) && (itemP->generation == generation) && (blockP->rawService == srv) && (blockP->rawSubService == subServ))
   {
-    return;
+    return blockP;
   }
 
-  if (serviceValid(srv) == false)
+  std::string                                     key = srv + "|" + subServ;
+  std::map<std::string, MetricsBlock*>::iterator  it;
+
+  blockP = NULL;
+
+  semTake(shardP);
+  if ((it = shardP->blocks.find(key)) != shardP->blocks.end())
   {
-    return;
+    blockP = it->second;
   }
+  semGive(shardP);
 
-  if (servicePathForMetrics(subServ, &subService) == false)
+  if (blockP == NULL)
   {
-    return;
+    std::string subService = "not-set";
+
+    if ((serviceValid(srv) == false) || (servicePathForMetrics(subServ, &subService) == false))
+    {
+      return NULL;
+    }
+
+    MetricsBlock* newBlockP = new MetricsBlock();
+
+    newBlockP->rawService    = srv;
+    newBlockP->rawSubService = subServ;
+    newBlockP->service       = srv;
+    newBlockP->subService    = subService;
+    memset((void*) newBlockP->counter, 0, sizeof(newBlockP->counter));
+
+    // Another thread may have created the block in the meantime
+    semTake(shardP);
+    if ((it = shardP->blocks.find(key)) != shardP->blocks.end())
+    {
+      blockP = it->second;
+    }
+    else
+    {
+      shardP->blocks[key] = newBlockP;
+      blockP              = newBlockP;
+    }
+    semGive(shardP);
+
+    if (blockP != newBlockP)
+    {
+      delete newBlockP;
+    }
   }
 
-  semTake();
+  itemP->blockP     = blockP;
+  itemP->generation = generation;
+
+  return blockP;
+}
+
 
 
-  // Do we have the service in the map?
-  if (metrics.find(srv) == metrics.end())
+/* ****************************************************************************
+*
+* MetricsManager::add -
+*/
+void MetricsManager::add(const std::string& srv, const std::string& subServ, const std::string& metric, uint64_t value)
+{
+  if (on == false)
   {
-    // not found: create it
-    metrics[srv] = new std::map<std::string, std::map<std::string, uint64_t>*>;
+    return;
   }
 
-  // Do we have the subservice in the map?
-  if (metrics[srv]->find(subService) == metrics[srv]->end())
+  int metricIx = metricIndex(metric);
+
+  if (metricIx == -1)
   {
-    //
-    // Not Found: create it
-    //
-    metrics[srv]->insert(std::pair<std::string, std::map<std::string, uint64_t>*>
-                         (subService,
-                          new std::map<std::string, uint64_t>));
+    LM_E(("Runtime Error (unknown metric '%s')", metric.c_str()));
+    return;
   }
 
-  // Do we have the metric in the map?
-  if (metrics[srv]->at(subService)->find(metric) == metrics[srv]->at(subService)->end())
+  MetricsBlock* blockP = blockLookup(srv, subServ);
+
+  if (blockP == NULL)
   {
-    //
-    // Not Found: create it
-    //
-    metrics[srv]->at(subService)->insert(std::pair<std::string, uint64_t>(metric, 0));
+    return;
   }
 
-  metrics[srv]->at(subService)->at(metric) += value;
-
-  semGive();
+  __sync_fetch_and_add(&blockP->counter[metricIx], value);
 }
 
 
@@ -299,32 +451,25 @@ void MetricsManager::add(const std::string& srv, const std::string& subServ, con
 /* ****************************************************************************
 *
 * MetricsManager::_reset -
+*
+* Blocks are zeroed, not removed, as most likely they will be needed soon after the reset.
 */
 void MetricsManager::_reset(void)
 {
-  //
-  // Three iterators needed to iterate over the 'triple-map' metrics:
-  //   serviceIter      to iterate over all services
-  //   subServiceIter   to iterate over all sub-services of a service
-  //   metricIter       to iterate over all metrics of a sub-service
-  //
-  std::map<std::string, std::map<std::string, std::map<std::string, uint64_t>*>*>::iterator  serviceIter;
-  std::map<std::string, std::map<std::string, uint64_t>*>::iterator                          subServiceIter;
-  std::map<std::string, uint64_t>::iterator                                                  metricIter;
-
-  for (serviceIter = metrics.begin(); serviceIter != metrics.end(); ++serviceIter)
+  for (int sIx = 0; sIx < METRICS_SHARDS; ++sIx)
   {
-    std::map<std::string, std::map<std::string, uint64_t>*>* servMap  = serviceIter->second;
+    std::map<std::string, MetricsBlock*>::iterator  it;
+    MetricsShard*                                   shardP = &shard[sIx];
 
-    for (subServiceIter = servMap->begin(); subServiceIter != servMap->end(); ++subServiceIter)
+    semTake(shardP);
+    for (it = shardP->blocks.begin(); it != shardP->blocks.end(); ++it)
     {
-      std::map<std::string, uint64_t>* metricMap  = subServiceIter->second;
-
-      for (metricIter = metricMap->begin(); metricIter != metricMap->end(); ++metricIter)
+      for (unsigned int ix = 0; ix < METRIC_NAMES; ++ix)
       {
-        metricIter->second = 0;
+        __sync_fetch_and_and(&it->second->counter[ix], 0);
       }
     }
+    semGive(shardP);
   }
 }
 
@@ -382,7 +527,7 @@ static std::string metricsRender(std::map<std::string, uint64_t>* metricsMap)
 *
 * MetricsManager::_toJson -
 */
-std::string MetricsManager::_toJson(void)
+std::string MetricsManager::_toJson(bool doReset)
 {
   //
   // Three iterators needed to iterate over the 'triple-map' metrics:
@@ -390,27 +535,56 @@ std::string MetricsManager::_toJson(void)
   //   subServiceIter   to iterate over all sub-services of a service
   //   metricIter       to iterate over all metrics of a sub-service
   //
-  std::map<std::string, std::map<std::string, std::map<std::string, uint64_t>*>*>::iterator  serviceIter;
-  std::map<std::string, std::map<std::string, uint64_t>*>::iterator                          subServiceIter;
-  std::map<std::string, uint64_t>::iterator                                                  metricIter;
-  JsonHelper                                                                                 top;
-  JsonHelper                                                                                 services;
-  std::map<std::string, uint64_t>                                                            sum;
-  std::map<std::string, std::map<std::string, uint64_t> >                                    subServCrossTenant;
+  std::map<std::string, std::map<std::string, std::map<std::string, uint64_t> > >             metrics;
+  std::map<std::string, std::map<std::string, std::map<std::string, uint64_t> > >::iterator   serviceIter;
+  std::map<std::string, std::map<std::string, uint64_t> >::iterator                           subServiceIter;
+  std::map<std::string, uint64_t>::iterator                                                   metricIter;
+  JsonHelper                                                                                  top;
+  JsonHelper                                                                                  services;
+  std::map<std::string, uint64_t>                                                             sum;
+  std::map<std::string, std::map<std::string, uint64_t> >                                     subServCrossTenant;
+
+  //
+  // Merge the counter blocks into the 'triple-map'. Zeroed counters are skipped (they would
+  // not be rendered anyway), but a service/subservice is in the map even if all its counters are zero
+  //
+  for (int sIx = 0; sIx < METRICS_SHARDS; ++sIx)
+  {
+    std::map<std::string, MetricsBlock*>::iterator  it;
+    MetricsShard*                                   shardP = &shard[sIx];
+
+    semTake(shardP);
+    for (it = shardP->blocks.begin(); it != shardP->blocks.end(); ++it)
+    {
+      MetricsBlock*                     blockP    = it->second;
+      std::map<std::string, uint64_t>*  metricMap = &metrics[blockP->service][blockP->subService];
+
+      for (unsigned int ix = 0; ix < METRIC_NAMES; ++ix)
+      {
+        uint64_t value = doReset? __sync_fetch_and_and(&blockP->counter[ix], 0) : __sync_fetch_and_add(&blockP->counter[ix], 0);
+
+        if (value != 0)
+        {
+          (*metricMap)[metricNameV[ix]] += value;
+        }
+      }
+    }
+    semGive(shardP);
+  }
 
   for (serviceIter = metrics.begin(); serviceIter != metrics.end(); ++serviceIter)
   {
     JsonHelper                                                subServiceTop;
     JsonHelper                                                jhSubService;
     std::string                                               service        = serviceIter->first;
-    std::map<std::string, std::map<std::string, uint64_t>*>*  servMap        = serviceIter->second;
+    std::map<std::string, std::map<std::string, uint64_t> >*  servMap        = &serviceIter->second;
     std::map<std::string, uint64_t>                           serviceSum;
 
     for (subServiceIter = servMap->begin(); subServiceIter != servMap->end(); ++subServiceIter)
     {
       JsonHelper                        jhMetrics;
       std::string                       subService           = subServiceIter->first;
-      std::map<std::string, uint64_t>*  metricMap            = subServiceIter->second;
+      std::map<std::string, uint64_t>*  metricMap            = &subServiceIter->second;
 
       for (metricIter = metricMap->begin(); metricIter != metricMap->end(); ++metricIter)
       {
@@ -524,19 +698,24 @@ bool MetricsManager::isOn(void)
 /* ****************************************************************************
 *
 * MetricsManager::semStateGet - 
+*
+* "taken" if the semaphore of any shard is taken
 */
 const char* MetricsManager::semStateGet(void)
 {
-  int value;
-
-  if (sem_getvalue(&sem, &value) == -1)
+  for (int ix = 0; ix < METRICS_SHARDS; ++ix)
   {
-    return "error";
-  }
+    int value;
 
-  if (value == 0)
-  {
-    return "taken";
+    if (sem_getvalue(&shard[ix].sem, &value) == -1)
+    {
+      return "error";
+    }
+
+    if (value == 0)
+    {
+      return "taken";
+    }
   }
 
   return "free";
@@ -547,6 +726,11 @@ const char* MetricsManager::semStateGet(void)
 /* ****************************************************************************
 *
 * MetricsManager::release -
+*
+* NOTE
+*   The blocks the threads keep in their caches are invalidated by the change of 'generation',
+*   but a thread could still be using one of them in add() while it is deleted, so this
+*   function is only to be called once no more requests are being processed.
 */
 void MetricsManager::release(void)
 {
@@ -555,33 +739,21 @@ void MetricsManager::release(void)
     return;
   }
 
-  semTake();
-
-  //
-  // Two iterators needed to iterate over metrics, clearing all maps:
-  //   serviceIter      to iterate over all services
-  //   subServiceIter   to iterate over all sub-services of a service
-  //
-  std::map<std::string, std::map<std::string, std::map<std::string, uint64_t>*>*>::iterator  serviceIter;
-  std::map<std::string, std::map<std::string, uint64_t>*>::iterator                          subServiceIter;
+  generation = generationNew();
 
-  for (serviceIter = metrics.begin(); serviceIter != metrics.end(); ++serviceIter)
+  for (int sIx = 0; sIx < METRICS_SHARDS; ++sIx)
   {
-    std::map<std::string, std::map<std::string, uint64_t>*>* servMap  = serviceIter->second;
+    std::map<std::string, MetricsBlock*>::iterator  it;
+    MetricsShard*                                   shardP = &shard[sIx];
 
-    for (subServiceIter = servMap->begin(); subServiceIter != servMap->end(); ++subServiceIter)
+    semTake(shardP);
+    for (it = shardP->blocks.begin(); it != shardP->blocks.end(); ++it)
     {
-      std::map<std::string, uint64_t>*  metricMap  = subServiceIter->second;
-
-      metricMap->clear();
-      delete metricMap;
+      delete it->second;
     }
-    servMap->clear();
-    delete servMap;
+    shardP->blocks.clear();
+    semGive(shardP);
   }
-  metrics.clear();
-
-  semGive();
 }
 
 
@@ -597,9 +769,7 @@ void MetricsManager::reset(void)
     return;
   }
 
-  semTake();
   _reset();
-  semGive();
 }
 
 
@@ -607,6 +777,9 @@ void MetricsManager::reset(void)
 /* ****************************************************************************
 *
 * MetricsManager::toJson -
+*
+* If doReset, each counter is read and zeroed in a single atomic operation, so no
+* increment done meanwhile is lost.
 */
 std::string MetricsManager::toJson(bool doReset)
 {
@@ -615,16 +788,5 @@ std::string MetricsManager::toJson(bool doReset)
     return "";
   }
 
-  semTake();
-
-  std::string  s = _toJson();
-
-  if (doReset)
-  {
-    _reset();
-  }
-
-  semGive();
-
-  return s;
+  return _toJson(doReset);
 }
@@ -101,6 +101,64 @@
 
 
 
+/* ****************************************************************************
+*
+* METRICS_MAX - maximum number of different metrics (see metricNameV in MetricsManager.cpp)
+*/
+#define METRICS_MAX  16
+
+
+
+/* ****************************************************************************
+*
+* METRICS_SHARDS - number of shards of the counter blocks
+*/
+#define METRICS_SHARDS  16
+
+
+
+/* ****************************************************************************
+*
+* METRICS_THREAD_CACHE - number of counter blocks each thread remembers
+*/
+#define METRICS_THREAD_CACHE  8
+
+
+
+/* ****************************************************************************
+*
+* MetricsBlock -
+*
+* The counters of a service/subservice pair, as received in the request (rawService and
+* rawSubService). Different pairs may end up in the same service/subservice for metrics
+* (e.g. "/A" and "/A/#"), their counters are merged when rendered.
+*
+* The counters are only modified with atomic operations, so they can be incremented
+* without any lock. Blocks are never removed (only zeroed on reset) until release().
+*/
+typedef struct MetricsBlock
+{
+  std::string        rawService;
+  std::string        rawSubService;
+  std::string        service;
+  std::string        subService;
+  volatile uint64_t  counter[METRICS_MAX];
+} MetricsBlock;
+
+
+
+/* ****************************************************************************
+*
+* MetricsShard - the counter blocks whose raw service/subservice hash to the shard
+*/
+typedef struct MetricsShard
+{
+  sem_t                                 sem;
+  std::map<std::string, MetricsBlock*>  blocks;
+} MetricsShard;
+
+
+
 /* ****************************************************************************
 *
 * MetricsManager -
@@ -117,20 +175,26 @@
 *     for metrics
 * 11. Try to come up with better solution for metrics for requests using invalid service-path / tenant?
 *
+* The counters are kept in blocks (one per service/subservice) spread over METRICS_SHARDS
+* shards, each one with its own semaphore, that is only taken to look up a block the calling
+* thread has not used recently (each thread keeps the last blocks it used). The counters
+* themselves are incremented with atomic operations and merged into the service/subservice/metric
+* maps only when rendered.
 */
 class MetricsManager
 {
  private:
-  std::map<std::string, std::map<std::string, std::map<std::string, uint64_t>*>*>  metrics;
+  MetricsShard    shard[METRICS_SHARDS];
+  unsigned int    generation;         // unique among managers, changed on release(), to invalidate the thread caches
   bool            on;
-  sem_t           sem;
   bool            semWaitStatistics;
   int64_t         semWaitTime;        // measured in microseconds
 
-  void            semTake(void);
-  void            semGive(void);
+  void            semTake(MetricsShard* shardP);
+  void            semGive(MetricsShard* shardP);
+  MetricsBlock*   blockLookup(const std::string& srv, const std::string& subServ);
   void            _reset(void);
-  std::string     _toJson(void);
+  std::string     _toJson(bool doReset);
   bool            serviceValid(const std::string& srv);
   bool            subServiceValid(const std::string& subsrv);
   bool            servicePathForMetrics(const std::string& spath, std::string* subServiceP);
@@ -26,6 +26,8 @@
 #include <vector>
 #include <map>
 
+#include <sys/time.h>
+
 #include "mongo/client/dbclient.h"
 
 #include "logMsg/logMsg.h"
@@ -435,6 +437,23 @@ void setBlacklist(const Subscription& sub, BSONObjBuilder* b)
 
 
 
+/* ****************************************************************************
+*
+* setCoalesce -
+*
+* Only subscriptions with a coalescing window have the field
+*/
+void setCoalesce(const Subscription& sub, BSONObjBuilder* b)
+{
+  if (sub.notification.coalesceMs > 0)
+  {
+    b->append(CSUB_COALESCE, sub.notification.coalesceMs);
+    LM_T(LmtMongo, ("Subscription coalesceMs: %lu", sub.notification.coalesceMs));
+  }
+}
+
+
+
 /* ****************************************************************************
 *
 * setMetadata -
@@ -453,3 +472,25 @@ void setMetadata(const Subscription& sub, BSONObjBuilder* b)
   b->append(CSUB_METADATA, metadataArr);
   LM_T(LmtMongo, ("Subscription metadata: %s", metadataArr.toString().c_str()));
 }
+
+
+
+/* ****************************************************************************
+*
+* setModDate -
+*
+* Microseconds since the epoch of the last create/update of the subscription. The
+* subscription cache sync only reloads the subscriptions whose modDate has changed, so
+* the counters updated by mongoSubCountersUpdate() must not touch it.
+*/
+void setModDate(BSONObjBuilder* b)
+{
+  struct timeval  tv;
+  long long       modDate;
+
+  gettimeofday(&tv, NULL);
+  modDate = (long long) tv.tv_sec * 1000000 + tv.tv_usec;
+
+  b->append(CSUB_MODDATE, modDate);
+  LM_T(LmtMongo, ("Subscription modDate: %lld", modDate));
+}
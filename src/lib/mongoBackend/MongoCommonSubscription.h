@@ -185,10 +185,26 @@ extern void setBlacklist(const ngsiv2::Subscription& sub, mongo::BSONObjBuilder*
 
 
 
+/* ****************************************************************************
+*
+* setCoalesce -
+*/
+extern void setCoalesce(const ngsiv2::Subscription& sub, mongo::BSONObjBuilder* b);
+
+
+
 /* ****************************************************************************
 *
 * setMetadata -
 */
 extern void setMetadata(const ngsiv2::Subscription& sub, mongo::BSONObjBuilder* b);
 
+
+
+/* ****************************************************************************
+*
+* setModDate -
+*/
+extern void setModDate(mongo::BSONObjBuilder* b);
+
 #endif  // SRC_LIB_MONGOBACKEND_MONGOCOMMONSUBSCRIPTION_H_
@@ -44,10 +44,13 @@
 #include "apiTypesV2/HttpInfo.h"
 #include "alarmMgr/alarmMgr.h"
 #include "orionTypes/OrionValueType.h"
+#include "orionTypes/GeoFilter.h"
 #include "cache/subCache.h"
 #include "rest/StringFilter.h"
 #include "ngsi/Scope.h"
 #include "rest/uriParamNames.h"
+#include "ngsiNotify/NotificationRenderMemo.h"
+#include "ngsiNotify/NotificationCoalescer.h"
 
 #include "mongoBackend/connectionOperations.h"
 #include "mongoBackend/safeMongo.h"
@@ -58,6 +61,7 @@
 #include "mongoBackend/location.h"
 #include "mongoBackend/compoundValueBson.h"
 #include "mongoBackend/MongoCommonUpdate.h"
+#include "mongoBackend/mongoTypesCatalog.h"
 
 
 
@@ -78,6 +82,76 @@ using orion::CompoundValueNode;
 
 
 
+/* ****************************************************************************
+*
+* PendingWrite -
+*
+* A context element whose entity write has been added to an UpdateBatch. Once the write
+* is done, its response is completed and the subscriptions it triggers are notified.
+*/
+typedef struct PendingWrite
+{
+  ContextElement*                                ceP;
+  ContextElementResponse*                        cerP;
+  ContextElementResponse*                        notifyCerP;     // NULL if there is nothing to notify
+  std::map<std::string, TriggeredSubscription*>  subsToNotify;
+  bool                                           creation;
+  BSONObj                                        entity;         // created document or document before update
+  BSONObj                                        location;       // location.coords after the write (empty if none)
+} PendingWrite;
+
+
+
+/* ****************************************************************************
+*
+* updateBatchAdd -
+*
+* Adds the write of an entity (insert if 'creation', otherwise update of the entity
+* matching 'q' with 'doc') to the batch. The batch takes ownership of notifyCerP and
+* of the triggered subscriptions. In the update case, 'entity' is the document before
+* the update (used to update the entity types catalog once written). 'location' is the
+* location of the entity once written, used to check the georel of the subscriptions.
+*/
+static void updateBatchAdd
+(
+  UpdateBatch*                                    batchP,
+  bool                                            creation,
+  const BSONObj&                                  q,
+  const BSONObj&                                  doc,
+  const BSONObj&                                  entity,
+  const BSONObj&                                  location,
+  ContextElement*                                 ceP,
+  ContextElementResponse*                         cerP,
+  ContextElementResponse*                         notifyCerP,
+  std::map<std::string, TriggeredSubscription*>*  subsToNotifyP
+)
+{
+  BulkWriteOp    op;
+  PendingWrite*  pwP = new PendingWrite();
+
+  op.insert = creation;
+  op.upsert = false;
+  op.q      = q;
+  op.doc    = doc;
+
+  pwP->ceP        = ceP;
+  pwP->cerP       = cerP;
+  pwP->notifyCerP = notifyCerP;
+  pwP->creation   = creation;
+  pwP->entity     = creation? doc : entity;
+  pwP->location   = location;
+
+  if (subsToNotifyP != NULL)
+  {
+    pwP->subsToNotify.swap(*subsToNotifyP);
+  }
+
+  batchP->opV.push_back(op);
+  batchP->pendingV.push_back(pwP);
+}
+
+
+
 /* ****************************************************************************
 *
 * isNotCustomMetadata -
@@ -1031,74 +1105,6 @@ static bool deleteAttribute
 
 
 
-/* ****************************************************************************
-*
-* servicePathSubscriptionRegex -
-*
-* 1. If the incoming request is without service path, then only subscriptions without
-*    service path is a match (without or with '/#', or '/')
-* 2. If the incoming request has a service path, then the REGEX must be created:
-*    - Incoming: /a1/a2/a3
-*    - REGEX: ^/#$ | ^/a1/#$ | | ^/a1/a2/#$ | ^/a1/a2/a3/#$ | ^/a1/a2/a3$
-*
-*/
-static std::string servicePathSubscriptionRegex(const std::string& servicePath, std::vector<std::string>& spathV)
-{
-  std::string  spathRegex;
-  int          spathComponents = 0;
-
-  //
-  // Split Service Path in 'path components'
-  //
-  if (servicePath != "")
-  {
-    spathComponents = stringSplit(servicePath, '/', spathV);
-  }
-
-  if (spathComponents == 0)
-  {
-    spathRegex = "^$|^\\/#$|^\\/$";
-  }
-  else
-  {
-    //
-    // 1. Empty or '/#'
-    //
-    spathRegex = std::string("^$|^\\/#$");
-
-
-    //
-    // 2. The whole list /a | /a/b | /a/b/c  etc
-    //
-    for (int ix = 0; ix < spathComponents; ++ix)
-    {
-      spathRegex += std::string("|^");
-
-      for (int cIx = 0; cIx <= ix; ++cIx)
-      {
-        spathRegex += std::string("\\/") + spathV[cIx];
-      }
-
-      spathRegex += std::string("\\/#$");
-    }
-
-
-    //
-    // 3. EXACT service path
-    //
-    spathRegex += std::string("|^");
-    for (int cIx = 0; cIx < spathComponents; ++cIx)
-    {
-      spathRegex += std::string("\\/") + spathV[cIx];
-    }
-    spathRegex += std::string("$");
-  }
-
-  return spathRegex;
-}
-
-
-
 /* ****************************************************************************
 *
 * addTriggeredSubscriptions_withCache
@@ -1202,10 +1208,12 @@ static bool addTriggeredSubscriptions_withCache
                                                            aList,
                                                            cSubP->subscriptionId,
                                                            cSubP->tenant);
-    subP->blacklist = cSubP->blacklist;
-    subP->metadata  = cSubP->metadata;
+    subP->blacklist  = cSubP->blacklist;
+    subP->coalesceMs = cSubP->coalesceMs;
+    subP->metadata   = cSubP->metadata;
 
     subP->fillExpression(cSubP->expression.georel, cSubP->expression.geometry, cSubP->expression.coords);
+    subP->geoFilter = cSubP->expression.geoFilter;
 
     std::string errorString;
 
@@ -1427,15 +1435,8 @@ static bool addTriggeredSubscriptions_noCache
   const std::vector<std::string>&                servicePathV
 )
 {
-  std::string               servicePath     = (servicePathV.size() > 0)? servicePathV[0] : "";
-  std::vector<std::string>  spathV;
-  std::string               spathRegex      = servicePathSubscriptionRegex(servicePath, spathV);
-
-
-  //
-  // Create the REGEX for the Service Path
-  //
-  spathRegex = std::string("/") + spathRegex + "/";
+  std::string  servicePath = (servicePathV.size() > 0)? servicePathV[0] : "";
+  BSONObj      spBson      = servicePathSubscriptionQuery(servicePath);
 
 
   /* Build query */
@@ -1443,8 +1444,6 @@ static bool addTriggeredSubscriptions_noCache
   std::string entTypeQ      = CSUB_ENTITIES   "." CSUB_ENTITY_TYPE;
   std::string entPatternQ   = CSUB_ENTITIES   "." CSUB_ENTITY_ISPATTERN;
   std::string typePatternQ  = CSUB_ENTITIES   "." CSUB_ENTITY_ISTYPEPATTERN;
-  std::string inRegex       = "{ $in: [ " + spathRegex + ", null ] }";
-  BSONObj     spBson        = mongo::fromjson(inRegex);
 
   /* Query is an $or of 4 sub-clauses:
    *
@@ -1575,7 +1574,8 @@ static bool addTriggeredSubscriptions_noCache
           httpInfo,
           subToAttributeList(sub), "", "");
 
-      trigs->blacklist = sub.hasField(CSUB_BLACKLIST)? getBoolFieldF(sub, CSUB_BLACKLIST) : false;
+      trigs->blacklist  = sub.hasField(CSUB_BLACKLIST)? getBoolFieldF(sub, CSUB_BLACKLIST) : false;
+      trigs->coalesceMs = sub.hasField(CSUB_COALESCE)? getIntOrLongFieldAsLongF(sub, CSUB_COALESCE) : 0;
 
       if (sub.hasField(CSUB_METADATA))
       {
@@ -1593,6 +1593,7 @@ static bool addTriggeredSubscriptions_noCache
         std::string coords   = expr.hasField(CSUB_EXPR_COORDS) ? getStringFieldF(expr, CSUB_EXPR_COORDS) : "";
 
         trigs->fillExpression(georel, geometry, coords);
+        trigs->geoFilter.compile(geometry, coords, georel);
 
         // Parsing q
         if (q != "")
@@ -1708,6 +1709,10 @@ static bool addTriggeredSubscriptions
 * This method returns true if the notification was actually sent. Otherwise, false
 * is returned. This is used in the caller to know if lastNotification field in the
 * subscription document in csubs collection has to be modified or not.
+*
+* Notifications of subscriptions with a coalescing window are handed to the notification
+* coalescer (if the broker has one), to be sent along with the other entities notified in
+* the window. They count as sent.
 */
 static bool processOnChangeConditionForUpdateContext
 (
@@ -1721,7 +1726,8 @@ static bool processOnChangeConditionForUpdateContext
   const std::string&               fiwareCorrelator,
   const std::vector<std::string>&  attrsOrder,
   const ngsiv2::HttpInfo&          httpInfo,
-  bool                             blacklist = false
+  bool                             blacklist = false,
+  long long                        coalesceMs = 0
 )
 {
   NotifyContextRequest   ncr;
@@ -1771,6 +1777,15 @@ static bool processOnChangeConditionForUpdateContext
   ncr.originator.set("localhost");
 
   ncr.subscriptionId.set(subId);
+
+  NotificationCoalescer* coalescerP = notificationCoalescerGet();
+
+  if ((coalesceMs > 0) && (coalescerP != NULL) &&
+      coalescerP->add(&ncr, coalesceMs, httpInfo, tenant, xauthToken, fiwareCorrelator, renderFormat, attrsOrder, metadataV, blacklist))
+  {
+    return true;
+  }
+
   getNotifier()->sendNotifyContextRequest(&ncr,
                                           httpInfo,
                                           tenant,
@@ -1938,6 +1953,111 @@ static void setDateModifiedMetadata(ContextElementResponse* notifyCerP)
 
 
 
+/* ****************************************************************************
+*
+* geoFilterMatch -
+*
+* Checks in memory the georel of a subscription against the location of the entity (the
+* location.coords field of the entity document, empty if the entity has no location).
+*
+* Only entities located in a point with the same GeoJSON that Orion stores for geo:point
+* ({type: "Point", coordinates: [lon, lat]}) are checked. For any other geometry (or if the
+* subscription area couldn't be compiled) the result is GeoUndecided.
+*/
+static orion::GeoFilterResult geoFilterMatch(const orion::GeoFilter* geoFilterP, const BSONObj& location)
+{
+  // Without location, the entity doesn't match any georel (disjoint included)
+  if (location.isEmpty())
+  {
+    return orion::GeoNoMatch;
+  }
+
+  if (!geoFilterP->isCompiled() || (location.nFields() != 2))
+  {
+    return orion::GeoUndecided;
+  }
+
+  mongo::BSONObjIterator  it(location);
+  BSONElement             type   = it.next();
+  BSONElement             coords = it.next();
+
+  if ((std::string(type.fieldName()) != "type") || (type.type() != mongo::String) || (type.String() != "Point") ||
+      (std::string(coords.fieldName()) != "coordinates") || (coords.type() != mongo::Array))
+  {
+    return orion::GeoUndecided;
+  }
+
+  std::vector<BSONElement> coordsV = coords.Array();
+
+  if ((coordsV.size() != 2) || !coordsV[0].isNumber() || !coordsV[1].isNumber())
+  {
+    return orion::GeoUndecided;
+  }
+
+  return geoFilterP->match(coordsV[1].Number(), coordsV[0].Number());
+}
+
+
+
+/* ****************************************************************************
+*
+* geoQueryMatch -
+*
+* Checks the georel of a subscription asking the DB if the entity matches it.
+*/
+static bool geoQueryMatch(TriggeredSubscription* tSubP, ContextElementResponse* notifyCerP, const std::string& tenant)
+{
+  Scope        geoScope;
+  std::string  filterErr;
+
+  if (geoScope.fill(V2, tSubP->expression.geometry, tSubP->expression.coords, tSubP->expression.georel, &filterErr) != 0)
+  {
+    // This has been already checked at subscription creation/update parsing time. Thus, the code cannot reach
+    // this part.
+    //
+    // (Probably the whole if clause will disapear when the missing part of #1705 gets implemented,
+    // moving geo-stuff strings to a filter object in TriggeredSubscription class
+
+    LM_E(("Runtime Error (code cannot reach this point, error: %s)", filterErr.c_str()));
+    geoScope.release();
+    return false;
+  }
+
+  BSONObj areaFilter;
+  bool    ok = processAreaScopeV2(&geoScope, &areaFilter);
+
+  geoScope.release();
+
+  if (!ok)
+  {
+    // Error in processAreaScopeV2 is interpreted as no-match (conservative approach)
+    return false;
+  }
+
+  // Look in the database of an entity that maches the geo-filters. Note that this query doesn't
+  // check any other filtering condition, assuming they are already checked in other steps.
+  std::string  keyId   = "_id." ENT_ENTITY_ID;
+  std::string  keyType = "_id." ENT_ENTITY_TYPE;
+  std::string  keySp   = "_id." ENT_SERVICE_PATH;
+  std::string  keyLoc  = ENT_LOCATION "." ENT_LOCATION_COORDS;
+  std::string  id      = notifyCerP->contextElement.entityId.id;
+  std::string  type    = notifyCerP->contextElement.entityId.type;
+  std::string  sp      = notifyCerP->contextElement.entityId.servicePath;
+  BSONObj      query   = BSON(keyId << id << keyType << type << keySp << sp << keyLoc << areaFilter);
+
+  unsigned long long n;
+  if (!collectionCount(getEntitiesCollectionName(tenant), query, &n, &filterErr))
+  {
+    // Error in database access is interpreted as no-match (conservative approach)
+    return false;
+  }
+
+  // No result? Then no-match
+  return (n > 0);
+}
+
+
+
 /* ****************************************************************************
 *
 * processSubscriptions - send a notification for each subscription in the map
@@ -1946,13 +2066,15 @@ static bool processSubscriptions
 (
   std::map<std::string, TriggeredSubscription*>& subs,
   ContextElementResponse*                        notifyCerP,
+  const BSONObj&                                 location,
   std::string*                                   err,
   const std::string&                             tenant,
   const std::string&                             xauthToken,
   const std::string&                             fiwareCorrelator
 )
 {
-  bool ret = true;
+  bool                    ret = true;
+  NotificationRenderMemo  renderMemo;  // notifications of the entity with the same payload 'data' render it once
 
   *err = "";
 
@@ -1996,52 +2118,18 @@ static bool processSubscriptions
     }
 
     /* Check 3: expression (georel, which also uses geometry and coords)
-     * This should be always the last check, as it is the most expensive one, given that it interacts with DB
-     * (Issue #2396 should solve that) */
+     * This should be always the last check, as it may need to interact with DB (when the georel
+     * can't be decided in memory) */
     if ((tSubP->expression.georel != "") && (tSubP->expression.coords != "") && (tSubP->expression.geometry != ""))
     {
-      Scope        geoScope;
-      std::string  filterErr;
-
-      if (geoScope.fill(V2, tSubP->expression.geometry, tSubP->expression.coords, tSubP->expression.georel, &filterErr) != 0)
-      {
-        // This has been already checked at subscription creation/update parsing time. Thus, the code cannot reach
-        // this part.
-        //
-        // (Probably the whole if clause will disapear when the missing part of #1705 gets implemented,
-        // moving geo-stuff strings to a filter object in TriggeredSubscription class
-
-        LM_E(("Runtime Error (code cannot reach this point, error: %s)", filterErr.c_str()));
-        continue;
-      }
+      orion::GeoFilterResult geoResult = geoFilterMatch(&tSubP->geoFilter, location);
 
-      BSONObj areaFilter;
-      if (!processAreaScopeV2(&geoScope, &areaFilter))
+      if (geoResult == orion::GeoNoMatch)
       {
-        // Error in processAreaScopeV2 is interpreted as no-match (conservative approach)
         continue;
       }
 
-      // Look in the database of an entity that maches the geo-filters. Note that this query doesn't
-      // check any other filtering condition, assuming they are already checked in other steps.
-      std::string  keyId   = "_id." ENT_ENTITY_ID;
-      std::string  keyType = "_id." ENT_ENTITY_TYPE;
-      std::string  keySp   = "_id." ENT_SERVICE_PATH;
-      std::string  keyLoc  = ENT_LOCATION "." ENT_LOCATION_COORDS;
-      std::string  id      = notifyCerP->contextElement.entityId.id;
-      std::string  type    = notifyCerP->contextElement.entityId.type;
-      std::string  sp      = notifyCerP->contextElement.entityId.servicePath;
-      BSONObj      query   = BSON(keyId << id << keyType << type << keySp << sp << keyLoc << areaFilter);
-
-      unsigned long long n;
-      if (!collectionCount(getEntitiesCollectionName(tenant), query, &n, &filterErr))
-      {
-        // Error in database access is interpreted as no-match (conservative approach)
-        continue;
-      }
-
-      // No result? Then no-match
-      if (n == 0)
+      if ((geoResult == orion::GeoUndecided) && !geoQueryMatch(tSubP, notifyCerP, tenant))
       {
         continue;
       }
@@ -2051,32 +2139,38 @@ static bool processSubscriptions
     if (tSubP->attrL.lookup(DATE_CREATED))
     {
       setDateCreatedAttribute(notifyCerP);
+      renderMemo.invalidate();
     }
 
     if (tSubP->attrL.lookup(DATE_MODIFIED))
     {
       setDateModifiedAttribute(notifyCerP);
+      renderMemo.invalidate();
     }
 
     /* Set special metadata */
     if (std::find(tSubP->metadata.begin(), tSubP->metadata.end(), NGSI_MD_ACTIONTYPE) != tSubP->metadata.end())
     {
       setActionTypeMetadata(notifyCerP);
+      renderMemo.invalidate();
     }
 
     if (std::find(tSubP->metadata.begin(), tSubP->metadata.end(), NGSI_MD_PREVIOUSVALUE) != tSubP->metadata.end())
     {
       setPreviousValueMetadata(notifyCerP);
+      renderMemo.invalidate();
     }
 
     if (std::find(tSubP->metadata.begin(), tSubP->metadata.end(), NGSI_MD_DATECREATED) != tSubP->metadata.end())
     {
       setDateCreatedMetadata(notifyCerP);
+      renderMemo.invalidate();
     }
 
     if (std::find(tSubP->metadata.begin(), tSubP->metadata.end(), NGSI_MD_DATEMODIFIED) != tSubP->metadata.end())
     {
       setDateModifiedMetadata(notifyCerP);
+      renderMemo.invalidate();
     }
 
 
@@ -2095,7 +2189,8 @@ static bool processSubscriptions
                                                                 fiwareCorrelator,
                                                                 tSubP->attrL.attributeV,
                                                                 tSubP->httpInfo,
-                                                                tSubP->blacklist);
+                                                                tSubP->blacklist,
+                                                                tSubP->coalesceMs);
 
     if (notificationSent)
     {
@@ -2849,6 +2944,9 @@ static bool processContextAttributeVector
 *
 * createEntity -
 *
+* If docP is not NULL, the document of the new entity is returned in it, instead of
+* being inserted. The location of the entity (location.coords in the document, empty if
+* the entity has no location) is returned in locationP.
 */
 static bool createEntity
 (
@@ -2860,7 +2958,9 @@ static bool createEntity
   const std::vector<std::string>&  servicePathV,
   ApiVersion                       apiVersion,
   const std::string&               fiwareCorrelator,
-  OrionError*                      oe
+  OrionError*                      oe,
+  BSONObj*                         locationP,
+  BSONObj*                         docP = NULL
 )
 {
   LM_T(LmtMongo, ("Entity not found in '%s' collection, creating it", getEntitiesCollectionName(tenant).c_str()));
@@ -2977,19 +3077,35 @@ static bool createEntity
   /* Add location information in the case it was found */
   if (locAttr.length() > 0)
   {
+    *locationP = geoJson.obj();
+
     insertedDoc.append(ENT_LOCATION, BSON(ENT_LOCATION_ATTRNAME << locAttr <<
-                                          ENT_LOCATION_COORDS   << geoJson.obj()));
+                                          ENT_LOCATION_COORDS   << *locationP));
   }
 
   // Correlator (for notification loop detection logic)
   insertedDoc.append(ENT_LAST_CORRELATOR, fiwareCorrelator);
 
-  if (!collectionInsert(getEntitiesCollectionName(tenant), insertedDoc.obj(), errDetail))
+  BSONObj doc = insertedDoc.obj();
+
+  // In the case of a batch, the caller does the insert
+  if (docP != NULL)
+  {
+    *docP = doc;
+    return true;
+  }
+
+  if (!collectionInsert(getEntitiesCollectionName(tenant), doc, errDetail))
   {
     oe->fill(SccReceiverInternalError, *errDetail, "InternalError");
     return false;
   }
 
+  TypesCatalogDelta delta;
+
+  typesCatalogEntityDelta(&delta, doc, 1);
+  typesCatalogApply(tenant, delta);
+
   return true;
 }
 
@@ -3161,7 +3277,8 @@ static void updateEntity
   std::string*                    attributeAlreadyExistsList,
   ApiVersion                      apiVersion,
   const std::string&              fiwareCorrelator,
-  const std::string&              ngsiV2AttrsFormat
+  const std::string&              ngsiV2AttrsFormat,
+  UpdateBatch*                    batchP
 )
 {
   // Used to accumulate error response information
@@ -3188,7 +3305,13 @@ static void updateEntity
   if (strcasecmp(action.c_str(), "delete") == 0 && ceP->contextAttributeVector.size() == 0)
   {
     LM_T(LmtServicePath, ("Removing entity"));
-    removeEntity(entityId, entityType, cerP, tenant, entitySPath, &(responseP->oe));
+    if (removeEntity(entityId, entityType, cerP, tenant, entitySPath, &(responseP->oe)))
+    {
+      TypesCatalogDelta delta;
+
+      typesCatalogEntityDelta(&delta, r, -1);
+      typesCatalogApply(tenant, delta);
+    }
     responseP->contextElementResponseVector.push_back(cerP);
     return;
   }
@@ -3329,13 +3452,15 @@ static void updateEntity
 
   // FIXME P5 https://github.com/telefonicaid/fiware-orion/issues/1142:
   // not sure how the following behaves in the case of "replace"...
+  BSONObj finalGeoJson;  // location of the entity after the update (empty if it has no location)
+
   if (locAttr.length() > 0)
   {
     BSONObj newGeoJson = geoJson.obj();
 
     // If processContextAttributeVector() didn't touched the geoJson, then we
     // use the existing object
-    BSONObj finalGeoJson = newGeoJson.nFields() > 0 ? newGeoJson : currentGeoJson;
+    finalGeoJson = newGeoJson.nFields() > 0 ? newGeoJson : currentGeoJson;
 
     toSet.append(ENT_LOCATION, BSON(ENT_LOCATION_ATTRNAME << locAttr <<
                                     ENT_LOCATION_COORDS   << finalGeoJson));
@@ -3417,6 +3542,14 @@ static void updateEntity
   // Service Path
   query.append(servicePathString, fillQueryServicePath(servicePathV));
 
+  // In the case of a batch, the entity is written (and the rest of this function done) in updateBatchFlush()
+  if (batchP != NULL)
+  {
+    updateBatchAdd(batchP, false, query.obj(), updatedEntityObj, r, finalGeoJson, ceP, cerP, notifyCerP, &subsToNotify);
+    responseP->contextElementResponseVector.push_back(cerP);
+    return;
+  }
+
   std::string err;
   if (!collectionUpdate(getEntitiesCollectionName(tenant), query.obj(), updatedEntityObj, false, &err))
   {
@@ -3433,9 +3566,15 @@ static void updateEntity
     return;
   }
 
+  // Only changes in the attributes (or their types) result in a write in the types catalog
+  TypesCatalogDelta delta;
+
+  typesCatalogUpdateDelta(&delta, r, updatedEntityObj);
+  typesCatalogApply(tenant, delta);
+
   /* Send notifications for each one of the ONCHANGE subscriptions accumulated by
    * previous addTriggeredSubscriptions() invocations */
-  processSubscriptions(subsToNotify, notifyCerP, &err, tenant, xauthToken, fiwareCorrelator);
+  processSubscriptions(subsToNotify, notifyCerP, finalGeoJson, &err, tenant, xauthToken, fiwareCorrelator);
   notifyCerP->release();
   delete notifyCerP;
 
@@ -3556,12 +3695,151 @@ static void setActionType(ContextElementResponse* notifyCerP, std::string action
 
 
 
+/* ****************************************************************************
+*
+* entitiesQuery -
+*
+* Get the entities matching the query, in 'results'.
+*
+* As ServicePath cannot be modified, nothing is done about ServicePath with the
+* found entities (the ServicePath is part of the query).
+*
+* FIXME P6: Once we allow for ServicePath to be modified, this must be looked at.
+*/
+static bool entitiesQuery
+(
+  const std::string&     tenant,
+  const BSONObj&         query,
+  std::vector<BSONObj>*  results,
+  std::string*           err
+)
+{
+  std::auto_ptr<DBClientCursor>  cursor;
+
+  TIME_STAT_MONGO_READ_WAIT_START();
+  DBClientBase* connection = getMongoConnection();
+
+  if (!collectionQuery(connection, getEntitiesCollectionName(tenant), query, &cursor, err))
+  {
+    releaseMongoConnection(connection);
+    TIME_STAT_MONGO_READ_WAIT_STOP();
+
+    return false;
+  }
+  TIME_STAT_MONGO_READ_WAIT_STOP();
+
+  unsigned int docs = 0;
+
+  while (moreSafe(cursor))
+  {
+    BSONObj r;
+
+    if (!nextSafeOrErrorF(cursor, &r, err))
+    {
+      LM_E(("Runtime Error (exception in nextSafe(): %s - query: %s)", err->c_str(), query.toString().c_str()));
+      continue;
+    }
+
+    docs++;
+    LM_T(LmtMongo, ("retrieved document [%d]: '%s'", docs, r.toString().c_str()));
+
+    BSONElement idField = getFieldF(r, "_id");
+
+    //
+    // BSONElement::eoo returns true if 'not found', i.e. the field "_id" doesn't exist in 'sub'
+    //
+    // Now, if 'getFieldF(r, "_id")' is not found, if we continue, calling embeddedObject() on it, then we get
+    // an exception and the broker crashes.
+    //
+    if (idField.eoo() == true)
+    {
+      std::string details = std::string("error retrieving _id field in doc: '") + r.toString() + "'";
+      alarmMgr.dbError(details);
+      continue;
+    }
+
+    //
+    // We need to use getOwned() here, otherwise we have empirically found that bad things may happen with long BSONObjs
+    // (see http://stackoverflow.com/questions/36917731/context-broker-crashing-with-certain-update-queries)
+    //
+    results->push_back(r.getOwned());
+  }
+
+  releaseMongoConnection(connection);
+
+  return true;
+}
+
+
+
+/* ****************************************************************************
+*
+* entitiesFilter -
+*
+* Select, among the entities loaded by updateBatchLoad() for an entity id, the ones
+* the query of processContextElement() would have returned.
+*/
+static void entitiesFilter
+(
+  const std::vector<BSONObj>&  entities,
+  const std::string&           type,
+  bool                         typeNotExist,
+  std::vector<BSONObj>*        results
+)
+{
+  for (unsigned int ix = 0; ix < entities.size(); ++ix)
+  {
+    BSONObj  idField = getObjectFieldF(entities[ix], "_id");
+    bool     hasType = idField.hasField(ENT_ENTITY_TYPE);
+
+    if ((type != "") && (!hasType || (getStringFieldF(idField, ENT_ENTITY_TYPE) != type)))
+    {
+      continue;
+    }
+
+    if (typeNotExist && hasType)
+    {
+      continue;
+    }
+
+    results->push_back(entities[ix]);
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* entityQueryFill -
+*
+* Query for the entities with the id (and type, if any) of enP in the service paths
+* of servicePathV.
+*/
+static void entityQueryFill(BSONObjBuilder* bobP, const EntityId* enP, const std::vector<std::string>& servicePathV)
+{
+  const std::string  idString          = "_id." ENT_ENTITY_ID;
+  const std::string  typeString        = "_id." ENT_ENTITY_TYPE;
+  const std::string  servicePathString = "_id." ENT_SERVICE_PATH;
+
+  bobP->append(idString, enP->id);
+
+  if (enP->type != "")
+  {
+    bobP->append(typeString, enP->type);
+  }
+
+  // Service path
+  bobP->append(servicePathString, fillQueryServicePath(servicePathV));
+}
+
+
+
 /* ****************************************************************************
 *
 * processContextElement -
 *
 * 1. Preconditions
-* 2. Get the complete list of entities from mongo
+* 2. Get the complete list of entities from mongo (or from the batch, if it was loaded there)
 */
 void processContextElement
 (
@@ -3575,7 +3853,8 @@ void processContextElement
   const std::string&                   fiwareCorrelator,
   const std::string&                   ngsiV2AttrsFormat,
   ApiVersion                           apiVersion,
-  Ngsiv2Flavour                        ngsiv2Flavour
+  Ngsiv2Flavour                        ngsiv2Flavour,
+  UpdateBatch*                         batchP
 )
 {
   /* Check preconditions */
@@ -3585,28 +3864,19 @@ void processContextElement
   }
 
   /* Find entities (could be several, in the case of no type or isPattern=true) */
-  const std::string  idString          = "_id." ENT_ENTITY_ID;
-  const std::string  typeString        = "_id." ENT_ENTITY_TYPE;
-  const std::string  servicePathString = "_id." ENT_SERVICE_PATH;
   EntityId*          enP               = &ceP->entityId;
   BSONObjBuilder     bob;
 
-  bob.append(idString, enP->id);
-
-  if (enP->type != "")
-  {
-    bob.append(typeString, enP->type);
-  }
-
-  // Service path
-  bob.append(servicePathString, fillQueryServicePath(servicePathV));
+  entityQueryFill(&bob, enP, servicePathV);
 
   // FIXME P7: we build the filter for '?!exist=entity::type' directly at mongoBackend layer given that
   // Restriction is not a valid field in updateContext according to the NGSI specification. In the
   // future we may consider to modify the spec to add such Restriction and avoid this ugly "direct injection"
   // of URI filter into mongoBackend
   //
-  if (uriParams[URI_PARAM_NOT_EXIST] == SCOPE_VALUE_ENTITY_TYPE)
+  bool typeNotExist = (uriParams[URI_PARAM_NOT_EXIST] == SCOPE_VALUE_ENTITY_TYPE);
+
+  if (typeNotExist)
   {
     std::string  entityTypeString = std::string("_id.") + ENT_ENTITY_TYPE;
     BSONObj      b                = BSON(entityTypeString << BSON("$exists" << false));
@@ -3614,16 +3884,30 @@ void processContextElement
     bob.appendElements(b);
   }
 
-  BSONObj                        query = bob.obj();
-  std::auto_ptr<DBClientCursor>  cursor;
+  BSONObj               query = bob.obj();
+  std::vector<BSONObj>  results;
+
+  // Entities loaded in advance with the rest of the batch?
+  std::map<std::string, std::vector<BSONObj> >::iterator  batchIt;
+  bool                                                    prefetched = false;
+
+  if ((batchP != NULL) && ((batchIt = batchP->entities.find(enP->id)) != batchP->entities.end()))
+  {
+    prefetched = true;
+    entitiesFilter(batchIt->second, enP->type, typeNotExist, &results);
+  }
+  else
+  {
+    batchP = NULL;
+  }
 
   // Several checks related to NGSIv2
   if (apiVersion == V2)
   {
-    unsigned long long entitiesNumber;
+    unsigned long long entitiesNumber = results.size();
     std::string        err;
 
-    if (!collectionCount(getEntitiesCollectionName(tenant), query, &entitiesNumber, &err))
+    if (!prefetched && !collectionCount(getEntitiesCollectionName(tenant), query, &entitiesNumber, &err))
     {
       buildGeneralErrorResponse(ceP, NULL, responseP, SccReceiverInternalError, err);
       responseP->oe.fill(SccReceiverInternalError, err, "InternalServerError");
@@ -3659,67 +3943,13 @@ void processContextElement
 
   std::string err;
 
-  TIME_STAT_MONGO_READ_WAIT_START();
-  DBClientBase* connection = getMongoConnection();
-
-  if (!collectionQuery(connection, getEntitiesCollectionName(tenant), query, &cursor, &err))
+  if (!prefetched && !entitiesQuery(tenant, query, &results, &err))
   {
-    releaseMongoConnection(connection);
-    TIME_STAT_MONGO_READ_WAIT_STOP();
     buildGeneralErrorResponse(ceP, NULL, responseP, SccReceiverInternalError, err);
     responseP->oe.fill(SccReceiverInternalError, err, "InternalServerError");
 
     return;
   }
-  TIME_STAT_MONGO_READ_WAIT_STOP();
-
-  //
-  // Going through the list of found entities.
-  // As ServicePath cannot be modified, inside this loop nothing will be done
-  // about ServicePath (The ServicePath was present in the mongo query to obtain the list)
-  //
-  // FIXME P6: Once we allow for ServicePath to be modified, this loop must be looked at.
-  //
-
-  std::vector<BSONObj> results;
-  unsigned int         docs = 0;
-
-  while (moreSafe(cursor))
-  {
-    BSONObj r;
-
-    if (!nextSafeOrErrorF(cursor, &r, &err))
-    {
-      LM_E(("Runtime Error (exception in nextSafe(): %s - query: %s)", err.c_str(), query.toString().c_str()));
-      continue;
-    }
-
-    docs++;
-    LM_T(LmtMongo, ("retrieved document [%d]: '%s'", docs, r.toString().c_str()));
-
-    BSONElement idField = getFieldF(r, "_id");
-
-    //
-    // BSONElement::eoo returns true if 'not found', i.e. the field "_id" doesn't exist in 'sub'
-    //
-    // Now, if 'getFieldF(r, "_id")' is not found, if we continue, calling embeddedObject() on it, then we get
-    // an exception and the broker crashes.
-    //
-    if (idField.eoo() == true)
-    {
-      std::string details = std::string("error retrieving _id field in doc: '") + r.toString() + "'";
-      alarmMgr.dbError(details);
-      continue;
-    }
-
-    //
-    // We need to use getOwned() here, otherwise we have empirically found that bad things may happen with long BSONObjs
-    // (see http://stackoverflow.com/questions/36917731/context-broker-crashing-with-certain-update-queries)
-    //
-    results.push_back(r.getOwned());
-  }
-
-  releaseMongoConnection(connection);
 
   LM_T(LmtServicePath, ("Docs found: %d", results.size()));
 
@@ -3742,7 +3972,8 @@ void processContextElement
                  &attributeAlreadyExistsList,
                  apiVersion,
                  fiwareCorrelator,
-                 ngsiV2AttrsFormat);
+                 ngsiV2AttrsFormat,
+                 batchP);
   }
 
   /*
@@ -3811,8 +4042,11 @@ void processContextElement
       std::string  errReason;
       std::string  errDetail;
       int          now = getCurrentTime();
+      BSONObj      doc;
+      BSONObj*     docP = (batchP != NULL)? &doc : NULL;
+      BSONObj      location;
 
-      if (!createEntity(enP, ceP->contextAttributeVector, now, &errDetail, tenant, servicePathV, apiVersion, fiwareCorrelator, &(responseP->oe)))
+      if (!createEntity(enP, ceP->contextAttributeVector, now, &errDetail, tenant, servicePathV, apiVersion, fiwareCorrelator, &(responseP->oe), &location, docP))
       {
         cerP->statusCode.fill(SccInvalidParameter, errDetail);
         // In this case, responseP->oe is not filled, as createEntity() deals internally with that
@@ -3842,6 +4076,12 @@ void processContextElement
           cerP->statusCode.fill(SccReceiverInternalError, err);
           responseP->oe.fill(SccReceiverInternalError, err, "InternalError");
 
+          // The entity has to be created anyway, as it would have been without batch
+          if (batchP != NULL)
+          {
+            updateBatchAdd(batchP, true, BSONObj(), doc, BSONObj(), location, ceP, cerP, NULL, NULL);
+          }
+
           responseP->contextElementResponseVector.push_back(cerP);
           return;  // Error already in responseP
         }
@@ -3867,7 +4107,16 @@ void processContextElement
         }
 
         notifyCerP->contextElement.entityId.servicePath = servicePathV.size() > 0? servicePathV[0] : "";
-        processSubscriptions(subsToNotify, notifyCerP, &errReason, tenant, xauthToken, fiwareCorrelator);
+
+        // In the case of a batch, the entity is created (and notifications sent) in updateBatchFlush()
+        if (batchP != NULL)
+        {
+          updateBatchAdd(batchP, true, BSONObj(), doc, BSONObj(), location, ceP, cerP, notifyCerP, &subsToNotify);
+          responseP->contextElementResponseVector.push_back(cerP);
+          return;
+        }
+
+        processSubscriptions(subsToNotify, notifyCerP, location, &errReason, tenant, xauthToken, fiwareCorrelator);
 
         notifyCerP->release();
         delete notifyCerP;
@@ -3887,3 +4136,301 @@ void processContextElement
 
   // Response in responseP
 }
+
+
+
+/* ****************************************************************************
+*
+* processEntityCreation -
+*
+* Creation of a new entity (POST /v2/entities), with the same result (in the DB, in the
+* notifications and in the errors) as processContextElement() with APPEND_STRICT and
+* NGSIV2_FLAVOUR_ONCREATE, but straight from the parsed entity:
+*
+* - no UpdateContextRequest/ContextElementResponse are built around the attributes
+* - the only query before the insert is the count that checks the entity doesn't exist
+*   (processContextElement() queries the entities afterwards, even if none was found)
+* - the entity is only copied for notifying if some subscription is triggered
+*
+* Errors are returned in oeP, whose code is left as SccNone if the entity is created.
+*/
+void processEntityCreation
+(
+  Entity*                          eP,
+  OrionError*                      oeP,
+  const std::string&               tenant,
+  const std::vector<std::string>&  servicePathV,
+  const std::string&               xauthToken,
+  const std::string&               fiwareCorrelator
+)
+{
+  ContextAttributeVector& attrsV = eP->attributeVector;
+
+  /* Checking there aren't duplicate attributes (as contextElementPreconditionsCheck() does) */
+  for (unsigned int ix = 0; ix < attrsV.size(); ++ix)
+  {
+    std::string name = attrsV[ix]->name;
+    std::string id   = attrsV[ix]->getId();
+
+    for (unsigned int jx = ix + 1; jx < attrsV.size(); ++jx)
+    {
+      if ((name == attrsV[jx]->name) && (id == attrsV[jx]->getId()))
+      {
+        std::string details = std::string("duplicated attribute name: name=<") + name + "> id=<" + id + ">";
+
+        alarmMgr.badInput(clientIp, details);
+        oeP->fill(SccBadRequest, "duplicated attribute /" + name + "/", "BadRequest");
+        return;
+      }
+    }
+  }
+
+  /* The entity must not exist */
+  EntityId            en(eP->id, eP->type, "false");
+  BSONObjBuilder      bob;
+  unsigned long long  entitiesNumber;
+  std::string         err;
+
+  entityQueryFill(&bob, &en, servicePathV);
+
+  if (!collectionCount(getEntitiesCollectionName(tenant), bob.obj(), &entitiesNumber, &err))
+  {
+    oeP->fill(SccReceiverInternalError, err, "InternalServerError");
+    return;
+  }
+
+  if (entitiesNumber > 0)
+  {
+    oeP->fill(SccInvalidModification, "Already Exists", "Unprocessable");
+    return;
+  }
+
+  std::string  errDetail;
+  int          now = getCurrentTime();
+  BSONObj      location;
+
+  if (!createEntity(&en, attrsV, now, &errDetail, tenant, servicePathV, V2, fiwareCorrelator, oeP, &location))
+  {
+    return;  // oeP already filled by createEntity()
+  }
+
+  /* Successful creation: send potential notifications */
+  std::map<std::string, TriggeredSubscription*>  subsToNotify;
+  std::vector<std::string>                       attrNames;
+
+  for (unsigned int ix = 0; ix < attrsV.size(); ++ix)
+  {
+    attrNames.push_back(attrsV[ix]->name);
+  }
+
+  if (!addTriggeredSubscriptions(en.id, en.type, attrNames, subsToNotify, err, tenant, servicePathV))
+  {
+    releaseTriggeredSubscriptions(&subsToNotify);
+    oeP->fill(SccReceiverInternalError, err, "InternalError");
+    return;
+  }
+
+  if (subsToNotify.empty())
+  {
+    return;
+  }
+
+  //
+  // The context element only points to the attributes of the entity (it is cleared before
+  // going out of scope), the copy is the CER used for notifying, as in processContextElement()
+  //
+  ContextElement  ce(eP->id, eP->type, "false");
+  std::string     errReason;
+
+  for (unsigned int ix = 0; ix < attrsV.size(); ++ix)
+  {
+    ce.contextAttributeVector.push_back(attrsV[ix]);
+  }
+
+  ContextElementResponse* notifyCerP = new ContextElementResponse(&ce, true);
+
+  ce.contextAttributeVector.vec.clear();
+
+  setActionType(notifyCerP, NGSI_MD_ACTIONTYPE_APPEND);
+
+  notifyCerP->contextElement.entityId.creDate = now;
+  notifyCerP->contextElement.entityId.modDate = now;
+
+  for (unsigned int ix = 0; ix < notifyCerP->contextElement.contextAttributeVector.size(); ix++)
+  {
+    ContextAttribute* caP = notifyCerP->contextElement.contextAttributeVector[ix];
+
+    caP->creDate = now;
+    caP->modDate = now;
+  }
+
+  notifyCerP->contextElement.entityId.servicePath = servicePathV.size() > 0? servicePathV[0] : "";
+
+  processSubscriptions(subsToNotify, notifyCerP, location, &errReason, tenant, xauthToken, fiwareCorrelator);
+
+  notifyCerP->release();
+  delete notifyCerP;
+  releaseTriggeredSubscriptions(&subsToNotify);
+}
+
+
+
+/* ****************************************************************************
+*
+* updateBatchLoad -
+*
+* Loads, with a single query, the entities of the context elements of the batch whose
+* id appears only once in it. Returns false (and an empty batch) if the query fails,
+* in which case the context elements are processed one by one.
+*/
+bool updateBatchLoad
+(
+  UpdateBatch*                     batchP,
+  const ContextElementVector&      ceV,
+  const std::string&               tenant,
+  const std::vector<std::string>&  servicePathV,
+  std::string*                     err
+)
+{
+  std::map<std::string, int>  idCount;
+
+  for (unsigned int ix = 0; ix < ceV.size(); ++ix)
+  {
+    idCount[ceV[ix]->entityId.id]++;
+  }
+
+  BSONArrayBuilder  ids;
+  bool              anyId = false;
+
+  for (std::map<std::string, int>::iterator it = idCount.begin(); it != idCount.end(); ++it)
+  {
+    if (it->second == 1)
+    {
+      batchP->entities[it->first] = std::vector<BSONObj>();
+      ids.append(it->first);
+      anyId = true;
+    }
+  }
+
+  if (!anyId)
+  {
+    return true;
+  }
+
+  std::string           idString          = std::string("_id.") + ENT_ENTITY_ID;
+  std::string           servicePathString = std::string("_id.") + ENT_SERVICE_PATH;
+  BSONObjBuilder        bob;
+  std::vector<BSONObj>  results;
+
+  bob.append(idString, BSON("$in" << ids.arr()));
+  bob.append(servicePathString, fillQueryServicePath(servicePathV));
+
+  BSONObj query = bob.obj();
+
+  if (!entitiesQuery(tenant, query, &results, err))
+  {
+    batchP->entities.clear();
+    return false;
+  }
+
+  for (unsigned int ix = 0; ix < results.size(); ++ix)
+  {
+    std::string id = getStringFieldF(getObjectFieldF(results[ix], "_id"), ENT_ENTITY_ID);
+
+    batchP->entities[id].push_back(results[ix]);
+  }
+
+  return true;
+}
+
+
+
+/* ****************************************************************************
+*
+* updateBatchFlush -
+*
+* Writes all the entities of the batch with a bulk write and completes, for each one
+* of them, what processContextElement() would have done after writing it: the status
+* of the response, the notifications and the search of context providers.
+*/
+void updateBatchFlush
+(
+  UpdateBatch*                     batchP,
+  UpdateContextResponse*           responseP,
+  const std::string&               tenant,
+  const std::vector<std::string>&  servicePathV,
+  const std::string&               xauthToken,
+  const std::string&               fiwareCorrelator
+)
+{
+  std::vector<std::string>  errV;
+  std::string               err;
+  TypesCatalogDelta         delta;
+
+  if (batchP->opV.size() > 0)
+  {
+    if (!collectionBulkWrite(getEntitiesCollectionName(tenant), batchP->opV, &errV, &err))
+    {
+      errV.assign(batchP->opV.size(), err);
+    }
+  }
+
+  for (unsigned int ix = 0; ix < batchP->pendingV.size(); ++ix)
+  {
+    PendingWrite*  pwP  = batchP->pendingV[ix];
+    std::string    e    = (ix < errV.size())? errV[ix] : "";
+
+    if ((e != "") && pwP->creation)
+    {
+      pwP->cerP->statusCode.fill(SccInvalidParameter, e);
+      responseP->oe.fill(SccReceiverInternalError, e, "InternalError");
+    }
+    else if (e != "")
+    {
+      pwP->cerP->statusCode.fill(SccReceiverInternalError, e);
+      responseP->oe.fill(SccReceiverInternalError, e, "InternalServerError");
+    }
+    else
+    {
+      if (pwP->creation)
+      {
+        typesCatalogEntityDelta(&delta, pwP->entity, 1);
+      }
+      else
+      {
+        typesCatalogUpdateDelta(&delta, pwP->entity, batchP->opV[ix].doc);
+      }
+
+      if (pwP->notifyCerP != NULL)
+      {
+        processSubscriptions(pwP->subsToNotify, pwP->notifyCerP, pwP->location, &err, tenant, xauthToken, fiwareCorrelator);
+      }
+
+      if (!pwP->creation)
+      {
+        searchContextProviders(tenant, servicePathV, pwP->ceP->entityId, pwP->ceP->contextAttributeVector, pwP->cerP);
+
+        // StatusCode may be set already (if so, we keep the existing value)
+        if (pwP->cerP->statusCode.code == SccNone)
+        {
+          pwP->cerP->statusCode.fill(SccOk);
+        }
+      }
+    }
+
+    if (pwP->notifyCerP != NULL)
+    {
+      pwP->notifyCerP->release();
+      delete pwP->notifyCerP;
+    }
+
+    releaseTriggeredSubscriptions(&pwP->subsToNotify);
+    delete pwP;
+  }
+
+  // The changes of all the entities in the batch go to the types catalog in a single bulk write
+  typesCatalogApply(tenant, delta);
+
+  batchP->opV.clear();
+  batchP->pendingV.clear();
+}
@@ -32,12 +32,79 @@
 #include "mongo/client/dbclient.h"
 
 #include "ngsi10/UpdateContextResponse.h"
+#include "ngsi/ContextElementVector.h"
+#include "apiTypesV2/Entity.h"
+#include "rest/OrionError.h"
+#include "mongoBackend/connectionOperations.h"
+
+
+
+/* ****************************************************************************
+*
+* PendingWrite - what is left to do for an entity once it is written (MongoCommonUpdate.cpp)
+*/
+struct PendingWrite;
+
+
+
+/* ****************************************************************************
+*
+* UpdateBatch -
+*
+* State shared by the context elements of an update with several entities: the entities
+* loaded in advance with a single query, and the entity writes, that are done together
+* with a bulk write at the end, followed by the notifications they trigger.
+*
+* Only the entities whose id appears once in the request are in 'entities' (even if
+* they were not found, with an empty vector), and only for them the write is delayed,
+* so no context element depends on what another one of the batch writes.
+*/
+typedef struct UpdateBatch
+{
+  std::map<std::string, std::vector<mongo::BSONObj> >  entities;
+  std::vector<BulkWriteOp>                             opV;
+  std::vector<PendingWrite*>                           pendingV;   // same index as opV
+} UpdateBatch;
+
+
+
+/* ****************************************************************************
+*
+* updateBatchLoad -
+*/
+extern bool updateBatchLoad
+(
+  UpdateBatch*                     batchP,
+  const ContextElementVector&      ceV,
+  const std::string&               tenant,
+  const std::vector<std::string>&  servicePathV,
+  std::string*                     err
+);
+
+
+
+/* ****************************************************************************
+*
+* updateBatchFlush -
+*/
+extern void updateBatchFlush
+(
+  UpdateBatch*                     batchP,
+  UpdateContextResponse*           responseP,
+  const std::string&               tenant,
+  const std::vector<std::string>&  servicePathV,
+  const std::string&               xauthToken,
+  const std::string&               fiwareCorrelator
+);
 
 
 
 /* ****************************************************************************
 *
 * processContextElement -
+*
+* If batchP is not NULL, the entity is taken from the batch and its write is added to
+* it, whenever the entity id is in the batch.
 */
 extern void processContextElement
 (
@@ -51,7 +118,24 @@ extern void processContextElement
   const std::string&                   fiwareCorrelator,
   const std::string&                   ngsiV2AttrsFormat,
   ApiVersion                           apiVersion       = V1,
-  Ngsiv2Flavour                        ngsiV2Flavour    = NGSIV2_NO_FLAVOUR
+  Ngsiv2Flavour                        ngsiV2Flavour    = NGSIV2_NO_FLAVOUR,
+  UpdateBatch*                         batchP           = NULL
+);
+
+
+
+/* ****************************************************************************
+*
+* processEntityCreation -
+*/
+extern void processEntityCreation
+(
+  Entity*                          eP,
+  OrionError*                      oeP,
+  const std::string&               tenant,
+  const std::vector<std::string>&  servicePathV,
+  const std::string&               xauthToken,
+  const std::string&               fiwareCorrelator
 );
 
 #endif  // SRC_LIB_MONGOBACKEND_MONGOCOMMONUPDATE_H_
@@ -26,6 +26,8 @@
 #include <semaphore.h>
 #include <regex.h>
 
+#include <pthread.h>
+
 #include <string>
 #include <vector>
 #include <map>
@@ -43,6 +45,8 @@
 #include "common/wsStrip.h"
 #include "common/statistics.h"
 #include "common/RenderFormat.h"
+#include "common/ServicePathTrie.h"
+#include "common/regexCache.h"
 #include "alarmMgr/alarmMgr.h"
 
 #include "orionTypes/OrionValueType.h"
@@ -568,6 +572,20 @@ std::string getSubscribeContextAvailabilityCollectionName(const std::string& ten
 
 
 
+/* ***************************************************************************
+*
+* getEntityTypesCollectionName -
+*
+* The entity types catalog (see mongoTypesCatalog.cpp) lives beside the entities
+* collection, so its name is not configurable.
+*/
+std::string getEntityTypesCollectionName(const std::string& tenant)
+{
+  return composeCollectionName(tenant, COL_ENTITY_TYPES);
+}
+
+
+
 /* ***************************************************************************
 *
 * mongoLocationCapable -
@@ -618,19 +636,19 @@ bool matchEntity(const EntityId* en1, const EntityId* en2)
 
   if (isTrue(en2->isPattern))
   {
-    regex_t regex;
+    regex_t* regexP = regexCacheGet(en2->id, REG_EXTENDED);
 
     idMatch = false;
-    if (regcomp(&regex, en2->id.c_str(), REG_EXTENDED) != 0)
+    if (regexP == NULL)
     {
       std::string details = std::string("error compiling regex for id: '") + en2->id + "'";
       alarmMgr.badInput(clientIp, details);
     }
     else
     {
-      idMatch = (regexec(&regex, en1->id.c_str(), 0, NULL, 0) == 0);
+      idMatch = (regexec(regexP, en1->id.c_str(), 0, NULL, 0) == 0);
 
-      regfree(&regex);  // If regcomp fails it frees up itself (see glibc sources for details)
+      regexCacheRelease(regexP);
     }
   }
   else  /* isPattern == false */
@@ -731,7 +749,36 @@ static void fillQueryEntity(BSONArrayBuilder* baP, const EntityId* enP)
 
 /* ****************************************************************************
 *
-* fillQueryServicePath -
+* ServicePathQueries - DB queries of a service path, built once (see servicePathQueryGet)
+*/
+typedef struct ServicePathQueries
+{
+  BSONObj  entities;        // fillQueryServicePath
+  BSONObj  subscriptions;   // servicePathSubscriptionQuery
+} ServicePathQueries;
+
+
+
+/* ****************************************************************************
+*
+* servicePathQueries -
+*
+* Not the trie of the subscription cache: the queries don't depend on the tenant and are
+* needed also when the subscription cache is disabled, so they are kept apart, under a
+* mutex of their own instead of the cache semaphore.
+*
+* Nodes are never removed from this trie (the number of them is limited by
+* SERVICE_PATH_QUERIES_MAX_NODES), so pointers to its entries can be used once
+* the mutex is released.
+*/
+static ServicePathTrie<ServicePathQueries>  servicePathQueries;
+static pthread_mutex_t                      servicePathQueriesMutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+
+/* ****************************************************************************
+*
+* fillQueryServicePathBuild -
 *
 * The regular expression for servicePath.
 *
@@ -739,7 +786,7 @@ static void fillQueryEntity(BSONArrayBuilder* baP, const EntityId* enP)
 * can be seen as a query on "/#" considering that entities without servicePath are implicitly
 * assigned to "/" service path.
 */
-BSONObj fillQueryServicePath(const std::vector<std::string>& servicePath)
+static BSONObj fillQueryServicePathBuild(const std::vector<std::string>& servicePath)
 {
   /* Due to limitations in the BSONArrayBuilder class (that hopefully will be solved in legacy-1.0.0
    * MongoDB driver) we need to compose the JSON string, then apply fromjson() function. Current
@@ -809,6 +856,137 @@ BSONObj fillQueryServicePath(const std::vector<std::string>& servicePath)
 
 
 
+/* ****************************************************************************
+*
+* servicePathSubscriptionQueryBuild -
+*
+* The service paths of the subscriptions matching an update in the service path
+* /a1/a2/a3 are:
+*   - no service path (empty or null)
+*   - /# | /a1/# | /a1/a2/# | /a1/a2/a3/#
+*   - /a1/a2/a3 (exact)
+*
+* As all of them are known, an $in of plain strings is used (instead of a regex), so the
+* index on servicePath can be used. An update without service path is the same as '/'.
+*/
+static BSONObj servicePathSubscriptionQueryBuild(const std::string& servicePath)
+{
+  std::string       spath = ((servicePath == "") || (servicePath == "/"))? "" : servicePath;
+  BSONArrayBuilder  spathV;
+
+  spathV.append("");
+  spathV.appendNull();
+  spathV.append("/#");
+
+  for (unsigned int ix = 1; ix < spath.size(); ++ix)
+  {
+    if (spath[ix] == '/')
+    {
+      spathV.append(spath.substr(0, ix) + "/#");
+    }
+  }
+
+  if (spath == "")
+  {
+    spathV.append("/");
+  }
+  else
+  {
+    spathV.append(spath + "/#");
+    spathV.append(spath);
+  }
+
+  return BSON("$in" << spathV.arr());
+}
+
+
+
+/* ****************************************************************************
+*
+* servicePathQueryGet -
+*
+* The query for the service path, from the servicePathQueries trie if it was already built.
+* The trie is shared by all tenants, as the queries don't depend on the tenant.
+*/
+static BSONObj servicePathQueryGet(const std::string& servicePath, bool subscriptions)
+{
+  ServicePathQueries*  queriesP;
+  BSONObj              query;
+
+  pthread_mutex_lock(&servicePathQueriesMutex);
+
+  queriesP = servicePathQueries.entryGet(servicePath, servicePathQueries.size() < SERVICE_PATH_QUERIES_MAX_NODES);
+  if (queriesP != NULL)
+  {
+    query = subscriptions? queriesP->subscriptions : queriesP->entities;
+  }
+
+  pthread_mutex_unlock(&servicePathQueriesMutex);
+
+  if (!query.isEmpty())
+  {
+    return query;
+  }
+
+  if (subscriptions)
+  {
+    query = servicePathSubscriptionQueryBuild(servicePath);
+  }
+  else
+  {
+    query = fillQueryServicePathBuild(std::vector<std::string>(1, servicePath));
+  }
+
+  if (queriesP != NULL)
+  {
+    pthread_mutex_lock(&servicePathQueriesMutex);
+
+    if (subscriptions)
+    {
+      queriesP->subscriptions = query.getOwned();
+    }
+    else
+    {
+      queriesP->entities = query.getOwned();
+    }
+
+    pthread_mutex_unlock(&servicePathQueriesMutex);
+  }
+
+  return query;
+}
+
+
+
+/* ****************************************************************************
+*
+* fillQueryServicePath -
+*
+* The query for a single service path (the most common case) is built once.
+*/
+BSONObj fillQueryServicePath(const std::vector<std::string>& servicePath)
+{
+  if (servicePath.size() != 1)
+  {
+    return fillQueryServicePathBuild(servicePath);
+  }
+
+  return servicePathQueryGet(servicePath[0], false);
+}
+
+
+
+/* ****************************************************************************
+*
+* servicePathSubscriptionQuery - query of the subscriptions matching an update in a service path
+*/
+BSONObj servicePathSubscriptionQuery(const std::string& servicePath)
+{
+  return servicePathQueryGet(servicePath, true);
+}
+
+
+
 /* *****************************************************************************
 *
 * processAreaScope -
@@ -945,6 +1123,324 @@ static std::string sortCriteria(const std::string& sortToken)
 
 
 
+/* ****************************************************************************
+*
+* sortKeysParse -
+*
+* Fields (and direction, 1 or -1) used to sort the entities for a given orderBy list.
+* The default order is by creation date.
+*/
+static void sortKeysParse
+(
+  const std::string&         sortOrderList,
+  std::vector<std::string>*  keyV,
+  std::vector<int>*          dirV
+)
+{
+  if (sortOrderList == "")
+  {
+    keyV->push_back(ENT_CREATION_DATE);
+    dirV->push_back(1);
+    return;
+  }
+
+  std::vector<std::string>  sortedV;
+  int                       components = stringSplit(sortOrderList, ',', sortedV);
+
+  for (int ix = 0; ix < components; ix++)
+  {
+    if (sortedV[ix][0] == '!')
+    {
+      // reverse
+      keyV->push_back(sortCriteria(sortedV[ix].substr(1)));
+      dirV->push_back(-1);
+    }
+    else
+    {
+      keyV->push_back(sortCriteria(sortedV[ix]));
+      dirV->push_back(1);
+    }
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* paginationCursorBuild -
+*
+* The cursor is the hex dump of a BSON object with the orderBy list and the values of the
+* sort keys (the last one being the entity _id) of the last entity in the page:
+*
+*   { o: "temperature,!humidity", k: [ 23.5, 80, { id: "E1", type: "T", servicePath: "/" } ] }
+*
+* Missing sort keys are kept as null, as this is the way they are sorted by MongoDB.
+*/
+static std::string paginationCursorBuild
+(
+  const BSONObj&                   doc,
+  const std::string&               sortOrderList,
+  const std::vector<std::string>&  keyV
+)
+{
+  static const char  hexDigits[] = "0123456789abcdef";
+  BSONArrayBuilder   values;
+
+  for (unsigned int ix = 0; ix < keyV.size(); ++ix)
+  {
+    BSONElement e = doc.getFieldDotted(keyV[ix]);
+
+    if (e.eoo())
+    {
+      values.appendNull();
+    }
+    else
+    {
+      values.append(e);
+    }
+  }
+
+  BSONObj      cursor = BSON("o" << sortOrderList << "k" << values.arr());
+  const char*  data   = cursor.objdata();
+  std::string  hex;
+
+  hex.reserve(cursor.objsize() * 2);
+  for (int ix = 0; ix < cursor.objsize(); ++ix)
+  {
+    hex += hexDigits[(data[ix] >> 4) & 0xF];
+    hex += hexDigits[data[ix] & 0xF];
+  }
+
+  return hex;
+}
+
+
+
+/* ****************************************************************************
+*
+* paginationCursorParse -
+*
+* Returns false if the cursor is not a valid one for the orderBy list of the request.
+*/
+bool paginationCursorParse(const std::string& cursor, const std::string& sortOrderList, BSONObj* cursorP)
+{
+  std::vector<std::string>  keyV;
+  std::vector<int>          dirV;
+  size_t                    size = cursor.size() / 2;
+
+  // At least the size of the object (4 bytes) and the final 0
+  if (((cursor.size() % 2) != 0) || (size < 5))
+  {
+    return false;
+  }
+
+  std::vector<char> data(size);
+
+  for (size_t ix = 0; ix < size; ++ix)
+  {
+    int nibbles[2];
+
+    for (int nIx = 0; nIx < 2; ++nIx)
+    {
+      char c = cursor[2 * ix + nIx];
+
+      if      ((c >= '0') && (c <= '9'))  nibbles[nIx] = c - '0';
+      else if ((c >= 'a') && (c <= 'f'))  nibbles[nIx] = c - 'a' + 10;
+      else                                return false;
+    }
+
+    data[ix] = (char) ((nibbles[0] << 4) | nibbles[1]);
+  }
+
+  // The size of a BSON object is its first int32 (little endian)
+  size_t objSize = (unsigned char) data[0] | ((unsigned char) data[1] << 8) | ((unsigned char) data[2] << 16) | ((unsigned char) data[3] << 24);
+
+  if ((objSize != size) || (data[size - 1] != 0))
+  {
+    return false;
+  }
+
+  BSONObj cursorObj(&data[0]);
+
+  if (!cursorObj.valid())
+  {
+    return false;
+  }
+
+  if ((cursorObj.getField("o").type() != mongo::String) || (cursorObj.getStringField("o") != sortOrderList))
+  {
+    return false;
+  }
+
+  if (cursorObj.getField("k").type() != mongo::Array)
+  {
+    return false;
+  }
+
+  // Same number of sort keys than the orderBy list, plus the _id
+  sortKeysParse(sortOrderList, &keyV, &dirV);
+  if (cursorObj.getField("k").Array().size() != keyV.size() + 1)
+  {
+    return false;
+  }
+
+  *cursorP = cursorObj.getOwned();
+
+  return true;
+}
+
+
+
+/* ****************************************************************************
+*
+* sortTypeBrackets -
+*
+* The BSON types that can be found in the sort keys, grouped in the order in which MongoDB
+* sorts them when a key has values of different types: null (or missing) < numbers < strings <
+* objects < booleans < dates < timestamps. Comparison operators ($gt, $lt) only match values of the same
+* group than the one compared with, so the groups before/after the one of a cursor value
+* need their own conditions (by $type) in paginationCursorFilter.
+*
+* Arrays are not in the list, as MongoDB sorts them by their lowest (ascending) or highest
+* (descending) element.
+*/
+static const int sortTypeBrackets[][3] =
+{
+  { mongo::jstNULL,       mongo::Undefined,  -1               },
+  { mongo::NumberDouble,  mongo::NumberInt,  mongo::NumberLong },
+  { mongo::String,        mongo::Symbol,     -1               },
+  { mongo::Object,        -1,                -1               },
+  { mongo::Bool,          -1,                -1               },
+  { mongo::Date,          -1,                -1               },
+  { mongo::Timestamp,     -1,                -1               }
+};
+
+
+
+/* ****************************************************************************
+*
+* sortTypeBracket - index in sortTypeBrackets of a BSON type, -1 if not found
+*/
+static int sortTypeBracket(int type)
+{
+  int brackets = sizeof(sortTypeBrackets) / sizeof(sortTypeBrackets[0]);
+
+  for (int bIx = 0; bIx < brackets; ++bIx)
+  {
+    for (int tIx = 0; tIx < 3; ++tIx)
+    {
+      if (sortTypeBrackets[bIx][tIx] == type)
+      {
+        return bIx;
+      }
+    }
+  }
+
+  return -1;
+}
+
+
+
+/* ****************************************************************************
+*
+* paginationCursorFilter -
+*
+* Condition for the entities after the cursor, according to the sort keys (k1, k2, ... _id)
+* and their directions:
+*
+*   { $or: [ { k1: { $gt: v1 } }, { k1: v1, k2: { $gt: v2 } }, ..., { k1: v1, k2: v2, ..., _id: { $gt: id } } ] }
+*
+* ($lt for descending keys). As $gt/$lt only match values of the same type than the cursor
+* value, for each key there are also conditions for the values of the types sorted after it
+* (see sortTypeBrackets):
+*
+*   - ascending:  { ki: { $type: t } } for the types after the one of vi, or { ki: { $ne: null } }
+*                 if vi is null (all the values but null/missing are after it)
+*   - descending: { ki: { $type: t } } for the types before the one of vi, and { ki: null } for the
+*                 entities with null or without ki, as null/missing is the lowest value. Nothing is
+*                 after a null vi.
+*/
+static BSONObj paginationCursorFilter
+(
+  const BSONObj&                   cursor,
+  const std::vector<std::string>&  keyV,
+  const std::vector<int>&          dirV
+)
+{
+  std::vector<BSONElement>  values   = cursor.getField("k").Array();
+  BSONArrayBuilder          orKeys;
+  int                       brackets = sizeof(sortTypeBrackets) / sizeof(sortTypeBrackets[0]);
+
+  for (unsigned int ix = 0; ix < keyV.size(); ++ix)
+  {
+    BSONObjBuilder  prefix;
+
+    for (unsigned int jx = 0; jx < ix; ++jx)
+    {
+      prefix.appendAs(values[jx], keyV[jx]);
+    }
+
+    BSONObj  equal   = prefix.obj();
+    int      bracket = sortTypeBracket(values[ix].type());
+
+    if (values[ix].isNull())
+    {
+      if (dirV[ix] > 0)
+      {
+        BSONObjBuilder condition;
+
+        condition.appendElements(equal);
+        condition.append(keyV[ix], BSON("$ne" << mongo::BSONNULL));
+        orKeys.append(condition.obj());
+      }
+
+      continue;
+    }
+
+    BSONObjBuilder  condition;
+    BSONObjBuilder  comparison;
+
+    comparison.appendAs(values[ix], (dirV[ix] > 0)? "$gt" : "$lt");
+    condition.appendElements(equal);
+    condition.append(keyV[ix], comparison.obj());
+    orKeys.append(condition.obj());
+
+    if (bracket == -1)
+    {
+      continue;
+    }
+
+    // Values of other types sorted after the cursor value (null is the first bracket)
+    int from = (dirV[ix] > 0)? bracket + 1 : 1;
+    int to   = (dirV[ix] > 0)? brackets    : bracket;
+
+    for (int bIx = from; bIx < to; ++bIx)
+    {
+      for (int tIx = 0; (tIx < 3) && (sortTypeBrackets[bIx][tIx] != -1); ++tIx)
+      {
+        BSONObjBuilder typeCondition;
+
+        typeCondition.appendElements(equal);
+        typeCondition.append(keyV[ix], BSON("$type" << sortTypeBrackets[bIx][tIx]));
+        orKeys.append(typeCondition.obj());
+      }
+    }
+
+    if (dirV[ix] < 0)
+    {
+      BSONObjBuilder nullCondition;
+
+      nullCondition.appendElements(equal);
+      nullCondition.appendNull(keyV[ix]);
+      orKeys.append(nullCondition.obj());
+    }
+  }
+
+  return BSON("$or" << orKeys.arr());
+}
+
+
+
 /* *****************************************************************************
 *
 * processAreaScopeV2 -
@@ -1134,7 +1630,9 @@ bool entitiesQuery
   bool*                            limitReached,
   long long*                       countP,
   const std::string&               sortOrderList,
-  ApiVersion                       apiVersion
+  ApiVersion                       apiVersion,
+  const BSONObj*                   cursorP,
+  std::string*                     nextCursorP
 )
 {
   /* Query structure is as follows
@@ -1264,46 +1762,47 @@ bool entitiesQuery
     finalQuery.appendElements(filters[ix]);
   }
 
+  /* Part 6: sort keys
+   *
+   * In the case of orderBy=geo:distance no sort is set, as the $near operator will do the
+   * sorting itself. Of course, using orderBy=geo:distance without using georel=near will return
+   * unexpected ordering, but this is already warned in the documentation.
+   *
+   * Paginating with cursor, the entity _id is added as last key, so the order is total and
+   * the page starts right after the entity in the cursor, whatever the number of previous pages.
+   */
+  std::vector<std::string>  sortKeyV;
+  std::vector<int>          sortDirV;
+
+  if (sortOrderList != ORDER_BY_PROXIMITY)
+  {
+    sortKeysParse(sortOrderList, &sortKeyV, &sortDirV);
+
+    if (nextCursorP != NULL)
+    {
+      sortKeyV.push_back("_id");
+      sortDirV.push_back(sortDirV.back());
+    }
+  }
+
+  if (cursorP != NULL)
+  {
+    finalQuery.append("$and", BSON_ARRAY(paginationCursorFilter(*cursorP, sortKeyV, sortDirV)));
+  }
+
   LM_T(LmtPagination, ("Offset: %d, Limit: %d, countP: %p", offset, limit, countP));
 
   /* Do the query on MongoDB */
   std::auto_ptr<DBClientCursor>  cursor;
   Query                          query(finalQuery.obj());
 
-  if (sortOrderList == "")
-  {
-    query.sort(BSON(ENT_CREATION_DATE << 1));
-  }
-  else if ((sortOrderList == ORDER_BY_PROXIMITY))
-  {
-    // In this case the solution is not setting any query.sort(), as the $near operator will do the
-    // sorting itself. Of course, using orderBy=geo:distance without using georel=near will return
-    // unexpected ordering, but this is already warned in the documentation.
-  }
-  else
+  if (sortKeyV.size() > 0)
   {
-    std::vector<std::string>  sortedV;
-    int                       components = stringSplit(sortOrderList, ',', sortedV);
-    BSONObjBuilder            sortOrder;
+    BSONObjBuilder sortOrder;
 
-    for (int ix = 0; ix < components; ix++)
+    for (unsigned int ix = 0; ix < sortKeyV.size(); ++ix)
     {
-      std::string  sortToken;
-      int          sortDirection;
-
-      if (sortedV[ix][0] == '!')
-      {
-        // reverse
-        sortToken     = sortedV[ix].substr(1);
-        sortDirection = -1;
-      }
-      else
-      {
-        sortToken     = sortedV[ix];
-        sortDirection = 1;
-      }
-
-      sortOrder.append(sortCriteria(sortToken), sortDirection);
+      sortOrder.append(sortKeyV[ix], sortDirV[ix]);
     }
 
     query.sort(sortOrder.obj());
@@ -1322,6 +1821,7 @@ bool entitiesQuery
 
   /* Process query result */
   unsigned int docs = 0;
+  BSONObj      lastDoc;
 
   while (moreSafe(cursor))
   {
@@ -1402,6 +1902,12 @@ bool entitiesQuery
     // Build CER from BSON retrieved from DB
     docs++;
     LM_T(LmtMongo, ("retrieved document [%d]: '%s'", docs, r.toString().c_str()));
+
+    // The cursor to the next page is only needed if this one is full
+    if ((nextCursorP != NULL) && (docs == (unsigned int) limit))
+    {
+      lastDoc = r.getOwned();
+    }
     ContextElementResponse*  cer = new ContextElementResponse(r, attrL, includeEmpty, apiVersion);
 
     addDatesForAttrs(cer, metadataList.lookup(NGSI_MD_DATECREATED), metadataList.lookup(NGSI_MD_DATEMODIFIED));
@@ -1439,6 +1945,11 @@ bool entitiesQuery
   }
   releaseMongoConnection(connection);
 
+  if ((nextCursorP != NULL) && !lastDoc.isEmpty())
+  {
+    *nextCursorP = paginationCursorBuild(lastDoc, sortOrderList, sortKeyV);
+  }
+
   /* If we have already reached the pagination limit with local entities, we have ended: no more "potential"
    * entities are added. Only if limitReached is being used, i.e. not NULL
    * FIXME P10 (it is easy :) limit should be unsigned int */
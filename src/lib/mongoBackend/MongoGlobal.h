@@ -257,6 +257,14 @@ extern std::string getSubscribeContextAvailabilityCollectionName(const std::stri
 
 
 
+/* ****************************************************************************
+*
+* getEntityTypesCollectionName -
+*/
+extern std::string getEntityTypesCollectionName(const std::string& tenant);
+
+
+
 /* ****************************************************************************
 *
 * mongoLocationCapable -
@@ -326,7 +334,22 @@ extern bool entitiesQuery
   bool*                            limitReached   = NULL,
   long long*                       countP         = NULL,
   const std::string&               sortOrderList  = "",
-  ApiVersion                       apiVersion     = V1
+  ApiVersion                       apiVersion     = V1,
+  const mongo::BSONObj*            cursorP        = NULL,
+  std::string*                     nextCursorP    = NULL
+);
+
+
+
+/* ****************************************************************************
+*
+* paginationCursorParse -
+*/
+extern bool paginationCursorParse
+(
+  const std::string&  cursor,
+  const std::string&  sortOrderList,
+  mongo::BSONObj*     cursorP
 );
 
 
@@ -460,6 +483,14 @@ extern mongo::BSONObj fillQueryServicePath(const std::vector<std::string>& servi
 
 
 
+/* ****************************************************************************
+*
+* servicePathSubscriptionQuery -
+*/
+extern mongo::BSONObj servicePathSubscriptionQuery(const std::string& servicePath);
+
+
+
 /* ****************************************************************************
 *
 * fillContextProviders -
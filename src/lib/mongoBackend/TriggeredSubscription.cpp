@@ -57,7 +57,8 @@ TriggeredSubscription::TriggeredSubscription
   tenant((_tenant == NULL)? "" : _tenant),
   stringFilterP(NULL),
   mdStringFilterP(NULL),
-  blacklist(false)
+  blacklist(false),
+  coalesceMs(0)
 {
 }
 
@@ -85,7 +86,8 @@ TriggeredSubscription::TriggeredSubscription
   tenant(""),
   stringFilterP(NULL),
   mdStringFilterP(NULL),
-  blacklist(false)
+  blacklist(false),
+  coalesceMs(0)
 {
 }
 
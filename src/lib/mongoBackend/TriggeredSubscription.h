@@ -31,6 +31,7 @@
 #include "apiTypesV2/HttpInfo.h"
 #include "common/RenderFormat.h"
 #include "ngsi/AttributeList.h"
+#include "orionTypes/GeoFilter.h"
 #include "rest/StringFilter.h"
 
 
@@ -62,6 +63,7 @@ class TriggeredSubscription
   StringFilter*             stringFilterP;
   StringFilter*             mdStringFilterP;
   bool                      blacklist;
+  long long                 coalesceMs;
   std::vector<std::string>  metadata;
 
   // FIXME P5: This entire struct will be removed once geo-stuff is implemented the same way StringFilter was implemented (for Issue #1705)
@@ -70,6 +72,7 @@ class TriggeredSubscription
     std::string               coords;
     std::string               georel;
   }                        expression;      // Only used by NGSIv2 subscription
+  orion::GeoFilter         geoFilter;       // compiled expression, to check the georel without DB
 
   TriggeredSubscription(long long                _throttling,
                         long long                _lastNotification,
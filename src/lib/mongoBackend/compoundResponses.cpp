@@ -23,7 +23,6 @@
 * Author: Fermín Galán
 */
 #include <string>
-#include <vector>
 
 #include "logMsg/logMsg.h"
 #include "logMsg/traceLevels.h"
@@ -43,95 +42,147 @@ using mongo::BSONObj;
 
 /* ****************************************************************************
 *
-* addCompoundNode -
+* compoundTypeSupported -
+*/
+static bool compoundTypeSupported(const BSONElement& e)
+{
+  return ((e.type() == mongo::String)       ||
+          (e.type() == mongo::Bool)         ||
+          (e.type() == mongo::NumberDouble) ||
+          (e.type() == mongo::jstNULL)      ||
+          (e.type() == mongo::Object)       ||
+          (e.type() == mongo::Array));
+}
+
+
+
+/* ****************************************************************************
+*
+* compoundNodes - number of nodes under a BSON object or array (i.e. the supported fields)
 *
+* If 'children' is true, only the fields of the object/array are counted, not their descendants.
 */
-static void addCompoundNode(orion::CompoundValueNode* cvP, const BSONElement& e)
+static unsigned int compoundNodes(const BSONElement& be, bool children)
 {
-  if ((e.type() != mongo::String)       &&
-      (e.type() != mongo::Bool)         &&
-      (e.type() != mongo::NumberDouble) &&
-      (e.type() != mongo::jstNULL)      &&
-      (e.type() != mongo::Object)       &&
-      (e.type() != mongo::Array))
+  BSONObj       obj   = be.embeddedObject();
+  unsigned int  nodes = 0;
+
+  for (BSONObj::iterator i = obj.begin(); i.more();)
   {
-    LM_E(("Runtime Error (unknown BSON type: %d)", e.type()));
-    return;
-  }
+    BSONElement e = i.next();
 
-  orion::CompoundValueNode* child = new orion::CompoundValueNode(orion::ValueTypeObject);
-  child->name = dbDotDecode(e.fieldName());
+    if (!compoundTypeSupported(e))
+    {
+      continue;
+    }
 
-  switch (e.type())
-  {
-  case mongo::String:
-    child->valueType  = orion::ValueTypeString;
-    child->stringValue = e.String();
-    break;
-
-  case mongo::Bool:
-    child->valueType  = orion::ValueTypeBoolean;
-    child->boolValue = e.Bool();
-    break;
-
-  case mongo::NumberDouble:
-    child->valueType  = orion::ValueTypeNumber;
-    child->numberValue = e.Number();
-    break;
-
-  case mongo::jstNULL:
-    child->valueType  = orion::ValueTypeNone;
-    break;
-
-  case mongo::Object:
-    compoundObjectResponse(child, e);
-    break;
-
-  case mongo::Array:
-    compoundVectorResponse(child, e);
-    break;
-
-  default:
-    //
-    // We need the default clause to avoid 'enumeration value X not handled in switch' errors
-    // due to -Werror=switch at compilation time
-    //
-    break;
+    ++nodes;
+
+    if ((children == false) && ((e.type() == mongo::Object) || (e.type() == mongo::Array)))
+    {
+      nodes += compoundNodes(e, false);
+    }
   }
 
-  cvP->add(child);
+  return nodes;
 }
 
 
+
 /* ****************************************************************************
 *
-* compoundObjectResponse -
+* addCompoundNodes -
+*
+* The children of 'cvP', out of the fields of the BSON object or array 'be', from the node
+* array of the flat tree whose root is 'rootP' (see CompoundValueNode::nodeArrayP).
 */
-void compoundObjectResponse(orion::CompoundValueNode* cvP, const BSONElement& be)
+static void addCompoundNodes(orion::CompoundValueNode* rootP, orion::CompoundValueNode* cvP, const BSONElement& be)
 {
-  BSONObj obj = be.embeddedObject();
+  BSONObj       obj = be.embeddedObject();
+  unsigned int  ix  = 0;
+
+  rootP->flatChildrenAdd(cvP, compoundNodes(be, true));
 
-  cvP->valueType = orion::ValueTypeObject;
   for (BSONObj::iterator i = obj.begin(); i.more();)
   {
     BSONElement e = i.next();
-    addCompoundNode(cvP, e);
+
+    if (!compoundTypeSupported(e))
+    {
+      LM_E(("Runtime Error (unknown BSON type: %d)", e.type()));
+      continue;
+    }
+
+    orion::CompoundValueNode* child = cvP->childV[ix++];
+    child->name = dbDotDecode(e.fieldName());
+
+    switch (e.type())
+    {
+    case mongo::String:
+      child->valueType  = orion::ValueTypeString;
+      child->stringValue = e.String();
+      break;
+
+    case mongo::Bool:
+      child->valueType  = orion::ValueTypeBoolean;
+      child->boolValue = e.Bool();
+      break;
+
+    case mongo::NumberDouble:
+      child->valueType  = orion::ValueTypeNumber;
+      child->numberValue = e.Number();
+      break;
+
+    case mongo::jstNULL:
+      child->valueType  = orion::ValueTypeNone;
+      break;
+
+    case mongo::Object:
+      child->valueType  = orion::ValueTypeObject;
+      addCompoundNodes(rootP, child, e);
+      break;
+
+    case mongo::Array:
+      child->valueType  = orion::ValueTypeVector;
+      addCompoundNodes(rootP, child, e);
+      break;
+
+    default:
+      //
+      // We need the default clause to avoid 'enumeration value X not handled in switch' errors
+      // due to -Werror=switch at compilation time
+      //
+      break;
+    }
   }
 }
 
 
+/* ****************************************************************************
+*
+* compoundObjectResponse -
+*
+* The compound is built as a flat tree, with 'cvP' as root.
+*/
+void compoundObjectResponse(orion::CompoundValueNode* cvP, const BSONElement& be)
+{
+  cvP->valueType = orion::ValueTypeObject;
+  cvP->flatInit(compoundNodes(be, false));
+
+  addCompoundNodes(cvP, cvP, be);
+}
+
+
 /* ****************************************************************************
 *
 * compoundVectorResponse -
+*
+* The compound is built as a flat tree, with 'cvP' as root.
 */
 void compoundVectorResponse(orion::CompoundValueNode* cvP, const BSONElement& be)
 {
-  std::vector<BSONElement> vec = be.Array();
-
   cvP->valueType = orion::ValueTypeVector;
-  for (unsigned int ix = 0; ix < vec.size(); ++ix)
-  {
-    BSONElement e = vec[ix];
-    addCompoundNode(cvP, e);
-  }
+  cvP->flatInit(compoundNodes(be, false));
+
+  addCompoundNodes(cvP, cvP, be);
 }
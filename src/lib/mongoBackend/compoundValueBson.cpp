@@ -49,7 +49,7 @@ using mongo::BSONObjBuilder;
 *
 * compoundValueBson (for arrays) -
 */
-void compoundValueBson(const std::vector<orion::CompoundValueNode*>& children, BSONArrayBuilder& b)
+void compoundValueBson(const orion::CompoundValueNodeVector& children, BSONArrayBuilder& b)
 {
   for (unsigned int ix = 0; ix < children.size(); ++ix)
   {
@@ -98,7 +98,7 @@ void compoundValueBson(const std::vector<orion::CompoundValueNode*>& children, B
 *
 * compoundValueBson (for objects) -
 */
-void compoundValueBson(const std::vector<orion::CompoundValueNode*>& children, BSONObjBuilder& b)
+void compoundValueBson(const orion::CompoundValueNodeVector& children, BSONObjBuilder& b)
 {
   for (unsigned int ix = 0; ix < children.size(); ++ix)
   {
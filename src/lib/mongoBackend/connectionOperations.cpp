@@ -23,6 +23,7 @@
 * Author: Fermín Galán
 */
 #include <string>
+#include <vector>
 
 #include "mongo/client/dbclient.h"
 
@@ -47,6 +48,8 @@ using mongo::BSONObj;
 using mongo::DBException;
 using mongo::Query;
 using mongo::WriteConcern;
+using mongo::WriteResult;
+using mongo::BulkOperationBuilder;
 
 
 
@@ -57,6 +60,8 @@ using mongo::WriteConcern;
 * Different from others, this function doesn't use getMongoConnection() and
 * releaseMongoConnection(). It is assumed that the caller will do, as the
 * connection cannot be released before the cursor has been used.
+*
+* If 'fieldsP' is not NULL, only the fields in it are returned (projection).
 */
 bool collectionQuery
 (
@@ -64,7 +69,8 @@ bool collectionQuery
   const std::string&              col,
   const BSONObj&                  q,
   std::auto_ptr<DBClientCursor>*  cursor,
-  std::string*                    err
+  std::string*                    err,
+  const BSONObj*                  fieldsP
 )
 {
   if (connection == NULL)
@@ -79,7 +85,7 @@ bool collectionQuery
 
   try
   {
-    *cursor = connection->query(col.c_str(), q);
+    *cursor = connection->query(col.c_str(), q, 0, 0, fieldsP);
 
     // We have observed that in some cases of DB errors (e.g. the database daemon is down) instead of
     // raising an exception, the query() method sets the cursor to NULL. In this case, we raise the
@@ -549,6 +555,136 @@ bool collectionRemove
 
 
 
+/* ****************************************************************************
+*
+* collectionBulkWrite -
+*
+* All the operations are sent as a single unordered bulk write (the driver splits it
+* in as many write commands as the server batch limit requires), so they must be
+* independent of each other.
+*
+* The result of each operation is returned in errV (same index as in opV), empty if the
+* operation succeeded. False is returned (and err filled) if the bulk as a whole failed.
+*/
+bool collectionBulkWrite
+(
+  const std::string&               col,
+  const std::vector<BulkWriteOp>&  opV,
+  std::vector<std::string>*        errV,
+  std::string*                     err
+)
+{
+  errV->assign(opV.size(), "");
+
+  if (opV.size() == 0)
+  {
+    return true;
+  }
+
+  TIME_STAT_MONGO_WRITE_WAIT_START();
+  DBClientBase* connection = getMongoConnection();
+
+  if (connection == NULL)
+  {
+    TIME_STAT_MONGO_WRITE_WAIT_STOP();
+
+    LM_E(("Fatal Error (null DB connection)"));
+    *err = "null DB connection";
+
+    return false;
+  }
+
+  LM_T(LmtMongo, ("bulk write in '%s' collection: %lu operations", col.c_str(), (unsigned long) opV.size()));
+
+  WriteResult  result;
+
+  try
+  {
+    BulkOperationBuilder bulk = connection->initializeUnorderedBulkOp(col);
+
+    for (unsigned int ix = 0; ix < opV.size(); ++ix)
+    {
+      if (opV[ix].insert)
+      {
+        bulk.insert(opV[ix].doc);
+      }
+      else if (opV[ix].upsert)
+      {
+        bulk.find(opV[ix].q).upsert().updateOne(opV[ix].doc);
+      }
+      else
+      {
+        bulk.find(opV[ix].q).updateOne(opV[ix].doc);
+      }
+    }
+
+    bulk.execute(&connection->getWriteConcern(), &result);
+    releaseMongoConnection(connection);
+    TIME_STAT_MONGO_WRITE_WAIT_STOP();
+    LM_I(("Database Operation Successful (bulk write: %lu operations)", (unsigned long) opV.size()));
+  }
+  catch (const std::exception& e)
+  {
+    releaseMongoConnection(connection);
+    TIME_STAT_MONGO_WRITE_WAIT_STOP();
+
+    //
+    // Errors in some of the operations (e.g. duplicated key) are reported as an exception,
+    // but the rest of operations (the bulk is unordered) have been done
+    //
+    const std::vector<BSONObj>& writeErrors = result.writeErrors();
+
+    if (writeErrors.size() == 0)
+    {
+      std::string msg = std::string("collection: ") + col.c_str() +
+        " - bulk write of " + toString(opV.size()) + " operations" +
+        " - exception: " + e.what();
+
+      *err = "Database Error (" + msg + ")";
+      alarmMgr.dbError(msg);
+
+      return false;
+    }
+
+    for (unsigned int ix = 0; ix < writeErrors.size(); ++ix)
+    {
+      unsigned int opIx = writeErrors[ix].getIntField("index");
+
+      if (opIx < opV.size())
+      {
+        std::string msg = std::string("collection: ") + col.c_str() +
+          " - " + (opV[opIx].insert? "insert(): <" + opV[opIx].doc.toString() + ">" :
+                                     "update(): <" + opV[opIx].q.toString() + "," + opV[opIx].doc.toString() + ">") +
+          " - exception: " + writeErrors[ix].getStringField("errmsg");
+
+        (*errV)[opIx] = "Database Error (" + msg + ")";
+        alarmMgr.dbError(msg);
+      }
+    }
+
+    return true;
+  }
+  catch (...)
+  {
+    releaseMongoConnection(connection);
+    TIME_STAT_MONGO_WRITE_WAIT_STOP();
+
+    std::string msg = std::string("collection: ") + col.c_str() +
+      " - bulk write of " + toString(opV.size()) + " operations" +
+      " - exception: generic";
+
+    *err = "Database Error (" + msg + ")";
+    alarmMgr.dbError(msg);
+
+    return false;
+  }
+
+  alarmMgr.dbErrorReset();
+  return true;
+}
+
+
+
 /* ****************************************************************************
 *
 * collectionCreateIndex -
@@ -26,6 +26,7 @@
 * Author: Fermín Galán
 */
 #include <string>
+#include <vector>
 
 #include "mongo/client/dbclient.h"
 
@@ -41,7 +42,8 @@ extern bool collectionQuery
   const std::string&                     col,
   const mongo::BSONObj&                  q,
   std::auto_ptr<mongo::DBClientCursor>*  cursor,
-  std::string*                           err
+  std::string*                           err,
+  const mongo::BSONObj*                  fieldsP = NULL
 );
 
 
@@ -133,6 +135,37 @@ extern bool collectionRemove
 
 
 
+/* ****************************************************************************
+*
+* BulkWriteOp - an operation of collectionBulkWrite
+*
+* If 'insert' is true, 'doc' is inserted. Otherwise, the first document matching 'q'
+* is updated with 'doc' (as collectionUpdate, with or without 'upsert').
+*/
+typedef struct BulkWriteOp
+{
+  bool             insert;
+  bool             upsert;
+  mongo::BSONObj   q;
+  mongo::BSONObj   doc;
+} BulkWriteOp;
+
+
+
+/* ****************************************************************************
+*
+* collectionBulkWrite -
+*/
+extern bool collectionBulkWrite
+(
+  const std::string&               col,
+  const std::vector<BulkWriteOp>&  opV,
+  std::vector<std::string>*        errV,
+  std::string*                     err
+);
+
+
+
 /* ****************************************************************************
 *
 * collectionCreateIndex -
@@ -36,6 +36,7 @@
 #define COL_REGISTRATIONS  "registrations"
 #define COL_CSUBS          "csubs"
 #define COL_CASUBS         "casubs"
+#define COL_ENTITY_TYPES   "entityTypes"
 
 
 
@@ -108,8 +109,10 @@
 #define CSUB_QS                      "qs"
 #define CSUB_PAYLOAD                 "payload"
 #define CSUB_BLACKLIST               "blacklist"
+#define CSUB_COALESCE                "coalesceMs"
 #define CSUB_LASTFAILURE             "lastFailure"
 #define CSUB_LASTSUCCESS             "lastSuccess"
+#define CSUB_MODDATE                 "modDate"
 
 #define CASUB_EXPIRATION             "expiration"
 #define CASUB_REFERENCE              "reference"
@@ -114,7 +114,8 @@ static void insertInCache
                      sub.subject.condition.expression.geometry,
                      sub.subject.condition.expression.coords,
                      sub.subject.condition.expression.georel,
-                     sub.notification.blacklist);
+                     sub.notification.blacklist,
+                     sub.notification.coalesceMs);
 
   cacheSemGive(__FUNCTION__, "Inserting subscription in cache");
 }
@@ -160,6 +161,7 @@ std::string mongoCreateSubscription
   setAttrs(sub, &b);
   setMetadata(sub, &b);
   setBlacklist(sub, &b);
+  setCoalesce(sub, &b);
 
   std::string status = sub.status == ""?  STATUS_ACTIVE : sub.status;
 
@@ -188,6 +190,7 @@ std::string mongoCreateSubscription
 
   setExpression(sub, &b);
   setFormat(sub, &b);
+  setModDate(&b);
 
   BSONObj doc = b.obj();
 
@@ -303,6 +303,10 @@ static void processGenericEntities
 *
 *   This replaces the 'uriParams[URI_PARAM_PAGINATION_DETAILS]' way of passing this information.
 *   The old method was one-way, using the new method 
+*
+*   If the out-parameter nextCursorP is non-NULL, the entities are paginated with cursor (starting
+*   after the one in uriParams[URI_PARAM_PAGINATION_CURSOR], if any) and the cursor to the next page
+*   is returned in *nextCursorP (empty if this page is not full, i.e. there are no more pages).
 */
 HttpStatusCode mongoQueryContext
 (
@@ -313,7 +317,8 @@ HttpStatusCode mongoQueryContext
   std::map<std::string, std::string>&  uriParams,
   std::map<std::string, bool>&         options,
   long long*                           countP,
-  ApiVersion                           apiVersion
+  ApiVersion                           apiVersion,
+  std::string*                         nextCursorP
 )
 {
   int         offset         = atoi(uriParams[URI_PARAM_PAGINATION_OFFSET].c_str());
@@ -335,6 +340,39 @@ HttpStatusCode mongoQueryContext
   bool                         limitReached = false;
   bool                         reqSemTaken;
   ContextElementResponseVector rawCerV;
+  mongo::BSONObj               cursor;
+  mongo::BSONObj*              cursorP      = NULL;
+
+  //
+  // Pagination with cursor replaces offset, and it needs a sort order known by the broker
+  //
+  if (nextCursorP != NULL)
+  {
+    std::string cursorString = uriParams[URI_PARAM_PAGINATION_CURSOR];
+
+    if (offset != 0)
+    {
+      responseP->errorCode.fill(SccBadRequest, "Incompatible parameters: offset, cursor");
+      return SccOk;
+    }
+
+    if (sortOrderList == ORDER_BY_PROXIMITY)
+    {
+      responseP->errorCode.fill(SccBadRequest, "Incompatible parameters: orderBy=geo:distance, cursor");
+      return SccOk;
+    }
+
+    if (cursorString != "")
+    {
+      if (!paginationCursorParse(cursorString, sortOrderList, &cursor))
+      {
+        responseP->errorCode.fill(SccBadRequest, "Invalid pagination cursor (for the orderBy of this query)");
+        return SccOk;
+      }
+
+      cursorP = &cursor;
+    }
+  }
 
   //
   // dateCreated and dateModified options are still supported although deprecated.
@@ -376,7 +414,9 @@ HttpStatusCode mongoQueryContext
                      &limitReached,
                      countP,
                      sortOrderList,
-                     apiVersion);
+                     apiVersion,
+                     cursorP,
+                     nextCursorP);
 
   if (!ok)
   {
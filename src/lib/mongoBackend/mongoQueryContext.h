@@ -49,7 +49,8 @@ extern HttpStatusCode mongoQueryContext
   std::map<std::string, std::string>&   uriParams,
   std::map<std::string, bool>&          options,
   long long*                            countP        = NULL,
-  ApiVersion                            apiVersion    = V1
+  ApiVersion                            apiVersion    = V1,
+  std::string*                          nextCursorP   = NULL
 );
 
 #endif  // SRC_LIB_MONGOBACKEND_MONGOQUERYCONTEXT_H_
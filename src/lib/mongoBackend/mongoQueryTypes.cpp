@@ -38,6 +38,7 @@
 #include "mongoBackend/dbFieldEncoding.h"
 #include "mongoBackend/safeMongo.h"
 #include "mongoBackend/mongoQueryTypes.h"
+#include "mongoBackend/mongoTypesCatalog.h"
 
 
 
@@ -176,6 +177,95 @@ static long long countEntities
 
 
 
+/* ****************************************************************************
+*
+* catalogTypes - entity types (with some entity) in the catalog, in order
+*/
+static void catalogTypes
+(
+  const std::map<std::string, TypesCatalogItem>&  catalog,
+  std::vector<std::string>*                       typesP
+)
+{
+  for (std::map<std::string, TypesCatalogItem>::const_iterator it = catalog.begin(); it != catalog.end(); ++it)
+  {
+    if (it->second.count > 0)
+    {
+      typesP->push_back(it->first);
+    }
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* catalogAttrs - attributes of an entity type in the catalog, in order
+*/
+static void catalogAttrs(const TypesCatalogItem& item, std::vector<std::string>* attrsP)
+{
+  std::map<std::string, std::map<std::string, long long> >::const_iterator  attrIt;
+
+  for (attrIt = item.attrs.begin(); attrIt != item.attrs.end(); ++attrIt)
+  {
+    for (std::map<std::string, long long>::const_iterator typeIt = attrIt->second.begin(); typeIt != attrIt->second.end(); ++typeIt)
+    {
+      if (typeIt->second > 0)
+      {
+        attrsP->push_back(attrIt->first);
+        break;
+      }
+    }
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* catalogAttrAdd -
+*
+* Adds an attribute of the catalog to the vector, the same way mongoEntityTypes()
+* and mongoAttributesForEntityType() do with the attributes found in the entities
+* collection: one element per attribute type (only the first one in NGSIv1) or
+* one element with empty type in the case of noAttrDetail.
+*/
+static void catalogAttrAdd
+(
+  const TypesCatalogItem&  item,
+  const std::string&       attrName,
+  bool                     noAttrDetail,
+  ApiVersion               apiVersion,
+  ContextAttributeVector*  caVP
+)
+{
+  if (noAttrDetail)
+  {
+    caVP->push_back(new ContextAttribute(attrName, "", ""));
+    return;
+  }
+
+  const std::map<std::string, long long>& types = item.attrs.find(attrName)->second;
+
+  for (std::map<std::string, long long>::const_iterator it = types.begin(); it != types.end(); ++it)
+  {
+    if (it->second <= 0)
+    {
+      continue;
+    }
+
+    caVP->push_back(new ContextAttribute(attrName, it->first, ""));
+
+    // For backward compability, NGSIv1 only accepts one element
+    if (apiVersion == V1)
+    {
+      break;
+    }
+  }
+}
+
+
+
 /* ****************************************************************************
 *
 * mongoEntityTypesValues -
@@ -202,6 +292,31 @@ HttpStatusCode mongoEntityTypesValues
 
   reqSemTake(__FUNCTION__, "query types request", SemReadOp, &reqSemTaken);
 
+  // If the entity types catalog of the tenant has been built, the response is taken from it
+  std::map<std::string, TypesCatalogItem> catalog;
+
+  if (typesCatalogGet(tenant, servicePathV, NULL, &catalog))
+  {
+    std::vector<std::string> types;
+
+    catalogTypes(catalog, &types);
+
+    if (totalTypesP != NULL)
+    {
+      *totalTypesP = types.size();
+    }
+
+    for (unsigned int ix = offset; ix < MIN(types.size(), offset + limit); ++ix)
+    {
+      responseP->entityTypeVector.push_back(new EntityType(types[ix]));
+    }
+
+    responseP->statusCode.fill(SccOk);
+    reqSemGive(__FUNCTION__, "query types request", reqSemTaken);
+
+    return SccOk;
+  }
+
   /* Compose query based on this aggregation command:
    *
    * db.runCommand({aggregate: "entities",
@@ -297,6 +412,93 @@ HttpStatusCode mongoEntityTypesValues
 
 
 
+/* ****************************************************************************
+*
+* entityTypesFromCatalog -
+*
+* Same response as the one built by mongoEntityTypes() from the aggregation result,
+* including the type "" going last.
+*/
+static void entityTypesFromCatalog
+(
+  EntityTypeVectorResponse*                       responseP,
+  const std::map<std::string, TypesCatalogItem>&  catalog,
+  unsigned int                                    offset,
+  unsigned int                                    limit,
+  ApiVersion                                      apiVersion,
+  unsigned int*                                   totalTypesP,
+  bool                                            noAttrDetail
+)
+{
+  std::vector<std::string>  types;
+  EntityType*               emptyEntityType = NULL;
+
+  catalogTypes(catalog, &types);
+
+  if (totalTypesP != NULL)
+  {
+    *totalTypesP = types.size();
+  }
+
+  for (unsigned int ix = offset; ix < MIN(types.size(), offset + limit); ++ix)
+  {
+    const TypesCatalogItem&   item        = catalog.find(types[ix])->second;
+    EntityType*               entityTypeP = new EntityType(types[ix]);
+    std::vector<std::string>  attrs;
+
+    entityTypeP->count = item.count;
+
+    catalogAttrs(item, &attrs);
+    for (unsigned int jx = 0; jx < attrs.size(); ++jx)
+    {
+      catalogAttrAdd(item, attrs[jx], noAttrDetail, apiVersion, &entityTypeP->contextAttributeVector);
+    }
+
+    if (types[ix] == "")
+    {
+      emptyEntityType = entityTypeP;
+    }
+    else
+    {
+      responseP->entityTypeVector.push_back(entityTypeP);
+    }
+  }
+
+  if (emptyEntityType != NULL)
+  {
+    responseP->entityTypeVector.push_back(emptyEntityType);
+  }
+
+  char detailsMsg[256];
+
+  if (responseP->entityTypeVector.size() > 0)
+  {
+    if (totalTypesP != NULL)
+    {
+      snprintf(detailsMsg, sizeof(detailsMsg), "Count: %d", (int) types.size());
+      responseP->statusCode.fill(SccOk, detailsMsg);
+    }
+    else
+    {
+      responseP->statusCode.fill(SccOk);
+    }
+  }
+  else
+  {
+    if ((totalTypesP != NULL) && (types.size() > 0))
+    {
+      snprintf(detailsMsg, sizeof(detailsMsg), "Number of types: %zu. Offset is %u", types.size(), offset);
+      responseP->statusCode.fill(SccContextElementNotFound, detailsMsg);
+    }
+    else
+    {
+      responseP->statusCode.fill(SccContextElementNotFound);
+    }
+  }
+}
+
+
+
 /* ****************************************************************************
 *
 * mongoEntityTypes -
@@ -321,6 +523,17 @@ HttpStatusCode mongoEntityTypes
 
   reqSemTake(__FUNCTION__, "query types request", SemReadOp, &reqSemTaken);
 
+  // If the entity types catalog of the tenant has been built, the response is taken from it
+  std::map<std::string, TypesCatalogItem> catalog;
+
+  if (typesCatalogGet(tenant, servicePathV, NULL, &catalog))
+  {
+    entityTypesFromCatalog(responseP, catalog, offset, limit, apiVersion, totalTypesP, noAttrDetail);
+    reqSemGive(__FUNCTION__, "query types request", reqSemTaken);
+
+    return SccOk;
+  }
+
   /* Compose query based on this aggregation command:
    *
    * db.runCommand({aggregate: "entities",
@@ -544,6 +757,70 @@ HttpStatusCode mongoEntityTypes
 
 
 
+/* ****************************************************************************
+*
+* attributesFromCatalog -
+*
+* Same response as the one built by mongoAttributesForEntityType() from the aggregation result
+*/
+static void attributesFromCatalog
+(
+  EntityTypeResponse*      responseP,
+  const TypesCatalogItem&  item,
+  unsigned int             offset,
+  unsigned int             limit,
+  bool                     count,
+  bool                     noAttrDetail,
+  ApiVersion               apiVersion
+)
+{
+  std::vector<std::string> attrs;
+
+  responseP->entityType.count = item.count;
+
+  catalogAttrs(item, &attrs);
+
+  if (attrs.size() == 0)
+  {
+    responseP->statusCode.fill(SccContextElementNotFound);
+    return;
+  }
+
+  for (unsigned int ix = offset; ix < MIN(attrs.size(), offset + limit); ++ix)
+  {
+    catalogAttrAdd(item, attrs[ix], noAttrDetail, apiVersion, &responseP->entityType.contextAttributeVector);
+  }
+
+  char detailsMsg[256];
+
+  if (responseP->entityType.contextAttributeVector.size() > 0)
+  {
+    if (count)
+    {
+      snprintf(detailsMsg, sizeof(detailsMsg), "Count: %d", (int) attrs.size());
+      responseP->statusCode.fill(SccOk, detailsMsg);
+    }
+    else
+    {
+      responseP->statusCode.fill(SccOk);
+    }
+  }
+  else
+  {
+    if (count)
+    {
+      snprintf(detailsMsg, sizeof(detailsMsg), "Number of attributes: %zu. Offset is %u", attrs.size(), offset);
+      responseP->statusCode.fill(SccContextElementNotFound, detailsMsg);
+    }
+    else
+    {
+      responseP->statusCode.fill(SccContextElementNotFound);
+    }
+  }
+}
+
+
+
 /* ****************************************************************************
 *
 * mongoAttributesForEntityType -
@@ -580,6 +857,16 @@ HttpStatusCode mongoAttributesForEntityType
 
   reqSemTake(__FUNCTION__, "query types attributes request", SemReadOp, &reqSemTaken);
 
+  // If the entity types catalog of the tenant has been built, the response is taken from it
+  std::map<std::string, TypesCatalogItem> catalog;
+
+  if (typesCatalogGet(tenant, servicePathV, &entityType, &catalog))
+  {
+    attributesFromCatalog(responseP, catalog[entityType], offset, limit, count, noAttrDetail, apiVersion);
+    reqSemGive(__FUNCTION__, "query types request", reqSemTaken);
+
+    return SccOk;
+  }
 
   /* Compose query based on this aggregation command:
    *
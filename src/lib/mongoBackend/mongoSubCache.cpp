@@ -61,7 +61,10 @@ using mongo::OID;
 
 /* ****************************************************************************
 *
-* mongoSubCacheItemInsert -
+* mongoSubCacheItemBuild -
+*
+* Create a CachedSubscription from the subscription document, without inserting it
+* in the cache (no need for the cache semaphore).
 *
 * RETURN VALUES
 *   0:  all OK
@@ -71,10 +74,10 @@ using mongo::OID;
 *  -5:  Error parsing string filter
 *  -6:  Error parsing metadata string filter
 *
-* Note that the 'count' of the inserted subscription is set to ZERO.
+* Note that the 'count' of the subscription is set to ZERO.
 *
 */
-int mongoSubCacheItemInsert(const char* tenant, const BSONObj& sub)
+static int mongoSubCacheItemBuild(const char* tenant, const BSONObj& sub, CachedSubscription** cSubPP)
 {
   //
   // 01. Check validity of subP parameter
@@ -120,8 +123,10 @@ int mongoSubCacheItemInsert(const char* tenant, const BSONObj& sub)
   cSubP->lastNotificationTime  = sub.hasField(CSUB_LASTNOTIFICATION)? getIntOrLongFieldAsLongF(sub, CSUB_LASTNOTIFICATION) : -1;
   cSubP->status                = sub.hasField(CSUB_STATUS)?           getStringFieldF(sub, CSUB_STATUS).c_str()            : "active";
   cSubP->blacklist             = sub.hasField(CSUB_BLACKLIST)?        getBoolFieldF(sub, CSUB_BLACKLIST)                   : false;
+  cSubP->coalesceMs            = sub.hasField(CSUB_COALESCE)?         getIntOrLongFieldAsLongF(sub, CSUB_COALESCE)         : 0;
   cSubP->lastFailure           = sub.hasField(CSUB_LASTFAILURE)?      getIntOrLongFieldAsLongF(sub, CSUB_LASTFAILURE)      : -1;
   cSubP->lastSuccess           = sub.hasField(CSUB_LASTSUCCESS)?      getIntOrLongFieldAsLongF(sub, CSUB_LASTSUCCESS)      : -1;
+  cSubP->modDate               = sub.hasField(CSUB_MODDATE)?          getIntOrLongFieldAsLongF(sub, CSUB_MODDATE)          : 0;
   cSubP->count                 = 0;
   cSubP->next                  = NULL;
 
@@ -132,6 +137,7 @@ int mongoSubCacheItemInsert(const char* tenant, const BSONObj& sub)
   // Note that the URL of the notification is stored outside the httpInfo object in mongo
   //
   cSubP->httpInfo.fill(sub);
+  cSubP->httpInfo.templatesCompile();
 
 
   //
@@ -189,6 +195,8 @@ int mongoSubCacheItemInsert(const char* tenant, const BSONObj& sub)
     {
       cSubP->expression.georel = getStringFieldF(expression, CSUB_EXPR_GEOREL);
     }
+
+    cSubP->expression.geoFilter.compile(cSubP->expression.geometry, cSubP->expression.coords, cSubP->expression.georel);
   }
 
 
@@ -235,14 +243,35 @@ int mongoSubCacheItemInsert(const char* tenant, const BSONObj& sub)
   //
   setStringVectorF(sub, CSUB_CONDITIONS, &(cSubP->notifyConditionV));
 
-
-  subCacheItemInsert(cSubP);
+  *cSubPP = cSubP;
 
   return 0;
 }
 
 
 
+/* ****************************************************************************
+*
+* mongoSubCacheItemInsert -
+*
+* RETURN VALUES
+*   See mongoSubCacheItemBuild
+*/
+int mongoSubCacheItemInsert(const char* tenant, const BSONObj& sub)
+{
+  CachedSubscription*  cSubP = NULL;
+  int                  r     = mongoSubCacheItemBuild(tenant, sub, &cSubP);
+
+  if (r == 0)
+  {
+    subCacheItemInsert(cSubP);
+  }
+
+  return r;
+}
+
+
+
 /* ****************************************************************************
 *
 * mongoSubCacheItemInsert -
@@ -372,6 +401,8 @@ int mongoSubCacheItemInsert
   cSubP->expression.georel     = georel;
   cSubP->next                  = NULL;
   cSubP->blacklist             = sub.hasField(CSUB_BLACKLIST)? getBoolFieldF(sub, CSUB_BLACKLIST) : false;
+  cSubP->coalesceMs            = sub.hasField(CSUB_COALESCE)? getIntOrLongFieldAsLongF(sub, CSUB_COALESCE) : 0;
+  cSubP->modDate               = sub.hasField(CSUB_MODDATE)? getIntOrLongFieldAsLongF(sub, CSUB_MODDATE) : 0;
 
   //
   // httpInfo
@@ -379,6 +410,7 @@ int mongoSubCacheItemInsert
   // Note that the URL of the notification is stored outside the httpInfo object in mongo
   //
   cSubP->httpInfo.fill(sub);
+  cSubP->httpInfo.templatesCompile();
 
 
   //
@@ -405,6 +437,8 @@ int mongoSubCacheItemInsert
     cSubP->expression.mdStringFilter.fill(mdStringFilterP, &errorString);
   }
 
+  cSubP->expression.geoFilter.compile(geometry, coords, georel);
+
   LM_T(LmtSubCache, ("set lastNotificationTime to %lu for '%s' (from DB)", cSubP->lastNotificationTime, cSubP->subscriptionId));
 
 
@@ -493,6 +527,158 @@ void mongoSubCacheRefresh(const std::string& database)
 
 
 
+/* ****************************************************************************
+*
+* mongoSubCacheStateGet -
+*
+* Get, for all the subscriptions of a database, the fields that subCacheSync needs to
+* know whether the cached copy of the subscription is up to date. Only these fields are
+* returned by the query (projection), not the whole documents.
+*
+* Returns false if the query fails, so the caller doesn't take the subscriptions of the
+* database as removed.
+*/
+bool mongoSubCacheStateGet(const std::string& database, std::vector<SubCacheDbState>* stateV)
+{
+  BSONObj                        query;      // empty query (all subscriptions)
+  BSONObj                        fields      = BSON("_id"                 << 1 <<
+                                                    CSUB_MODDATE          << 1 <<
+                                                    CSUB_LASTNOTIFICATION << 1 <<
+                                                    CSUB_LASTFAILURE      << 1 <<
+                                                    CSUB_LASTSUCCESS      << 1);
+  std::string                    tenant      = tenantFromDb(database);
+  std::string                    collection  = getSubscribeContextCollectionName(tenant);
+  std::auto_ptr<DBClientCursor>  cursor;
+  std::string                    errorString;
+
+  TIME_STAT_MONGO_READ_WAIT_START();
+  DBClientBase* connection = getMongoConnection();
+  if (collectionQuery(connection, collection, query, &cursor, &errorString, &fields) != true)
+  {
+    releaseMongoConnection(connection);
+    TIME_STAT_MONGO_READ_WAIT_STOP();
+    LM_E(("Runtime Error (getting subscriptions of database '%s': %s)", database.c_str(), errorString.c_str()));
+    return false;
+  }
+  TIME_STAT_MONGO_READ_WAIT_STOP();
+
+  while (moreSafe(cursor))
+  {
+    BSONObj          sub;
+    std::string      err;
+    SubCacheDbState  state;
+
+    if (!nextSafeOrErrorF(cursor, &sub, &err))
+    {
+      LM_E(("Runtime Error (exception in nextSafe(): %s - query: %s)", err.c_str(), query.toString().c_str()));
+      releaseMongoConnection(connection);
+      return false;
+    }
+
+    BSONElement idField = getFieldF(sub, "_id");
+
+    if (idField.eoo() == true)
+    {
+      continue;
+    }
+
+    state.subscriptionId       = idField.OID().toString();
+    state.modDate              = sub.hasField(CSUB_MODDATE)?          getIntOrLongFieldAsLongF(sub, CSUB_MODDATE)          : 0;
+    state.lastNotificationTime = sub.hasField(CSUB_LASTNOTIFICATION)? getIntOrLongFieldAsLongF(sub, CSUB_LASTNOTIFICATION) : -1;
+    state.lastFailure          = sub.hasField(CSUB_LASTFAILURE)?      getIntOrLongFieldAsLongF(sub, CSUB_LASTFAILURE)      : -1;
+    state.lastSuccess          = sub.hasField(CSUB_LASTSUCCESS)?      getIntOrLongFieldAsLongF(sub, CSUB_LASTSUCCESS)      : -1;
+
+    stateV->push_back(state);
+  }
+  releaseMongoConnection(connection);
+
+  return true;
+}
+
+
+
+/* ****************************************************************************
+*
+* mongoSubCacheLoad -
+*
+* Create CachedSubscriptions for the subscriptions in 'subIdV', all of them in a single query.
+* The subscriptions are NOT inserted in the cache, that is up to the caller (with the cache
+* semaphore taken). Subscriptions that are not valid for the cache are just not returned.
+*
+* Returns false if the query fails (or the cursor breaks in the middle), with 'cSubV' empty,
+* so the caller doesn't take the subscriptions that could not be loaded as invalid.
+*/
+bool mongoSubCacheLoad
+(
+  const std::string&                 database,
+  const std::vector<std::string>&    subIdV,
+  std::vector<CachedSubscription*>*  cSubV
+)
+{
+  if (subIdV.size() == 0)
+  {
+    return true;
+  }
+
+  mongo::BSONArrayBuilder  idV;
+
+  for (unsigned int ix = 0; ix < subIdV.size(); ++ix)
+  {
+    idV.append(OID(subIdV[ix]));
+  }
+
+  BSONObj                        query       = BSON("_id" << BSON("$in" << idV.arr()));
+  std::string                    tenant      = tenantFromDb(database);
+  std::string                    collection  = getSubscribeContextCollectionName(tenant);
+  std::auto_ptr<DBClientCursor>  cursor;
+  std::string                    errorString;
+
+  TIME_STAT_MONGO_READ_WAIT_START();
+  DBClientBase* connection = getMongoConnection();
+  if (collectionQuery(connection, collection, query, &cursor, &errorString) != true)
+  {
+    releaseMongoConnection(connection);
+    TIME_STAT_MONGO_READ_WAIT_STOP();
+    LM_E(("Runtime Error (loading subscriptions of database '%s': %s)", database.c_str(), errorString.c_str()));
+    return false;
+  }
+  TIME_STAT_MONGO_READ_WAIT_STOP();
+
+  while (moreSafe(cursor))
+  {
+    BSONObj              sub;
+    std::string          err;
+    CachedSubscription*  cSubP = NULL;
+
+    if (!nextSafeOrErrorF(cursor, &sub, &err))
+    {
+      LM_E(("Runtime Error (exception in nextSafe(): %s - query: %s)", err.c_str(), query.toString().c_str()));
+      releaseMongoConnection(connection);
+
+      for (unsigned int ix = 0; ix < cSubV->size(); ++ix)
+      {
+        subCacheItemDestroy((*cSubV)[ix]);
+        delete (*cSubV)[ix];
+      }
+      cSubV->clear();
+
+      return false;
+    }
+
+    if (mongoSubCacheItemBuild(tenant.c_str(), sub, &cSubP) == 0)
+    {
+      cSubV->push_back(cSubP);
+    }
+  }
+  releaseMongoConnection(connection);
+
+  LM_T(LmtSubCache, ("Loaded %d of %d subscriptions for database '%s'", cSubV->size(), subIdV.size(), database.c_str()));
+
+  return true;
+}
+
+
+
 /* ****************************************************************************
 *
 * mongoSubCountersUpdateCount -
@@ -646,3 +832,95 @@ void mongoSubCountersUpdate
     mongoSubCountersUpdateLastSuccess(collection, subId, lastSuccess);
   }
 }
+
+
+
+/* ****************************************************************************
+*
+* mongoSubCountersBulkUpdate - update the counters of several subscriptions of a tenant
+*
+* Same as calling mongoSubCountersUpdate for each subscription, but with a single unordered
+* bulk write. Each subscription is a single update, using $max for the timestamps instead of
+* a conditional update per timestamp.
+*/
+void mongoSubCountersBulkUpdate(const std::string& tenant, const std::vector<SubCountersDelta>& deltaV)
+{
+  std::string               collection = getSubscribeContextCollectionName(tenant);
+  std::vector<BulkWriteOp>  opV;
+  std::vector<std::string>  errV;
+  std::string               err;
+
+  for (unsigned int ix = 0; ix < deltaV.size(); ++ix)
+  {
+    const SubCountersDelta&  delta = deltaV[ix];
+    mongo::BSONObjBuilder    update;
+    mongo::BSONObjBuilder    max;
+    BulkWriteOp              op;
+
+    if (delta.subscriptionId == "")
+    {
+      LM_E(("Runtime Error (empty subscription id)"));
+      continue;
+    }
+
+    if (delta.count > 0)
+    {
+      update.append("$inc", BSON(CSUB_COUNT << (long long) delta.count));
+    }
+
+    if (delta.lastNotificationTime > 0)
+    {
+      max.append(CSUB_LASTNOTIFICATION, (long long) delta.lastNotificationTime);
+    }
+
+    if (delta.lastFailure > 0)
+    {
+      max.append(CSUB_LASTFAILURE, (long long) delta.lastFailure);
+    }
+
+    if (delta.lastSuccess > 0)
+    {
+      max.append(CSUB_LASTSUCCESS, (long long) delta.lastSuccess);
+    }
+
+    BSONObj maxObj = max.obj();
+
+    if (!maxObj.isEmpty())
+    {
+      update.append("$max", maxObj);
+    }
+
+    BSONObj doc = update.obj();
+
+    if (doc.isEmpty())
+    {
+      continue;
+    }
+
+    op.insert = false;
+    op.upsert = false;
+    op.q      = BSON("_id" << OID(delta.subscriptionId));
+    op.doc    = doc;
+
+    opV.push_back(op);
+  }
+
+  if (opV.size() == 0)
+  {
+    return;
+  }
+
+  if (collectionBulkWrite(collection, opV, &errV, &err) != true)
+  {
+    LM_E(("Internal Error (error updating counters of %d subscriptions: %s)", opV.size(), err.c_str()));
+    return;
+  }
+
+  for (unsigned int ix = 0; ix < errV.size(); ++ix)
+  {
+    if (errV[ix] != "")
+    {
+      LM_E(("Internal Error (error updating counters for a subscription: %s)", errV[ix].c_str()));
+    }
+  }
+}
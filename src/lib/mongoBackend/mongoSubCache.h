@@ -26,6 +26,7 @@
 * Author: Ken Zangelin
 */
 #include <regex.h>
+#include <stdint.h>
 
 #include <string>
 #include <vector>
@@ -36,6 +37,43 @@
 
 
 
+struct CachedSubscription;
+
+
+
+/* ****************************************************************************
+*
+* SubCacheDbState - state in DB of a subscription, as needed by subCacheSync
+*/
+typedef struct SubCacheDbState
+{
+  std::string  subscriptionId;
+  int64_t      modDate;
+  int64_t      lastNotificationTime;
+  int64_t      lastFailure;
+  int64_t      lastSuccess;
+} SubCacheDbState;
+
+
+
+/* ****************************************************************************
+*
+* SubCountersDelta - counters of a subscription to be flushed to DB by mongoSubCountersBulkUpdate
+*
+* 'count' is an increment, the timestamps are only written if newer than those in DB.
+* Zero means nothing to write.
+*/
+typedef struct SubCountersDelta
+{
+  std::string  subscriptionId;
+  int64_t      count;
+  int64_t      lastNotificationTime;
+  int64_t      lastFailure;
+  int64_t      lastSuccess;
+} SubCountersDelta;
+
+
+
 /* ****************************************************************************
 *
 * mongoSubCacheItemInsert - 
@@ -79,6 +117,27 @@ extern void mongoSubCacheRefresh(const std::string& database);
 
 
 
+/* ****************************************************************************
+*
+* mongoSubCacheStateGet -
+*/
+extern bool mongoSubCacheStateGet(const std::string& database, std::vector<SubCacheDbState>* stateV);
+
+
+
+/* ****************************************************************************
+*
+* mongoSubCacheLoad -
+*/
+extern bool mongoSubCacheLoad
+(
+  const std::string&                 database,
+  const std::vector<std::string>&    subIdV,
+  std::vector<CachedSubscription*>*  cSubV
+);
+
+
+
 /* ****************************************************************************
 *
 * mongoSubCountersUpdate - 
@@ -93,4 +152,13 @@ extern void mongoSubCountersUpdate
   long long           lastSuccess
 );
 
+
+
+
+/* ****************************************************************************
+*
+* mongoSubCountersBulkUpdate -
+*/
+extern void mongoSubCountersBulkUpdate(const std::string& tenant, const std::vector<SubCountersDelta>& deltaV);
+
 #endif  // SRC_LIB_MONGOBACKEND_MONGOSUBCACHE_H_
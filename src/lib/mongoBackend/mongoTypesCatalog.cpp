@@ -0,0 +1,558 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <utility>
+
+#include "logMsg/logMsg.h"
+#include "logMsg/traceLevels.h"
+
+#include "common/globals.h"
+#include "mongoBackend/MongoGlobal.h"
+#include "mongoBackend/connectionOperations.h"
+#include "mongoBackend/dbConstants.h"
+#include "mongoBackend/dbFieldEncoding.h"
+#include "mongoBackend/safeMongo.h"
+#include "mongoBackend/mongoTypesCatalog.h"
+
+
+
+/* ****************************************************************************
+*
+* USING
+*/
+using mongo::BSONObjBuilder;
+using mongo::BSONObj;
+using mongo::DBClientBase;
+using mongo::DBClientCursor;
+
+
+
+/* ****************************************************************************
+*
+* Fields of the documents in the entity types catalog collection
+*
+* There is a document per entity type and service path:
+*
+*   { _id: { type: "T", servicePath: "/sp" }, count: 2, attrs: { A: { Number: 2 } } }
+*
+* plus a document with _id TYPES_CATALOG_STATE_ID, written at the end of a rebuild.
+* While it is missing the catalog is not used.
+*/
+#define TYPES_CATALOG_COUNT     "count"
+#define TYPES_CATALOG_ATTRS     "attrs"
+#define TYPES_CATALOG_STATE_ID  "state"
+#define TYPES_CATALOG_BUILT_AT  "builtAt"
+
+
+
+/* ****************************************************************************
+*
+* catalogKeyEncode -
+*
+* Attribute names and types are used as field names in the catalog documents, so dots
+* are encoded as in the entities collection and names that could be taken as operators
+* (or be empty) are prefixed with '_'.
+*/
+static std::string catalogKeyEncode(const std::string& s)
+{
+  std::string key = dbDotEncode(s);
+
+  if ((key == "") || (key[0] == '$') || (key[0] == '_'))
+  {
+    return "_" + key;
+  }
+
+  return key;
+}
+
+
+
+/* ****************************************************************************
+*
+* catalogKeyDecode -
+*/
+static std::string catalogKeyDecode(const std::string& key)
+{
+  if ((key != "") && (key[0] == '_'))
+  {
+    return dbDotDecode(key.substr(1));
+  }
+
+  return dbDotDecode(key);
+}
+
+
+
+/* ****************************************************************************
+*
+* catalogIdGet - (entity type, service path) of an entity document
+*/
+static std::pair<std::string, std::string> catalogIdGet(const BSONObj& entity)
+{
+  BSONObj      idField     = getObjectFieldF(entity, "_id");
+  std::string  type        = idField.hasField(ENT_ENTITY_TYPE)?  getStringFieldF(idField, ENT_ENTITY_TYPE)  : "";
+  std::string  servicePath = idField.hasField(ENT_SERVICE_PATH)? getStringFieldF(idField, ENT_SERVICE_PATH) : "";
+
+  return std::make_pair(type, servicePath);
+}
+
+
+
+/* ****************************************************************************
+*
+* catalogIdBson - _id of the catalog document for (entity type, service path)
+*/
+static BSONObj catalogIdBson(const std::pair<std::string, std::string>& id)
+{
+  BSONObjBuilder bob;
+
+  bob.append(ENT_ENTITY_TYPE, id.first);
+
+  if (id.second != "")
+  {
+    bob.append(ENT_SERVICE_PATH, id.second);
+  }
+
+  return bob.obj();
+}
+
+
+
+/* ****************************************************************************
+*
+* attrDelta - account one attribute (key in the attrs field of an entity document)
+*/
+static void attrDelta(TypesCatalogItem* itemP, const std::string& attrKey, const BSONObj& attr, int sign)
+{
+  std::string name = dbDotDecode(basePart(attrKey));
+
+  itemP->attrs[name][getStringFieldF(attr, ENT_ATTRS_TYPE)] += sign;
+}
+
+
+
+/* ****************************************************************************
+*
+* attrsDelta - account all the attributes of an attrs field
+*/
+static void attrsDelta(TypesCatalogItem* itemP, const BSONObj& attrs, int sign)
+{
+  std::set<std::string> attrsSet;
+
+  attrs.getFieldNames(attrsSet);
+
+  for (std::set<std::string>::iterator it = attrsSet.begin(); it != attrsSet.end(); ++it)
+  {
+    attrDelta(itemP, *it, getObjectFieldF(attrs, *it), sign);
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* typesCatalogEntityDelta -
+*/
+void typesCatalogEntityDelta(TypesCatalogDelta* deltaP, const BSONObj& entity, int sign)
+{
+  TypesCatalogItem* itemP = &(*deltaP)[catalogIdGet(entity)];
+
+  itemP->count += sign;
+  attrsDelta(itemP, getObjectFieldF(entity, ENT_ATTRS), sign);
+}
+
+
+
+/* ****************************************************************************
+*
+* typesCatalogUpdateDelta -
+*
+* In the replace case $set includes the whole attrs field. Otherwise, $set and $unset
+* include "attrs.<key>" fields, each one with the whole attribute in the $set case. An
+* attribute already in the entity is subtracted before adding its new version, so only
+* changes in the set of attributes or in their types result in a change in the catalog.
+*/
+void typesCatalogUpdateDelta(TypesCatalogDelta* deltaP, const BSONObj& entity, const BSONObj& update)
+{
+  TypesCatalogItem*  itemP    = &(*deltaP)[catalogIdGet(entity)];
+  BSONObj            attrs    = getObjectFieldF(entity, ENT_ATTRS);
+  const std::string  prefix   = std::string(ENT_ATTRS) + ".";
+
+  if (update.hasField("$set"))
+  {
+    BSONObj setObj = getObjectFieldF(update, "$set");
+
+    if (setObj.hasField(ENT_ATTRS))
+    {
+      attrsDelta(itemP, attrs, -1);
+      attrsDelta(itemP, getObjectFieldF(setObj, ENT_ATTRS), 1);
+    }
+    else
+    {
+      std::set<std::string> fieldsSet;
+
+      setObj.getFieldNames(fieldsSet);
+
+      for (std::set<std::string>::iterator it = fieldsSet.begin(); it != fieldsSet.end(); ++it)
+      {
+        if (it->compare(0, prefix.size(), prefix) != 0)
+        {
+          continue;
+        }
+
+        std::string attrKey = it->substr(prefix.size());
+
+        if (attrs.hasField(attrKey))
+        {
+          attrDelta(itemP, attrKey, getObjectFieldF(attrs, attrKey), -1);
+        }
+
+        attrDelta(itemP, attrKey, getObjectFieldF(setObj, *it), 1);
+      }
+    }
+  }
+
+  if (update.hasField("$unset"))
+  {
+    BSONObj                unsetObj = getObjectFieldF(update, "$unset");
+    std::set<std::string>  fieldsSet;
+
+    unsetObj.getFieldNames(fieldsSet);
+
+    for (std::set<std::string>::iterator it = fieldsSet.begin(); it != fieldsSet.end(); ++it)
+    {
+      if (it->compare(0, prefix.size(), prefix) != 0)
+      {
+        continue;
+      }
+
+      std::string attrKey = it->substr(prefix.size());
+
+      if (attrs.hasField(attrKey))
+      {
+        attrDelta(itemP, attrKey, getObjectFieldF(attrs, attrKey), -1);
+      }
+    }
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* typesCatalogApply -
+*
+* Each (entity type, service path) with some non-zero counter results in an upsert with
+* $inc, all of them sent in a single bulk write. A failure is only logged: the catalog
+* can be fixed with a rebuild, but the entities have already been written.
+*/
+void typesCatalogApply(const std::string& tenant, const TypesCatalogDelta& delta)
+{
+  std::vector<BulkWriteOp>  opV;
+  std::vector<std::string>  errV;
+  std::string               err;
+
+  for (TypesCatalogDelta::const_iterator it = delta.begin(); it != delta.end(); ++it)
+  {
+    const TypesCatalogItem&  item = it->second;
+    BSONObjBuilder           inc;
+    bool                     changed = false;
+
+    if (item.count != 0)
+    {
+      inc.append(TYPES_CATALOG_COUNT, item.count);
+      changed = true;
+    }
+
+    std::map<std::string, std::map<std::string, long long> >::const_iterator  attrIt;
+
+    for (attrIt = item.attrs.begin(); attrIt != item.attrs.end(); ++attrIt)
+    {
+      std::string prefix = std::string(TYPES_CATALOG_ATTRS) + "." + catalogKeyEncode(attrIt->first) + ".";
+
+      for (std::map<std::string, long long>::const_iterator typeIt = attrIt->second.begin(); typeIt != attrIt->second.end(); ++typeIt)
+      {
+        if (typeIt->second != 0)
+        {
+          inc.append(prefix + catalogKeyEncode(typeIt->first), typeIt->second);
+          changed = true;
+        }
+      }
+    }
+
+    if (!changed)
+    {
+      continue;
+    }
+
+    BulkWriteOp op;
+
+    op.insert = false;
+    op.upsert = true;
+    op.q      = BSON("_id" << catalogIdBson(it->first));
+    op.doc    = BSON("$inc" << inc.obj());
+
+    opV.push_back(op);
+  }
+
+  if (opV.size() == 0)
+  {
+    return;
+  }
+
+  if (!collectionBulkWrite(getEntityTypesCollectionName(tenant), opV, &errV, &err))
+  {
+    LM_E(("Runtime Error (entity types catalog update failed for tenant '%s': %s)", tenant.c_str(), err.c_str()));
+    return;
+  }
+
+  for (unsigned int ix = 0; ix < errV.size(); ++ix)
+  {
+    if (errV[ix] != "")
+    {
+      LM_E(("Runtime Error (entity types catalog update failed for tenant '%s': %s)", tenant.c_str(), errV[ix].c_str()));
+    }
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* typesCatalogGet -
+*
+* The documents of all the matching service paths are merged in a single item per type.
+*/
+bool typesCatalogGet
+(
+  const std::string&                        tenant,
+  const std::vector<std::string>&           servicePathV,
+  const std::string*                        entityTypeP,
+  std::map<std::string, TypesCatalogItem>*  typesP
+)
+{
+  std::string  collection = getEntityTypesCollectionName(tenant);
+  std::string  err;
+  BSONObj      state;
+
+  if (!collectionFindOne(collection, BSON("_id" << TYPES_CATALOG_STATE_ID), &state, &err) || state.isEmpty())
+  {
+    LM_T(LmtMongo, ("entity types catalog not available for tenant '%s'", tenant.c_str()));
+    return false;
+  }
+
+  BSONObjBuilder  query;
+  std::string     idType        = std::string("_id.") + ENT_ENTITY_TYPE;
+  std::string     idServicePath = std::string("_id.") + ENT_SERVICE_PATH;
+
+  if (entityTypeP != NULL)
+  {
+    query.append(idType, *entityTypeP);
+  }
+  else
+  {
+    query.append(idType, BSON("$exists" << true));
+  }
+  query.append(idServicePath, fillQueryServicePath(servicePathV));
+
+  std::auto_ptr<DBClientCursor>  cursor;
+  BSONObj                        q = query.obj();
+
+  TIME_STAT_MONGO_READ_WAIT_START();
+  DBClientBase* connection = getMongoConnection();
+
+  if (!collectionQuery(connection, collection, q, &cursor, &err))
+  {
+    releaseMongoConnection(connection);
+    TIME_STAT_MONGO_READ_WAIT_STOP();
+    return false;
+  }
+  TIME_STAT_MONGO_READ_WAIT_STOP();
+
+  while (moreSafe(cursor))
+  {
+    BSONObj r;
+
+    if (!nextSafeOrErrorF(cursor, &r, &err))
+    {
+      //
+      // A partial catalog would give wrong counts, so the caller falls back to the
+      // aggregation query on the entities collection
+      //
+      LM_E(("Runtime Error (exception in nextSafe(): %s - query: %s)", err.c_str(), q.toString().c_str()));
+      typesP->clear();
+      releaseMongoConnection(connection);
+      return false;
+    }
+
+    TypesCatalogItem*      itemP = &(*typesP)[getStringFieldF(getObjectFieldF(r, "_id"), ENT_ENTITY_TYPE)];
+    BSONObj                attrs = r.hasField(TYPES_CATALOG_ATTRS)? getObjectFieldF(r, TYPES_CATALOG_ATTRS) : BSONObj();
+    std::set<std::string>  attrsSet;
+
+    itemP->count += getIntOrLongFieldAsLongF(r, TYPES_CATALOG_COUNT);
+
+    attrs.getFieldNames(attrsSet);
+    for (std::set<std::string>::iterator it = attrsSet.begin(); it != attrsSet.end(); ++it)
+    {
+      BSONObj                                types = getObjectFieldF(attrs, *it);
+      std::set<std::string>                  typesSet;
+      std::map<std::string, long long>*      attrTypesP = &itemP->attrs[catalogKeyDecode(*it)];
+
+      types.getFieldNames(typesSet);
+      for (std::set<std::string>::iterator typeIt = typesSet.begin(); typeIt != typesSet.end(); ++typeIt)
+      {
+        (*attrTypesP)[catalogKeyDecode(*typeIt)] += getIntOrLongFieldAsLongF(types, *typeIt);
+      }
+    }
+  }
+
+  releaseMongoConnection(connection);
+
+  return true;
+}
+
+
+
+/* ****************************************************************************
+*
+* typesCatalogRebuild -
+*
+* The whole entities collection is scanned (only _id and attrs) to compute the catalog,
+* that replaces the existing one. The state document is removed first and written last,
+* so GET /v2/types uses the entities collection while the rebuild is in progress.
+*
+* Entities created, updated or removed during the scan may end up accounted twice or
+* not at all. The caller takes the request semaphore for writing, so this only may
+* happen if the broker runs with -reqMutexPolicy none or read.
+*/
+bool typesCatalogRebuild(const std::string& tenant, std::string* err)
+{
+  std::string                    collection = getEntityTypesCollectionName(tenant);
+  BSONObj                        fields     = BSON("_id" << 1 << ENT_ATTRS << 1);
+  std::auto_ptr<DBClientCursor>  cursor;
+  TypesCatalogDelta              catalog;
+  unsigned int                   docs = 0;
+
+  if (!collectionRemove(collection, BSON("_id" << TYPES_CATALOG_STATE_ID), err))
+  {
+    return false;
+  }
+
+  TIME_STAT_MONGO_READ_WAIT_START();
+  DBClientBase* connection = getMongoConnection();
+
+  if (!collectionQuery(connection, getEntitiesCollectionName(tenant), BSONObj(), &cursor, err, &fields))
+  {
+    releaseMongoConnection(connection);
+    TIME_STAT_MONGO_READ_WAIT_STOP();
+    return false;
+  }
+  TIME_STAT_MONGO_READ_WAIT_STOP();
+
+  while (moreSafe(cursor))
+  {
+    BSONObj r;
+
+    if (!nextSafeOrErrorF(cursor, &r, err))
+    {
+      //
+      // The state document was already removed, so the existing catalog is not used
+      // until a rebuild that scans the whole collection succeeds
+      //
+      LM_E(("Runtime Error (exception in nextSafe(): %s)", err->c_str()));
+      releaseMongoConnection(connection);
+      return false;
+    }
+
+    typesCatalogEntityDelta(&catalog, r, 1);
+    ++docs;
+  }
+
+  releaseMongoConnection(connection);
+
+  std::vector<BulkWriteOp>  opV;
+  std::vector<std::string>  errV;
+
+  for (TypesCatalogDelta::const_iterator it = catalog.begin(); it != catalog.end(); ++it)
+  {
+    BSONObjBuilder  attrs;
+    BulkWriteOp     op;
+
+    std::map<std::string, std::map<std::string, long long> >::const_iterator  attrIt;
+
+    for (attrIt = it->second.attrs.begin(); attrIt != it->second.attrs.end(); ++attrIt)
+    {
+      BSONObjBuilder types;
+
+      for (std::map<std::string, long long>::const_iterator typeIt = attrIt->second.begin(); typeIt != attrIt->second.end(); ++typeIt)
+      {
+        types.append(catalogKeyEncode(typeIt->first), typeIt->second);
+      }
+
+      attrs.append(catalogKeyEncode(attrIt->first), types.obj());
+    }
+
+    op.insert = true;
+    op.upsert = false;
+    op.doc    = BSON("_id"                << catalogIdBson(it->first) <<
+                     TYPES_CATALOG_COUNT  << it->second.count <<
+                     TYPES_CATALOG_ATTRS  << attrs.obj());
+
+    opV.push_back(op);
+  }
+
+  if (!collectionRemove(collection, BSONObj(), err))
+  {
+    return false;
+  }
+
+  if (!collectionBulkWrite(collection, opV, &errV, err))
+  {
+    return false;
+  }
+
+  for (unsigned int ix = 0; ix < errV.size(); ++ix)
+  {
+    if (errV[ix] != "")
+    {
+      *err = errV[ix];
+      return false;
+    }
+  }
+
+  BSONObj state = BSON("_id" << TYPES_CATALOG_STATE_ID << TYPES_CATALOG_BUILT_AT << (long long) getCurrentTime());
+
+  if (!collectionInsert(collection, state, err))
+  {
+    return false;
+  }
+
+  LM_I(("Entity types catalog rebuilt for tenant '%s' (%u entities, %lu types)", tenant.c_str(), docs, (unsigned long) catalog.size()));
+
+  return true;
+}
@@ -0,0 +1,123 @@
+#ifndef SRC_LIB_MONGOBACKEND_MONGOTYPESCATALOG_H_
+#define SRC_LIB_MONGOBACKEND_MONGOTYPESCATALOG_H_
+
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+
+#include "mongo/client/dbclient.h"
+
+
+
+/* ****************************************************************************
+*
+* TypesCatalogItem - entities and attribute types of an entity type in a service path
+*
+* 'attrs' is indexed by attribute name and then by attribute type. Each counter is the
+* number of attributes (an attribute with metadata ID counts once per ID) with that
+* name and type.
+*/
+typedef struct TypesCatalogItem
+{
+  long long                                                  count;
+  std::map<std::string, std::map<std::string, long long> >  attrs;
+
+  TypesCatalogItem(): count(0) {}
+} TypesCatalogItem;
+
+
+
+/* ****************************************************************************
+*
+* TypesCatalogDelta - changes in the catalog, indexed by (entity type, service path)
+*
+* Entities without type are accounted in type "" and entities without service path
+* in service path "".
+*/
+typedef std::map<std::pair<std::string, std::string>, TypesCatalogItem> TypesCatalogDelta;
+
+
+
+/* ****************************************************************************
+*
+* typesCatalogEntityDelta -
+*
+* Accounts in the delta the creation (sign 1) or removal (sign -1) of an entity document.
+*/
+extern void typesCatalogEntityDelta(TypesCatalogDelta* deltaP, const mongo::BSONObj& entity, int sign);
+
+
+
+/* ****************************************************************************
+*
+* typesCatalogUpdateDelta -
+*
+* Accounts in the delta the attributes set and unset by 'update' (as built by
+* updateEntity()) in the entity document 'entity' (as it was before the update).
+*/
+extern void typesCatalogUpdateDelta
+(
+  TypesCatalogDelta*     deltaP,
+  const mongo::BSONObj&  entity,
+  const mongo::BSONObj&  update
+);
+
+
+
+/* ****************************************************************************
+*
+* typesCatalogApply -
+*/
+extern void typesCatalogApply(const std::string& tenant, const TypesCatalogDelta& delta);
+
+
+
+/* ****************************************************************************
+*
+* typesCatalogGet -
+*
+* Returns false if the catalog of the tenant has not been built (or cannot be read),
+* so the caller has to use the entities collection instead.
+*/
+extern bool typesCatalogGet
+(
+  const std::string&                        tenant,
+  const std::vector<std::string>&           servicePathV,
+  const std::string*                        entityTypeP,
+  std::map<std::string, TypesCatalogItem>*  typesP
+);
+
+
+
+/* ****************************************************************************
+*
+* typesCatalogRebuild -
+*/
+extern bool typesCatalogRebuild(const std::string& tenant, std::string* err);
+
+#endif  // SRC_LIB_MONGOBACKEND_MONGOTYPESCATALOG_H_
@@ -80,6 +80,22 @@ HttpStatusCode mongoUpdateContext
   }
   else
   {
+    //
+    // With several entities, they are loaded with a single query and written with a single
+    // bulk write (see UpdateBatch). If the load fails, they are processed one by one.
+    //
+    UpdateBatch   batch;
+    UpdateBatch*  batchP = NULL;
+    std::string   err;
+
+    if (requestP->contextElementVector.size() > 1)
+    {
+      if (updateBatchLoad(&batch, requestP->contextElementVector, tenant, servicePathV, &err))
+      {
+        batchP = &batch;
+      }
+    }
+
     /* Process each ContextElement */
     for (unsigned int ix = 0; ix < requestP->contextElementVector.size(); ++ix)
     {
@@ -93,7 +109,13 @@ HttpStatusCode mongoUpdateContext
                             fiwareCorrelator,
                             ngsiV2AttrsFormat,
                             apiVersion,
-                            ngsiv2Flavour);
+                            ngsiv2Flavour,
+                            batchP);
+    }
+
+    if (batchP != NULL)
+    {
+      updateBatchFlush(batchP, responseP, tenant, servicePathV, xauthToken, fiwareCorrelator);
     }
 
     /* Note that although individual processContextElements() invocations return ConnectionError, this
@@ -655,6 +655,30 @@ static void setBlacklist(const SubscriptionUpdate& subUp, const BSONObj& subOrig
 
 
 
+/* ****************************************************************************
+*
+* setCoalesce -
+*
+* As the other notification fields, if notification is updated without coalesceMs,
+* the coalescing window of the subscription is removed
+*/
+static void setCoalesce(const SubscriptionUpdate& subUp, const BSONObj& subOrig, BSONObjBuilder* b)
+{
+  if (subUp.notificationProvided)
+  {
+    setCoalesce(subUp, b);
+  }
+  else if (subOrig.hasField(CSUB_COALESCE))
+  {
+    long long coalesceMs = getIntOrLongFieldAsLongF(subOrig, CSUB_COALESCE);
+
+    b->append(CSUB_COALESCE, coalesceMs);
+    LM_T(LmtMongo, ("Subscription coalesceMs: %lu", coalesceMs));
+  }
+}
+
+
+
 /* ****************************************************************************
 *
 * setMetadata -
@@ -908,6 +932,7 @@ std::string mongoUpdateSubscription
   setAttrs(subUp, subOrig, &b);
   setMetadata(subUp, subOrig, &b);
   setBlacklist(subUp, subOrig, &b);
+  setCoalesce(subUp, subOrig, &b);
 
   setCondsAndInitialNotify(subUp,
                            subOrig,
@@ -951,6 +976,7 @@ std::string mongoUpdateSubscription
 
   setExpression(subUp, subOrig, &b);
   setFormat(subUp, subOrig, &b);
+  setModDate(&b);
 
   BSONObj doc = b.obj();
 
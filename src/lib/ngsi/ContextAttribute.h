@@ -30,6 +30,7 @@
 
 #include "common/RenderFormat.h"
 #include "common/globals.h"
+#include "common/RequestArena.h"
 #include "orionTypes/OrionValueType.h"
 #include "ngsi/MetadataVector.h"
 #include "ngsi/Request.h"
@@ -46,6 +47,8 @@
 typedef struct ContextAttribute
 {
 public:
+  REQUEST_ARENA_ALLOCATED
+
   std::string     name;                    // Mandatory
   std::string     type;                    // Optional
   MetadataVector  metadataVector;          // Optional
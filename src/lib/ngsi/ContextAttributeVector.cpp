@@ -34,6 +34,7 @@
 #include "common/tag.h"
 #include "common/string.h"
 #include "common/RenderFormat.h"
+#include "common/RequestArena.h"
 #include "ngsi/ContextAttributeVector.h"
 #include "ngsi/Request.h"
 
@@ -498,6 +499,36 @@ void ContextAttributeVector::fill(ContextAttributeVector* cavP, bool useDefaultT
 
 
 
+/* ****************************************************************************
+*
+* compoundValuesToHeap -
+*
+* The ContextAttribute copy constructor moves the compound value instead of cloning it,
+* so attributes copied to the heap (to outlive the request) may still have a compound
+* value from the arena of the request. Such compound values are replaced by heap clones.
+*/
+void ContextAttributeVector::compoundValuesToHeap(void)
+{
+  RequestArena* arenaP = requestArenaGet();
+
+  requestArenaSet(NULL);
+
+  for (unsigned int ix = 0; ix < vec.size(); ++ix)
+  {
+    orion::CompoundValueNode* cvP = vec[ix]->compoundValueP;
+
+    if ((cvP != NULL) && requestArenaObjectInArena(cvP))
+    {
+      vec[ix]->compoundValueP = cvP->clone();
+      delete cvP;
+    }
+  }
+
+  requestArenaSet(arenaP);
+}
+
+
+
 /* ****************************************************************************
 *
 * lookup -
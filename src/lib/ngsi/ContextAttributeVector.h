@@ -51,6 +51,7 @@ typedef struct ContextAttributeVector
   void                     release(void);
   void                     fill(struct ContextAttributeVector* cavP, bool useDefaultType = false);
   ContextAttribute*        lookup(const std::string& attributeName) const;
+  void                     compoundValuesToHeap(void);
   
   ContextAttribute*  operator[](unsigned int ix) const;
 
@@ -29,6 +29,7 @@
 
 #include "common/RenderFormat.h"
 #include "common/globals.h"
+#include "common/RequestArena.h"
 #include "ngsi/ContextElement.h"
 #include "ngsi/StatusCode.h"
 #include "ngsi/AttributeList.h"
@@ -50,6 +51,8 @@ struct QueryContextResponse;
 */
 typedef struct ContextElementResponse
 {
+  REQUEST_ARENA_ALLOCATED
+
   ContextElement   contextElement;             // Mandatory
   StatusCode       statusCode;                 // Mandatory
 
@@ -31,6 +31,7 @@
 #include "common/globals.h"
 #include "ngsi/EntityId.h"
 #include "common/tag.h"
+#include "common/regexCache.h"
 
 
 
@@ -175,12 +176,14 @@ std::string EntityId::check
 
   if (isTrue(isPattern))
   {
-    regex_t re;
-    if (regcomp(&re, id.c_str(), REG_EXTENDED) != 0)
+    // Compiled through the cache, so the later matching of the pattern finds it there
+    regex_t* reP = regexCacheGet(id, REG_EXTENDED);
+
+    if (reP == NULL)
     {
       return "invalid regex for entity id pattern";
     }
-    regfree(&re);  // If regcomp fails it frees up itself (see glibc sources for details)
+    regexCacheRelease(reP);
   }
   return "OK";
 }
@@ -29,6 +29,7 @@
 #include <vector>
 
 #include "common/globals.h"
+#include "common/RequestArena.h"
 
 #include "mongo/client/dbclient.h"
 
@@ -69,6 +70,8 @@
 */
 typedef struct Metadata
 {
+  REQUEST_ARENA_ALLOCATED
+
   std::string  name;         // Mandatory
   std::string  type;         // Optional
 
@@ -78,6 +78,7 @@ const char* requestType(RequestType rt)
   case LogLevelRequest:                             return "LogLevel";
   case SemStateRequest:                             return "SemState";
   case MetricsRequest:                              return "Metrics";
+  case TypesCatalogRequest:                         return "TypesCatalog";
   case VersionRequest:                              return "Version";
   case StatisticsRequest:                           return "Statistics";
   case ExitRequest:                                 return "Exit";
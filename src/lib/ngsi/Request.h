@@ -86,6 +86,7 @@ typedef enum RequestType
   LogLevelRequest,
   SemStateRequest,
   MetricsRequest,
+  TypesCatalogRequest,
   VersionRequest,
   ExitRequest,
 
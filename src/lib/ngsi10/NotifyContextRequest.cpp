@@ -80,15 +80,30 @@ std::string NotifyContextRequest::toJson
     return oe.toJson();
   }
 
+  return toJson(dataToJson(renderFormat, attrsFilter, metadataFilter, blacklist));
+}
+
+
+
+/* ****************************************************************************
+*
+* NotifyContextRequest::toJson -
+*
+* Payload with an already rendered 'data' (see dataToJson)
+*/
+std::string NotifyContextRequest::toJson(const std::string& dataJson)
+{
   std::string out;
 
+  out.reserve(dataJson.size() + subscriptionId.get().size() + 32);
+
   out += "{";
   out += JSON_STR("subscriptionId") + ":";
   out += JSON_STR(subscriptionId.get());
   out += ",";
   out += JSON_STR("data") + ":[";
 
-  out += contextElementResponseVector.toJson(renderFormat, attrsFilter, metadataFilter, blacklist);
+  out += dataJson;
   out += "]";
   out += "}";
 
@@ -97,6 +112,25 @@ std::string NotifyContextRequest::toJson
 
 
 
+/* ****************************************************************************
+*
+* NotifyContextRequest::dataToJson -
+*
+* The 'data' of the payload, that doesn't depend on the subscriptionId
+*/
+std::string NotifyContextRequest::dataToJson
+(
+  RenderFormat                     renderFormat,
+  const std::vector<std::string>&  attrsFilter,
+  const std::vector<std::string>&  metadataFilter,
+  bool                             blacklist
+)
+{
+  return contextElementResponseVector.toJson(renderFormat, attrsFilter, metadataFilter, blacklist);
+}
+
+
+
 /* ****************************************************************************
 *
 * NotifyContextRequest::check
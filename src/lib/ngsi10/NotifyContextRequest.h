@@ -50,6 +50,11 @@ typedef struct NotifyContextRequest
                        const std::vector<std::string>&  attrsFilter,
                        const std::vector<std::string>&  metadataFilter,
                        bool                             blacklist = false);
+  std::string   toJson(const std::string& dataJson);
+  std::string   dataToJson(RenderFormat                     renderFormat,
+                           const std::vector<std::string>&  attrsFilter,
+                           const std::vector<std::string>&  metadataFilter,
+                           bool                             blacklist = false);
   std::string   check(ApiVersion apiVersion, const std::string& indent, const std::string& predetectedError);
   void          present(const std::string& indent);
   void          release(void);
@@ -0,0 +1,455 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "common/globals.h"
+#include "common/clockFunctions.h"
+#include "rest/httpPool.h"
+#include "ngsiNotify/FairNotifQueue.h"
+
+
+
+/* ****************************************************************************
+*
+* fairQueueP - the fair queue in use, for the statistics
+*/
+static FairNotifQueue* fairQueueP = NULL;
+
+
+
+/* ****************************************************************************
+*
+* destinationOf - the key of the sub-queue for a queue element
+*/
+static std::string destinationOf(std::vector<SenderThreadParams*>* paramsV)
+{
+  if (paramsV->empty())
+  {
+    return "";
+  }
+
+  SenderThreadParams* params = (*paramsV)[0];
+
+  return httpPoolEndpoint(params->protocol, params->ip, params->port);
+}
+
+
+
+/* ****************************************************************************
+*
+* costOf - the cost of a queue element in the round robin, its payload size
+*/
+static int costOf(std::vector<SenderThreadParams*>* paramsV)
+{
+  int cost = 0;
+
+  for (unsigned int ix = 0; ix < paramsV->size(); ++ix)
+  {
+    cost += (*paramsV)[ix]->content.size();
+  }
+
+  return (cost == 0)? 1 : cost;
+}
+
+
+
+/* ****************************************************************************
+*
+* FairNotifQueue::FairNotifQueue -
+*/
+FairNotifQueue::FairNotifQueue(size_t sz, size_t _quota, int _busyMax):
+  maxSize(sz),
+  quota(_quota),
+  busyMax(_busyMax),
+  lastPurge(getCurrentTime()),
+  items(0)
+{
+  fairQueueP = this;
+}
+
+
+
+/* ****************************************************************************
+*
+* FairNotifQueue::~FairNotifQueue -
+*/
+FairNotifQueue::~FairNotifQueue()
+{
+  if (fairQueueP == this)
+  {
+    fairQueueP = NULL;
+  }
+
+  for (std::map<std::string, FairSubQueue*>::iterator it = subQueues.begin(); it != subQueues.end(); ++it)
+  {
+    delete it->second;
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* FairNotifQueue::try_push -
+*
+* Fails if the whole queue is full or if the sub-queue of the destination has reached
+* its quota.
+*
+* The idle sub-queues are looked for here, every FAIR_QUEUE_IDLE_TIMEOUT seconds.
+*/
+bool FairNotifQueue::try_push(std::vector<SenderThreadParams*>* paramsV)
+{
+  std::string                 destination = destinationOf(paramsV);
+  int                         cost        = costOf(paramsV);
+  int                         now         = getCurrentTime();
+  boost::mutex::scoped_lock   lock(mtx);
+  FairSubQueue*               subQueueP;
+
+  if (now - lastPurge >= FAIR_QUEUE_IDLE_TIMEOUT)
+  {
+    idleSubQueuesRemove(now);
+  }
+
+  std::map<std::string, FairSubQueue*>::iterator it = subQueues.find(destination);
+
+  if (it == subQueues.end())
+  {
+    subQueueP = new FairSubQueue();
+
+    subQueueP->destination = destination;
+    subQueueP->deficit     = 0;
+    subQueueP->active      = false;
+    subQueueP->busy        = 0;
+    memset(&subQueueP->stats, 0, sizeof(subQueueP->stats));
+
+    subQueues[destination] = subQueueP;
+  }
+  else
+  {
+    subQueueP = it->second;
+  }
+
+  if ((items >= maxSize) || (subQueueP->items.size() >= quota))
+  {
+    ++subQueueP->stats.reject;
+    return false;
+  }
+
+  subQueueP->items.push_back(paramsV);
+  subQueueP->costs.push_back(cost);
+  subQueueP->lastUsed = now;
+  ++subQueueP->stats.in;
+  ++subQueueP->stats.size;
+  ++items;
+
+  if (!subQueueP->active)
+  {
+    subQueueP->active  = true;
+    subQueueP->deficit = 0;
+    roundRobin.push_back(subQueueP);
+  }
+
+  addedElement.notify_one();
+
+  return true;
+}
+
+
+
+/* ****************************************************************************
+*
+* FairNotifQueue::dequeue -
+*
+* Deficit round robin. The sub-queue in the front of the round robin list delivers its
+* first element if its credit covers the cost of it; otherwise it gets the quantum and
+* goes to the back of the list. A sub-queue getting empty leaves the list and loses its
+* credit.
+*
+* Sub-queues with 'busyMax' notifications being sent are skipped (without credit), so
+* nothing is delivered if all the sub-queues in the list are in that case.
+*
+* Must be called with the mutex taken.
+*/
+bool FairNotifQueue::dequeue(std::vector<SenderThreadParams*>** paramsVP)
+{
+  unsigned int skipped = 0;
+
+  while (skipped < roundRobin.size())
+  {
+    FairSubQueue* subQueueP = roundRobin.front();
+
+    if (subQueueP->busy >= busyMax)
+    {
+      ++skipped;
+      roundRobin.pop_front();
+      roundRobin.push_back(subQueueP);
+      continue;
+    }
+
+    if (subQueueP->deficit < subQueueP->costs.front())
+    {
+      skipped = 0;
+      subQueueP->deficit += FAIR_QUEUE_QUANTUM;
+      roundRobin.pop_front();
+      roundRobin.push_back(subQueueP);
+      continue;
+    }
+
+    *paramsVP = subQueueP->items.front();
+    subQueueP->deficit -= subQueueP->costs.front();
+    subQueueP->items.pop_front();
+    subQueueP->costs.pop_front();
+
+    ++subQueueP->stats.out;
+    --subQueueP->stats.size;
+    --items;
+
+    subQueueP->busy += (*paramsVP)->size();
+
+    if (!(*paramsVP)->empty())
+    {
+      struct timespec  now;
+      struct timespec  diff;
+
+      clock_gettime(CLOCK_REALTIME, &now);
+      clock_difftime(&now, &(*paramsVP)->front()->timeStamp, &diff);
+      clock_addtime(&subQueueP->stats.timeInQ, &diff);
+    }
+
+    if (subQueueP->items.empty())
+    {
+      subQueueP->active  = false;
+      subQueueP->deficit = 0;
+      roundRobin.pop_front();
+    }
+
+    return true;
+  }
+
+  return false;
+}
+
+
+
+/* ****************************************************************************
+*
+* FairNotifQueue::try_pop -
+*/
+bool FairNotifQueue::try_pop(std::vector<SenderThreadParams*>** paramsVP)
+{
+  boost::mutex::scoped_lock lock(mtx);
+
+  return dequeue(paramsVP);
+}
+
+
+
+/* ****************************************************************************
+*
+* FairNotifQueue::pop -
+*/
+std::vector<SenderThreadParams*>* FairNotifQueue::pop()
+{
+  std::vector<SenderThreadParams*>*  paramsV;
+  boost::mutex::scoped_lock          lock(mtx);
+
+  while (!dequeue(&paramsV))
+  {
+    addedElement.wait(lock);
+  }
+
+  return paramsV;
+}
+
+
+
+/* ****************************************************************************
+*
+* FairNotifQueue::size -
+*/
+size_t FairNotifQueue::size() const
+{
+  return items;
+}
+
+
+
+/* ****************************************************************************
+*
+* FairNotifQueue::done -
+*
+* A notification is no longer being sent, so its destination may deliver another one.
+*/
+void FairNotifQueue::done(SenderThreadParams* params)
+{
+  std::string                destination = httpPoolEndpoint(params->protocol, params->ip, params->port);
+  boost::mutex::scoped_lock  lock(mtx);
+
+  std::map<std::string, FairSubQueue*>::iterator it = subQueues.find(destination);
+
+  if ((it == subQueues.end()) || (it->second->busy == 0))
+  {
+    return;
+  }
+
+  FairSubQueue* subQueueP = it->second;
+
+  subQueueP->lastUsed = getCurrentTime();
+  --subQueueP->busy;
+
+  // Waiting workers may have found nothing to deliver because of this sub-queue
+  if (subQueueP->busy == busyMax - 1)
+  {
+    addedElement.notify_all();
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* FairNotifQueue::idlePurge -
+*/
+void FairNotifQueue::idlePurge(int now)
+{
+  boost::mutex::scoped_lock lock(mtx);
+
+  idleSubQueuesRemove(now);
+}
+
+
+
+/* ****************************************************************************
+*
+* FairNotifQueue::idleSubQueuesRemove -
+*
+* Removes the sub-queues (with their statistics) with nothing queued nor being sent for
+* FAIR_QUEUE_IDLE_TIMEOUT seconds, so the destinations no longer notified are forgotten.
+*
+* Must be called with the mutex taken.
+*/
+void FairNotifQueue::idleSubQueuesRemove(int now)
+{
+  std::map<std::string, FairSubQueue*>::iterator it = subQueues.begin();
+
+  while (it != subQueues.end())
+  {
+    FairSubQueue* subQueueP = it->second;
+
+    if (subQueueP->items.empty() && (subQueueP->busy == 0) && (now - subQueueP->lastUsed >= FAIR_QUEUE_IDLE_TIMEOUT))
+    {
+      delete subQueueP;
+      subQueues.erase(it++);
+      continue;
+    }
+
+    ++it;
+  }
+
+  lastPurge = now;
+}
+
+
+
+/* ****************************************************************************
+*
+* FairNotifQueue::statisticsGet -
+*/
+void FairNotifQueue::statisticsGet(std::map<std::string, NotifDestStats>* statsP)
+{
+  boost::mutex::scoped_lock lock(mtx);
+
+  for (std::map<std::string, FairSubQueue*>::iterator it = subQueues.begin(); it != subQueues.end(); ++it)
+  {
+    (*statsP)[it->first] = it->second->stats;
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* FairNotifQueue::statisticsReset -
+*
+* Sub-queues with nothing queued nor being sent are removed, so destinations that are
+* no longer notified do not stay in the statistics forever.
+*/
+void FairNotifQueue::statisticsReset(void)
+{
+  boost::mutex::scoped_lock lock(mtx);
+
+  std::map<std::string, FairSubQueue*>::iterator it = subQueues.begin();
+
+  while (it != subQueues.end())
+  {
+    FairSubQueue* subQueueP = it->second;
+
+    if (subQueueP->items.empty() && (subQueueP->busy == 0))
+    {
+      delete subQueueP;
+      subQueues.erase(it++);
+      continue;
+    }
+
+    subQueueP->stats.in              = 0;
+    subQueueP->stats.out             = 0;
+    subQueueP->stats.reject          = 0;
+    subQueueP->stats.timeInQ.tv_sec  = 0;
+    subQueueP->stats.timeInQ.tv_nsec = 0;
+    ++it;
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* fairQueueStatisticsGet -
+*/
+void fairQueueStatisticsGet(std::map<std::string, NotifDestStats>* statsP)
+{
+  if (fairQueueP != NULL)
+  {
+    fairQueueP->statisticsGet(statsP);
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* fairQueueStatisticsReset -
+*/
+void fairQueueStatisticsReset(void)
+{
+  if (fairQueueP != NULL)
+  {
+    fairQueueP->statisticsReset();
+  }
+}
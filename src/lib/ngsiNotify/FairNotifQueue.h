@@ -0,0 +1,160 @@
+#ifndef SRC_LIB_NGSINOTIFY_FAIRNOTIFQUEUE_H_
+#define SRC_LIB_NGSINOTIFY_FAIRNOTIFQUEUE_H_
+
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <time.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include "ngsiNotify/senderThread.h"
+#include "ngsiNotify/NotifQueue.h"
+
+
+
+/* ****************************************************************************
+*
+* FAIR_QUEUE_QUANTUM - payload bytes each destination may send in a round
+*/
+#define FAIR_QUEUE_QUANTUM  4096
+
+
+
+/* ****************************************************************************
+*
+* FAIR_QUEUE_IDLE_TIMEOUT - seconds after which an empty sub-queue is removed
+*/
+#define FAIR_QUEUE_IDLE_TIMEOUT  60
+
+
+
+/* ****************************************************************************
+*
+* NotifDestStats - statistics of the sub-queue of a destination
+*/
+typedef struct NotifDestStats
+{
+  int              size;       // notifications currently queued
+  int              in;
+  int              out;
+  int              reject;     // because the quota of the destination was reached
+  struct timespec  timeInQ;    // accumulated time in queue of the notifications taken out
+} NotifDestStats;
+
+
+
+/* ****************************************************************************
+*
+* FairSubQueue - the notifications queued for a destination
+*/
+typedef struct FairSubQueue
+{
+  std::string                                      destination;
+  std::deque<std::vector<SenderThreadParams*>*>    items;
+  std::deque<int>                                  costs;
+  int                                              deficit;
+  bool                                             active;    // in the round robin list
+  int                                              busy;      // notifications taken out and not sent yet
+  int                                              lastUsed;  // last time an element was pushed or sent
+  NotifDestStats                                   stats;
+} FairSubQueue;
+
+
+
+/* ****************************************************************************
+*
+* class FairNotifQueue -
+*
+* Notification queue with a sub-queue per destination (protocol, host and port), each
+* one with its own quota, so a dead or slow receiver only fills its own sub-queue and
+* only its own notifications are rejected.
+*
+* Workers take notifications from the sub-queues in deficit round robin order: on each
+* turn a sub-queue gets FAIR_QUEUE_QUANTUM bytes of credit and may deliver notifications
+* as long as their payload is covered by its credit, so destinations share the workers
+* evenly, no matter how many notifications each one has queued. In addition, no more
+* than 'busyMax' notifications of a destination are sent at the same time (workers report
+* the notifications they are done with calling done()), so a slow receiver cannot hold
+* all the workers.
+*
+* Sub-queues left empty for FAIR_QUEUE_IDLE_TIMEOUT seconds are removed.
+*
+* Unlike RingNotifQueue, it is protected by a mutex.
+*/
+class FairNotifQueue : public NotifQueue
+{
+public:
+  FairNotifQueue(size_t sz, size_t _quota, int _busyMax);
+  ~FairNotifQueue();
+
+  bool                               try_push(std::vector<SenderThreadParams*>* paramsV);
+  bool                               try_pop(std::vector<SenderThreadParams*>** paramsVP);
+  std::vector<SenderThreadParams*>*  pop();
+  size_t                             size() const;
+  void                               done(SenderThreadParams* params);
+
+  void                               idlePurge(int now);
+  void                               statisticsGet(std::map<std::string, NotifDestStats>* statsP);
+  void                               statisticsReset(void);
+
+private:
+  bool                               dequeue(std::vector<SenderThreadParams*>** paramsVP);
+  void                               idleSubQueuesRemove(int now);
+
+  std::map<std::string, FairSubQueue*>  subQueues;
+  std::deque<FairSubQueue*>             roundRobin;
+  size_t                                maxSize;
+  size_t                                quota;
+  int                                   busyMax;
+  int                                   lastPurge;
+  volatile size_t                       items;
+  boost::mutex                          mtx;
+  boost::condition_variable             addedElement;
+};
+
+
+
+/* ****************************************************************************
+*
+* fairQueueStatisticsGet -
+*
+* Per destination statistics of the fair notification queue, if it is in use.
+*/
+extern void fairQueueStatisticsGet(std::map<std::string, NotifDestStats>* statsP);
+
+
+
+/* ****************************************************************************
+*
+* fairQueueStatisticsReset -
+*/
+extern void fairQueueStatisticsReset(void);
+
+#endif  // SRC_LIB_NGSINOTIFY_FAIRNOTIFQUEUE_H_
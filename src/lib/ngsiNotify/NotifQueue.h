@@ -0,0 +1,79 @@
+#ifndef SRC_LIB_NGSINOTIFY_NOTIFQUEUE_H_
+#define SRC_LIB_NGSINOTIFY_NOTIFQUEUE_H_
+
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <vector>
+
+#include "common/SyncQRing.h"
+#include "ngsiNotify/senderThread.h"
+
+
+
+/* ****************************************************************************
+*
+* class NotifQueue -
+*
+* The queue between QueueNotifier and the workers (threadpool and async modes). Same
+* contract as SyncQRing, being each element the notifications triggered by a subscription.
+*
+* Workers call done() for each notification taken from the queue once it has been sent
+* (or has failed), before freeing it.
+*/
+class NotifQueue
+{
+public:
+  virtual ~NotifQueue() {}
+
+  virtual bool                               try_push(std::vector<SenderThreadParams*>* paramsV) = 0;
+  virtual bool                               try_pop(std::vector<SenderThreadParams*>** paramsVP) = 0;
+  virtual std::vector<SenderThreadParams*>*  pop() = 0;
+  virtual size_t                             size() const = 0;
+  virtual void                               done(SenderThreadParams* params) {}
+};
+
+
+
+/* ****************************************************************************
+*
+* class RingNotifQueue -
+*
+* A single queue shared by all the notifications, i.e. a SyncQRing.
+*/
+class RingNotifQueue : public NotifQueue
+{
+public:
+  explicit RingNotifQueue(size_t sz): ring(sz) {}
+
+  bool                               try_push(std::vector<SenderThreadParams*>* paramsV)   { return ring.try_push(paramsV);  }
+  bool                               try_pop(std::vector<SenderThreadParams*>** paramsVP)  { return ring.try_pop(paramsVP);  }
+  std::vector<SenderThreadParams*>*  pop()                                                 { return ring.pop();              }
+  size_t                             size() const                                          { return ring.size();             }
+
+private:
+  SyncQRing<std::vector<SenderThreadParams*>*>  ring;
+};
+
+#endif  // SRC_LIB_NGSINOTIFY_NOTIFQUEUE_H_
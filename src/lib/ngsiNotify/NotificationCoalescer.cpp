@@ -0,0 +1,413 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <time.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <utility>
+
+#include "logMsg/logMsg.h"
+#include "logMsg/traceLevels.h"
+
+#include "common/RequestArena.h"
+#include "ngsi/ContextElementResponse.h"
+#include "ngsiNotify/NotificationCoalescer.h"
+
+
+
+/* ****************************************************************************
+*
+* coalescerP - the coalescer of the broker
+*/
+static NotificationCoalescer*  coalescerP = NULL;
+
+
+
+/* ****************************************************************************
+*
+* nowMs - milliseconds of the monotonic clock
+*/
+static int64_t nowMs(void)
+{
+  struct timespec  now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return (int64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+
+
+/* ****************************************************************************
+*
+* NotificationCoalescer::start -
+*/
+int NotificationCoalescer::start(void)
+{
+  int rc = pthread_create(&flusherTid, NULL, flusherFunc, this);
+
+  if (rc != 0)
+  {
+    LM_E(("Internal Error (pthread_create: %s)", strerror(rc)));
+    return rc;
+  }
+
+  started = true;
+
+  return 0;
+}
+
+
+
+/* ****************************************************************************
+*
+* NotificationCoalescer::add -
+*
+* Adds the context elements of ncrP to the notification of its subscription, which is created
+* (starting its window) if the subscription has nothing buffered. The context elements are
+* copied, as those of ncrP don't live beyond the request being processed.
+*
+* Returns false if the coalescer has been stopped, in which case the caller has to send the
+* notification itself.
+*/
+bool NotificationCoalescer::add
+(
+  NotifyContextRequest*            ncrP,
+  int64_t                          coalesceMs,
+  const ngsiv2::HttpInfo&          httpInfo,
+  const std::string&               tenant,
+  const std::string&               xauthToken,
+  const std::string&               fiwareCorrelator,
+  RenderFormat                     renderFormat,
+  const std::vector<std::string>&  attrsOrder,
+  const std::vector<std::string>&  metadataFilter,
+  bool                             blacklist
+)
+{
+  std::string                          key = tenant + "/" + ncrP->subscriptionId.get();
+  std::vector<ContextElementResponse*> cerV;
+  std::vector<CoalescedNotification*>  toSend;
+  bool                                 newWindow = false;
+
+  // Copies from the heap, not from the arena of the request (if any)
+  RequestArena* arenaP = requestArenaGet();
+
+  requestArenaSet(NULL);
+  for (unsigned int ix = 0; ix < ncrP->contextElementResponseVector.size(); ++ix)
+  {
+    ContextElementResponse* cerP = new ContextElementResponse(ncrP->contextElementResponseVector[ix]);
+
+    // Compound values are moved by the copy, not cloned, so they may still be in the arena
+    cerP->contextElement.contextAttributeVector.compoundValuesToHeap();
+    cerV.push_back(cerP);
+  }
+  requestArenaSet(arenaP);
+
+  boost::mutex::scoped_lock lock(mtx);
+
+  if (stopped)
+  {
+    lock.unlock();
+
+    for (unsigned int ix = 0; ix < cerV.size(); ++ix)
+    {
+      delete cerV[ix];
+    }
+
+    return false;
+  }
+
+  std::map<std::string, CoalescedNotification*>::iterator it = batchMap.find(key);
+
+  if ((it != batchMap.end()) && (it->second->xauthToken != xauthToken))
+  {
+    take(key, &toSend);
+    it = batchMap.end();
+  }
+
+  CoalescedNotification* cnP;
+
+  if (it == batchMap.end())
+  {
+    cnP = new CoalescedNotification();
+
+    cnP->ncr.subscriptionId = ncrP->subscriptionId;
+    cnP->ncr.originator     = ncrP->originator;
+    cnP->httpInfo           = httpInfo;
+    cnP->tenant             = tenant;
+    cnP->xauthToken         = xauthToken;
+    cnP->fiwareCorrelator   = fiwareCorrelator;
+    cnP->renderFormat       = renderFormat;
+    cnP->attrsOrder         = attrsOrder;
+    cnP->metadataFilter     = metadataFilter;
+    cnP->blacklist          = blacklist;
+    cnP->deadline           = nowMs() + coalesceMs;
+
+    batchMap[key] = cnP;
+    deadlineSet.insert(std::make_pair(cnP->deadline, key));
+    newWindow = true;
+  }
+  else
+  {
+    cnP = it->second;
+  }
+
+  for (unsigned int ix = 0; ix < cerV.size(); ++ix)
+  {
+    cnP->ncr.contextElementResponseVector.push_back(cerV[ix]);
+  }
+
+  if (cnP->ncr.contextElementResponseVector.size() >= COALESCE_MAX_ENTITIES)
+  {
+    LM_T(LmtNotifier, ("coalesced notification of %s full, sending it", key.c_str()));
+    take(key, &toSend);
+  }
+
+  lock.unlock();
+
+  if (newWindow)
+  {
+    changed.notify_one();
+  }
+
+  for (unsigned int ix = 0; ix < toSend.size(); ++ix)
+  {
+    send(toSend[ix], false);
+  }
+
+  return true;
+}
+
+
+
+/* ****************************************************************************
+*
+* NotificationCoalescer::stop -
+*
+* Stops the flusher thread and sends all the buffered notifications, waiting for them to
+* be sent. After that, add() no longer accepts notifications.
+*/
+void NotificationCoalescer::stop(void)
+{
+  std::vector<CoalescedNotification*> toSend;
+
+  {
+    boost::mutex::scoped_lock lock(mtx);
+
+    if (stopped)
+    {
+      return;
+    }
+
+    stopped = true;
+
+    while (!batchMap.empty())
+    {
+      std::string key = batchMap.begin()->first;
+
+      take(key, &toSend);
+    }
+  }
+
+  changed.notify_all();
+
+  if (started)
+  {
+    pthread_join(flusherTid, NULL);
+  }
+
+  LM_T(LmtNotifier, ("sending %d coalesced notifications before stopping", (int) toSend.size()));
+
+  for (unsigned int ix = 0; ix < toSend.size(); ++ix)
+  {
+    send(toSend[ix], true);
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* NotificationCoalescer::size - number of subscriptions with a notification buffered
+*/
+int NotificationCoalescer::size(void)
+{
+  boost::mutex::scoped_lock lock(mtx);
+
+  return batchMap.size();
+}
+
+
+
+/* ****************************************************************************
+*
+* NotificationCoalescer::take -
+*
+* Takes the notification of a subscription out of the coalescer, to be sent. To be called
+* with the mutex taken.
+*/
+void NotificationCoalescer::take(const std::string& key, std::vector<CoalescedNotification*>* toSendP)
+{
+  std::map<std::string, CoalescedNotification*>::iterator it = batchMap.find(key);
+
+  if (it == batchMap.end())
+  {
+    return;
+  }
+
+  deadlineSet.erase(std::make_pair(it->second->deadline, key));
+  toSendP->push_back(it->second);
+  batchMap.erase(it);
+}
+
+
+
+/* ****************************************************************************
+*
+* NotificationCoalescer::send -
+*
+* Sends a coalesced notification, through the notifier or, if 'wait' is set, by the calling
+* thread. The notification is freed.
+*/
+void NotificationCoalescer::send(CoalescedNotification* cnP, bool wait)
+{
+  LM_T(LmtNotifier, ("sending coalesced notification of %s with %d entities",
+                     cnP->ncr.subscriptionId.get().c_str(),
+                     (int) cnP->ncr.contextElementResponseVector.size()));
+
+  if (wait)
+  {
+    notifierP->sendNotifyContextRequestSync(&cnP->ncr,
+                                            cnP->httpInfo,
+                                            cnP->tenant,
+                                            cnP->xauthToken,
+                                            cnP->fiwareCorrelator,
+                                            cnP->renderFormat,
+                                            cnP->attrsOrder,
+                                            cnP->metadataFilter,
+                                            cnP->blacklist);
+  }
+  else
+  {
+    notifierP->sendNotifyContextRequest(&cnP->ncr,
+                                        cnP->httpInfo,
+                                        cnP->tenant,
+                                        cnP->xauthToken,
+                                        cnP->fiwareCorrelator,
+                                        cnP->renderFormat,
+                                        cnP->attrsOrder,
+                                        cnP->metadataFilter,
+                                        cnP->blacklist);
+  }
+
+  delete cnP;
+}
+
+
+
+/* ****************************************************************************
+*
+* NotificationCoalescer::flusherFunc -
+*
+* Thread sending the notifications whose window has ended.
+*/
+void* NotificationCoalescer::flusherFunc(void* pCoalescer)
+{
+  NotificationCoalescer* cP = (NotificationCoalescer*) pCoalescer;
+
+  while (true)
+  {
+    std::vector<CoalescedNotification*> toSend;
+
+    {
+      boost::mutex::scoped_lock lock(cP->mtx);
+
+      while (!cP->stopped)
+      {
+        if (cP->deadlineSet.empty())
+        {
+          cP->changed.wait(lock);
+          continue;
+        }
+
+        int64_t left = cP->deadlineSet.begin()->first - nowMs();
+
+        if (left <= 0)
+        {
+          break;
+        }
+
+        cP->changed.timed_wait(lock, boost::posix_time::milliseconds(left));
+      }
+
+      if (cP->stopped)
+      {
+        break;
+      }
+
+      int64_t now = nowMs();
+
+      while (!cP->deadlineSet.empty() && (cP->deadlineSet.begin()->first <= now))
+      {
+        std::string key = cP->deadlineSet.begin()->second;
+
+        cP->take(key, &toSend);
+      }
+    }
+
+    for (unsigned int ix = 0; ix < toSend.size(); ++ix)
+    {
+      cP->send(toSend[ix], false);
+    }
+  }
+
+  return NULL;
+}
+
+
+
+/* ****************************************************************************
+*
+* notificationCoalescerSet -
+*/
+void notificationCoalescerSet(NotificationCoalescer* _coalescerP)
+{
+  coalescerP = _coalescerP;
+}
+
+
+
+/* ****************************************************************************
+*
+* notificationCoalescerGet -
+*/
+NotificationCoalescer* notificationCoalescerGet(void)
+{
+  return coalescerP;
+}
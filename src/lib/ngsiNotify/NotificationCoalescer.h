@@ -0,0 +1,143 @@
+#ifndef SRC_LIB_NGSINOTIFY_NOTIFICATIONCOALESCER_H_
+#define SRC_LIB_NGSINOTIFY_NOTIFICATIONCOALESCER_H_
+
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <utility>
+
+#include <pthread.h>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include "apiTypesV2/HttpInfo.h"
+#include "common/RenderFormat.h"
+#include "ngsi10/NotifyContextRequest.h"
+#include "ngsiNotify/Notifier.h"
+
+
+
+/* ****************************************************************************
+*
+* COALESCE_MAX_ENTITIES - entities of a coalesced notification
+*
+* When a subscription reaches it, its notification is sent without waiting for the
+* end of the window.
+*/
+#define COALESCE_MAX_ENTITIES  1000
+
+
+
+/* ****************************************************************************
+*
+* CoalescedNotification - notification of a subscription waiting for the end of its window
+*/
+typedef struct CoalescedNotification
+{
+  NotifyContextRequest      ncr;             // owns the context elements
+  ngsiv2::HttpInfo          httpInfo;
+  std::string               tenant;
+  std::string               xauthToken;
+  std::string               fiwareCorrelator;
+  RenderFormat              renderFormat;
+  std::vector<std::string>  attrsOrder;
+  std::vector<std::string>  metadataFilter;
+  bool                      blacklist;
+  int64_t                   deadline;        // milliseconds, monotonic clock
+
+  ~CoalescedNotification() { ncr.release(); }
+} CoalescedNotification;
+
+
+
+/* ****************************************************************************
+*
+* NotificationCoalescer -
+*
+* Buffers the notifications of the subscriptions with a coalescing window (coalesceMs). The
+* entities notified for a subscription during its window are sent together, as one notification
+* with many context elements, when the window ends, when COALESCE_MAX_ENTITIES is reached or
+* when the coalescer is stopped (at broker exit).
+*
+* Windows start with the first notification of the subscription and are not extended by the
+* following ones. Notifications with a different X-Auth-Token close the current window.
+*/
+class NotificationCoalescer
+{
+public:
+  NotificationCoalescer(Notifier* _notifierP): notifierP(_notifierP), started(false), stopped(false) {}
+
+  int   start(void);
+  bool  add(NotifyContextRequest*            ncrP,
+            int64_t                          coalesceMs,
+            const ngsiv2::HttpInfo&          httpInfo,
+            const std::string&               tenant,
+            const std::string&               xauthToken,
+            const std::string&               fiwareCorrelator,
+            RenderFormat                     renderFormat,
+            const std::vector<std::string>&  attrsOrder,
+            const std::vector<std::string>&  metadataFilter,
+            bool                             blacklist);
+  void  stop(void);
+  int   size(void);
+
+private:
+  static void* flusherFunc(void* pCoalescer);
+  void         send(CoalescedNotification* cnP, bool wait);
+  void         take(const std::string& key, std::vector<CoalescedNotification*>* toSendP);
+
+  Notifier*                                       notifierP;
+  pthread_t                                       flusherTid;
+  bool                                            started;
+  bool                                            stopped;
+  std::map<std::string, CoalescedNotification*>   batchMap;      // key: tenant + '/' + subscriptionId
+  std::set<std::pair<int64_t, std::string> >      deadlineSet;   // (deadline, key) of each item in batchMap
+  boost::mutex                                    mtx;
+  boost::condition_variable                       changed;
+};
+
+
+
+/* ****************************************************************************
+*
+* notificationCoalescerSet -
+*/
+extern void notificationCoalescerSet(NotificationCoalescer* coalescerP);
+
+
+
+/* ****************************************************************************
+*
+* notificationCoalescerGet - the coalescer of the broker, NULL if none
+*/
+extern NotificationCoalescer* notificationCoalescerGet(void);
+
+#endif  // SRC_LIB_NGSINOTIFY_NOTIFICATIONCOALESCER_H_
@@ -0,0 +1,194 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "ngsiNotify/NotificationRenderMemo.h"
+
+
+
+/* ****************************************************************************
+*
+* threadMemoP - the memo of the thread
+*/
+static __thread NotificationRenderMemo*  threadMemoP = NULL;
+
+
+
+/* ****************************************************************************
+*
+* keyAdd - adds a string to a key, prefixed by its length so keys are unambiguous
+*/
+static void keyAdd(std::string* keyP, const std::string& s)
+{
+  char len[16];
+
+  snprintf(len, sizeof(len), "%lu:", (unsigned long) s.size());
+  *keyP += len;
+  *keyP += s;
+}
+
+
+
+/* ****************************************************************************
+*
+* NotificationRenderMemo::NotificationRenderMemo -
+*
+* The new memo becomes the memo of the thread until it is destroyed.
+*/
+NotificationRenderMemo::NotificationRenderMemo(): size(0), hitCount(0), missCount(0), previousP(threadMemoP)
+{
+  threadMemoP = this;
+}
+
+
+
+/* ****************************************************************************
+*
+* NotificationRenderMemo::~NotificationRenderMemo -
+*/
+NotificationRenderMemo::~NotificationRenderMemo()
+{
+  threadMemoP = previousP;
+}
+
+
+
+/* ****************************************************************************
+*
+* NotificationRenderMemo::lookup -
+*/
+const std::string* NotificationRenderMemo::lookup(const std::string& key) const
+{
+  std::map<std::string, std::string>::const_iterator it = dataMap.find(key);
+
+  if (it == dataMap.end())
+  {
+    return NULL;
+  }
+
+  ++hitCount;
+  return &it->second;
+}
+
+
+
+/* ****************************************************************************
+*
+* NotificationRenderMemo::insert -
+*/
+void NotificationRenderMemo::insert(const std::string& key, const std::string& data)
+{
+  ++missCount;
+
+  if (size + key.size() + data.size() > RENDER_MEMO_MAX_SIZE)
+  {
+    return;
+  }
+
+  dataMap[key]  = data;
+  size         += key.size() + data.size();
+}
+
+
+
+/* ****************************************************************************
+*
+* NotificationRenderMemo::invalidate -
+*/
+void NotificationRenderMemo::invalidate(void)
+{
+  dataMap.clear();
+  size = 0;
+}
+
+
+
+/* ****************************************************************************
+*
+* NotificationRenderMemo::key -
+*
+* The attributes are identified by their address, as they don't change while the memo is in use
+* (see invalidate()).
+*/
+std::string NotificationRenderMemo::key
+(
+  const ContextElementResponseVector&  cerV,
+  RenderFormat                         renderFormat,
+  const std::vector<std::string>&      attrsOrder,
+  const std::vector<std::string>&      metadataFilter,
+  bool                                 blacklist
+)
+{
+  std::string  key;
+  char         buf[32];
+
+  snprintf(buf, sizeof(buf), "%d/%d/%lu/%lu/", (int) renderFormat, blacklist? 1 : 0, (unsigned long) attrsOrder.size(), (unsigned long) metadataFilter.size());
+  key += buf;
+
+  for (unsigned int ix = 0; ix < attrsOrder.size(); ++ix)
+  {
+    keyAdd(&key, attrsOrder[ix]);
+  }
+
+  for (unsigned int ix = 0; ix < metadataFilter.size(); ++ix)
+  {
+    keyAdd(&key, metadataFilter[ix]);
+  }
+
+  for (unsigned int ix = 0; ix < cerV.size(); ++ix)
+  {
+    const ContextElement& ce = cerV[ix]->contextElement;
+
+    keyAdd(&key, ce.entityId.id);
+    keyAdd(&key, ce.entityId.type);
+    keyAdd(&key, ce.entityId.servicePath);
+
+    snprintf(buf, sizeof(buf), "%lu/", (unsigned long) ce.contextAttributeVector.size());
+    key += buf;
+
+    for (unsigned int aIx = 0; aIx < ce.contextAttributeVector.size(); ++aIx)
+    {
+      snprintf(buf, sizeof(buf), "%p/", (void*) ce.contextAttributeVector[aIx]);
+      key += buf;
+    }
+  }
+
+  return key;
+}
+
+
+
+/* ****************************************************************************
+*
+* notificationRenderMemoGet -
+*/
+NotificationRenderMemo* notificationRenderMemoGet(void)
+{
+  return threadMemoP;
+}
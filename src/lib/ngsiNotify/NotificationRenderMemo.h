@@ -0,0 +1,99 @@
+#ifndef SRC_LIB_NGSINOTIFY_NOTIFICATIONRENDERMEMO_H_
+#define SRC_LIB_NGSINOTIFY_NOTIFICATIONRENDERMEMO_H_
+
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <string>
+#include <vector>
+#include <map>
+
+#include "common/RenderFormat.h"
+#include "ngsi/ContextElementResponseVector.h"
+
+
+
+/* ****************************************************************************
+*
+* RENDER_MEMO_MAX_SIZE - bytes of rendered payloads a memo may keep
+*
+* Once reached, new payloads are rendered as usual but no longer kept.
+*/
+#define RENDER_MEMO_MAX_SIZE  (8 * 1024 * 1024)
+
+
+
+/* ****************************************************************************
+*
+* NotificationRenderMemo -
+*
+* Rendered 'data' of the notifications of an entity, sent for several subscriptions in the
+* processing of the same update. Subscriptions with the same format, attributes and metadata
+* filter get the very same 'data', so it is rendered only for the first one. The payload of
+* each notification is then built from it, with the subscriptionId of its subscription.
+*
+* The memo is thread-local: while it exists, it is the one used by the notifications built
+* in the thread that created it (see Notifier::buildSenderParams). The attributes of the
+* notified entity must not change in that time; if they do (e.g. metadata added for a
+* given subscription), invalidate() must be called.
+*/
+class NotificationRenderMemo
+{
+ public:
+  NotificationRenderMemo();
+  ~NotificationRenderMemo();
+
+  const std::string*  lookup(const std::string& key) const;
+  void                insert(const std::string& key, const std::string& data);
+  void                invalidate(void);
+
+  int                 hits(void) const    { return hitCount;  }
+  int                 misses(void) const  { return missCount; }
+
+  static std::string  key(const ContextElementResponseVector&  cerV,
+                          RenderFormat                         renderFormat,
+                          const std::vector<std::string>&      attrsOrder,
+                          const std::vector<std::string>&      metadataFilter,
+                          bool                                 blacklist);
+
+ private:
+  std::map<std::string, std::string>  dataMap;
+  size_t                              size;
+  mutable int                         hitCount;
+  int                                 missCount;
+  NotificationRenderMemo*             previousP;
+
+  NotificationRenderMemo(const NotificationRenderMemo&);
+  NotificationRenderMemo& operator=(const NotificationRenderMemo&);
+};
+
+
+
+/* ****************************************************************************
+*
+* notificationRenderMemoGet - the memo of the calling thread, NULL if none
+*/
+extern NotificationRenderMemo* notificationRenderMemoGet(void);
+
+#endif  // SRC_LIB_NGSINOTIFY_NOTIFICATIONRENDERMEMO_H_
@@ -23,6 +23,7 @@
 * Author: Fermin Galan
 */
 
+#include <string.h>
 #include <vector>
 
 #include <curl/curl.h>
@@ -30,6 +31,7 @@
 #include "logMsg/logMsg.h"
 #include "logMsg/traceLevels.h"
 
+#include "common/globals.h"
 #include "common/string.h"
 #include "common/statistics.h"
 #include "common/limits.h"
@@ -39,6 +41,7 @@
 #include "apiTypesV2/HttpInfo.h"
 #include "ngsi10/NotifyContextRequest.h"
 #include "ngsiNotify/senderThread.h"
+#include "ngsiNotify/NotificationRenderMemo.h"
 #include "rest/uriParamNames.h"
 #include "rest/ConnectionInfo.h"
 #include "ngsiNotify/Notifier.h"
@@ -58,6 +61,47 @@ Notifier::~Notifier (void)
 }
 
 
+/* ****************************************************************************
+*
+* Notifier::senderDispatch -
+*
+* Sends the notifications in paramsV in background, using the sender pool if the notifier
+* has one or a new (detached) thread otherwise. The notifier takes ownership of paramsV.
+*/
+void Notifier::senderDispatch(std::vector<SenderThreadParams*>* paramsV)
+{
+  if (senderPoolP != NULL)
+  {
+    if (senderPoolP->dispatch(paramsV))
+    {
+      return;
+    }
+
+    LM_E(("Runtime Error (notification sender pool is busy, %d notifications dropped)", (int) paramsV->size()));
+  }
+  else
+  {
+    pthread_t  tid;
+    int        ret = pthread_create(&tid, NULL, startSenderThread, paramsV);
+
+    if (ret == 0)
+    {
+      pthread_detach(tid);
+      return;
+    }
+
+    LM_E(("Runtime Error (error creating thread: %d)", ret));
+  }
+
+  for (unsigned ix = 0; ix < paramsV->size(); ix++)
+  {
+    delete (*paramsV)[ix];
+  }
+  delete paramsV;
+}
+
+
+
 /* ****************************************************************************
 *
 * Notifier::sendNotifyContextRequest -
@@ -75,28 +119,44 @@ void Notifier::sendNotifyContextRequest
     bool                             blackList
 )
 {
-  pthread_t                         tid;
   std::vector<SenderThreadParams*>* paramsV = Notifier::buildSenderParams(ncrP, httpInfo, tenant, xauthToken, fiwareCorrelator, renderFormat, attrsOrder, metadataFilter, blackList);
 
   if (!paramsV->empty()) // al least one param, an empty vector means an error occurred
   {
-    int ret = pthread_create(&tid, NULL, startSenderThread, paramsV);
-    if (ret != 0)
-    {
-      LM_E(("Runtime Error (error creating thread: %d)", ret));
-      for (unsigned ix = 0; ix < paramsV->size(); ix++)
-      {
-        delete (*paramsV)[ix];
-      }
-      delete paramsV;
-      return;
-    }
-    pthread_detach(tid);
+    senderDispatch(paramsV);
   }
 }
 
 
 
+/* ****************************************************************************
+*
+* Notifier::sendNotifyContextRequestSync -
+*
+* Like sendNotifyContextRequest, but the notifications are sent by the calling thread,
+* which waits for them to complete, whatever the notification mode.
+*/
+void Notifier::sendNotifyContextRequestSync
+(
+    NotifyContextRequest*            ncrP,
+    const ngsiv2::HttpInfo&          httpInfo,
+    const std::string&               tenant,
+    const std::string&               xauthToken,
+    const std::string&               fiwareCorrelator,
+    RenderFormat                     renderFormat,
+    const std::vector<std::string>&  attrsOrder,
+    const std::vector<std::string>&  metadataFilter,
+    bool                             blackList
+)
+{
+  std::vector<SenderThreadParams*>*  paramsV = Notifier::buildSenderParams(ncrP, httpInfo, tenant, xauthToken, fiwareCorrelator, renderFormat, attrsOrder, metadataFilter, blackList);
+  NotifTimeMode                      mode    = (strcmp(notificationMode, "persistent") == 0)? NotifTimePersistent : NotifTimeTransient;
+
+  senderParamsSend(paramsV, NULL, mode);
+}
+
+
+
 /* ****************************************************************************
 *
 * Notifier::sendNotifyContextAvailabilityRequest -
@@ -135,7 +195,6 @@ void Notifier::sendNotifyContextAvailabilityRequest
     std::string content_type = "application/json";
 
     /* Send the message (without awaiting response, in a separate thread to avoid blocking) */
-    pthread_t            tid;
     SenderThreadParams*  params = new SenderThreadParams();
 
     params->ip               = host;
@@ -156,22 +215,59 @@ void Notifier::sendNotifyContextAvailabilityRequest
     std::vector<SenderThreadParams*>* paramsV = new std::vector<SenderThreadParams*>;
     paramsV->push_back(params);
 
-    int ret = pthread_create(&tid, NULL, startSenderThread, paramsV);
-    if (ret != 0)
-    {
-      LM_E(("Runtime Error (error creating thread: %d)", ret));
-      return;
-    }
-    pthread_detach(tid);
+    senderDispatch(paramsV);
 }
 
 
 
 
+/* ****************************************************************************
+*
+* notificationPayload -
+*
+* NGSIv2 payload of a notification. If the thread has a render memo, the 'data' rendered
+* for a previous notification with the same entities, format and filters is reused.
+*/
+static std::string notificationPayload
+(
+  NotifyContextRequest*            ncrP,
+  RenderFormat                     renderFormat,
+  const std::vector<std::string>&  attrsOrder,
+  const std::vector<std::string>&  metadataFilter,
+  bool                             blackList
+)
+{
+  NotificationRenderMemo* memoP = notificationRenderMemoGet();
+
+  if ((memoP == NULL) || ((renderFormat != NGSI_V2_NORMALIZED) && (renderFormat != NGSI_V2_KEYVALUES) && (renderFormat != NGSI_V2_VALUES)))
+  {
+    return ncrP->toJson(renderFormat, attrsOrder, metadataFilter, blackList);
+  }
+
+  std::string         key   = NotificationRenderMemo::key(ncrP->contextElementResponseVector, renderFormat, attrsOrder, metadataFilter, blackList);
+  const std::string*  dataP = memoP->lookup(key);
+
+  if (dataP != NULL)
+  {
+    return ncrP->toJson(*dataP);
+  }
+
+  std::string data = ncrP->dataToJson(renderFormat, attrsOrder, metadataFilter, blackList);
+
+  memoP->insert(key, data);
+
+  return ncrP->toJson(data);
+}
+
+
+
 /* ****************************************************************************
 *
 * buildSenderParamsCustom -
 *
+* The templates are expanded from the compiled version kept in the httpInfo of cached
+* subscriptions. Without it (e.g. cache disabled) they are compiled here, once for all
+* the context elements.
 */
 static std::vector<SenderThreadParams*>* buildSenderParamsCustom
 (
@@ -187,9 +283,17 @@ static std::vector<SenderThreadParams*>* buildSenderParamsCustom
 )
 {
   std::vector<SenderThreadParams*>*  paramsV;
+  ngsiv2::HttpInfoTemplates          localTemplates;
+  const ngsiv2::HttpInfoTemplates*   templatesP = httpInfo.templatesP;
 
   paramsV = new std::vector<SenderThreadParams*>;
 
+  if ((templatesP == NULL) && (cv.size() > 0))
+  {
+    localTemplates.fill(httpInfo);
+    templatesP = &localTemplates;
+  }
+
   for (unsigned ix = 0; ix < cv.size(); ix++)
   {
     Verb                                verb    = httpInfo.verb;
@@ -215,9 +319,9 @@ static std::vector<SenderThreadParams*>* buildSenderParamsCustom
     //
     // 2. URL
     //
-    if (macroSubstitute(&url, httpInfo.url, ce) == false)
+    if (templatesP->url.expand(&url, ce) == false)
     {
-      // Warning already logged in macroSubstitude()
+      // Warning already logged in MacroTemplate::expand()
       return paramsV;  // empty vector
     }
 
@@ -233,14 +337,14 @@ static std::vector<SenderThreadParams*>* buildSenderParamsCustom
       cer.contextElement = ce;
       ncr.subscriptionId = subscriptionId;
       ncr.contextElementResponseVector.push_back(&cer);
-      payload  = ncr.toJson(renderFormat, attrsOrder, metadataFilter);
+      payload  = notificationPayload(&ncr, renderFormat, attrsOrder, metadataFilter, false);
       mimeType = "application/json";
     }
     else
     {
-      if (macroSubstitute(&payload, httpInfo.payload, ce) == false)
+      if (templatesP->payload.expand(&payload, ce) == false)
       {
-        // Warning already logged in macroSubstitude()
+        // Warning already logged in MacroTemplate::expand()
         return paramsV;  // empty vector
       }
 
@@ -255,14 +359,14 @@ static std::vector<SenderThreadParams*>* buildSenderParamsCustom
     //
     // 4. URI Params (Query Strings)
     //
-    for (std::map<std::string, std::string>::const_iterator it = httpInfo.qs.begin(); it != httpInfo.qs.end(); ++it)
+    for (unsigned int qx = 0; qx < templatesP->qs.size(); ++qx)
     {
-      std::string key   = it->first;
-      std::string value = it->second;
+      std::string key;
+      std::string value;
 
-      if ((macroSubstitute(&key, it->first, ce) == false) || (macroSubstitute(&value, it->second, ce) == false))
+      if ((templatesP->qs[qx].first.expand(&key, ce) == false) || (templatesP->qs[qx].second.expand(&value, ce) == false))
       {
-        // Warning already logged in macroSubstitude()
+        // Warning already logged in MacroTemplate::expand()
         return paramsV;  // empty vector
       }
 
@@ -278,14 +382,14 @@ static std::vector<SenderThreadParams*>* buildSenderParamsCustom
     //
     // 5. HTTP Headers
     //
-    for (std::map<std::string, std::string>::const_iterator it = httpInfo.headers.begin(); it != httpInfo.headers.end(); ++it)
+    for (unsigned int hx = 0; hx < templatesP->headers.size(); ++hx)
     {
-      std::string key   = it->first;
-      std::string value = it->second;
+      std::string key;
+      std::string value;
 
-      if ((macroSubstitute(&key, it->first, ce) == false) || (macroSubstitute(&value, it->second, ce) == false))
+      if ((templatesP->headers[hx].first.expand(&key, ce) == false) || (templatesP->headers[hx].second.expand(&value, ce) == false))
       {
-        // Warning already logged in macroSubstitude()
+        // Warning already logged in MacroTemplate::expand()
         return paramsV;  // empty vector
       }
 
@@ -463,7 +567,7 @@ std::vector<SenderThreadParams*>* Notifier::buildSenderParams
     }
     else
     {
-      payloadString = ncrP->toJson(renderFormat, attrsOrder, metadataFilter, blackList);
+      payloadString = notificationPayload(ncrP, renderFormat, attrsOrder, metadataFilter, blackList);
     }
 
     /* Parse URL */
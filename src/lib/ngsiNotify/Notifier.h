@@ -35,6 +35,7 @@
 #include "ngsiNotify/ThreadData.h"
 
 #include "ngsiNotify/senderThread.h"
+#include "ngsiNotify/SenderPool.h"
 
 
 
@@ -45,6 +46,7 @@
 class Notifier
 {
 public:
+  Notifier(SenderPool* _senderPoolP = NULL): senderPoolP(_senderPoolP) {}
   virtual ~Notifier(void);
 
   virtual void sendNotifyContextRequest(NotifyContextRequest*                      ncr,
@@ -57,6 +59,16 @@ public:
                                         const std::vector<std::string>&            metadataFilter,
                                         bool                                       blackList);
 
+  void sendNotifyContextRequestSync(NotifyContextRequest*            ncr,
+                                    const ngsiv2::HttpInfo&          httpInfo,
+                                    const std::string&               tenant,
+                                    const std::string&               xauthToken,
+                                    const std::string&               fiwareCorrelator,
+                                    RenderFormat                     renderFormat,
+                                    const std::vector<std::string>&  attrsOrder,
+                                    const std::vector<std::string>&  metadataFilter,
+                                    bool                             blackList);
+
   virtual void sendNotifyContextAvailabilityRequest(NotifyContextAvailabilityRequest* ncr,
                                                     const std::string&                url,
                                                     const std::string&                tenant,
@@ -73,6 +85,11 @@ protected:
                                                              const std::vector<std::string>&  metadataFilter,
                                                              bool                             blackList
   );
+
+  void senderDispatch(std::vector<SenderThreadParams*>* paramsV);
+
+private:
+  SenderPool*  senderPoolP;   // NULL means one thread per notification
 };
 
 #endif  // SRC_LIB_NGSINOTIFY_NOTIFIER_H_
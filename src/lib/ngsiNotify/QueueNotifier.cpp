@@ -30,21 +30,58 @@
 #include "alarmMgr/alarmMgr.h"
 
 #include "ngsiNotify/QueueStatistics.h"
+#include "ngsiNotify/FairNotifQueue.h"
+#include "ngsiNotify/asyncWorker.h"
 #include "ngsiNotify/QueueNotifier.h"
 
 
 
+/* ****************************************************************************
+*
+* newNotifQueue -
+*
+* A destQuota greater than zero enables the fair queue, with a sub-queue per destination.
+* A destination may then use up to half of the sending capacity (workers, or requests in
+* flight in async mode), the other half being left for the rest.
+*/
+static NotifQueue* newNotifQueue(size_t queueSize, int numThreads, bool async, int destQuota)
+{
+  if (destQuota > 0)
+  {
+    int busyMax = (async? numThreads * ASYNC_MAX_IN_FLIGHT : numThreads) / 2;
+
+    return new FairNotifQueue(queueSize, destQuota, (busyMax > 0)? busyMax : 1);
+  }
+
+  return new RingNotifQueue(queueSize);
+}
+
+
+
 /* ****************************************************************************
 *
 * QueueNotifier::Notifier -
 */
-QueueNotifier::QueueNotifier(size_t queueSize, int numThreads): queue(queueSize), workers(&queue, numThreads)
+QueueNotifier::QueueNotifier(size_t queueSize, int numThreads, bool async, int destQuota):
+  queueP(newNotifQueue(queueSize, numThreads, async, destQuota)),
+  workers(queueP, numThreads, async)
 {
   LM_T(LmtNotifier,("Setting up queue and threads for notifications"));
 }
 
 
 
+/* ****************************************************************************
+*
+* QueueNotifier::~QueueNotifier -
+*/
+QueueNotifier::~QueueNotifier()
+{
+  delete queueP;
+}
+
+
+
 /* ****************************************************************************
 *
 * QueueNotifier::start -
@@ -89,7 +126,7 @@ void QueueNotifier::sendNotifyContextRequest
     clock_gettime(CLOCK_REALTIME, &(((*paramsV)[ix])->timeStamp));
   }
 
-  bool enqueued = queue.try_push(paramsV);
+  bool enqueued = queueP->try_push(paramsV);
   if (!enqueued)
   {
     QueueStatistics::incReject(notificationsNum);
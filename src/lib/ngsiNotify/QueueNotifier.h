@@ -28,7 +28,7 @@
 #include "logMsg/logMsg.h"
 #include "logMsg/traceLevels.h"
 
-#include "common/SyncQOverflow.h"
+#include "ngsiNotify/NotifQueue.h"
 #include "common/RenderFormat.h"
 #include "ngsiNotify/Notifier.h"
 #include "ngsiNotify/senderThread.h"
@@ -39,6 +39,8 @@
 #define DEFAULT_NOTIF_QS 100
 // default number of threads
 #define DEFAULT_NOTIF_TN 10
+// default number of threads in async mode (each one with many notifications in flight)
+#define DEFAULT_NOTIF_ASYNC_TN 2
 
 
 
@@ -49,7 +51,8 @@
 class QueueNotifier : public Notifier
 {
 public:
-  QueueNotifier(size_t queueSize, int numThreads);
+  QueueNotifier(size_t queueSize, int numThreads, bool async = false, int destQuota = 0);
+  ~QueueNotifier();
 
   void sendNotifyContextRequest(NotifyContextRequest*            ncr,
                                 const ngsiv2::HttpInfo&          httpInfo,
@@ -63,8 +66,8 @@ public:
   int start();
 
 private:
- SyncQOverflow<std::vector<SenderThreadParams*>*>  queue;
- QueueWorkers                        workers;
+ NotifQueue*   queueP;
+ QueueWorkers  workers;
 
 };
 
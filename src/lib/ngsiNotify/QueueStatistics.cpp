@@ -36,6 +36,7 @@ volatile int QueueStatistics::noOfNotificationsQueueOut;
 volatile int QueueStatistics::noOfNotificationsQueueReject;
 volatile int QueueStatistics::noOfNotificationsQueueSentOK;
 volatile int QueueStatistics::noOfNotificationsQueueSentError;
+volatile int QueueStatistics::noOfNotificationsInFlight;
 
 boost::mutex QueueStatistics::mtxTimeInQ;
 struct timespec QueueStatistics::timeInQ;
@@ -130,6 +131,33 @@ void QueueStatistics::incSentError()
 {
   __sync_fetch_and_add(&noOfNotificationsQueueSentError, 1);
 }
+
+/* ****************************************************************************
+*
+* getInFlight -
+*/
+int  QueueStatistics::getInFlight()
+{
+  return __sync_fetch_and_add(&noOfNotificationsInFlight, 0);
+}
+
+/* ****************************************************************************
+*
+* incInFlight -
+*/
+void QueueStatistics::incInFlight()
+{
+  __sync_fetch_and_add(&noOfNotificationsInFlight, 1);
+}
+
+/* ****************************************************************************
+*
+* decInFlight -
+*/
+void QueueStatistics::decInFlight()
+{
+  __sync_fetch_and_sub(&noOfNotificationsInFlight, 1);
+}
 /* ****************************************************************************
 *
 * getTimInQ -
@@ -177,6 +205,7 @@ void QueueStatistics::reset()
   __sync_fetch_and_and(&noOfNotificationsQueueReject, 0);
   __sync_fetch_and_and(&noOfNotificationsQueueSentOK, 0);
   __sync_fetch_and_and(&noOfNotificationsQueueSentError, 0);
+  // noOfNotificationsInFlight is not reset, it is a gauge of the requests curl has on the wire
 
   boost::mutex::scoped_lock lock(mtxTimeInQ);
   timeInQ.tv_sec = 0;
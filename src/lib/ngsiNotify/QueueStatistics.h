@@ -98,6 +98,24 @@ public:
   */
   static void incSentError();
 
+  /* ****************************************************************************
+  *
+  * getInFlight -
+  */
+  static int  getInFlight();
+
+  /* ****************************************************************************
+  *
+  * incInFlight -
+  */
+  static void incInFlight();
+
+  /* ****************************************************************************
+  *
+  * decInFlight -
+  */
+  static void decInFlight();
+
   /* ****************************************************************************
   *
   * getTimInQ -
@@ -131,6 +149,7 @@ private:
    static volatile int noOfNotificationsQueueReject;
    static volatile int noOfNotificationsQueueSentOK;
    static volatile int noOfNotificationsQueueSentError;
+   static volatile int noOfNotificationsInFlight;
 
    static boost::mutex    mtxTimeInQ;
    static struct timespec timeInQ;
@@ -35,8 +35,10 @@
 #include "cache/subCache.h"
 #include "ngsi10/NotifyContextRequest.h"
 #include "rest/httpRequestSend.h"
+#include "rest/httpPool.h"
 #include "ngsiNotify/QueueStatistics.h"
 #include "ngsiNotify/QueueWorkers.h"
+#include "ngsiNotify/asyncWorker.h"
 
 
 
@@ -57,7 +59,7 @@ int QueueWorkers::start()
   for (int i = 0; i < numberOfThreads; ++i)
   {
     pthread_t  tid;
-    int        rc = pthread_create(&tid, NULL, workerFunc, pQueue);
+    int        rc = pthread_create(&tid, NULL, async? asyncWorkerFunc : workerFunc, pQueue);
 
     if (rc != 0)
     {
@@ -71,19 +73,59 @@ int QueueWorkers::start()
 
 
 
+/* ****************************************************************************
+*
+* queueWorkerResult -
+*
+* Statistics, alarms and subscription status after sending a notification taken from
+* the queue, 'r' being what httpRequestSend returned.
+*/
+void queueWorkerResult(SenderThreadParams* params, int r)
+{
+  //
+  // FIXME: ok and error counter should be incremented in the other notification modes (generalizing the concept, i.e.
+  // not as member of QueueStatistics:: which seems to be tied to just the threadpool notification mode)
+  //
+  char portV[STRING_SIZE_FOR_INT];
+  snprintf(portV, sizeof(portV), "%d", params->port);
+  std::string url = params->ip + ":" + portV + params->resource;
+
+  if (r == 0)
+  {
+    statisticsUpdate(NotifyContextSent, params->mimeType);
+    QueueStatistics::incSentOK();
+    alarmMgr.notificationErrorReset(url);
+
+    if (params->registration == false)
+    {
+      subCacheItemNotificationErrorStatus(params->tenant, params->subscriptionId, 0);
+    }
+  }
+  else
+  {
+    QueueStatistics::incSentError();
+    alarmMgr.notificationError(url, "notification failure for queue worker");
+
+    if (params->registration == false)
+    {
+      subCacheItemNotificationErrorStatus(params->tenant, params->subscriptionId, 1);
+    }
+  }
+}
+
+
+
 /* ****************************************************************************
 *
 * workerFunc -
 */
 static void* workerFunc(void* pSyncQ)
 {
-  SyncQOverflow<std::vector<SenderThreadParams*>*>*  queue = (SyncQOverflow<std::vector<SenderThreadParams*>*> *) pSyncQ;
-  CURL*                                              curl;
+  NotifQueue*  queue = (NotifQueue*) pSyncQ;
+  CURL*        curl  = NULL;
 
-  // Initialize curl context
-  curl = curl_easy_init();
-
-  if (curl == NULL)
+  // Initialize curl context, unless handles are taken from the HTTP connection pool
+  if (!httpPoolEnabled() && ((curl = curl_easy_init()) == NULL))
   {
     LM_E(("Runtime Error (curl_easy_init)"));
     pthread_exit(NULL);
@@ -126,59 +168,70 @@ static void* workerFunc(void* pSyncQ)
       }
       else // we'll send the notification
       {
-        std::string  out;
-        int          r;
-
-        r =  httpRequestSendWithCurl(curl,
-                                     params->ip,
-                                     params->port,
-                                     params->protocol,
-                                     params->verb,
-                                     params->tenant,
-                                     params->servicePath,
-                                     params->xauthToken,
-                                     params->resource,
-                                     params->content_type,
-                                     params->content,
-                                     params->fiwareCorrelator,
-                                     params->renderFormat,
-                                     true,
-                                     NOTIFICATION_WAIT_MODE,
-                                     &out,
-                                     params->extraHeaders);
-
-        //
-        // FIXME: ok and error counter should be incremented in the other notification modes (generalizing the concept, i.e.
-        // not as member of QueueStatistics:: which seems to be tied to just the threadpool notification mode)
-        //
-        char portV[STRING_SIZE_FOR_INT];
-        snprintf(portV, sizeof(portV), "%d", params->port);
-        std::string url = params->ip + ":" + portV + params->resource;
-
-        if (r == 0)
+        std::string      out;
+        int              r;
+        struct timespec  start;
+
+        if (timingStatistics)
         {
-          statisticsUpdate(NotifyContextSent, params->mimeType);
-          QueueStatistics::incSentOK();
-          alarmMgr.notificationErrorReset(url);
-
-          if (params->registration == false)
-          {
-            subCacheItemNotificationErrorStatus(params->tenant, params->subscriptionId, 0);
-          }
+          clock_gettime(CLOCK_REALTIME, &start);
+        }
+
+        if (curl == NULL)
+        {
+          r = httpRequestSend(params->ip,
+                              params->port,
+                              params->protocol,
+                              params->verb,
+                              params->tenant,
+                              params->servicePath,
+                              params->xauthToken,
+                              params->resource,
+                              params->content_type,
+                              params->content,
+                              params->fiwareCorrelator,
+                              params->renderFormat,
+                              true,
+                              NOTIFICATION_WAIT_MODE,
+                              &out,
+                              params->extraHeaders);
         }
         else
         {
-          QueueStatistics::incSentError();
-          alarmMgr.notificationError(url, "notification failure for queue worker");
+          r = httpRequestSendWithCurl(curl,
+                                      params->ip,
+                                      params->port,
+                                      params->protocol,
+                                      params->verb,
+                                      params->tenant,
+                                      params->servicePath,
+                                      params->xauthToken,
+                                      params->resource,
+                                      params->content_type,
+                                      params->content,
+                                      params->fiwareCorrelator,
+                                      params->renderFormat,
+                                      true,
+                                      NOTIFICATION_WAIT_MODE,
+                                      &out,
+                                      params->extraHeaders);
+        }
+
+        if (timingStatistics)
+        {
+          struct timespec  end;
+          struct timespec  diff;
 
-          if (params->registration == false)
-          {
-            subCacheItemNotificationErrorStatus(params->tenant, params->subscriptionId, 1);
-          }
+          clock_gettime(CLOCK_REALTIME, &end);
+          clock_difftime(&end, &start, &diff);
+          notifTimeAdd(NotifTimeThreadpool, &diff);
         }
+
+        queueWorkerResult(params, r);
       }
 
       // Free params memory
+      queue->done(params);
       delete params;
     }
 
@@ -186,6 +239,9 @@ static void* workerFunc(void* pSyncQ)
     delete paramsV;
 
     // Reset curl for next iteration
-    curl_easy_reset(curl);
+    if (curl != NULL)
+    {
+      curl_easy_reset(curl);
+    }
   }
 }
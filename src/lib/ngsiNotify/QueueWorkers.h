@@ -25,17 +25,26 @@
 * Author: Orion dev team
 */
 
-#include "common/SyncQOverflow.h"
+#include "ngsiNotify/NotifQueue.h"
 #include "ngsiNotify/senderThread.h"
 
 class QueueWorkers
 {
 public:
-  QueueWorkers(SyncQOverflow<std::vector<SenderThreadParams*>*> *pQ, int numThreads): pQueue(pQ), numberOfThreads(numThreads) {}
+  QueueWorkers(NotifQueue *pQ, int numThreads, bool _async = false): pQueue(pQ), numberOfThreads(numThreads), async(_async) {}
   int start();
 private:
-    SyncQOverflow<std::vector<SenderThreadParams*>*> *pQueue;
+    NotifQueue *pQueue;
     int numberOfThreads;
+    bool async;
 };
 
+
+
+/* ****************************************************************************
+*
+* queueWorkerResult -
+*/
+extern void queueWorkerResult(SenderThreadParams* params, int r);
+
 #endif  // SRC_LIB_NGSINOTIFY_QUEUEWORKERS_H_
@@ -0,0 +1,160 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <pthread.h>
+
+#include <curl/curl.h>
+
+#include "logMsg/logMsg.h"
+#include "logMsg/traceLevels.h"
+
+#include "common/statistics.h"
+#include "rest/httpPool.h"
+#include "ngsiNotify/senderThread.h"
+#include "ngsiNotify/SenderPool.h"
+
+
+
+/* ****************************************************************************
+*
+* SenderPool::start -
+*/
+int SenderPool::start()
+{
+  for (int i = 0; i < numberOfThreads; ++i)
+  {
+    pthread_t  tid;
+    int        rc = pthread_create(&tid, NULL, workerFunc, this);
+
+    if (rc != 0)
+    {
+      LM_E(("Internal Error (pthread_create: %s)", strerror(rc)));
+      return rc;
+    }
+
+    pthread_detach(tid);
+  }
+
+  return 0;
+}
+
+
+
+/* ****************************************************************************
+*
+* SenderPool::dispatch -
+*
+* Hands paramsV over to a waiting worker. Returns false if the pool drops when busy and
+* no worker was ready, in which case paramsV is NOT freed (the caller still owns it).
+*/
+bool SenderPool::dispatch(std::vector<SenderThreadParams*>* paramsV)
+{
+  boost::mutex::scoped_lock lock(mtx);
+
+  while (ready == 0)
+  {
+    if (dropWhenBusy)
+    {
+      return false;
+    }
+
+    workerReady.wait(lock);
+  }
+
+  --ready;
+  handOff.push_back(paramsV);
+  lock.unlock();
+
+  workHandedOff.notify_one();
+  return true;
+}
+
+
+
+/* ****************************************************************************
+*
+* SenderPool::take -
+*
+* Called by a worker when it is ready for more work. Blocks until something is handed over.
+*/
+std::vector<SenderThreadParams*>* SenderPool::take(void)
+{
+  boost::mutex::scoped_lock lock(mtx);
+
+  ++ready;
+  workerReady.notify_one();
+
+  while (handOff.empty())
+  {
+    workHandedOff.wait(lock);
+  }
+
+  std::vector<SenderThreadParams*>* paramsV = handOff.front();
+  handOff.pop_front();
+
+  return paramsV;
+}
+
+
+
+/* ****************************************************************************
+*
+* SenderPool::workerFunc -
+*
+* If the HTTP connection pool is enabled, handles (and their connections) are taken from
+* it for each notification. Otherwise, the worker uses its own curl handle, reset between
+* notifications, without reusing connections (the connection is closed right after the
+* notification is sent).
+*/
+void* SenderPool::workerFunc(void* pPool)
+{
+  SenderPool*  pool = (SenderPool*) pPool;
+  CURL*        curl = NULL;
+
+  if (!httpPoolEnabled() && ((curl = curl_easy_init()) == NULL))
+  {
+    LM_E(("Runtime Error (curl_easy_init)"));
+    pthread_exit(NULL);
+  }
+
+  for (;;)
+  {
+    std::vector<SenderThreadParams*>* paramsV = pool->take();
+
+    if (curl != NULL)
+    {
+      curl_easy_setopt(curl, CURLOPT_FORBID_REUSE, 1L);
+    }
+
+    senderParamsSend(paramsV, curl, NotifTimeTransient);
+
+    // Reset curl for next iteration
+    if (curl != NULL)
+    {
+      curl_easy_reset(curl);
+    }
+  }
+
+  return NULL;
+}
@@ -0,0 +1,73 @@
+#ifndef SRC_LIB_NGSINOTIFY_SENDERPOOL_H_
+#define SRC_LIB_NGSINOTIFY_SENDERPOOL_H_
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <vector>
+#include <deque>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include "ngsiNotify/senderThread.h"
+
+
+// default number of threads for transient notification mode
+#define DEFAULT_NOTIF_TRANSIENT_TN 50
+
+
+
+/* ****************************************************************************
+*
+* class SenderPool -
+*
+* Fixed set of sender threads for the transient notification mode, each one with its
+* own curl handle, reused from one notification to the next.
+*
+* There is no queue: a notification is only accepted if there is a worker waiting
+* for work. Otherwise the caller is blocked until a worker gets ready or, if the pool
+* has been configured to drop, the notification is rejected.
+*/
+class SenderPool
+{
+public:
+  SenderPool(int numThreads, bool _dropWhenBusy): numberOfThreads(numThreads), dropWhenBusy(_dropWhenBusy), ready(0) {}
+
+  int   start();
+  bool  dispatch(std::vector<SenderThreadParams*>* paramsV);
+
+private:
+  static void* workerFunc(void* pPool);
+  std::vector<SenderThreadParams*>* take(void);
+
+  int                                             numberOfThreads;
+  bool                                            dropWhenBusy;
+  int                                             ready;         // workers waiting for work, minus work handed to them but not yet taken
+  std::deque<std::vector<SenderThreadParams*>*>   handOff;       // never longer than the number of waiting workers
+  boost::mutex                                    mtx;
+  boost::condition_variable                       workerReady;
+  boost::condition_variable                       workHandedOff;
+};
+
+#endif  // SRC_LIB_NGSINOTIFY_SENDERPOOL_H_
@@ -0,0 +1,388 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <string.h>
+#include <sys/select.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <deque>
+
+#include <curl/curl.h>
+
+#include "logMsg/logMsg.h"
+#include "logMsg/traceLevels.h"
+
+#include "common/clockFunctions.h"
+#include "common/statistics.h"
+#include "rest/httpRequestSend.h"
+#include "ngsiNotify/senderThread.h"
+#include "ngsiNotify/NotifQueue.h"
+#include "ngsiNotify/QueueStatistics.h"
+#include "ngsiNotify/QueueWorkers.h"
+#include "ngsiNotify/asyncWorker.h"
+
+
+
+/* ****************************************************************************
+*
+* ASYNC_WAIT_MAX_MS - max time waiting for socket activity
+*
+* New notifications are only taken from the queue between waits, so this is also the max
+* delay added to a notification arriving while the worker has other notifications in flight.
+*/
+#define ASYNC_WAIT_MAX_MS  10
+
+
+
+/* ****************************************************************************
+*
+* AsyncRequest - a notification on the wire, attached to its curl handle as CURLOPT_PRIVATE
+*/
+typedef struct AsyncRequest
+{
+  SenderThreadParams*  params;
+  HttpRequestState*    stateP;
+  std::string          out;
+  struct timespec      start;
+} AsyncRequest;
+
+
+
+/* ****************************************************************************
+*
+* AsyncWorker - state of an async worker thread
+*/
+typedef struct AsyncWorker
+{
+  NotifQueue*                      queue;
+  CURLM*                           multi;
+  std::vector<CURL*>               idleV;     // handles not in use, kept to reuse their connections
+  std::deque<SenderThreadParams*>  pending;   // taken from the queue but not yet started
+  int                              inFlight;
+} AsyncWorker;
+
+
+
+/* ****************************************************************************
+*
+* pendingAdd - move the notifications of a queue item to the pending list of the worker
+*/
+static void pendingAdd(AsyncWorker* workerP, std::vector<SenderThreadParams*>* paramsV)
+{
+  for (unsigned ix = 0; ix < paramsV->size(); ix++)
+  {
+    workerP->pending.push_back((*paramsV)[ix]);
+  }
+
+  delete paramsV;
+}
+
+
+
+/* ****************************************************************************
+*
+* requestStart -
+*
+* Prepares the request of a notification and adds it to the multi handle. Notifications
+* that cannot be started (simulated ones or invalid requests) are finished right away.
+*/
+static void requestStart(AsyncWorker* workerP, SenderThreadParams* params)
+{
+  struct timespec  now;
+  struct timespec  howlong;
+
+  QueueStatistics::incOut();
+  clock_gettime(CLOCK_REALTIME, &now);
+  clock_difftime(&now, &params->timeStamp, &howlong);
+  QueueStatistics::addTimeInQWithSize(&howlong, workerP->queue->size());
+
+  strncpy(transactionId, params->transactionId, sizeof(transactionId));
+
+  LM_T(LmtNotifier, ("async worker sending to: host='%s', port=%d, verb=%s, tenant='%s', service-path: '%s', xauthToken: '%s', path='%s', content-type: %s",
+                     params->ip.c_str(),
+                     params->port,
+                     params->verb.c_str(),
+                     params->tenant.c_str(),
+                     params->servicePath.c_str(),
+                     params->xauthToken.c_str(),
+                     params->resource.c_str(),
+                     params->content_type.c_str()));
+
+  if (simulatedNotification)
+  {
+    LM_T(LmtNotifier, ("simulatedNotification is 'true', skipping outgoing request"));
+    __sync_fetch_and_add(&noOfSimulatedNotifications, 1);
+    workerP->queue->done(params);
+    delete params;
+    return;
+  }
+
+  CURL* curl;
+
+  if (!workerP->idleV.empty())
+  {
+    curl = workerP->idleV.back();
+    workerP->idleV.pop_back();
+  }
+  else if ((curl = curl_easy_init()) == NULL)
+  {
+    LM_E(("Runtime Error (curl_easy_init)"));
+    queueWorkerResult(params, -9);
+    workerP->queue->done(params);
+    delete params;
+    return;
+  }
+
+  AsyncRequest* reqP = new AsyncRequest();
+
+  reqP->params = params;
+  clock_gettime(CLOCK_REALTIME, &reqP->start);
+
+  int r = httpRequestPrepare(curl,
+                             params->ip,
+                             params->port,
+                             params->protocol,
+                             params->verb,
+                             params->tenant,
+                             params->servicePath,
+                             params->xauthToken,
+                             params->resource,
+                             params->content_type,
+                             params->content,
+                             params->fiwareCorrelator,
+                             params->renderFormat,
+                             true,
+                             NOTIFICATION_WAIT_MODE,
+                             &reqP->out,
+                             params->extraHeaders,
+                             "",
+                             -1,
+                             &reqP->stateP);
+
+  if (r != 0)
+  {
+    queueWorkerResult(params, r);
+
+    curl_easy_reset(curl);
+    workerP->idleV.push_back(curl);
+
+    workerP->queue->done(params);
+    delete params;
+    delete reqP;
+    return;
+  }
+
+  // The payload (params->content) is not copied by curl, params is alive until the request is completed
+  curl_easy_setopt(curl, CURLOPT_PRIVATE, (char*) reqP);
+  curl_multi_add_handle(workerP->multi, curl);
+
+  ++workerP->inFlight;
+  QueueStatistics::incInFlight();
+}
+
+
+
+/* ****************************************************************************
+*
+* requestsComplete - finish the requests curl is done with
+*/
+static void requestsComplete(AsyncWorker* workerP)
+{
+  CURLMsg*  msgP;
+  int       msgsLeft;
+
+  while ((msgP = curl_multi_info_read(workerP->multi, &msgsLeft)) != NULL)
+  {
+    if (msgP->msg != CURLMSG_DONE)
+    {
+      continue;
+    }
+
+    // msgP is no longer valid once the handle is removed
+    CURL*          curl = msgP->easy_handle;
+    CURLcode       res  = msgP->data.result;
+    AsyncRequest*  reqP = NULL;
+
+    curl_easy_getinfo(curl, CURLINFO_PRIVATE, (char**) &reqP);
+    curl_multi_remove_handle(workerP->multi, curl);
+
+    strncpy(transactionId, reqP->params->transactionId, sizeof(transactionId));
+
+    int r = httpRequestComplete(reqP->stateP, res, &reqP->out);
+
+    if (timingStatistics)
+    {
+      struct timespec  end;
+      struct timespec  diff;
+
+      clock_gettime(CLOCK_REALTIME, &end);
+      clock_difftime(&end, &reqP->start, &diff);
+      notifTimeAdd(NotifTimeAsync, &diff);
+    }
+
+    queueWorkerResult(reqP->params, r);
+
+    // Handles of failed requests are not reused, their connection may be broken
+    if (res == CURLE_OK)
+    {
+      curl_easy_reset(curl);
+      workerP->idleV.push_back(curl);
+    }
+    else
+    {
+      curl_easy_cleanup(curl);
+    }
+
+    workerP->queue->done(reqP->params);
+    delete reqP->params;
+    delete reqP;
+
+    --workerP->inFlight;
+    QueueStatistics::decInFlight();
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* socketsWait - wait (at most ASYNC_WAIT_MAX_MS) until some socket of the multi handle is ready
+*/
+static void socketsWait(AsyncWorker* workerP)
+{
+  long timeout = ASYNC_WAIT_MAX_MS;
+
+  curl_multi_timeout(workerP->multi, &timeout);
+  if ((timeout < 0) || (timeout > ASYNC_WAIT_MAX_MS))
+  {
+    timeout = ASYNC_WAIT_MAX_MS;
+  }
+
+  if (timeout == 0)
+  {
+    return;
+  }
+
+#if LIBCURL_VERSION_NUM >= 0x071c00
+  // curl_multi_wait() uses poll(), so it is not limited to FD_SETSIZE descriptors
+  curl_multi_wait(workerP->multi, NULL, 0, timeout, NULL);
+#else
+  fd_set          readFds;
+  fd_set          writeFds;
+  fd_set          excFds;
+  int             maxFd = -1;
+  struct timeval  tv;
+
+  FD_ZERO(&readFds);
+  FD_ZERO(&writeFds);
+  FD_ZERO(&excFds);
+
+  tv.tv_sec  = 0;
+  tv.tv_usec = timeout * 1000;
+
+  curl_multi_fdset(workerP->multi, &readFds, &writeFds, &excFds, &maxFd);
+
+  if (maxFd == -1)
+  {
+    // Nothing to wait on (e.g. name resolution in progress), just sleep
+    select(0, NULL, NULL, NULL, &tv);
+  }
+  else
+  {
+    select(maxFd + 1, &readFds, &writeFds, &excFds, &tv);
+  }
+#endif
+}
+
+
+
+/* ****************************************************************************
+*
+* asyncWorkerFunc -
+*
+* Event loop of an async worker: notifications are taken from the queue and started
+* (up to ASYNC_MAX_IN_FLIGHT at the same time), and a curl multi handle drives all of
+* them at once, so a slow receiver only holds a connection, not a thread.
+*
+* The worker only blocks on the queue when it has nothing in flight.
+*/
+void* asyncWorkerFunc(void* pSyncQ)
+{
+  AsyncWorker worker;
+
+  worker.queue    = (NotifQueue*) pSyncQ;
+  worker.inFlight = 0;
+
+  if ((worker.multi = curl_multi_init()) == NULL)
+  {
+    LM_E(("Runtime Error (curl_multi_init)"));
+    pthread_exit(NULL);
+  }
+
+  for (;;)
+  {
+    std::vector<SenderThreadParams*>* paramsV;
+
+    if ((worker.inFlight == 0) && (worker.pending.empty()))
+    {
+      pendingAdd(&worker, worker.queue->pop());
+    }
+
+    while ((worker.inFlight + worker.pending.size() < ASYNC_MAX_IN_FLIGHT) && (worker.queue->try_pop(&paramsV)))
+    {
+      pendingAdd(&worker, paramsV);
+    }
+
+    while ((worker.inFlight < ASYNC_MAX_IN_FLIGHT) && (!worker.pending.empty()))
+    {
+      SenderThreadParams* params = worker.pending.front();
+
+      worker.pending.pop_front();
+      requestStart(&worker, params);
+    }
+
+    if (worker.inFlight == 0)
+    {
+      continue;
+    }
+
+    int       running;
+    CURLMcode mc;
+
+    do
+    {
+      mc = curl_multi_perform(worker.multi, &running);
+    } while (mc == CURLM_CALL_MULTI_PERFORM);
+
+    requestsComplete(&worker);
+
+    if (running > 0)
+    {
+      socketsWait(&worker);
+    }
+  }
+
+  return NULL;
+}
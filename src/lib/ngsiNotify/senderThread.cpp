@@ -23,7 +23,9 @@
 #include "logMsg/traceLevels.h"
 #include "logMsg/logMsg.h"
 
+#include "common/globals.h"
 #include "common/statistics.h"
+#include "common/clockFunctions.h"
 #include "common/limits.h"
 #include "alarmMgr/alarmMgr.h"
 #include "rest/httpRequestSend.h"
@@ -34,12 +36,16 @@
 
 /* ****************************************************************************
 *
-* startSenderThread -
+* senderParamsSend -
+*
+* Sends all the notifications in paramsV and frees paramsV and its items.
+*
+* If 'curl' is NULL, a curl context is got (and released) for each notification, using
+* httpRequestSend(). Otherwise the given curl handle is used, which allows the caller to
+* reuse the same handle for many notifications.
 */
-void* startSenderThread(void* p)
+void senderParamsSend(std::vector<SenderThreadParams*>* paramsV, CURL* curl, NotifTimeMode mode)
 {
-  std::vector<SenderThreadParams*>* paramsV = (std::vector<SenderThreadParams*>*) p;
-
   for (unsigned ix = 0; ix < paramsV->size(); ix++)
   {
     SenderThreadParams* params = (SenderThreadParams*) (*paramsV)[ix];
@@ -63,25 +69,64 @@ void* startSenderThread(void* p)
 
     if (!simulatedNotification)
     {
-      std::string  out;
-      int          r;
-
-      r = httpRequestSend(params->ip,
-                          params->port,
-                          params->protocol,
-                          params->verb,
-                          params->tenant,
-                          params->servicePath,
-                          params->xauthToken,
-                          params->resource,
-                          params->content_type,
-                          params->content,
-                          params->fiwareCorrelator,
-                          params->renderFormat,
-                          true,
-                          NOTIFICATION_WAIT_MODE,
-                          &out,
-                          params->extraHeaders);
+      std::string      out;
+      int              r;
+      struct timespec  start;
+
+      if (timingStatistics)
+      {
+        clock_gettime(CLOCK_REALTIME, &start);
+      }
+
+      if (curl == NULL)
+      {
+        r = httpRequestSend(params->ip,
+                            params->port,
+                            params->protocol,
+                            params->verb,
+                            params->tenant,
+                            params->servicePath,
+                            params->xauthToken,
+                            params->resource,
+                            params->content_type,
+                            params->content,
+                            params->fiwareCorrelator,
+                            params->renderFormat,
+                            true,
+                            NOTIFICATION_WAIT_MODE,
+                            &out,
+                            params->extraHeaders);
+      }
+      else
+      {
+        r = httpRequestSendWithCurl(curl,
+                                    params->ip,
+                                    params->port,
+                                    params->protocol,
+                                    params->verb,
+                                    params->tenant,
+                                    params->servicePath,
+                                    params->xauthToken,
+                                    params->resource,
+                                    params->content_type,
+                                    params->content,
+                                    params->fiwareCorrelator,
+                                    params->renderFormat,
+                                    true,
+                                    NOTIFICATION_WAIT_MODE,
+                                    &out,
+                                    params->extraHeaders);
+      }
+
+      if (timingStatistics)
+      {
+        struct timespec  end;
+        struct timespec  diff;
+
+        clock_gettime(CLOCK_REALTIME, &end);
+        clock_difftime(&end, &start, &diff);
+        notifTimeAdd(mode, &diff);
+      }
 
       if (r == 0)
       {
@@ -114,6 +159,25 @@ void* startSenderThread(void* p)
 
   /* Delete the parameters vector after using it */
   delete paramsV;
+}
+
+
+
+/* ****************************************************************************
+*
+* startSenderThread -
+*/
+void* startSenderThread(void* p)
+{
+  std::vector<SenderThreadParams*>* paramsV = (std::vector<SenderThreadParams*>*) p;
+  NotifTimeMode                     mode    = NotifTimeTransient;
+
+  if (strcmp(notificationMode, "persistent") == 0)
+  {
+    mode = NotifTimePersistent;
+  }
+
+  senderParamsSend(paramsV, NULL, mode);
 
   pthread_exit(NULL);
   return NULL;
@@ -27,7 +27,10 @@
 #include <vector>
 #include <map>
 
+#include <curl/curl.h>
+
 #include "common/MimeType.h"
+#include "common/statistics.h"
 
 
 
@@ -67,6 +70,14 @@ typedef struct SenderThreadParams
 
 
 
+/* ****************************************************************************
+*
+* senderParamsSend -
+*/
+extern void senderParamsSend(std::vector<SenderThreadParams*>* paramsV, CURL* curl, NotifTimeMode mode);
+
+
+
 /* ****************************************************************************
 *
 * startSenderThread -
@@ -0,0 +1,486 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <math.h>
+
+#include <string>
+#include <vector>
+
+#include "logMsg/logMsg.h"
+#include "logMsg/traceLevels.h"
+
+#include "common/globals.h"
+#include "ngsi/Scope.h"
+#include "orionTypes/GeoFilter.h"
+
+
+
+namespace orion
+{
+/* ****************************************************************************
+*
+* GEO_MAX_VERTEX_LAT - vertices closer to the poles are not compiled
+*/
+#define GEO_MAX_VERTEX_LAT  85.0
+
+
+
+/* ****************************************************************************
+*
+* GEO_MAX_EDGE_LON - edges spanning more longitude degrees are not compiled
+*/
+#define GEO_MAX_EDGE_LON    90.0
+
+
+
+/* ****************************************************************************
+*
+* unitVector - point in the unit sphere for the given coordinates (in degrees)
+*/
+static void unitVector(double lat, double lon, double* v)
+{
+  double latRad = lat * M_PI / 180;
+  double lonRad = lon * M_PI / 180;
+
+  v[0] = cos(latRad) * cos(lonRad);
+  v[1] = cos(latRad) * sin(lonRad);
+  v[2] = sin(latRad);
+}
+
+
+
+/* ****************************************************************************
+*
+* angleBetween - angle (in radians) between two points in the unit sphere
+*
+* atan2() of the cross and dot products, as S2 does, which is accurate for any angle.
+*/
+static double angleBetween(const double* a, const double* b)
+{
+  double cx = a[1] * b[2] - a[2] * b[1];
+  double cy = a[2] * b[0] - a[0] * b[2];
+  double cz = a[0] * b[1] - a[1] * b[0];
+  double d  = a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+
+  return atan2(sqrt(cx * cx + cy * cy + cz * cz), d);
+}
+
+
+
+/* ****************************************************************************
+*
+* segmentDistance - distance in the lon/lat plane from a point to a segment
+*/
+static double segmentDistance(const Point& p, const Point& a, const Point& b)
+{
+  double dx  = b.longitude() - a.longitude();
+  double dy  = b.latitude()  - a.latitude();
+  double len = dx * dx + dy * dy;
+  double t   = 0;
+
+  if (len > 0)
+  {
+    t = ((p.longitude() - a.longitude()) * dx + (p.latitude() - a.latitude()) * dy) / len;
+    t = (t < 0)? 0 : ((t > 1)? 1 : t);
+  }
+
+  double x = a.longitude() + t * dx - p.longitude();
+  double y = a.latitude()  + t * dy - p.latitude();
+
+  return sqrt(x * x + y * y);
+}
+
+
+
+/* ****************************************************************************
+*
+* orientation - sign of the cross product (b - a) x (c - a) in the lon/lat plane
+*/
+static int orientation(const Point& a, const Point& b, const Point& c)
+{
+  double cross = (b.longitude() - a.longitude()) * (c.latitude() - a.latitude()) -
+                 (b.latitude()  - a.latitude())  * (c.longitude() - a.longitude());
+
+  return (cross > 0)? 1 : ((cross < 0)? -1 : 0);
+}
+
+
+
+/* ****************************************************************************
+*
+* segmentsTouch - true if the segments a-b and c-d have any point in common
+*/
+static bool segmentsTouch(const Point& a, const Point& b, const Point& c, const Point& d)
+{
+  int o1 = orientation(a, b, c);
+  int o2 = orientation(a, b, d);
+  int o3 = orientation(c, d, a);
+  int o4 = orientation(c, d, b);
+
+  if ((o1 != o2) && (o3 != o4))
+  {
+    return true;
+  }
+
+  // Collinear cases: some endpoint lies on the other segment
+  return ((o1 == 0) && (segmentDistance(c, a, b) == 0)) ||
+         ((o2 == 0) && (segmentDistance(d, a, b) == 0)) ||
+         ((o3 == 0) && (segmentDistance(a, c, d) == 0)) ||
+         ((o4 == 0) && (segmentDistance(b, c, d) == 0));
+}
+
+
+
+/* ****************************************************************************
+*
+* geodesicDeviation -
+*
+* Maximum distance, in the lon/lat plane, between the geodesic from 'a' to 'b' and the
+* straight segment between them, sampled at a quarter, half and three quarters of the edge.
+*/
+static double geodesicDeviation(const Point& a, const Point& b)
+{
+  double  va[3];
+  double  vb[3];
+  double  theta;
+  double  deviation = 0;
+
+  unitVector(a.latitude(), a.longitude(), va);
+  unitVector(b.latitude(), b.longitude(), vb);
+
+  theta = angleBetween(va, vb);
+
+  if (theta < 1e-12)
+  {
+    return 0;
+  }
+
+  for (int ix = 1; ix <= 3; ++ix)
+  {
+    double  t  = ix / 4.0;
+    double  fa = sin((1 - t) * theta) / sin(theta);
+    double  fb = sin(t * theta) / sin(theta);
+    double  v[3];
+
+    v[0] = fa * va[0] + fb * vb[0];
+    v[1] = fa * va[1] + fb * vb[1];
+    v[2] = fa * va[2] + fb * vb[2];
+
+    Point   s(atan2(v[2], sqrt(v[0] * v[0] + v[1] * v[1])) * 180 / M_PI, atan2(v[1], v[0]) * 180 / M_PI);
+    double  d = segmentDistance(s, a, b);
+
+    if (d > deviation)
+    {
+      deviation = d;
+    }
+  }
+
+  return deviation;
+}
+
+
+
+/* ****************************************************************************
+*
+* GeoFilter::GeoFilter -
+*/
+GeoFilter::GeoFilter(): valid(false), areaType(NoArea), maxDistance(-1), minDistance(-1)
+{
+}
+
+
+
+/* ****************************************************************************
+*
+* GeoFilter::compile -
+*
+* Returns false if the expression can't be checked in memory (or there is no geo expression,
+* i.e. any of the three strings is empty). The expression has been
+* already validated when the subscription was created, so the only reason for Scope::fill()
+* to fail here would be a subscription stored by an old version with a wrong expression.
+*/
+bool GeoFilter::compile(const std::string& geometry, const std::string& coords, const std::string& georelString)
+{
+  Scope        scope;
+  std::string  errorString;
+
+  valid = false;
+  vertexV.clear();
+  bandV.clear();
+
+  if ((geometry == "") || (coords == "") || (georelString == ""))
+  {
+    return false;
+  }
+
+  if (scope.fill(V2, geometry, coords, georelString, &errorString) != 0)
+  {
+    scope.release();
+    return false;
+  }
+
+  georel      = scope.georel.type;
+  maxDistance = scope.georel.maxDistance;
+  minDistance = scope.georel.minDistance;
+
+  if (scope.areaType == PointType)
+  {
+    areaType = PointType;
+    center   = Point(scope.point.latitude(), scope.point.longitude());
+    valid    = true;
+  }
+  else if (scope.areaType == BoxType)
+  {
+    // Same vertices than the polygon built for the box by processAreaScopeV2()
+    const Point& ll = scope.box.lowerLeft;
+    const Point& ur = scope.box.upperRight;
+
+    vertexV.push_back(Point(ll.latitude(), ll.longitude()));
+    vertexV.push_back(Point(ll.latitude(), ur.longitude()));
+    vertexV.push_back(Point(ur.latitude(), ur.longitude()));
+    vertexV.push_back(Point(ur.latitude(), ll.longitude()));
+    vertexV.push_back(Point(ll.latitude(), ll.longitude()));
+
+    areaType = PolygonType;
+    valid    = polygonCompile();
+  }
+  else if (scope.areaType == PolygonType)
+  {
+    for (unsigned int ix = 0; ix < scope.polygon.vertexList.size(); ++ix)
+    {
+      Point* pP = scope.polygon.vertexList[ix];
+
+      vertexV.push_back(Point(pP->latitude(), pP->longitude()));
+    }
+
+    areaType = PolygonType;
+    valid    = polygonCompile();
+  }
+
+  scope.release();
+
+  LM_T(LmtSubCache, ("geo filter %s/%s/%s %s", geometry.c_str(), coords.c_str(), georelString.c_str(), valid? "compiled" : "not compiled"));
+
+  return valid;
+}
+
+
+
+/* ****************************************************************************
+*
+* GeoFilter::polygonCompile -
+*
+* Polygons are only compiled if the lon/lat plane is a faithful enough representation of
+* them: far from the poles, not crossing the antimeridian, without too long edges and
+* without repeated consecutive vertices or self-intersections (that MongoDB rejects).
+*/
+bool GeoFilter::polygonCompile(void)
+{
+  unsigned int  edges   = vertexV.size() - 1;
+  double        maxBand = 0;
+  double        minLat  = vertexV[0].latitude();
+  double        maxLat  = vertexV[0].latitude();
+  double        minLon  = vertexV[0].longitude();
+  double        maxLon  = vertexV[0].longitude();
+
+  for (unsigned int ix = 0; ix < edges; ++ix)
+  {
+    const Point& a = vertexV[ix];
+    const Point& b = vertexV[ix + 1];
+
+    if ((fabs(a.latitude()) > GEO_MAX_VERTEX_LAT) || (fabs(b.longitude() - a.longitude()) >= GEO_MAX_EDGE_LON))
+    {
+      return false;
+    }
+
+    if ((a.latitude() == b.latitude()) && (a.longitude() == b.longitude()))
+    {
+      return false;
+    }
+
+    double band = 2 * geodesicDeviation(a, b) + GEO_COORDS_BAND;
+
+    bandV.push_back(band);
+    maxBand = (band > maxBand)? band : maxBand;
+
+    minLat  = (a.latitude()  < minLat)? a.latitude()  : minLat;
+    maxLat  = (a.latitude()  > maxLat)? a.latitude()  : maxLat;
+    minLon  = (a.longitude() < minLon)? a.longitude() : minLon;
+    maxLon  = (a.longitude() > maxLon)? a.longitude() : maxLon;
+  }
+
+  if (maxLon - minLon >= 180)
+  {
+    return false;
+  }
+
+  // Non-adjacent edges must not touch (the first and the last edges are adjacent)
+  for (unsigned int ix = 0; ix < edges; ++ix)
+  {
+    for (unsigned int jx = ix + 2; jx < edges; ++jx)
+    {
+      if ((ix == 0) && (jx == edges - 1))
+      {
+        continue;
+      }
+
+      if (segmentsTouch(vertexV[ix], vertexV[ix + 1], vertexV[jx], vertexV[jx + 1]))
+      {
+        return false;
+      }
+    }
+  }
+
+  Point ll(minLat - maxBand, minLon - maxBand);
+  Point ur(maxLat + maxBand, maxLon + maxBand);
+
+  bbox.fill(&ll, &ur);
+
+  return true;
+}
+
+
+
+/* ****************************************************************************
+*
+* GeoFilter::isCompiled -
+*/
+bool GeoFilter::isCompiled(void) const
+{
+  return valid;
+}
+
+
+
+/* ****************************************************************************
+*
+* GeoFilter::pointInPolygon -
+*
+* Bounding box prefilter, then the undecided bands around the edges and finally the
+* even-odd rule (crossings of a ray going east from the point).
+*/
+GeoFilterResult GeoFilter::pointInPolygon(double lat, double lon) const
+{
+  if ((lat < bbox.lowerLeft.latitude())  || (lat > bbox.upperRight.latitude()) ||
+      (lon < bbox.lowerLeft.longitude()) || (lon > bbox.upperRight.longitude()))
+  {
+    return GeoNoMatch;
+  }
+
+  Point  p(lat, lon);
+  bool   inside = false;
+
+  for (unsigned int ix = 0; ix < bandV.size(); ++ix)
+  {
+    const Point& a = vertexV[ix];
+    const Point& b = vertexV[ix + 1];
+
+    if (segmentDistance(p, a, b) <= bandV[ix])
+    {
+      return GeoUndecided;
+    }
+
+    if ((a.latitude() > lat) != (b.latitude() > lat))
+    {
+      double crossLon = a.longitude() + (lat - a.latitude()) * (b.longitude() - a.longitude()) / (b.latitude() - a.latitude());
+
+      if (lon < crossLon)
+      {
+        inside = !inside;
+      }
+    }
+  }
+
+  return inside? GeoMatch : GeoNoMatch;
+}
+
+
+
+/* ****************************************************************************
+*
+* GeoFilter::match - check an entity located in the given point
+*/
+GeoFilterResult GeoFilter::match(double lat, double lon) const
+{
+  if (!valid)
+  {
+    return GeoUndecided;
+  }
+
+  if (areaType == PointType)
+  {
+    bool same = (lat == center.latitude()) && (lon == center.longitude());
+
+    if (georel == "near")
+    {
+      double  vc[3];
+      double  vp[3];
+
+      unitVector(center.latitude(), center.longitude(), vc);
+      unitVector(lat, lon, vp);
+
+      double distance = angleBetween(vc, vp) * GEO_EARTH_RADIUS;
+
+      if (((maxDistance >= 0) && (fabs(distance - maxDistance) <= GEO_DISTANCE_BAND)) ||
+          ((minDistance >= 0) && (fabs(distance - minDistance) <= GEO_DISTANCE_BAND)))
+      {
+        return GeoUndecided;
+      }
+
+      bool in = ((maxDistance < 0) || (distance <= maxDistance)) && ((minDistance < 0) || (distance >= minDistance));
+
+      return in? GeoMatch : GeoNoMatch;
+    }
+
+    if (georel == "equals")
+    {
+      return same? GeoMatch : GeoNoMatch;
+    }
+
+    // intersects or disjoint
+    if (!same && (fabs(lat - center.latitude()) <= GEO_COORDS_BAND) && (fabs(lon - center.longitude()) <= GEO_COORDS_BAND))
+    {
+      return GeoUndecided;
+    }
+
+    return (same == (georel == "intersects"))? GeoMatch : GeoNoMatch;
+  }
+
+  // Polygon: a point is never equal to it
+  if (georel == "equals")
+  {
+    return GeoNoMatch;
+  }
+
+  GeoFilterResult inside = pointInPolygon(lat, lon);
+
+  if ((inside == GeoUndecided) || (georel != "disjoint"))
+  {
+    return inside;
+  }
+
+  return (inside == GeoMatch)? GeoNoMatch : GeoMatch;
+}
+
+}
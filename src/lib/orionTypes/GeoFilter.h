@@ -0,0 +1,116 @@
+#ifndef SRC_LIB_ORIONTYPES_GEOFILTER_H_
+#define SRC_LIB_ORIONTYPES_GEOFILTER_H_
+
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <string>
+#include <vector>
+
+#include "orionTypes/areas.h"
+
+
+
+namespace orion
+{
+/* ****************************************************************************
+*
+* GEO_EARTH_RADIUS - radius (in meters) used by MongoDB for 2dsphere distances
+*/
+#define GEO_EARTH_RADIUS    6378100.0
+
+
+
+/* ****************************************************************************
+*
+* GEO_DISTANCE_BAND - distance (in meters) to a near limit in which the result is undecided
+*/
+#define GEO_DISTANCE_BAND   0.001
+
+
+
+/* ****************************************************************************
+*
+* GEO_COORDS_BAND - distance (in degrees) to an area border in which the result is undecided
+*/
+#define GEO_COORDS_BAND     1e-9
+
+
+
+/* ****************************************************************************
+*
+* GeoFilterResult -
+*/
+typedef enum GeoFilterResult
+{
+  GeoMatch,
+  GeoNoMatch,
+  GeoUndecided
+} GeoFilterResult;
+
+
+
+/* ****************************************************************************
+*
+* GeoFilter -
+*
+* The geometry/coords/georel of a subscription expression, compiled to check in memory
+* whether an entity located in a point matches it, with the same result that the
+* equivalent MongoDB query on the entity location.
+*
+* MongoDB uses spherical geometry (polygon edges are geodesics) while the point in polygon
+* check here is done on the lon/lat plane. Each edge keeps the maximum distance between the
+* geodesic and the straight segment (doubled, for safety), and points that close to a border
+* (or that close to a near distance limit) get GeoUndecided, so the caller has to ask MongoDB.
+*
+* Areas that can't be checked in memory (lines, polygons too big or close to the poles,
+* self-intersecting polygons, etc.) are not compiled, and GeoUndecided is returned for them.
+*/
+class GeoFilter
+{
+ private:
+  bool                 valid;
+  std::string          georel;
+  AreaType             areaType;       // PointType or PolygonType (boxes are compiled as polygons)
+  Point                center;
+  double               maxDistance;
+  double               minDistance;
+  std::vector<Point>   vertexV;        // the first vertex is repeated at the end
+  std::vector<double>  bandV;          // undecided band around each edge (in degrees)
+  Box                  bbox;           // bounding box of the polygon, bands included
+
+  bool             polygonCompile(void);
+  GeoFilterResult  pointInPolygon(double lat, double lon) const;
+
+ public:
+  GeoFilter();
+
+  bool             compile(const std::string& geometry, const std::string& coords, const std::string& georelString);
+  bool             isCompiled(void) const;
+  GeoFilterResult  match(double lat, double lon) const;
+};
+
+}
+
+#endif  // SRC_LIB_ORIONTYPES_GEOFILTER_H_
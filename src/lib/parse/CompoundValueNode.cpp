@@ -22,6 +22,9 @@
 *
 * Author: Ken Zangelin
 */
+#include <stdio.h>
+#include <stdlib.h>
+
 #include <string>
 
 #include "logMsg/logMsg.h"
@@ -53,8 +56,8 @@ CompoundValueNode::CompoundValueNode():
   rootP       (NULL),
   siblingNo   (0),
   renderName  (false),
-  path        ("Unset"),
-  level       (0)
+  flat        (false),
+  nodeArrayP  (NULL)
 {
   LM_T(LmtCompoundValue, ("Created EMPTY compound node at %p", this));
 }
@@ -74,8 +77,8 @@ CompoundValueNode::CompoundValueNode(orion::ValueType _type):
   rootP       (this),
   siblingNo   (0),
   renderName  (false),
-  path        ("/"),
-  level       (0)
+  flat        (false),
+  nodeArrayP  (NULL)
 {
   LM_T(LmtCompoundValue, ("Created TOPLEVEL compound node (a %s) at %p", (valueType == orion::ValueTypeVector)? "Vector" : "Object", this));
 }
@@ -89,12 +92,10 @@ CompoundValueNode::CompoundValueNode(orion::ValueType _type):
 CompoundValueNode::CompoundValueNode
 (
   CompoundValueNode*  _container,
-  const std::string&  _path,
   const std::string&  _name,
   const std::string&  _value,
   int                 _siblingNo,
-  orion::ValueType    _type,
-  int                 _level
+  orion::ValueType    _type
 ):
   name        (_name),
   valueType   (_type),
@@ -105,12 +106,12 @@ CompoundValueNode::CompoundValueNode
   rootP       (container->rootP),
   siblingNo   (_siblingNo),
   renderName  (false),
-  path        (_path),
-  level       (container->level + 1)
+  flat        (false),
+  nodeArrayP  (NULL)
 {
   LM_T(LmtCompoundValue, ("Created compound node '%s' at level %d, sibling number %d, type %s at %p",
                           name.c_str(),
-                          level,
+                          level(),
                           siblingNo,
                           orion::valueTypeName(valueType),
                           this));
@@ -125,12 +126,10 @@ CompoundValueNode::CompoundValueNode
 CompoundValueNode::CompoundValueNode
 (
   CompoundValueNode*  _container,
-  const std::string&  _path,
   const std::string&  _name,
   const char*         _value,
   int                 _siblingNo,
-  orion::ValueType    _type,
-  int                 _level
+  orion::ValueType    _type
 ):
   name        (_name),
   valueType   (_type),
@@ -141,12 +140,12 @@ CompoundValueNode::CompoundValueNode
   rootP       (container->rootP),
   siblingNo   (_siblingNo),
   renderName  (false),
-  path        (_path),
-  level       (container->level + 1)
+  flat        (false),
+  nodeArrayP  (NULL)
 {
   LM_T(LmtCompoundValue, ("Created compound node '%s' at level %d, sibling number %d, type %s at %p",
                           name.c_str(),
-                          level,
+                          level(),
                           siblingNo,
                           orion::valueTypeName(valueType),
                           this));
@@ -161,12 +160,10 @@ CompoundValueNode::CompoundValueNode
 CompoundValueNode::CompoundValueNode
 (
   CompoundValueNode*  _container,
-  const std::string&  _path,
   const std::string&  _name,
   double              _value,
   int                 _siblingNo,
-  orion::ValueType    _type,
-  int                 _level
+  orion::ValueType    _type
 ):
   name        (_name),
   valueType   (_type),
@@ -177,12 +174,12 @@ CompoundValueNode::CompoundValueNode
   rootP       (container->rootP),
   siblingNo   (_siblingNo),
   renderName  (false),
-  path        (_path),
-  level       (container->level + 1)
+  flat        (false),
+  nodeArrayP  (NULL)
 {
   LM_T(LmtCompoundValue, ("Created compound node '%s' at level %d, sibling number %d, type %s at %p",
                           name.c_str(),
-                          level,
+                          level(),
                           siblingNo,
                           orion::valueTypeName(valueType),
                           this));
@@ -197,12 +194,10 @@ CompoundValueNode::CompoundValueNode
 CompoundValueNode::CompoundValueNode
 (
   CompoundValueNode*  _container,
-  const std::string&  _path,
   const std::string&  _name,
   bool                _value,
   int                 _siblingNo,
-  orion::ValueType    _type,
-  int                 _level
+  orion::ValueType    _type
 ):
   name        (_name),
   valueType   (_type),
@@ -213,12 +208,12 @@ CompoundValueNode::CompoundValueNode
   rootP       (container->rootP),
   siblingNo   (_siblingNo),
   renderName  (false),
-  path        (_path),
-  level       (container->level + 1)
+  flat        (false),
+  nodeArrayP  (NULL)
 {
   LM_T(LmtCompoundValue, ("Created compound node '%s' at level %d, sibling number %d, type %s at %p",
                           name.c_str(),
-                          level,
+                          level(),
                           siblingNo,
                           orion::valueTypeName(valueType),
                           this));
@@ -232,24 +227,97 @@ CompoundValueNode::CompoundValueNode
 */
 CompoundValueNode::~CompoundValueNode()
 {
-  LM_T(LmtCompoundValue, ("Destroying node %p: name: '%s', path '%s' at %p (with %d children)", this, name.c_str(), path.c_str(), this, childV.size()));
+  LM_T(LmtCompoundValue, ("Destroying node %p: name: '%s' at %p (with %d children)", this, name.c_str(), this, childV.size()));
 
   for (uint64_t ix = 0; ix < childV.size(); ++ix)
   {
-    if (childV[ix] != NULL)
+    // The nodes of a flat tree go away with the node array of the root
+    if ((childV[ix] != NULL) && (childV[ix]->flat == false))
     {
       LM_T(LmtCompoundValue, ("Deleting child %d, at %p", ix, childV[ix]));
       delete childV[ix];
-      childV[ix] = NULL;
     }
   }
 
-  while (childV.size() != 0)
+  childV.clear();
+
+  if (nodeArrayP != NULL)
   {
-    childV.erase(childV.begin());
+    delete[] nodeArrayP->nodeV;
+    delete nodeArrayP;
+    nodeArrayP = NULL;
   }
+}
 
-  childV.clear();
+
+
+/* ****************************************************************************
+*
+* flatInit -
+*
+* Makes this node the root of a flat tree of '_nodes' nodes (the root not included).
+* The array is allocated here, the nodes are given to their containers by flatChildrenAdd.
+*/
+void CompoundValueNode::flatInit(unsigned int _nodes)
+{
+  if ((nodeArrayP != NULL) || (_nodes == 0))
+  {
+    return;
+  }
+
+  nodeArrayP            = new CompoundValueNodeArray;
+  nodeArrayP->nodeV     = new CompoundValueNode[_nodes];
+  nodeArrayP->nodes     = _nodes;
+  nodeArrayP->nodesUsed = 0;
+}
+
+
+
+/* ****************************************************************************
+*
+* flatChildrenAdd -
+*
+* Called for the root of a flat tree, gives 'parentP' its 'children' children: the next
+* nodes of the node array. Their values are up to the caller, through parentP->childV.
+*
+* If the array is not big enough (i.e. the caller counted wrong), the children are created
+* one by one, as for any other tree.
+*/
+void CompoundValueNode::flatChildrenAdd(CompoundValueNode* parentP, unsigned int children)
+{
+  if (children == 0)
+  {
+    return;
+  }
+
+  if ((nodeArrayP == NULL) || (nodeArrayP->nodesUsed + children > nodeArrayP->nodes))
+  {
+    LM_E(("Runtime Error (no room for %d compound nodes in a flat tree of %d nodes)",
+          children,
+          (nodeArrayP == NULL)? 0 : nodeArrayP->nodes));
+
+    for (unsigned int ix = 0; ix < children; ++ix)
+    {
+      parentP->add(new CompoundValueNode());
+    }
+
+    return;
+  }
+
+  CompoundValueNode* first = &nodeArrayP->nodeV[nodeArrayP->nodesUsed];
+
+  for (unsigned int ix = 0; ix < children; ++ix)
+  {
+    CompoundValueNode* node = &first[ix];
+
+    node->container = parentP;
+    node->rootP     = parentP->rootP;
+    node->siblingNo = ix;
+    node->flat      = true;
+  }
+
+  nodeArrayP->nodesUsed += children;
+  parentP->childV.range(first, children);
 }
 
 
@@ -260,8 +328,6 @@ CompoundValueNode::~CompoundValueNode()
 */
 std::string CompoundValueNode::finish(void)
 {
-  error = "OK";
-
   LM_T(LmtCompoundValue, ("Finishing a compound"));
 
   if (lmTraceIsSet(LmtCompoundValueShow))
@@ -269,9 +335,7 @@ std::string CompoundValueNode::finish(void)
     show("");
   }
 
-  check();  // sets 'error' for toplevel node
-
-  return error;
+  return check();
 }
 
 
@@ -283,7 +347,6 @@ std::string CompoundValueNode::finish(void)
 CompoundValueNode* CompoundValueNode::add(CompoundValueNode* node)
 {
   node->container = this;
-  node->level     = level + 1;
   node->siblingNo = childV.size();
   node->rootP     = rootP;
 
@@ -291,11 +354,11 @@ CompoundValueNode* CompoundValueNode::add(CompoundValueNode* node)
     LM_T(LmtCompoundValueAdd, ("Adding String '%s', with value '%s' under '%s' (%s)",
                                node->name.c_str(),
                                node->stringValue.c_str(),
-                               node->container->path.c_str(),
+                               fullPath().c_str(),
                                node->container->name.c_str()));
   else
     LM_T(LmtCompoundValueAdd, ("Adding %s '%s' under '%s' (%s)", orion::valueTypeName(node->valueType), node->name.c_str(),
-                               node->container->path.c_str(),
+                               fullPath().c_str(),
                                node->container->name.c_str()));
 
   childV.push_back(node);
@@ -315,18 +378,7 @@ CompoundValueNode* CompoundValueNode::add
   const std::string&      _value
 )
 {
-  std::string newPath = path;
-
-  if (newPath == "/")
-  {
-    newPath += _name;
-  }
-  else
-  {
-    newPath += "/" + _name;
-  }
-
-  CompoundValueNode* node = new CompoundValueNode(this, newPath, _name, _value, childV.size(), _type, level + 1);
+  CompoundValueNode* node = new CompoundValueNode(this, _name, _value, childV.size(), _type);
 
   return add(node);
 }
@@ -344,18 +396,7 @@ CompoundValueNode* CompoundValueNode::add
   const char*             _value
 )
 {
-  std::string newPath = path;
-
-  if (newPath == "/")
-  {
-    newPath += _name;
-  }
-  else
-  {
-    newPath += "/" + _name;
-  }
-
-  CompoundValueNode* node = new CompoundValueNode(this, newPath, _name, _value, childV.size(), _type, level + 1);
+  CompoundValueNode* node = new CompoundValueNode(this, _name, _value, childV.size(), _type);
 
   return add(node);
 }
@@ -373,18 +414,7 @@ CompoundValueNode* CompoundValueNode::add
   double                  _value
 )
 {
-  std::string newPath = path;
-
-  if (newPath == "/")
-  {
-    newPath += _name;
-  }
-  else
-  {
-    newPath += "/" + _name;
-  }
-
-  CompoundValueNode* node = new CompoundValueNode(this, newPath, _name, _value, childV.size(), _type, level + 1);
+  CompoundValueNode* node = new CompoundValueNode(this, _name, _value, childV.size(), _type);
 
   return add(node);
 }
@@ -402,18 +432,7 @@ CompoundValueNode* CompoundValueNode::add
   bool                    _value
 )
 {
-  std::string newPath = path;
-
-  if (newPath == "/")
-  {
-    newPath += _name;
-  }
-  else
-  {
-    newPath += "/" + _name;
-  }
-
-  CompoundValueNode* node = new CompoundValueNode(this, newPath, _name, _value, childV.size(), _type, level + 1);
+  CompoundValueNode* node = new CompoundValueNode(this, _name, _value, childV.size(), _type);
 
   return add(node);
 }
@@ -508,7 +527,7 @@ void CompoundValueNode::show(const std::string& indent)
                               container->name.c_str()));
   LM_T(LmtCompoundValueShow, ("%slevel:     %d",
                               indent.c_str(),
-                              level));
+                              level()));
   LM_T(LmtCompoundValueShow, ("%ssibling:   %d",
                               indent.c_str(),
                               siblingNo));
@@ -517,7 +536,7 @@ void CompoundValueNode::show(const std::string& indent)
                               orion::valueTypeName(valueType)));
   LM_T(LmtCompoundValueShow, ("%spath:      %s",
                               indent.c_str(),
-                              path.c_str()));
+                              fullPath().c_str()));
   LM_T(LmtCompoundValueShow, ("%srootP:     %s",
                               indent.c_str(),
                               rootP->name.c_str()));
@@ -581,7 +600,7 @@ void CompoundValueNode::show(const std::string& indent)
 * A vector must have all its children with the same name.
 * An object cannot have two children with the same name.
 *
-* Encountered errors are saved in the 'error' field of the root of the tree (rootP->error).
+* The first error found is returned, "OK" if none.
 */
 std::string CompoundValueNode::check(void)
 {
@@ -596,11 +615,11 @@ std::string CompoundValueNode::check(void)
     {
       if (childV[ix]->name != childV[0]->name)
       {
-        rootP->error =
+        std::string error =
           std::string("bad tag-name of vector item: /") + childV[ix]->name + "/, should be /" + childV[0]->name + "/";
 
-        alarmMgr.badInput(clientIp, rootP->error);
-        return rootP->error;
+        alarmMgr.badInput(clientIp, error);
+        return error;
       }
     }
   }
@@ -617,10 +636,10 @@ std::string CompoundValueNode::check(void)
       {
         if (childV[ix]->name == childV[ix2]->name)
         {
-          rootP->error = std::string("duplicated tag-name: /") + childV[ix]->name + "/ in path: " + path;
-          alarmMgr.badInput(clientIp, rootP->error);
+          std::string error = std::string("duplicated tag-name: /") + childV[ix]->name + "/ in path: " + fullPath();
+          alarmMgr.badInput(clientIp, error);
 
-          return rootP->error;
+          return error;
         }
       }
     }
@@ -984,7 +1003,12 @@ CompoundValueNode* CompoundValueNode::clone(void)
 
   if (rootP == this)
   {
+    // A whole tree is copied in one go, as a flat tree
     me = new CompoundValueNode(valueType);
+    me->flatInit(descendants());
+    flatCopy(me, me);
+
+    return me;
   }
   else
   {
@@ -993,19 +1017,19 @@ CompoundValueNode* CompoundValueNode::clone(void)
     case orion::ValueTypeString:
     case orion::ValueTypeObject:
     case orion::ValueTypeVector:
-      me = new CompoundValueNode(container, path, name, stringValue, siblingNo, valueType, level);
+      me = new CompoundValueNode(container, name, stringValue, siblingNo, valueType);
       break;
 
     case orion::ValueTypeNumber:
-      me = new CompoundValueNode(container, path, name, numberValue, siblingNo, valueType, level);
+      me = new CompoundValueNode(container, name, numberValue, siblingNo, valueType);
       break;
 
     case orion::ValueTypeBoolean:
-      me = new CompoundValueNode(container, path, name, boolValue, siblingNo, valueType, level);
+      me = new CompoundValueNode(container, name, boolValue, siblingNo, valueType);
       break;
 
     case orion::ValueTypeNone:
-      me = new CompoundValueNode(container, path, name, stringValue, siblingNo, valueType, level);
+      me = new CompoundValueNode(container, name, stringValue, siblingNo, valueType);
       me->valueType = orion::ValueTypeNone;
       break;
 
@@ -1026,6 +1050,52 @@ CompoundValueNode* CompoundValueNode::clone(void)
 
 
 
+/* ****************************************************************************
+*
+* flatCopy -
+*
+* Copies the children of this node, recursively, as the children of 'copyP', a node of the
+* flat tree whose root is 'copyRootP'.
+*/
+void CompoundValueNode::flatCopy(CompoundValueNode* copyRootP, CompoundValueNode* copyP)
+{
+  copyRootP->flatChildrenAdd(copyP, childV.size());
+
+  for (unsigned int ix = 0; ix < childV.size(); ++ix)
+  {
+    CompoundValueNode* child = childV[ix];
+    CompoundValueNode* copy  = copyP->childV[ix];
+
+    copy->name        = child->name;
+    copy->valueType   = child->valueType;
+    copy->stringValue = child->stringValue;
+    copy->numberValue = child->numberValue;
+    copy->boolValue   = child->boolValue;
+
+    child->flatCopy(copyRootP, copy);
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* descendants - number of nodes under this one
+*/
+unsigned int CompoundValueNode::descendants(void)
+{
+  unsigned int n = childV.size();
+
+  for (unsigned int ix = 0; ix < childV.size(); ++ix)
+  {
+    n += childV[ix]->descendants();
+  }
+
+  return n;
+}
+
+
+
 /* ****************************************************************************
 *
 * isVector -
@@ -1072,10 +1142,163 @@ const char* CompoundValueNode::cname(void)
 
 /* ****************************************************************************
 *
-* cpath -
+* fullPath -
+*
+* Nodes don't keep their path, it is built here from the chain of containers, only when
+* needed (error messages and traces).
+*
+* Flat trees use the format the JSON v2 parser has always used: "/" for the root, the name
+* of object members, "[NNN]" for vector items and a trailing "/" for objects and vectors,
+* e.g. "/a/[002]/b".
+* Trees built node by node use the format of the NGSIv1 parsers: the names of the nodes
+* separated by "/", e.g. "/a/item/b".
+*/
+std::string CompoundValueNode::fullPath(void)
+{
+  if ((container == NULL) || (container == this))
+  {
+    return "/";
+  }
+
+  std::string out = container->fullPath();
+
+  if ((rootP == NULL) || (rootP->nodeArrayP == NULL))
+  {
+    return (out == "/")? out + name : out + "/" + name;
+  }
+
+  if (container->valueType == orion::ValueTypeVector)
+  {
+    char itemNo[16];
+
+    snprintf(itemNo, sizeof(itemNo), "[%03d]", siblingNo);
+    out += itemNo;
+  }
+  else
+  {
+    out += name;
+  }
+
+  if ((valueType == orion::ValueTypeObject) || (valueType == orion::ValueTypeVector))
+  {
+    out += "/";
+  }
+
+  return out;
+}
+
+
+
+/* ****************************************************************************
+*
+* level - the depth of the node in the tree, 0 for the root
+*/
+int CompoundValueNode::level(void)
+{
+  int                 depth = 0;
+  CompoundValueNode*  nodeP = this;
+
+  while ((nodeP->container != NULL) && (nodeP->container != nodeP))
+  {
+    nodeP = nodeP->container;
+    ++depth;
+  }
+
+  return depth;
+}
+
+
+
+/* ****************************************************************************
+*
+* CompoundValueNodeVector -
+*/
+CompoundValueNodeVector::CompoundValueNodeVector():
+  nodePV   (NULL),
+  count    (0),
+  capacity (0)
+{
+}
+
+
+
+/* ****************************************************************************
+*
+* CompoundValueNodeVector::~CompoundValueNodeVector -
+*
+* The children themselves are deleted by their container (see ~CompoundValueNode).
+*/
+CompoundValueNodeVector::~CompoundValueNodeVector()
+{
+  clear();
+}
+
+
+
+/* ****************************************************************************
+*
+* CompoundValueNodeVector::push_back -
+*/
+void CompoundValueNodeVector::push_back(CompoundValueNode* node)
+{
+  if ((capacity == 0) || (count == capacity))
+  {
+    unsigned int         newCapacity = (count < 2)? 4 : count * 2;
+    CompoundValueNode**  newV        = (CompoundValueNode**) malloc(newCapacity * sizeof(CompoundValueNode*));
+
+    if (newV == NULL)
+    {
+      LM_E(("Runtime Error (out of memory adding a compound node)"));
+      return;
+    }
+
+    // A range (capacity 0) is turned into a vector of pointers to the nodes of the range
+    for (unsigned int ix = 0; ix < count; ++ix)
+    {
+      newV[ix] = (*this)[ix];
+    }
+
+    if (capacity != 0)
+    {
+      free(nodePV);
+    }
+
+    nodePV   = newV;
+    capacity = newCapacity;
+  }
+
+  nodePV[count++] = node;
+}
+
+
+
+/* ****************************************************************************
+*
+* CompoundValueNodeVector::range -
 */
-const char* CompoundValueNode::cpath(void)
+void CompoundValueNodeVector::range(CompoundValueNode* _first, unsigned int _count)
 {
-  return path.c_str();
+  clear();
+
+  first = _first;
+  count = _count;
+}
+
+
+
+/* ****************************************************************************
+*
+* CompoundValueNodeVector::clear -
+*/
+void CompoundValueNodeVector::clear(void)
+{
+  if (capacity != 0)
+  {
+    free(nodePV);
+  }
+
+  nodePV   = NULL;
+  count    = 0;
+  capacity = 0;
 }
 }
@@ -25,16 +25,83 @@
 *
 * Author: Ken Zangelin
 */
+#include <stddef.h>
+
 #include <string>
 #include <vector>
 
 #include "common/globals.h"
+#include "common/RequestArena.h"
 
 #include "orionTypes/OrionValueType.h"
 
 
 namespace orion
 {
+class CompoundValueNode;
+
+
+
+/* ****************************************************************************
+*
+* CompoundValueNodeVector -
+*
+* The children of a CompoundValueNode.
+*
+* In a flat tree (see CompoundValueNode::nodeArrayP) the children of a node are contiguous in
+* the node array of the root, so they are kept as a range of it: the first child and the
+* number of children, with no allocation at all.
+* In a tree built node by node (NGSIv1 parsers, CompoundValueNode::add) they are a vector of
+* pointers, as any other vector. A range is turned into a vector of pointers if a node is
+* added to it.
+* Both share the same storage (capacity is 0 for a range), so the vector takes 16 bytes.
+*/
+class CompoundValueNodeVector
+{
+ public:
+  CompoundValueNodeVector();
+  ~CompoundValueNodeVector();
+
+  size_t              size(void) const   { return count; }
+  bool                empty(void) const  { return count == 0; }
+  CompoundValueNode*  operator[](size_t ix) const;
+
+  void                push_back(CompoundValueNode* node);
+  void                range(CompoundValueNode* _first, unsigned int _count);
+  void                clear(void);
+
+ private:
+  union
+  {
+    CompoundValueNode*   first;   // Range: first child, in the node array of a flat tree
+    CompoundValueNode**  nodePV;  // Vector: pointers to the children
+  };
+  unsigned int           count;
+  unsigned int           capacity;  // Size of nodePV, 0 for a range
+
+  CompoundValueNodeVector(const CompoundValueNodeVector&);
+  CompoundValueNodeVector& operator=(const CompoundValueNodeVector&);
+};
+
+
+
+/* ****************************************************************************
+*
+* CompoundValueNodeArray -
+*
+* The node array of a flat tree, kept by its root only (see CompoundValueNode::nodeArrayP):
+* 'nodes' nodes, where flatChildrenAdd hands out the next ones (nodesUsed so far) as the
+* children of a node, so the children of each node are contiguous too.
+*/
+typedef struct CompoundValueNodeArray
+{
+  CompoundValueNode*  nodeV;
+  unsigned int        nodes;
+  unsigned int        nodesUsed;
+} CompoundValueNodeArray;
+
+
+
 /* ****************************************************************************
 *
 * CompoundValueNode -
@@ -53,52 +120,52 @@ namespace orion
 *
 * o boolValue    The value of a Bool in the tree.
 *
-* o childV       A vector of the children of a Vector or Object.
-*                Contains pointers to CompoundValueNode.
+* o childV       The children of a Vector or Object (see CompoundValueNodeVector).
 *
 * o container    A pointer to the father of the node. The father is the Object/Vector node
 *                that owns this node.
 *
 * o rootP        A pointer to the owner of the entire tree
 *
-* o error        This string is used by the 'check' function to save any errors detected during
-*                the 'check' phase.
-*                FIXME P1: May be removed if the check function is modified.
-*
-* o path         Absolute path of the node in the tree.
-*                Used for error messages, e.g. duplicated tag-name in a struct.
-*
-* o level        The depth or nesting level in which this node lives.
-*
 * o siblingNo:   This field is used for rendering JSON. It tells us whether a comma should
 *                be added after a field (a comma is added unless the sibling number is
 *                equal to the number of siblings (the size of the containers child vector).
+*
+* o flat         The node lives in the node array of its root, so it is not deleted on its own.
+*
+* o nodeArrayP   Flat trees (built in one go by the JSON v2 parsers, from the DB and by clone):
+*                the root allocates all the other nodes of the tree in one contiguous array.
+*                NULL for any other node.
+*
+* The path (used for error messages, e.g. duplicated tag-name in a struct) and the nesting
+* level of a node are not kept, they are worked out from the chain of containers (see
+* fullPath and level).
 */
 class CompoundValueNode
 {
  public:
+  REQUEST_ARENA_ALLOCATED
+
   // Tree fields
   std::string                        name;
   orion::ValueType                   valueType;
   std::string                        stringValue;
   double                             numberValue;
   bool                               boolValue;
-  std::vector<CompoundValueNode*>    childV;
+  CompoundValueNodeVector            childV;
 
 
   // Auxiliar fields for creation of the tree
   CompoundValueNode*                 container;
   CompoundValueNode*                 rootP;
-  std::string                        error;
 
   // Needed for JSON rendering
   int                                siblingNo;
   bool                               renderName;
 
-  // Fields that may not be necessary
-  // FIXME P4: when finally sure, remove the unnecessary fields
-  std::string                        path;
-  int                                level;
+  // Flat trees
+  bool                               flat;
+  CompoundValueNodeArray*            nodeArrayP;
 
   // Constructors/Destructors
   CompoundValueNode();
@@ -107,47 +174,39 @@ class CompoundValueNode
   CompoundValueNode
   (
     CompoundValueNode*  _container,
-    const std::string&  _path,
     const std::string&  _name,
     const std::string&  _value,
     int                 _siblingNo,
-    orion::ValueType    _type,
-    int                 _level = -1
+    orion::ValueType    _type
   );
 
 
   CompoundValueNode
   (
     CompoundValueNode*  _container,
-    const std::string&  _path,
     const std::string&  _name,
     const char*         _value,
     int                 _siblingNo,
-    orion::ValueType    _type,
-    int                 _level = -1
+    orion::ValueType    _type
   );
 
 
   CompoundValueNode
   (
     CompoundValueNode*  _container,
-    const std::string&  _path,
     const std::string&  _name,
     double              _value,
     int                 _siblingNo,
-    orion::ValueType    _type,
-    int                 _level = -1
+    orion::ValueType    _type
   );
 
   CompoundValueNode
   (
     CompoundValueNode*  _container,
-    const std::string&  _path,
     const std::string&  _name,
     bool                 _value,
     int                 _siblingNo,
-    orion::ValueType    _type,
-    int                 _level = -1
+    orion::ValueType    _type
   );
 
   ~CompoundValueNode();
@@ -158,6 +217,8 @@ class CompoundValueNode
   CompoundValueNode*  add(const orion::ValueType _type, const std::string& _name, const char* _value);
   CompoundValueNode*  add(const orion::ValueType _type, const std::string& _name, double _value);
   CompoundValueNode*  add(const orion::ValueType _type, const std::string& _name, bool _value);
+  void                flatInit(unsigned int _nodes);
+  void                flatChildrenAdd(CompoundValueNode* parentP, unsigned int children);
   std::string         check(void);
   std::string         finish(void);
   std::string         render(ApiVersion apiVersion, const std::string& indent);
@@ -171,9 +232,25 @@ class CompoundValueNode
   bool                isString(void);
 
   const char*         cname(void);
-  const char*         cpath(void);
+  std::string         fullPath(void);
+  int                 level(void);
+
+ private:
+  void                flatCopy(CompoundValueNode* copyRootP, CompoundValueNode* copyP);
+  unsigned int        descendants(void);
 };
 
+
+
+/* ****************************************************************************
+*
+* CompoundValueNodeVector::operator[] -
+*/
+inline CompoundValueNode* CompoundValueNodeVector::operator[](size_t ix) const
+{
+  return (capacity != 0)? nodePV[ix] : &first[ix];
+}
+
 }  // namespace orion
 
 #endif  // SRC_LIB_PARSE_COMPOUNDVALUENODE_H_
@@ -63,7 +63,7 @@ void compoundValueStart
   ciP->compoundValueRoot = ciP->compoundValueP;
 
   LM_T(LmtCompoundValueContainer, ("Set current container to '%s' (%s)",
-                                   ciP->compoundValueP->path.c_str(),
+                                   ciP->compoundValueP->fullPath().c_str(),
                                    ciP->compoundValueP->name.c_str()));
 
 
@@ -119,7 +119,7 @@ void compoundValueMiddle
     ciP->compoundValueP = ciP->compoundValueP->add(type, name, "");
 
     LM_T(LmtCompoundValueContainer, ("Set current container to '%s' (%s)",
-                                     ciP->compoundValueP->path.c_str(),
+                                     ciP->compoundValueP->fullPath().c_str(),
                                      ciP->compoundValueP->name.c_str()));
   }
   else
@@ -47,7 +47,8 @@ static const char* validOptions[] =
   OPT_UNIQUE_VALUES,
   OPT_DATE_CREATED,
   OPT_DATE_MODIFIED,
-  OPT_NO_ATTR_DETAIL
+  OPT_NO_ATTR_DETAIL,
+  OPT_CURSOR
 };
 
 
@@ -35,11 +35,13 @@
 #include "logMsg/logMsg.h"
 
 #include "common/MimeType.h"
+#include "common/RequestArena.h"
 #include "parse/CompoundValueNode.h"
 #include "rest/HttpStatusCode.h"
 #include "rest/mhd.h"
 #include "rest/Verb.h"
 #include "rest/HttpHeaders.h"
+#include "rest/ResponseStream.h"
 #include "ngsi/Request.h"
 
 struct ParseData;
@@ -69,7 +71,9 @@ public:
     inCompoundValue        (false),
     compoundValueP         (NULL),
     compoundValueRoot      (NULL),
-    httpStatusCode         (SccOk)
+    httpStatusCode         (SccOk),
+    responseStreamP        (NULL),
+    arenaP                 (NULL)
   {
     memset(payloadWord, 0, sizeof(payloadWord));
   }
@@ -90,7 +94,9 @@ public:
     inCompoundValue        (false),
     compoundValueP         (NULL),
     compoundValueRoot      (NULL),
-    httpStatusCode         (SccOk)
+    httpStatusCode         (SccOk),
+    responseStreamP        (NULL),
+    arenaP                 (NULL)
   {
     memset(payloadWord, 0, sizeof(payloadWord));
   }
@@ -114,7 +120,9 @@ public:
     inCompoundValue        (false),
     compoundValueP         (NULL),
     compoundValueRoot      (NULL),
-    httpStatusCode         (SccOk)
+    httpStatusCode         (SccOk),
+    responseStreamP        (NULL),
+    arenaP                 (NULL)
   {
 
     memset(payloadWord, 0, sizeof(payloadWord));
@@ -132,6 +140,13 @@ public:
     if (compoundValueRoot != NULL)
       delete compoundValueRoot;
 
+    if (responseStreamP != NULL)
+      delete responseStreamP;
+
+    // Last, as the objects above may come from the arena
+    if (arenaP != NULL)
+      delete arenaP;
+
     servicePathV.clear();
     httpHeaders.release();
   }
@@ -174,6 +189,10 @@ public:
   HttpStatusCode            httpStatusCode;
   std::vector<std::string>  httpHeader;
   std::vector<std::string>  httpHeaderValue;
+  ResponseStream*           responseStreamP;  // If not NULL, the payload is streamed (see restReply)
+
+  // Memory of the NGSI objects of the request (see -reqArena), NULL if not used
+  RequestArena*             arenaP;
 
   // Timing
   struct timespec           reqStartTime;
@@ -0,0 +1,53 @@
+#ifndef SRC_LIB_REST_RESPONSESTREAM_H_
+#define SRC_LIB_REST_RESPONSESTREAM_H_
+
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <string>
+
+
+
+/* ****************************************************************************
+*
+* ResponseStream -
+*
+* A response payload that is rendered piece by piece while it is being sent, instead of
+* being rendered in a single string (see restReply). A service routine that wants its
+* response to be streamed sets ConnectionInfo::responseStreamP and returns an empty
+* string. The stream is deleted once the response has been sent (or the connection closed),
+* which may happen after the request is completed, so it must not refer to anything in
+* ConnectionInfo nor to objects allocated from the arena of the request (see RequestArena):
+* everything it uses must be owned by it and allocated from the heap.
+*/
+class ResponseStream
+{
+ public:
+  virtual ~ResponseStream() {}
+
+  // Puts the next piece of the payload in 'chunkP'. Returns false when there is nothing left
+  virtual bool next(std::string* chunkP) = 0;
+};
+
+#endif  // SRC_LIB_REST_RESPONSESTREAM_H_
@@ -31,6 +31,7 @@
 
 #include "common/wsStrip.h"
 #include "common/string.h"
+#include "common/regexCache.h"
 #include "parse/forbiddenChars.h"
 #include "parse/CompoundValueNode.h"
 #include "rest/StringFilter.h"
@@ -47,7 +48,7 @@ using namespace mongo;
 *
 * StringFilterItem::StringFilterItem -
 */
-StringFilterItem::StringFilterItem() : compiledPattern(false)
+StringFilterItem::StringFilterItem() : patternValueP(NULL), compiledPattern(false)
 {
   numberList.clear();
   stringList.clear();
@@ -82,13 +83,12 @@ bool StringFilterItem::fill(StringFilterItem* sfiP, std::string* errorStringP)
   if (compiledPattern)
   {
     //
-    // FIXME P4: not very optimized to recalculate the regex.
+    // The regex of sfiP is in the regex cache (unless it has been evicted meanwhile), so
+    // this is just a lookup, not a new compilation.
     //
-    // We don't know of a better way to copy the regex from sfiP, and have a question out on SOF:
-    // http://stackoverflow.com/questions/36846426/best-way-of-cloning-compiled-regex-t-struct-in-c
-    //
-    if (regcomp(&patternValue, stringValue.c_str(), REG_EXTENDED) != 0)
+    if ((patternValueP = regexCacheGet(stringValue, REG_EXTENDED)) == NULL)
     {
+      compiledPattern = false;
       *errorStringP = std::string("error compiling filter regex: '") + stringValue + "'";
       return false;
     }
@@ -110,7 +110,8 @@ StringFilterItem::~StringFilterItem()
 
   if (compiledPattern == true)
   {
-    regfree(&patternValue);  // If regcomp fails it frees up itself (see glibc sources for details)
+    regexCacheRelease(patternValueP);
+    patternValueP   = NULL;
     compiledPattern = false;
   }
 }
@@ -150,7 +151,7 @@ bool StringFilterItem::valueParse(char* s, std::string* errorStringP)
 
   if (op == SfopMatchPattern)
   {
-    if (regcomp(&patternValue, stringValue.c_str(), REG_EXTENDED) != 0)
+    if ((patternValueP = regexCacheGet(stringValue, REG_EXTENDED)) == NULL)
     {
       *errorStringP = std::string("error compiling filter regex: '") + stringValue + "'";
       return false;
@@ -682,7 +683,7 @@ bool StringFilterItem::parse(char* qItem, std::string* errorStringP, StringFilte
     // Can't call valueParse here, as the forced valueType 'SfvtString' will be knocked back to its 'default'.
     // So, instead we just perform the part of SfopMatchPattern of valueParse
     //
-    if (regcomp(&patternValue, stringValue.c_str(), REG_EXTENDED) != 0)
+    if ((patternValueP = regexCacheGet(stringValue, REG_EXTENDED)) == NULL)
     {
       *errorStringP = std::string("error compiling filter regex: '") + stringValue + "'";
       return false;
@@ -1220,7 +1221,7 @@ bool StringFilterItem::matchPattern(ContextAttribute* caP)
     return false;
   }
 
-  return (regexec(&patternValue, caP->stringValue.c_str(), 0, NULL, 0) == 0);
+  return (regexec(patternValueP, caP->stringValue.c_str(), 0, NULL, 0) == 0);
 }
 
 
@@ -1237,7 +1238,7 @@ bool StringFilterItem::matchPattern(orion::CompoundValueNode* cvP)
     return false;
   }
 
-  return (regexec(&patternValue, cvP->stringValue.c_str(), 0, NULL, 0) == 0);
+  return (regexec(patternValueP, cvP->stringValue.c_str(), 0, NULL, 0) == 0);
 }
 
 
@@ -1272,7 +1273,7 @@ bool StringFilterItem::matchPattern(Metadata* mdP)
     return false;
   }
 
-  return (regexec(&patternValue, mdP->stringValue.c_str(), 0, NULL, 0) == 0);
+  return (regexec(patternValueP, mdP->stringValue.c_str(), 0, NULL, 0) == 0);
 }
 
 
@@ -140,7 +140,7 @@ public:
   StringFilterValueType     valueType;
   double                    numberValue;
   std::string               stringValue;
-  regex_t                   patternValue;
+  regex_t*                  patternValueP;  // From the regex cache, see common/regexCache.h
   bool                      boolValue;
   std::vector<std::string>  stringList;
   std::vector<double>       numberList;
@@ -0,0 +1,437 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <map>
+#include <deque>
+
+#include <curl/curl.h>
+
+#include "logMsg/logMsg.h"
+#include "logMsg/traceLevels.h"
+
+#include "common/globals.h"
+#include "common/limits.h"
+#include "rest/httpPool.h"
+
+
+
+/* ****************************************************************************
+*
+* IdleHandle - a curl handle waiting in the pool, with the time it was given back
+*/
+typedef struct IdleHandle
+{
+  CURL*  curl;
+  int    lastUsed;
+} IdleHandle;
+
+
+
+/* ****************************************************************************
+*
+* EndpointHandles - the handles of an endpoint
+*
+* The idle handles are kept in LRU order: given back at the end of the deque and taken
+* from the end too (the most recently used connection is the one most likely to be still
+* open), while the ones at the beginning are the first to expire.
+*
+* 'active' counts the handles taken and not given back yet. The connections to an
+* endpoint (active plus idle handles) never exceed the maximum per host.
+*/
+typedef struct EndpointHandles
+{
+  std::deque<IdleHandle>  idle;
+  int                     active;
+
+  EndpointHandles(): active(0) {}
+} EndpointHandles;
+
+
+
+/* ****************************************************************************
+*
+* HttpPoolShard -
+*
+* 'released' is signaled when a handle is given back, for the threads waiting for a
+* connection to an endpoint of the shard that is at its maximum.
+*/
+typedef struct HttpPoolShard
+{
+  pthread_mutex_t                          mutex;
+  pthread_cond_t                           released;
+  std::map<std::string, EndpointHandles>   endpoints;
+} HttpPoolShard;
+
+
+
+/* ****************************************************************************
+*
+* Pool state and statistics -
+*/
+static HttpPoolShard  shardV[HTTP_POOL_SHARDS];
+static int            poolMaxPerHost    = 0;
+static int            poolIdleTimeout   = 0;
+static bool           sweeperStarted    = false;
+static volatile int   poolHits          = 0;
+static volatile int   poolMisses        = 0;
+static volatile int   poolEvictions     = 0;
+
+
+
+/* ****************************************************************************
+*
+* shardGet -
+*/
+static HttpPoolShard* shardGet(const std::string& endpoint)
+{
+  unsigned int hash = 5381;
+
+  for (unsigned int ix = 0; ix < endpoint.size(); ++ix)
+  {
+    hash = ((hash << 5) + hash) + (unsigned char) endpoint[ix];
+  }
+
+  return &shardV[hash % HTTP_POOL_SHARDS];
+}
+
+
+
+/* ****************************************************************************
+*
+* expiredPurge - destroy the handles that have been idle too long (shard mutex taken)
+*/
+static void expiredPurge(std::deque<IdleHandle>* handlesP, int now)
+{
+  while (!handlesP->empty() && (now - handlesP->front().lastUsed > poolIdleTimeout))
+  {
+    curl_easy_cleanup(handlesP->front().curl);
+    handlesP->pop_front();
+    __sync_fetch_and_add(&poolEvictions, 1);
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* sweeperFunc -
+*
+* Thread purging the expired handles of all the endpoints, as those of an endpoint are
+* otherwise only purged when the endpoint is used again.
+*/
+static void* sweeperFunc(void* vP)
+{
+  while (true)
+  {
+    sleep(poolIdleTimeout);
+
+    if (httpPoolEnabled())
+    {
+      httpPoolSweep(getCurrentTime());
+    }
+  }
+
+  return NULL;
+}
+
+
+
+/* ****************************************************************************
+*
+* handleTake -
+*
+* Takes a handle for the endpoint, reusing an idle one if possible. If the endpoint is
+* at its maximum of connections, waits for a handle to be given back or, if 'wait' is
+* false, returns false.
+*/
+static bool handleTake(const std::string& endpoint, bool wait, CURL** curlP)
+{
+  HttpPoolShard*  shardP = shardGet(endpoint);
+  CURL*           curl   = NULL;
+
+  pthread_mutex_lock(&shardP->mutex);
+
+  EndpointHandles* ehP = &shardP->endpoints[endpoint];
+
+  expiredPurge(&ehP->idle, getCurrentTime());
+
+  while (ehP->idle.empty() && (ehP->active >= poolMaxPerHost))
+  {
+    if (!wait)
+    {
+      pthread_mutex_unlock(&shardP->mutex);
+      return false;
+    }
+
+    LM_T(LmtCurlContext, ("waiting for a connection to %s", endpoint.c_str()));
+    pthread_cond_wait(&shardP->released, &shardP->mutex);
+
+    // The sweeper may have removed the endpoint meanwhile
+    ehP = &shardP->endpoints[endpoint];
+  }
+
+  if (!ehP->idle.empty())
+  {
+    curl = ehP->idle.back().curl;
+    ehP->idle.pop_back();
+  }
+
+  ++ehP->active;
+
+  pthread_mutex_unlock(&shardP->mutex);
+
+  if (curl != NULL)
+  {
+    __sync_fetch_and_add(&poolHits, 1);
+    LM_T(LmtCurlContext, ("reusing connection to %s", endpoint.c_str()));
+    *curlP = curl;
+    return true;
+  }
+
+  __sync_fetch_and_add(&poolMisses, 1);
+  LM_T(LmtCurlContext, ("new connection to %s", endpoint.c_str()));
+
+  if ((curl = curl_easy_init()) == NULL)
+  {
+    LM_E(("Runtime Error (curl_easy_init)"));
+
+    pthread_mutex_lock(&shardP->mutex);
+    --shardP->endpoints[endpoint].active;
+    pthread_cond_broadcast(&shardP->released);
+    pthread_mutex_unlock(&shardP->mutex);
+  }
+
+  *curlP = curl;
+  return true;
+}
+
+
+
+/* ****************************************************************************
+*
+* httpPoolInit -
+*/
+void httpPoolInit(int maxPerHost, int idleTimeout)
+{
+  poolMaxPerHost  = maxPerHost;
+  poolIdleTimeout = idleTimeout;
+
+  for (int ix = 0; ix < HTTP_POOL_SHARDS; ++ix)
+  {
+    pthread_mutex_init(&shardV[ix].mutex, NULL);
+    pthread_cond_init(&shardV[ix].released, NULL);
+  }
+
+  if ((maxPerHost > 0) && !sweeperStarted)
+  {
+    pthread_t  tid;
+    int        rc = pthread_create(&tid, NULL, sweeperFunc, NULL);
+
+    if (rc != 0)
+    {
+      LM_E(("Internal Error (pthread_create: %s)", strerror(rc)));
+      return;
+    }
+
+    pthread_detach(tid);
+    sweeperStarted = true;
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* httpPoolEnabled -
+*/
+bool httpPoolEnabled(void)
+{
+  return poolMaxPerHost > 0;
+}
+
+
+
+/* ****************************************************************************
+*
+* httpPoolEndpoint -
+*/
+std::string httpPoolEndpoint(const std::string& protocol, const std::string& host, unsigned short port)
+{
+  char portV[STRING_SIZE_FOR_INT];
+
+  snprintf(portV, sizeof(portV), "%u", port);
+
+  return protocol + "//" + host + ":" + portV;
+}
+
+
+
+/* ****************************************************************************
+*
+* httpPoolGet -
+*/
+CURL* httpPoolGet(const std::string& endpoint)
+{
+  CURL* curl = NULL;
+
+  handleTake(endpoint, true, &curl);
+
+  return curl;
+}
+
+
+
+/* ****************************************************************************
+*
+* httpPoolTryGet -
+*/
+bool httpPoolTryGet(const std::string& endpoint, CURL** curlP)
+{
+  *curlP = NULL;
+
+  return handleTake(endpoint, false, curlP);
+}
+
+
+
+/* ****************************************************************************
+*
+* httpPoolRelease -
+*
+* curl_easy_reset() clears the options of the handle, but keeps its open connections.
+*/
+void httpPoolRelease(const std::string& endpoint, CURL* curl, bool reusable)
+{
+  HttpPoolShard*  shardP = shardGet(endpoint);
+  IdleHandle      handle;
+
+  if (reusable)
+  {
+    curl_easy_reset(curl);
+
+    handle.curl     = curl;
+    handle.lastUsed = getCurrentTime();
+  }
+
+  pthread_mutex_lock(&shardP->mutex);
+
+  EndpointHandles* ehP = &shardP->endpoints[endpoint];
+
+  --ehP->active;
+
+  if (reusable)
+  {
+    expiredPurge(&ehP->idle, handle.lastUsed);
+    ehP->idle.push_back(handle);
+    curl = NULL;
+  }
+
+  pthread_cond_broadcast(&shardP->released);
+  pthread_mutex_unlock(&shardP->mutex);
+
+  if (curl != NULL)
+  {
+    curl_easy_cleanup(curl);
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* httpPoolSweep -
+*/
+void httpPoolSweep(int now)
+{
+  for (int ix = 0; ix < HTTP_POOL_SHARDS; ++ix)
+  {
+    HttpPoolShard* shardP = &shardV[ix];
+
+    pthread_mutex_lock(&shardP->mutex);
+
+    std::map<std::string, EndpointHandles>::iterator it = shardP->endpoints.begin();
+
+    while (it != shardP->endpoints.end())
+    {
+      expiredPurge(&it->second.idle, now);
+
+      if (it->second.idle.empty() && (it->second.active == 0))
+      {
+        shardP->endpoints.erase(it++);
+      }
+      else
+      {
+        ++it;
+      }
+    }
+
+    pthread_mutex_unlock(&shardP->mutex);
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* httpPoolStatisticsGet -
+*/
+void httpPoolStatisticsGet(int* hitsP, int* missesP, int* evictionsP, int* idleP)
+{
+  *hitsP      = __sync_fetch_and_add(&poolHits, 0);
+  *missesP    = __sync_fetch_and_add(&poolMisses, 0);
+  *evictionsP = __sync_fetch_and_add(&poolEvictions, 0);
+  *idleP      = 0;
+
+  for (int ix = 0; ix < HTTP_POOL_SHARDS; ++ix)
+  {
+    pthread_mutex_lock(&shardV[ix].mutex);
+
+    std::map<std::string, EndpointHandles>::iterator it;
+    for (it = shardV[ix].endpoints.begin(); it != shardV[ix].endpoints.end(); ++it)
+    {
+      *idleP += it->second.idle.size();
+    }
+
+    pthread_mutex_unlock(&shardV[ix].mutex);
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* httpPoolStatisticsReset -
+*/
+void httpPoolStatisticsReset(void)
+{
+  __sync_fetch_and_and(&poolHits,      0);
+  __sync_fetch_and_and(&poolMisses,    0);
+  __sync_fetch_and_and(&poolEvictions, 0);
+}
@@ -0,0 +1,133 @@
+#ifndef SRC_LIB_REST_HTTPPOOL_H_
+#define SRC_LIB_REST_HTTPPOOL_H_
+
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <string>
+
+#include <curl/curl.h>
+
+
+
+/* ****************************************************************************
+*
+* HTTP_POOL_SHARDS - number of independently locked parts of the pool
+*/
+#define HTTP_POOL_SHARDS  16
+
+
+
+/* ****************************************************************************
+*
+* httpPoolInit -
+*
+* A 'maxPerHost' of zero disables the pool.
+*/
+extern void httpPoolInit(int maxPerHost, int idleTimeout);
+
+
+
+/* ****************************************************************************
+*
+* httpPoolEnabled -
+*/
+extern bool httpPoolEnabled(void);
+
+
+
+/* ****************************************************************************
+*
+* httpPoolEndpoint - the key of the pool, as protocol://host:port
+*/
+extern std::string httpPoolEndpoint(const std::string& protocol, const std::string& host, unsigned short port);
+
+
+
+/* ****************************************************************************
+*
+* httpPoolGet -
+*
+* Returns an idle curl handle that was used before for the same endpoint (so its
+* connection may still be open) or a new one. NULL if curl_easy_init fails.
+*
+* The connections to an endpoint are limited to the maximum per host: when it is
+* reached, the caller waits until some other thread gives a handle back. A thread
+* holding handles of an endpoint must not ask for more with this function (it could
+* wait for itself), but use httpPoolTryGet.
+*/
+extern CURL* httpPoolGet(const std::string& endpoint);
+
+
+
+/* ****************************************************************************
+*
+* httpPoolTryGet -
+*
+* Like httpPoolGet, but returns false (without waiting) if the endpoint is at its
+* maximum of connections. Otherwise returns true and the handle (NULL if
+* curl_easy_init fails) in 'curlP'.
+*/
+extern bool httpPoolTryGet(const std::string& endpoint, CURL** curlP);
+
+
+
+/* ****************************************************************************
+*
+* httpPoolRelease -
+*
+* Gives back a handle got with httpPoolGet/httpPoolTryGet. If the request failed
+* ('reusable' false), the connection is not trusted and the handle is destroyed.
+*/
+extern void httpPoolRelease(const std::string& endpoint, CURL* curl, bool reusable);
+
+
+
+/* ****************************************************************************
+*
+* httpPoolSweep -
+*
+* Destroys the handles idle for longer than the idle timeout at 'now' (seconds), for
+* all the endpoints, and forgets the endpoints with no handles. A thread started by
+* httpPoolInit does it periodically.
+*/
+extern void httpPoolSweep(int now);
+
+
+
+/* ****************************************************************************
+*
+* httpPoolStatisticsGet -
+*/
+extern void httpPoolStatisticsGet(int* hitsP, int* missesP, int* evictionsP, int* idleP);
+
+
+
+/* ****************************************************************************
+*
+* httpPoolStatisticsReset -
+*/
+extern void httpPoolStatisticsReset(void);
+
+#endif  // SRC_LIB_REST_HTTPPOOL_H_
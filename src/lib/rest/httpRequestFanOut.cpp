@@ -0,0 +1,412 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <sys/select.h>
+#include <time.h>
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include <curl/curl.h>
+
+#include "logMsg/logMsg.h"
+#include "logMsg/traceLevels.h"
+
+#include "common/clockFunctions.h"
+#include "rest/httpPool.h"
+#include "rest/httpRequestSend.h"
+#include "rest/httpRequestFanOut.h"
+
+
+
+/* ****************************************************************************
+*
+* FANOUT_WAIT_MAX_MS - maximum time waiting for the sockets, before checking the deadline again
+*/
+#define FANOUT_WAIT_MAX_MS  100
+
+
+
+/* ****************************************************************************
+*
+* FANOUT_DEADLINE_OUT - 'out' of the forwards that exceed the deadline of the fan-out
+*/
+#define FANOUT_DEADLINE_OUT  "context provider forward timeout"
+
+
+
+/* ****************************************************************************
+*
+* FanOutHandle - a request of the fan-out while it is in the multi handle
+*/
+typedef struct FanOutHandle
+{
+  HttpFanOutRequest*  reqP;
+  CURL*               curl;
+  std::string         endpoint;   // empty if the handle does not belong to the connection pool
+  HttpRequestState*   stateP;
+  bool                running;
+  bool                pending;    // not started yet, its endpoint was at its maximum of connections
+} FanOutHandle;
+
+
+
+/* ****************************************************************************
+*
+* handleRelease -
+*/
+static void handleRelease(FanOutHandle* hP, bool reusable)
+{
+  if (hP->endpoint != "")
+  {
+    httpPoolRelease(hP->endpoint, hP->curl, reusable);
+  }
+  else
+  {
+    curl_easy_cleanup(hP->curl);
+  }
+
+  hP->curl = NULL;
+}
+
+
+
+/* ****************************************************************************
+*
+* requestStart -
+*
+* Prepares the request and adds it to the multi handle. If it cannot be started, the
+* error is left in the request and false is returned.
+*
+* The handle of the connection pool (if enabled) is used, but not the per-IP contexts
+* of httpRequestSend(), as they are locked while in use and two context providers may
+* share the same IP. As this thread may already hold handles of the same endpoint, it
+* doesn't wait for the pool: if the endpoint is at its maximum of connections, the
+* request is left pending (and false returned), to be started later.
+*/
+static bool requestStart(CURLM* multi, FanOutHandle* hP)
+{
+  HttpFanOutRequest*                  reqP = hP->reqP;
+  std::map<std::string, std::string>  noHeaders;
+
+  hP->pending = false;
+
+  if (httpPoolEnabled())
+  {
+    hP->endpoint = httpPoolEndpoint(reqP->protocol, reqP->ip, reqP->port);
+
+    if (!httpPoolTryGet(hP->endpoint, &hP->curl))
+    {
+      hP->pending = true;
+      return false;
+    }
+  }
+  else
+  {
+    hP->curl = curl_easy_init();
+  }
+
+  if (hP->curl == NULL)
+  {
+    LM_E(("Runtime Error (could not init libcurl)"));
+    reqP->out = "error";
+    reqP->r   = -8;
+    return false;
+  }
+
+  reqP->r = httpRequestPrepare(hP->curl,
+                               reqP->ip,
+                               reqP->port,
+                               reqP->protocol,
+                               "POST",
+                               reqP->tenant,
+                               reqP->servicePath,
+                               reqP->xauthToken,
+                               reqP->resource,
+                               reqP->mimeType,
+                               reqP->content,
+                               reqP->correlator,
+                               "",
+                               false,
+                               true,
+                               &reqP->out,
+                               noHeaders,
+                               reqP->mimeType,
+                               -1,
+                               &hP->stateP);
+
+  if (reqP->r != 0)
+  {
+    // Nothing was sent, so the handle can be reused
+    handleRelease(hP, true);
+    return false;
+  }
+
+  curl_easy_setopt(hP->curl, CURLOPT_PRIVATE, (char*) hP);
+  curl_multi_add_handle(multi, hP->curl);
+
+  hP->running = true;
+  return true;
+}
+
+
+
+/* ****************************************************************************
+*
+* requestsComplete - finish the requests curl is done with, returns how many of them
+*/
+static int requestsComplete(CURLM* multi)
+{
+  CURLMsg*  msgP;
+  int       msgsLeft;
+  int       completed = 0;
+
+  while ((msgP = curl_multi_info_read(multi, &msgsLeft)) != NULL)
+  {
+    if (msgP->msg != CURLMSG_DONE)
+    {
+      continue;
+    }
+
+    // msgP is no longer valid once the handle is removed
+    CURL*          curl = msgP->easy_handle;
+    CURLcode       res  = msgP->data.result;
+    FanOutHandle*  hP   = NULL;
+
+    curl_easy_getinfo(curl, CURLINFO_PRIVATE, (char**) &hP);
+    curl_multi_remove_handle(multi, curl);
+
+    hP->reqP->r = httpRequestComplete(hP->stateP, res, &hP->reqP->out);
+    hP->running = false;
+
+    // Handles of failed requests are not reused, their connection may be broken
+    handleRelease(hP, res == CURLE_OK);
+    ++completed;
+  }
+
+  return completed;
+}
+
+
+
+/* ****************************************************************************
+*
+* socketsWait - wait (at most 'maxWait' milliseconds) until some socket of the multi handle is ready
+*/
+static void socketsWait(CURLM* multi, long maxWait)
+{
+  long timeout = maxWait;
+
+  curl_multi_timeout(multi, &timeout);
+  if ((timeout < 0) || (timeout > maxWait))
+  {
+    timeout = maxWait;
+  }
+
+  if (timeout == 0)
+  {
+    return;
+  }
+
+#if LIBCURL_VERSION_NUM >= 0x071c00
+  curl_multi_wait(multi, NULL, 0, timeout, NULL);
+#else
+  fd_set          readFds;
+  fd_set          writeFds;
+  fd_set          excFds;
+  int             maxFd = -1;
+  struct timeval  tv;
+
+  FD_ZERO(&readFds);
+  FD_ZERO(&writeFds);
+  FD_ZERO(&excFds);
+
+  tv.tv_sec  = 0;
+  tv.tv_usec = timeout * 1000;
+
+  curl_multi_fdset(multi, &readFds, &writeFds, &excFds, &maxFd);
+
+  if (maxFd == -1)
+  {
+    select(0, NULL, NULL, NULL, &tv);
+  }
+  else
+  {
+    select(maxFd + 1, &readFds, &writeFds, &excFds, &tv);
+  }
+#endif
+}
+
+
+
+/* ****************************************************************************
+*
+* elapsedMs -
+*/
+static long elapsedMs(const struct timespec* startP)
+{
+  struct timespec  now;
+  struct timespec  diff;
+
+  clock_gettime(CLOCK_REALTIME, &now);
+  clock_difftime(&now, startP, &diff);
+
+  return diff.tv_sec * 1000 + diff.tv_nsec / 1000000;
+}
+
+
+
+/* ****************************************************************************
+*
+* httpRequestFanOut -
+*/
+void httpRequestFanOut(const std::vector<HttpFanOutRequest*>& requestV, long deadlineInMilliseconds)
+{
+  std::vector<FanOutHandle>  handleV(requestV.size());
+  struct timespec            start;
+  int                        inFlight = 0;
+  int                        pending  = 0;
+  CURLM*                     multi    = curl_multi_init();
+
+  if (multi == NULL)
+  {
+    LM_E(("Runtime Error (could not init libcurl multi handle, %d forwards not sent)", (int) requestV.size()));
+
+    for (unsigned int ix = 0; ix < requestV.size(); ++ix)
+    {
+      requestV[ix]->out = "error";
+      requestV[ix]->r   = -8;
+    }
+
+    return;
+  }
+
+  clock_gettime(CLOCK_REALTIME, &start);
+
+  for (unsigned int ix = 0; ix < requestV.size(); ++ix)
+  {
+    handleV[ix].reqP    = requestV[ix];
+    handleV[ix].curl    = NULL;
+    handleV[ix].stateP  = NULL;
+    handleV[ix].running = false;
+    handleV[ix].pending = false;
+
+    if (requestStart(multi, &handleV[ix]))
+    {
+      ++inFlight;
+    }
+    else if (handleV[ix].pending)
+    {
+      ++pending;
+    }
+  }
+
+  LM_T(LmtCPrForwardRequestPayload, ("%d forwards in flight, %d pending", inFlight, pending));
+
+  while ((inFlight > 0) || (pending > 0))
+  {
+    int  running;
+    long maxWait = FANOUT_WAIT_MAX_MS;
+
+    while (curl_multi_perform(multi, &running) == CURLM_CALL_MULTI_PERFORM)
+    {
+    }
+
+    inFlight -= requestsComplete(multi);
+
+    // Completed requests (of this or other threads) may have freed connections for the pending ones
+    for (unsigned int ix = 0; (ix < handleV.size()) && (pending > 0); ++ix)
+    {
+      if (!handleV[ix].pending)
+      {
+        continue;
+      }
+
+      if (requestStart(multi, &handleV[ix]))
+      {
+        ++inFlight;
+        --pending;
+      }
+      else if (!handleV[ix].pending)
+      {
+        --pending;
+      }
+    }
+
+    if ((inFlight == 0) && (pending == 0))
+    {
+      break;
+    }
+
+    if (deadlineInMilliseconds > 0)
+    {
+      long left = deadlineInMilliseconds - elapsedMs(&start);
+
+      if (left <= 0)
+      {
+        break;
+      }
+
+      maxWait = (left < maxWait)? left : maxWait;
+    }
+
+    socketsWait(multi, maxWait);
+  }
+
+  //
+  // Requests still running or pending at this point have exceeded the deadline
+  //
+  for (unsigned int ix = 0; ix < handleV.size(); ++ix)
+  {
+    FanOutHandle* hP = &handleV[ix];
+
+    if (hP->pending)
+    {
+      LM_W(("Runtime Error (forward to %s:%d%s not sent, deadline of %ld ms exceeded waiting for a connection)",
+            hP->reqP->ip.c_str(), hP->reqP->port, hP->reqP->resource.c_str(), deadlineInMilliseconds));
+
+      hP->reqP->out = FANOUT_DEADLINE_OUT;
+      hP->reqP->r   = -9;
+      continue;
+    }
+
+    if (!hP->running)
+    {
+      continue;
+    }
+
+    LM_W(("Runtime Error (forward to %s:%d%s aborted, deadline of %ld ms exceeded)",
+          hP->reqP->ip.c_str(), hP->reqP->port, hP->reqP->resource.c_str(), deadlineInMilliseconds));
+
+    curl_multi_remove_handle(multi, hP->curl);
+    hP->reqP->r   = httpRequestComplete(hP->stateP, CURLE_OPERATION_TIMEDOUT, &hP->reqP->out);
+    hP->reqP->out = FANOUT_DEADLINE_OUT;
+    hP->running   = false;
+
+    handleRelease(hP, false);
+  }
+
+  curl_multi_cleanup(multi);
+}
@@ -0,0 +1,73 @@
+#ifndef SRC_LIB_REST_HTTPREQUESTFANOUT_H_
+#define SRC_LIB_REST_HTTPREQUESTFANOUT_H_
+
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <string>
+#include <vector>
+
+
+
+/* ****************************************************************************
+*
+* HttpFanOutRequest -
+*
+* A POST request to be sent by httpRequestFanOut(), with its result: 'r' is what
+* httpRequestSend() would have returned and 'out' the response (or the error).
+*/
+typedef struct HttpFanOutRequest
+{
+  std::string     ip;
+  unsigned short  port;
+  std::string     protocol;
+  std::string     tenant;
+  std::string     servicePath;
+  std::string     xauthToken;
+  std::string     resource;
+  std::string     mimeType;     // used both as Content-Type and Accept
+  std::string     content;
+  std::string     correlator;
+
+  int             r;
+  std::string     out;
+} HttpFanOutRequest;
+
+
+
+/* ****************************************************************************
+*
+* httpRequestFanOut -
+*
+* Sends all the requests of 'requestV' at the same time, using a curl multi handle
+* driven by the calling thread, and returns once all of them are done.
+*
+* Each request has the usual timeout (-httpTimeout). Besides, if 'deadlineInMilliseconds'
+* is not zero, the requests still running (or not started yet) when it expires are aborted,
+* failing with -9 and "context provider forward timeout" as 'out'. If the multi handle can't
+* be created, all the requests fail with -8.
+*/
+extern void httpRequestFanOut(const std::vector<HttpFanOutRequest*>& requestV, long deadlineInMilliseconds);
+
+#endif  // SRC_LIB_REST_HTTPREQUESTFANOUT_H_
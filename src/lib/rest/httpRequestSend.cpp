@@ -41,6 +41,7 @@
 #include "logMsg/logMsg.h"
 #include "logMsg/traceLevels.h"
 
+#include "common/globals.h"
 #include "common/string.h"
 #include "common/sem.h"
 #include "common/limits.h"
@@ -49,6 +50,7 @@
 #include "metricsMgr/metricsMgr.h"
 #include "rest/ConnectionInfo.h"
 #include "rest/httpRequestSend.h"
+#include "rest/httpPool.h"
 #include "rest/rest.h"
 #include "serviceRoutines/versionTreat.h"
 
@@ -223,28 +225,34 @@ static int contentLenParse(char* s)
 
 /* ****************************************************************************
 *
-* httpRequestSendWithCurl -
+* HttpRequestState - what is kept of a request between preparing and completing it
+*/
+struct HttpRequestState
+{
+  struct curl_slist*  headers;
+  MemoryStruct*       httpResponse;
+  std::string         tenant;
+  std::string         servicePath0;
+  std::string         url;
+  unsigned long long  payloadSize;
+};
+
+
+
+/* ****************************************************************************
 *
-* The waitForResponse arguments specifies if the method has to wait for response
-* before return. If this argument is false, the return string is ""
+* httpRequestPrepare -
 *
-* NOTE
-* We are using a hybrid approach, consisting of a static thread-local buffer of a
-* small size that copes with most notifications to avoid expensive
-* calloc/free syscalls if the notification payload is not very large.
+* Checks the request and sets up all the options of the curl handle, so the request is
+* ready to be performed, either synchronously (curl_easy_perform) or by a curl multi
+* handle. What is needed to complete the request is returned in *statePP, to be passed
+* to httpRequestComplete() once the transfer is done.
 *
 * RETURN VALUES
-*   httpRequestSendWithCurl returns 0 on success and a negative number on failure:
-*     -1: Invalid port
-*     -2: Invalid IP
-*     -3: Invalid verb
-*     -4: Invalid resource
-*     -5: No Content-Type BUT content present
-*     -6: Content-Type present but there is no content
-*     -7: Total outgoing message size is too big
-*     -9: Error making HTTP request
+*   The same as httpRequestSendWithCurl, except -9, as no request is sent yet.
+*   In case of error, *statePP is not set and the transaction is ended.
 */
-int httpRequestSendWithCurl
+int httpRequestPrepare
 (
    CURL*                                      curl,
    const std::string&                         _ip,
@@ -264,7 +272,8 @@ int httpRequestSendWithCurl
    std::string*                               outP,
    const std::map<std::string, std::string>&  extraHeaders,
    const std::string&                         acceptFormat,
-   long                                       timeoutInMilliseconds
+   long                                       timeoutInMilliseconds,
+   HttpRequestState**                         statePP
 )
 {
   char                            portAsString[STRING_SIZE_FOR_INT];
@@ -272,7 +281,6 @@ int httpRequestSendWithCurl
   std::string                     ip                 = _ip;
   struct curl_slist*              headers            = NULL;
   MemoryStruct*                   httpResponse       = NULL;
-  CURLcode                        res;
   int                             outgoingMsgSize       = 0;
   std::string                     content_type(orig_content_type);
   std::map<std::string, bool>     usedExtraHeaders;
@@ -591,42 +599,69 @@ int httpRequestSendWithCurl
   //
   LM_I(("Sending message %lu to HTTP server: sending message of %d bytes to HTTP server", callNo, outgoingMsgSize));
 
-  res = curl_easy_perform(curl);
+  HttpRequestState* stateP = new HttpRequestState();
+
+  stateP->headers      = headers;
+  stateP->httpResponse = httpResponse;
+  stateP->tenant       = tenant;
+  stateP->servicePath0 = servicePath0;
+  stateP->url          = url;
+  stateP->payloadSize  = payloadSize;
+
+  *statePP = stateP;
+  return 0;
+}
+
+
+
+/* ****************************************************************************
+*
+* httpRequestComplete -
+*
+* Takes care of the response (or the error) of a request prepared with httpRequestPrepare(),
+* once curl is done with it, and frees the request state.
+*
+* RETURN VALUES
+*   0 on success, -9 if the HTTP request failed.
+*/
+int httpRequestComplete(HttpRequestState* stateP, CURLcode res, std::string* outP)
+{
   if (res != CURLE_OK)
   {
     //
     // NOTE: This log line is used by the functional tests in cases/880_timeout_for_forward_and_notifications/
     //       So, this line should not be removed/altered, at least not without also modifying the functests.
     //
-    alarmMgr.notificationError(url, "(curl_easy_perform failed: " + std::string(curl_easy_strerror(res)) + ")");
+    alarmMgr.notificationError(stateP->url, "(curl_easy_perform failed: " + std::string(curl_easy_strerror(res)) + ")");
     *outP = "notification failure";
 
-    metricsMgr.add(tenant, servicePath0, METRIC_TRANS_OUT_ERRORS, 1);
+    metricsMgr.add(stateP->tenant, stateP->servicePath0, METRIC_TRANS_OUT_ERRORS, 1);
   }
   else
   {
     //
     // The Response is here
     //
-    int   payloadLen  = contentLenParse(httpResponse->memory);
+    int   payloadLen  = contentLenParse(stateP->httpResponse->memory);
 
-    LM_I(("Notification Successfully Sent to %s", url.c_str()));
-    outP->assign(httpResponse->memory, httpResponse->size);
+    LM_I(("Notification Successfully Sent to %s", stateP->url.c_str()));
+    outP->assign(stateP->httpResponse->memory, stateP->httpResponse->size);
 
-    metricsMgr.add(tenant, servicePath0, METRIC_TRANS_OUT_RESP_SIZE, payloadLen);
+    metricsMgr.add(stateP->tenant, stateP->servicePath0, METRIC_TRANS_OUT_RESP_SIZE, payloadLen);
   }
 
-  if (payloadSize > 0)
+  if (stateP->payloadSize > 0)
   {
-    metricsMgr.add(tenant, servicePath0, METRIC_TRANS_OUT_REQ_SIZE, payloadSize);
+    metricsMgr.add(stateP->tenant, stateP->servicePath0, METRIC_TRANS_OUT_REQ_SIZE, stateP->payloadSize);
   }
 
   // Cleanup curl environment
 
-  curl_slist_free_all(headers);
+  curl_slist_free_all(stateP->headers);
 
-  free(httpResponse->memory);
-  delete httpResponse;
+  free(stateP->httpResponse->memory);
+  delete stateP->httpResponse;
+  delete stateP;
 
   lmTransactionEnd();
 
@@ -635,6 +670,86 @@ int httpRequestSendWithCurl
 
 
 
+/* ****************************************************************************
+*
+* httpRequestSendWithCurl -
+*
+* The waitForResponse arguments specifies if the method has to wait for response
+* before return. If this argument is false, the return string is ""
+*
+* NOTE
+* We are using a hybrid approach, consisting of a static thread-local buffer of a
+* small size that copes with most notifications to avoid expensive
+* calloc/free syscalls if the notification payload is not very large.
+*
+* RETURN VALUES
+*   httpRequestSendWithCurl returns 0 on success and a negative number on failure:
+*     -1: Invalid port
+*     -2: Invalid IP
+*     -3: Invalid verb
+*     -4: Invalid resource
+*     -5: No Content-Type BUT content present
+*     -6: Content-Type present but there is no content
+*     -7: Total outgoing message size is too big
+*     -9: Error making HTTP request
+*/
+int httpRequestSendWithCurl
+(
+   CURL*                                      curl,
+   const std::string&                         _ip,
+   unsigned short                             port,
+   const std::string&                         _protocol,
+   const std::string&                         verb,
+   const std::string&                         tenant,
+   const std::string&                         servicePath,
+   const std::string&                         xauthToken,
+   const std::string&                         resource,
+   const std::string&                         orig_content_type,
+   const std::string&                         content,
+   const std::string&                         fiwareCorrelation,
+   const std::string&                         ngisv2AttrFormat,
+   bool                                       useRush,
+   bool                                       waitForResponse,
+   std::string*                               outP,
+   const std::map<std::string, std::string>&  extraHeaders,
+   const std::string&                         acceptFormat,
+   long                                       timeoutInMilliseconds
+)
+{
+  HttpRequestState*  stateP;
+  int                r;
+
+  r = httpRequestPrepare(curl,
+                         _ip,
+                         port,
+                         _protocol,
+                         verb,
+                         tenant,
+                         servicePath,
+                         xauthToken,
+                         resource,
+                         orig_content_type,
+                         content,
+                         fiwareCorrelation,
+                         ngisv2AttrFormat,
+                         useRush,
+                         waitForResponse,
+                         outP,
+                         extraHeaders,
+                         acceptFormat,
+                         timeoutInMilliseconds,
+                         &stateP);
+
+  if (r != 0)
+  {
+    return r;
+  }
+
+  return httpRequestComplete(stateP, curl_easy_perform(curl), outP);
+}
+
+
+
 /* ****************************************************************************
 *
 * httpRequestSend -
@@ -677,8 +792,25 @@ int httpRequestSend
 {
   struct curl_context  cc;
   int                  response;
+  std::string          endpoint;
+
+  //
+  // The connection pool is not used in persistent notification mode, which has its own
+  // connection context per endpoint
+  //
+  bool                 pooled = httpPoolEnabled() && (strcmp(notificationMode, "persistent") != 0);
+
+  if (pooled)
+  {
+    endpoint  = httpPoolEndpoint(protocol, _ip, port);
+    cc.curl   = httpPoolGet(endpoint);
+    cc.pmutex = NULL;
+  }
+  else
+  {
+    get_curl_context(_ip, &cc);
+  }
 
-  get_curl_context(_ip, &cc);
   if (cc.curl == NULL)
   {
     char servicePath0[SERVICE_PATH_MAX_COMPONENT_LEN + 1];  // +1 for zero termination
@@ -688,7 +820,10 @@ int httpRequestSend
     metricsMgr.add(tenant, servicePath0, METRIC_TRANS_OUT,        1);
     metricsMgr.add(tenant, servicePath0, METRIC_TRANS_OUT_ERRORS, 1);
 
-    release_curl_context(&cc);
+    if (!pooled)
+    {
+      release_curl_context(&cc);
+    }
     LM_E(("Runtime Error (could not init libcurl)"));
     lmTransactionEnd();
 
@@ -716,6 +851,14 @@ int httpRequestSend
                                      acceptFormat,
                                      timeoutInMilliseconds);
 
-  release_curl_context(&cc);
+  if (pooled)
+  {
+    httpPoolRelease(endpoint, cc.curl, response == 0);
+  }
+  else
+  {
+    release_curl_context(&cc);
+  }
+
   return response;
 }
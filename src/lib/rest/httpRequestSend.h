@@ -106,4 +106,55 @@ extern int httpRequestSendWithCurl
   long                                       timeoutInMilliseconds = -1
 );
 
+
+
+/* ****************************************************************************
+*
+* HttpRequestState - request prepared by httpRequestPrepare, pending to be completed
+*/
+struct HttpRequestState;
+
+
+
+/* ****************************************************************************
+*
+* httpRequestPrepare -
+*
+* First half of httpRequestSendWithCurl, for requests performed by a curl multi handle.
+* The content must be kept alive until the request is completed.
+*/
+extern int httpRequestPrepare
+(
+  CURL*                                      curl,
+  const std::string&                         ip,
+  unsigned short                             port,
+  const std::string&                         protocol,
+  const std::string&                         verb,
+  const std::string&                         tenant,
+  const std::string&                         servicePath,
+  const std::string&                         xauthToken,
+  const std::string&                         resource,
+  const std::string&                         content_type,
+  const std::string&                         content,
+  const std::string&                         fiwareCorrelation,
+  const std::string&                         ngisv2AttrFormat,
+  bool                                       useRush,
+  bool                                       waitForResponse,
+  std::string*                               outP,
+  const std::map<std::string, std::string>&  extraHeaders,
+  const std::string&                         acceptFormat,
+  long                                       timeoutInMilliseconds,
+  HttpRequestState**                         statePP
+);
+
+
+
+/* ****************************************************************************
+*
+* httpRequestComplete -
+*
+* Second half of httpRequestSendWithCurl, once the transfer is done with result 'res'.
+*/
+extern int httpRequestComplete(HttpRequestState* stateP, CURLcode res, std::string* outP);
+
 #endif  // SRC_LIB_REST_HTTPREQUESTSEND_H_
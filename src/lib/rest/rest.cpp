@@ -44,6 +44,7 @@
 #include "common/clockFunctions.h"
 #include "common/statistics.h"
 #include "common/tag.h"
+#include "common/RequestArena.h"
 
 #include "alarmMgr/alarmMgr.h"
 #include "metricsMgr/metricsMgr.h"
@@ -559,7 +560,19 @@ static int httpHeaderGet(void* cbDataP, MHD_ValueKind kind, const char* ckey, co
 */
 static void serve(ConnectionInfo* ciP)
 {
+  //
+  // The NGSI objects built while serving the request come from its arena, if enabled,
+  // and are freed all at once with the ConnectionInfo, in requestCompleted()
+  //
+  if (requestArenaEnabled())
+  {
+    ciP->arenaP = new RequestArena();
+    requestArenaSet(ciP->arenaP);
+  }
+
   restService(ciP, restServiceV);
+
+  requestArenaSet(NULL);
 }
 
 
@@ -27,6 +27,7 @@
 #include "logMsg/logMsg.h"
 
 #include "common/MimeType.h"
+#include "common/limits.h"
 #include "ngsi/StatusCode.h"
 #include "metricsMgr/metricsMgr.h"
 
@@ -51,6 +52,7 @@
 #include "rest/mhd.h"
 #include "rest/OrionError.h"
 #include "rest/restReply.h"
+#include "rest/ResponseStream.h"
 
 #include "logMsg/traceLevels.h"
 
@@ -58,31 +60,168 @@
 
 static int replyIx = 0;
 
+
+
 /* ****************************************************************************
 *
-* restReply -
+* StreamReply - state of a streamed response, owned by MHD once the response is created
 */
-void restReply(ConnectionInfo* ciP, const std::string& answer)
+typedef struct StreamReply
+{
+  ResponseStream*  streamP;
+  std::string      chunk;      // piece of the payload being sent
+  size_t           offset;     // bytes of 'chunk' already sent
+  uint64_t         size;       // bytes sent so far
+  std::string      tenant;
+  std::string      servicePath;
+} StreamReply;
+
+
+
+/* ****************************************************************************
+*
+* streamReplyRead - MHD_ContentReaderCallback for streamed responses
+*
+* Fills the buffer of MHD with as many pieces of the payload as fit in it, rendering
+* the next piece only when the previous one has been completely sent.
+*/
+static ssize_t streamReplyRead(void* cls, uint64_t pos, char* buf, size_t max)
+{
+  StreamReply*  srP  = (StreamReply*) cls;
+  size_t        len  = 0;
+
+  while (len < max)
+  {
+    if (srP->offset == srP->chunk.length())
+    {
+      srP->chunk.clear();
+      srP->offset = 0;
+
+      if ((srP->streamP == NULL) || (srP->streamP->next(&srP->chunk) == false))
+      {
+        delete srP->streamP;
+        srP->streamP = NULL;
+        break;
+      }
+
+      continue;
+    }
+
+    size_t n = srP->chunk.length() - srP->offset;
+
+    if (n > max - len)
+    {
+      n = max - len;
+    }
+
+    memcpy(buf + len, srP->chunk.c_str() + srP->offset, n);
+    srP->offset += n;
+    len         += n;
+  }
+
+  if (len == 0)
+  {
+    return MHD_CONTENT_READER_END_OF_STREAM;
+  }
+
+  srP->size += len;
+
+  return len;
+}
+
+
+
+/* ****************************************************************************
+*
+* streamReplyFree - MHD_ContentReaderFreeCallback for streamed responses
+*/
+static void streamReplyFree(void* cls)
+{
+  StreamReply* srP = (StreamReply*) cls;
+
+  if (srP->size > 0)
+  {
+    metricsMgr.add(srP->tenant, srP->servicePath, METRIC_TRANS_IN_RESP_SIZE, srP->size);
+  }
+
+  LM_T(LmtServiceOutPayload, ("Streamed response: %lu bytes", (unsigned long) srP->size));
+
+  delete srP->streamP;
+  delete srP;
+}
+
+
+
+/* ****************************************************************************
+*
+* responseCreate -
+*
+* If the service routine left a ResponseStream in ciP, the response is streamed to the
+* client (chunked transfer encoding, as the length is not known in advance) and 'answer'
+* is ignored. Otherwise, 'answer' is the payload.
+*/
+static MHD_Response* responseCreate(ConnectionInfo* ciP, const std::string& answer, const std::string& spath)
 {
   MHD_Response*  response;
   uint64_t       answerLen = answer.length();
-  std::string    spath     = (ciP->servicePathV.size() > 0)? ciP->servicePathV[0] : "";
 
-  ++replyIx;
+  if (ciP->responseStreamP != NULL)
+  {
+    StreamReply* srP = new StreamReply();
+
+    srP->streamP     = ciP->responseStreamP;
+    srP->offset      = 0;
+    srP->size        = 0;
+    srP->tenant      = ciP->httpHeaders.tenant;
+    srP->servicePath = spath;
+
+    ciP->responseStreamP = NULL;
+
+    LM_T(LmtServiceOutPayload, ("Response %d: streaming response, Status Code %d", replyIx, ciP->httpStatusCode));
+
+    response = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN, STREAM_RESPONSE_BLOCK_SIZE, streamReplyRead, srP, streamReplyFree);
+    if (!response)
+    {
+      delete srP->streamP;
+      delete srP;
+    }
+
+    return response;
+  }
+
   LM_T(LmtServiceOutPayload, ("Response %d: responding with %d bytes, Status Code %d", replyIx, answerLen, ciP->httpStatusCode));
   LM_T(LmtServiceOutPayload, ("Response payload: '%s'", answer.c_str()));
 
   response = MHD_create_response_from_buffer(answerLen, (void*) answer.c_str(), MHD_RESPMEM_MUST_COPY);
-  if (!response)
+
+  if ((response != NULL) && (answerLen > 0))
   {
-    metricsMgr.add(ciP->httpHeaders.tenant, spath, METRIC_TRANS_IN_ERRORS, 1);
-    LM_E(("Runtime Error (MHD_create_response_from_buffer FAILED)"));
-    return;
+    metricsMgr.add(ciP->httpHeaders.tenant, spath, METRIC_TRANS_IN_RESP_SIZE, answerLen);
   }
 
-  if (answerLen > 0)
+  return response;
+}
+
+
+
+/* ****************************************************************************
+*
+* restReply -
+*/
+void restReply(ConnectionInfo* ciP, const std::string& answer)
+{
+  MHD_Response*  response;
+  bool           stream    = (ciP->responseStreamP != NULL);
+  std::string    spath     = (ciP->servicePathV.size() > 0)? ciP->servicePathV[0] : "";
+
+  ++replyIx;
+
+  response = responseCreate(ciP, answer, spath);
+  if (!response)
   {
-    metricsMgr.add(ciP->httpHeaders.tenant, spath, METRIC_TRANS_IN_RESP_SIZE, answerLen);
+    metricsMgr.add(ciP->httpHeaders.tenant, spath, METRIC_TRANS_IN_ERRORS, 1);
+    LM_E(("Runtime Error (MHD_create_response FAILED)"));
+    return;
   }
 
   for (unsigned int hIx = 0; hIx < ciP->httpHeader.size(); ++hIx)
@@ -90,7 +229,7 @@ void restReply(ConnectionInfo* ciP, const std::string& answer)
     MHD_add_response_header(response, ciP->httpHeader[hIx].c_str(), ciP->httpHeaderValue[hIx].c_str());
   }
 
-  if (answer != "")
+  if ((answer != "") || (stream == true))
   {
     if (ciP->outMimeType == JSON)
     {
@@ -36,6 +36,7 @@
 #define URI_PARAM_PAGINATION_OFFSET       "offset"
 #define URI_PARAM_PAGINATION_LIMIT        "limit"
 #define URI_PARAM_PAGINATION_DETAILS      "details"
+#define URI_PARAM_PAGINATION_CURSOR       "cursor"
 #define URI_PARAM_COLLAPSE                "collapse"
 #define URI_PARAM_ENTITY_TYPE             SCOPE_VALUE_ENTITY_TYPE
 #define URI_PARAM_NOT_EXIST               "!exist"
@@ -41,6 +41,7 @@
 #include "orionTypes/QueryContextResponseVector.h"
 #include "rest/ConnectionInfo.h"
 #include "rest/httpRequestSend.h"
+#include "rest/httpRequestFanOut.h"
 #include "rest/uriParamNames.h"
 #include "rest/OrionError.h"
 #include "serviceRoutines/postQueryContext.h"
@@ -61,21 +62,26 @@ static char* jsonPayloadClean(const char* payload)
 
 /* ****************************************************************************
 *
-* queryForward -
+* queryForwardPrepare -
 *
 * An entity/attribute has been found on some context provider.
-* We need to forward the query request to the context provider, indicated in qcrsP->contextProvider
+* We need to forward the query request to the context provider, indicated in qcrP->contextProvider
 *
 * 1. Parse the providing application to extract IP, port and URI-path
-* 2. Render the string of the request we want to forward
-* 3. Send the request to the providing application (and await the response)
-* 4. Parse the response and fill in a binary QueryContextResponse
-* 5. Fill in the response from the redirection into the response of this function
-* 6. 'Fix' StatusCode
-* 7. Freeing memory
+* 2. Render the string of the request we want to forward and fill in the request to be sent
 *
+* The request is sent later on, together with the rest of forwards of the query (see
+* httpRequestFanOut), and its response is processed by queryForwardResponse().
+*
+* If the providing application is invalid, the error is set in qcrsP and false is returned.
 */
-static void queryForward(ConnectionInfo* ciP, QueryContextRequest* qcrP, QueryContextResponse* qcrsP)
+static bool queryForwardPrepare
+(
+  ConnectionInfo*        ciP,
+  QueryContextRequest*   qcrP,
+  QueryContextResponse*  qcrsP,
+  HttpFanOutRequest*     reqP
+)
 {
   std::string     ip;
   std::string     protocol;
@@ -96,59 +102,60 @@ static void queryForward(ConnectionInfo* ciP, QueryContextRequest* qcrP, QueryCo
     //  SccBadRequest should have been returned before, when it was registered!
     //
     qcrsP->errorCode.fill(SccContextElementNotFound, "");
-    return;
+    return false;
   }
 
 
   //
   // 2. Render the string of the request we want to forward
+  // FIXME P7: Should Rush be used?
   //
-  std::string  payload;
-  TIMED_RENDER(payload = qcrP->render(""));
+  TIMED_RENDER(reqP->content = qcrP->render(""));
+
+  reqP->ip          = ip;
+  reqP->port        = port;
+  reqP->protocol    = protocol;
+  reqP->tenant      = ciP->tenant;
+  reqP->servicePath = (ciP->httpHeaders.servicePathReceived == true)? ciP->httpHeaders.servicePath : "";
+  reqP->xauthToken  = ciP->httpHeaders.xauthToken;
+  reqP->resource    = prefix + "/queryContext";
+  reqP->mimeType    = "application/json";
+  reqP->correlator  = ciP->httpHeaders.correlator;
+  reqP->r           = 0;
+
+  LM_T(LmtCPrForwardRequestPayload, ("forward queryContext request payload: %s", reqP->content.c_str()));
+
+  return true;
+}
 
-  char* cleanPayload = (char*) payload.c_str();;
 
+
+/* ****************************************************************************
+*
+* queryForwardResponse -
+*
+* 3. Check the result of sending the request to the providing application
+* 4. Parse the response and fill in a binary QueryContextResponse
+* 5. Fill in the response from the redirection into the response of this function
+* 6. 'Fix' StatusCode
+* 7. Freeing memory
+*
+* Parsing uses ciP, so the responses of the forwards are processed one by one, in the
+* thread of the client request.
+*/
+static void queryForwardResponse(ConnectionInfo* ciP, HttpFanOutRequest* reqP, QueryContextResponse* qcrsP)
+{
   //
-  // 3. Send the request to the Context Provider (and await the reply)
-  // FIXME P7: Should Rush be used?
+  // 3. Check the result of sending the request to the Context Provider
   //
-  std::string     verb         = "POST";
-  std::string     resource     = prefix + "/queryContext";
-  std::string     tenant       = ciP->tenant;
-  std::string     servicePath  = (ciP->httpHeaders.servicePathReceived == true)? ciP->httpHeaders.servicePath : "";
-  std::string     mimeType     = "application/json";
-  std::string     out;
-  int             r;
-
-  LM_T(LmtCPrForwardRequestPayload, ("forward queryContext request payload: %s", payload.c_str()));
-
-  std::map<std::string, std::string> noHeaders;
-  r = httpRequestSend(ip,
-                      port,
-                      protocol,
-                      verb,
-                      tenant,
-                      servicePath,
-                      ciP->httpHeaders.xauthToken,
-                      resource,
-                      mimeType,
-                      payload,
-                      ciP->httpHeaders.correlator,
-                      "",
-                      false,
-                      true,
-                      &out,
-                      noHeaders,
-                      mimeType);
-
-  if (r != 0)
+  if (reqP->r != 0)
   {
     qcrsP->errorCode.fill(SccContextElementNotFound, "error forwarding query");
     LM_W(("Runtime Error (error forwarding 'Query' to providing application)"));
     return;
   }
 
-  LM_T(LmtCPrForwardRequestPayload, ("forward queryContext response payload: %s", out.c_str()));
+  LM_T(LmtCPrForwardRequestPayload, ("forward queryContext response payload: %s", reqP->out.c_str()));
 
 
   //
@@ -156,9 +163,9 @@ static void queryForward(ConnectionInfo* ciP, QueryContextRequest* qcrP, QueryCo
   //
   std::string  s;
   std::string  errorMsg;
+  char*        cleanPayload;
 
-
-  cleanPayload = jsonPayloadClean(out.c_str());
+  cleanPayload = jsonPayloadClean(reqP->out.c_str());
 
   if ((cleanPayload == NULL) || (cleanPayload[0] == 0))
   {
@@ -286,6 +293,8 @@ std::string postQueryContext
   QueryContextResponseVector  responseV;
   long long                   count = 0;
   long long*                  countP = NULL;
+  std::string                 nextCursor;
+  std::string*                nextCursorP = NULL;
 
   bool asJsonObject = (ciP->uriParam[URI_PARAM_ATTRIBUTE_FORMAT] == "object" && ciP->outMimeType == JSON);
 
@@ -307,6 +316,16 @@ std::string postQueryContext
     countP = &count;
   }
 
+  //
+  // Pagination with cursor (only API version 2): asked for with options=cursor in the first page and
+  // with the URI param 'cursor' (taken from the Fiware-Next-Cursor HTTP header of the previous page)
+  // in the following ones
+  //
+  if ((ciP->apiVersion == V2) && (ciP->uriParamOptions[OPT_CURSOR] || (ciP->uriParam[URI_PARAM_PAGINATION_CURSOR] != "")))
+  {
+    nextCursorP = &nextCursor;
+  }
+
 
 
   //
@@ -321,7 +340,8 @@ std::string postQueryContext
                                                       ciP->uriParam,
                                                       ciP->uriParamOptions,
                                                       countP,
-                                                      ciP->apiVersion));
+                                                      ciP->apiVersion,
+                                                      nextCursorP));
 
   if (qcrsP->errorCode.code == SccBadRequest)
   {
@@ -346,6 +366,15 @@ std::string postQueryContext
     ciP->httpHeaderValue.push_back(cV);
   }
 
+  //
+  // If paginating with cursor and there are more pages, add the cursor to the next one in HTTP header Fiware-Next-Cursor
+  //
+  if ((nextCursorP != NULL) && (nextCursor != ""))
+  {
+    ciP->httpHeader.push_back("Fiware-Next-Cursor");
+    ciP->httpHeaderValue.push_back(nextCursor);
+  }
+
 
 
   //
@@ -486,15 +515,15 @@ std::string postQueryContext
   }
 
   //
-  // Now, forward the Query requests, each in a separate thread (to be implemented) and
-  // await all the responses.
-  // Actually, if there is only ONE forward to be done then there is no reason to
-  // do the forward in a separate shell. Better to do it inside the current thread.
+  // Now, forward the Query requests (at most cprForwardLimit of them), all of them at the
+  // same time, and await all the responses (or the -cprForwardDeadline).
+  // The responses are then processed in the order of the requests.
   //
   // If providingApplication is empty then that part of the query has been performed already, locally.
   //
-  //
-  QueryContextResponse* qP;
+  std::vector<HttpFanOutRequest*>     fanOutV;
+  std::vector<QueryContextResponse*>  fanOutResponseV;
+  QueryContextResponse*               qP;
 
   for (unsigned int fIx = 0; fIx < requestV.size() && fIx < cprForwardLimit; ++fIx)
   {
@@ -506,7 +535,18 @@ std::string postQueryContext
 
     qP = new QueryContextResponse();
     qP->errorCode.fill(SccOk);
-    queryForward(ciP, requestV[fIx], qP);
+
+    HttpFanOutRequest* reqP = new HttpFanOutRequest();
+
+    if (queryForwardPrepare(ciP, requestV[fIx], qP, reqP))
+    {
+      fanOutV.push_back(reqP);
+      fanOutResponseV.push_back(qP);
+    }
+    else
+    {
+      delete reqP;
+    }
 
     //
     // Now, each ContextElementResponse of qP should be tested to see whether there
@@ -514,6 +554,17 @@ std::string postQueryContext
     responseV.push_back(qP);
   }
 
+  if (fanOutV.size() != 0)
+  {
+    httpRequestFanOut(fanOutV, cprForwardDeadline);
+  }
+
+  for (unsigned int fIx = 0; fIx < fanOutV.size(); ++fIx)
+  {
+    queryForwardResponse(ciP, fanOutV[fIx], fanOutResponseV[fIx]);
+    delete fanOutV[fIx];
+  }
+
   std::string detailsString  = ciP->uriParam[URI_PARAM_PAGINATION_DETAILS];
   bool        details        = (strcasecmp("on", detailsString.c_str()) == 0)? true : false;
 
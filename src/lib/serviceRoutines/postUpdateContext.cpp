@@ -43,6 +43,7 @@
 #include "orionTypes/UpdateContextRequestVector.h"
 #include "rest/ConnectionInfo.h"
 #include "rest/httpRequestSend.h"
+#include "rest/httpRequestFanOut.h"
 #include "rest/uriParamNames.h"
 #include "serviceRoutines/postUpdateContext.h"
 
@@ -87,21 +88,26 @@ static bool forwardsPending(UpdateContextResponse* upcrsP)
 
 /* ****************************************************************************
 *
-* updateForward -
+* updateForwardPrepare -
 *
 * An entity/attribute has been found on some context provider.
-* We need to forward the update request to the context provider, indicated in upcrsP->contextProvider
+* We need to forward the update request to the context provider, indicated in upcrP->contextProvider
 *
 * 1. Parse the providing application to extract IP, port and URI-path
-* 2. Render the string of the request we want to forward
-* 3. Send the request to the providing application (and await the response)
-* 4. Parse the response and fill in a binary UpdateContextResponse
-* 5. Fill in the response from the redirection into the response of this function
-* 6. 'Fix' StatusCode
-* 7. Freeing memory
+* 2. Render the string of the request we want to forward and fill in the request to be sent
+*
+* The request is sent later on, together with the rest of forwards of the update (see
+* httpRequestFanOut), and its response is processed by updateForwardResponse().
 *
+* If the providing application is invalid, the error is set in upcrsP and false is returned.
 */
-static void updateForward(ConnectionInfo* ciP, UpdateContextRequest* upcrP, UpdateContextResponse* upcrsP)
+static bool updateForwardPrepare
+(
+  ConnectionInfo*         ciP,
+  UpdateContextRequest*   upcrP,
+  UpdateContextResponse*  upcrsP,
+  HttpFanOutRequest*      reqP
+)
 {
   std::string      ip;
   std::string      protocol;
@@ -124,65 +130,66 @@ static void updateForward(ConnectionInfo* ciP, UpdateContextRequest* upcrP, Upda
     //  SccBadRequest should have been returned before, when it was registered!
     //
     upcrsP->errorCode.fill(SccContextElementNotFound, "");
-    return;
+    return false;
   }
 
 
   //
   // 2. Render the string of the request we want to forward
+  // FIXME P7: Should Rush be used?
   //
   MimeType     outMimeType = ciP->outMimeType;
-  std::string  payload;
-  char*        cleanPayload;
 
   ciP->outMimeType  = JSON;
 
-  TIMED_RENDER(payload = upcrP->render(ciP->apiVersion, asJsonObject, ""));
+  TIMED_RENDER(reqP->content = upcrP->render(ciP->apiVersion, asJsonObject, ""));
 
   ciP->outMimeType  = outMimeType;
-  cleanPayload      = (char*) payload.c_str();
 
+  reqP->ip          = ip;
+  reqP->port        = port;
+  reqP->protocol    = protocol;
+  reqP->tenant      = ciP->tenant;
+  reqP->servicePath = (ciP->httpHeaders.servicePathReceived == true)? ciP->httpHeaders.servicePath : "";
+  reqP->xauthToken  = ciP->httpHeaders.xauthToken;
+  reqP->resource    = prefix + "/updateContext";
+  reqP->mimeType    = "application/json";
+  reqP->correlator  = ciP->httpHeaders.correlator;
+  reqP->r           = 0;
+
+  LM_T(LmtCPrForwardRequestPayload, ("forward updateContext request payload: %s", reqP->content.c_str()));
+
+  return true;
+}
+
+
+
+/* ****************************************************************************
+*
+* updateForwardResponse -
+*
+* 3. Check the result of sending the request to the providing application
+* 4. Parse the response and fill in a binary UpdateContextResponse
+* 5. Fill in the response from the redirection into the response of this function
+* 6. 'Fix' StatusCode
+* 7. Freeing memory
+*
+* Parsing uses ciP, so the responses of the forwards are processed one by one, in the
+* thread of the client request.
+*/
+static void updateForwardResponse(ConnectionInfo* ciP, HttpFanOutRequest* reqP, UpdateContextResponse* upcrsP)
+{
   //
-  // 3. Send the request to the Context Provider (and await the reply)
-  // FIXME P7: Should Rush be used?
+  // 3. Check the result of sending the request to the Context Provider
   //
-  std::string     verb         = "POST";
-  std::string     resource     = prefix + "/updateContext";
-  std::string     tenant       = ciP->tenant;
-  std::string     servicePath  = (ciP->httpHeaders.servicePathReceived == true)? ciP->httpHeaders.servicePath : "";
-  std::string     mimeType     = "application/json";
-  std::string     out;
-  int             r;
-
-  LM_T(LmtCPrForwardRequestPayload, ("forward updateContext request payload: %s", payload.c_str()));
-
-  std::map<std::string, std::string> noHeaders;
-  r = httpRequestSend(ip,
-                      port,
-                      protocol,
-                      verb,
-                      tenant,
-                      servicePath,
-                      ciP->httpHeaders.xauthToken,
-                      resource,
-                      mimeType,
-                      cleanPayload,
-                      ciP->httpHeaders.correlator,
-                      "",
-                      false,
-                      true,
-                      &out,
-                      noHeaders,
-                      mimeType);
-
-  if (r != 0)
+  if (reqP->r != 0)
   {
     upcrsP->errorCode.fill(SccContextElementNotFound, "error forwarding update");
     LM_E(("Runtime Error (error forwarding 'Update' to providing application)"));
     return;
   }
 
-  LM_T(LmtCPrForwardRequestPayload, ("forward updateContext response payload: %s", out.c_str()));
+  LM_T(LmtCPrForwardRequestPayload, ("forward updateContext response payload: %s", reqP->out.c_str()));
 
 
   //
@@ -190,8 +197,9 @@ static void updateForward(ConnectionInfo* ciP, UpdateContextRequest* upcrP, Upda
   //
   std::string  s;
   std::string  errorMsg;
+  char*        cleanPayload;
 
-  cleanPayload = jsonPayloadClean(out.c_str());
+  cleanPayload = jsonPayloadClean(reqP->out.c_str());
 
   if ((cleanPayload == NULL) || (cleanPayload[0] == 0))
   {
@@ -643,9 +651,12 @@ std::string postUpdateContext
 
 
   //
-  // Calling each of the Context Providers, merging their results into the
-  // total response 'response'
+  // Calling all the Context Providers (at most cprForwardLimit of them) at the same time,
+  // and merging their results into the total response 'response', in the order of the requests
   //
+  std::vector<HttpFanOutRequest*>      fanOutV;
+  std::vector<HttpFanOutRequest*>      forwardV;    // parallel to upcrsV, NULL if not sent
+  std::vector<UpdateContextResponse*>  upcrsV;
 
   for (unsigned int ix = 0; ix < requestV.size() && ix < cprForwardLimit; ++ix)
   {
@@ -655,14 +666,41 @@ std::string postUpdateContext
       continue;
     }
 
-    UpdateContextResponse upcrs;
+    UpdateContextResponse*  upcrsP = new UpdateContextResponse();
+    HttpFanOutRequest*      reqP   = new HttpFanOutRequest();
 
-    updateForward(ciP, requestV[ix], &upcrs);
+    if (updateForwardPrepare(ciP, requestV[ix], upcrsP, reqP))
+    {
+      fanOutV.push_back(reqP);
+    }
+    else
+    {
+      delete reqP;
+      reqP = NULL;
+    }
+
+    forwardV.push_back(reqP);
+    upcrsV.push_back(upcrsP);
+  }
+
+  if (fanOutV.size() != 0)
+  {
+    httpRequestFanOut(fanOutV, cprForwardDeadline);
+  }
+
+  for (unsigned int ix = 0; ix < upcrsV.size(); ++ix)
+  {
+    if (forwardV[ix] != NULL)
+    {
+      updateForwardResponse(ciP, forwardV[ix], upcrsV[ix]);
+      delete forwardV[ix];
+    }
 
     //
     // Add the result from the forwarded update to the total response in 'response'
     //
-    response.merge(&upcrs);
+    response.merge(upcrsV[ix]);
+    delete upcrsV[ix];
   }
 
   // Note this is a slight break in the separation of concerns among the different layers (i.e.
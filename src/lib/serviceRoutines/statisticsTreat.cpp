@@ -24,6 +24,7 @@
 */
 #include <string>
 #include <vector>
+#include <map>
 
 #include "logMsg/logMsg.h"
 #include "logMsg/traceLevels.h"
@@ -33,14 +34,18 @@
 #include "common/tag.h"
 #include "common/statistics.h"
 #include "common/sem.h"
+#include "common/regexCache.h"
+#include "common/RequestArena.h"
 #include "metricsMgr/metricsMgr.h"
 #include "ngsi/ParseData.h"
 #include "rest/ConnectionInfo.h"
 #include "rest/rest.h"
+#include "rest/httpPool.h"
 #include "serviceRoutines/statisticsTreat.h"
 #include "mongoBackend/mongoConnectionPool.h"
 #include "cache/subCache.h"
 #include "ngsiNotify/QueueStatistics.h"
+#include "ngsiNotify/FairNotifQueue.h"
 #include "common/JsonHelper.h"
 
 
@@ -55,6 +60,17 @@
 
 
 
+/* ****************************************************************************
+*
+* logAsyncOverflowsAtReset - lines lost by the asynchronous log before the last reset
+*
+* The counter in logMsg is never reset, as the log writer uses it to report the lines
+* lost since its previous report.
+*/
+static unsigned long long logAsyncOverflowsAtReset = 0;
+
+
+
 /* ****************************************************************************
 *
 * resetStatistics -
@@ -130,8 +146,14 @@ static void resetStatistics(void)
   noOfSimulatedNotifications                      = -1;
   noOfBatchQueryRequest                           = -1;
   noOfBatchUpdateRequest                          = -1;
+  noOfSubCacheFlushedDocs                         = -1;
+  logAsyncOverflowsAtReset                        = lmAsyncOverflowsGet();
 
   QueueStatistics::reset();
+  fairQueueStatisticsReset();
+  httpPoolStatisticsReset();
+  regexCacheStatisticsReset();
+  requestArenaStatisticsReset();
 
   semTimeReqReset();
   semTimeTransReset();
@@ -210,6 +232,14 @@ std::string renderCounterStats(void)
   renderUsedCounter(&js, "entityByIdAttributeByNameIdAndType",        noOfEntityByIdAttributeByNameIdAndType);
   renderUsedCounter(&js, "batchQueryRequests",                        noOfBatchQueryRequest);
   renderUsedCounter(&js, "batchUpdateRequests",                       noOfBatchUpdateRequest);
+  renderUsedCounter(&js, "subCacheFlushedDocs",                       noOfSubCacheFlushedDocs);
+
+  unsigned long long logAsyncOverflows = lmAsyncOverflowsGet() - logAsyncOverflowsAtReset;
+  if (logAsyncOverflows > 0)
+  {
+    js.addNumber("logAsyncOverflows", logAsyncOverflows);
+  }
+
   renderUsedCounter(&js, "logTraceRequests",                          noOfLogTraceRequests);
   renderUsedCounter(&js, "logLevelRequests",                          noOfLogLevelRequests);
 
@@ -245,6 +275,13 @@ std::string renderSemWaitStats(void)
   JsonHelper jh;
 
   jh.addFloat("request",           semTimeReqGet());
+
+  if (reqSemPolicyGet() == SemSharedOp)
+  {
+    jh.addFloat("requestShared",     semTimeReqSharedGet());
+    jh.addFloat("requestExclusive",  semTimeReqExclusiveGet());
+  }
+
   jh.addFloat("dbConnectionPool",  mongoPoolConnectionSemWaitingTimeGet());
   jh.addFloat("transaction",       semTimeTransGet());
   jh.addFloat("subCache",          semTimeCacheGet());
@@ -257,6 +294,34 @@ std::string renderSemWaitStats(void)
 
 
 
+/* ****************************************************************************
+*
+* renderNotifDestStats - per destination statistics of the fair notification queue
+*/
+static std::string renderNotifDestStats(const std::map<std::string, NotifDestStats>& destStats)
+{
+  JsonHelper jh;
+
+  for (std::map<std::string, NotifDestStats>::const_iterator it = destStats.begin(); it != destStats.end(); ++it)
+  {
+    JsonHelper  destJh;
+    float       timeInQ = it->second.timeInQ.tv_sec + ((float) it->second.timeInQ.tv_nsec) / 1E9;
+
+    destJh.addNumber("in",             it->second.in);
+    destJh.addNumber("out",            it->second.out);
+    destJh.addNumber("reject",         it->second.reject);
+    destJh.addFloat ("timeInQueue",    timeInQ);
+    destJh.addFloat ("avgTimeInQueue", it->second.out == 0 ? 0 : (timeInQ / it->second.out));
+    destJh.addNumber("size",           it->second.size);
+
+    jh.addRaw(it->first, destJh.str());
+  }
+
+  return jh.str();
+}
+
+
+
 /* ****************************************************************************
 *
 * renderNotifQueueStats -
@@ -276,6 +341,92 @@ std::string renderNotifQueueStats(void)
   jh.addFloat ("avgTimeInQueue", out==0 ? 0 : (timeInQ/out));
   jh.addNumber("size",           QueueStatistics::getQSize());
 
+  if (strcmp(notificationMode, "async") == 0)
+  {
+    jh.addNumber("inFlight",     QueueStatistics::getInFlight());
+  }
+
+  std::map<std::string, NotifDestStats> destStats;
+
+  fairQueueStatisticsGet(&destStats);
+  if (!destStats.empty())
+  {
+    jh.addRaw("destinations", renderNotifDestStats(destStats));
+  }
+
+  return jh.str();
+}
+
+
+
+/* ****************************************************************************
+*
+* renderHttpPoolStats -
+*/
+std::string renderHttpPoolStats(void)
+{
+  JsonHelper jh;
+  int        hits;
+  int        misses;
+  int        evictions;
+  int        idle;
+
+  httpPoolStatisticsGet(&hits, &misses, &evictions, &idle);
+
+  jh.addNumber("hits",      hits);
+  jh.addNumber("misses",    misses);
+  jh.addNumber("evictions", evictions);
+  jh.addNumber("idle",      idle);
+
+  return jh.str();
+}
+
+
+
+/* ****************************************************************************
+*
+* renderRegexCacheStats -
+*/
+std::string renderRegexCacheStats(void)
+{
+  JsonHelper jh;
+  int        hits;
+  int        misses;
+  int        evictions;
+  int        size;
+
+  regexCacheStatisticsGet(&hits, &misses, &evictions, &size);
+
+  jh.addNumber("hits",      hits);
+  jh.addNumber("misses",    misses);
+  jh.addFloat("hitRate",    (hits + misses == 0)? 0 : (float) hits / (hits + misses));
+  jh.addNumber("evictions", evictions);
+  jh.addNumber("size",      size);
+
+  return jh.str();
+}
+
+
+
+/* ****************************************************************************
+*
+* renderReqArenaStats -
+*/
+std::string renderReqArenaStats(void)
+{
+  JsonHelper jh;
+  long long  arenaAllocs;
+  long long  heapAllocs;
+  long long  arenas;
+  long long  peakSize;
+
+  requestArenaStatisticsGet(&arenaAllocs, &heapAllocs, &arenas, &peakSize);
+
+  jh.addNumber("arenaAllocs", arenaAllocs);
+  jh.addNumber("heapAllocs",  heapAllocs);
+  jh.addNumber("arenas",      arenas);
+  jh.addNumber("peakSize",    peakSize);
+
   return jh.str();
 }
 
@@ -317,10 +468,22 @@ std::string statisticsTreat
   {
     js.addRaw("timing", renderTimingStatistics());
   }
-  if ((notifQueueStatistics) && (strcmp(notificationMode, "threadpool") == 0))
+  if ((notifQueueStatistics) && ((strcmp(notificationMode, "threadpool") == 0) || (strcmp(notificationMode, "async") == 0)))
   {
     js.addRaw("notifQueue", renderNotifQueueStats());
   }
+  if ((httpPoolStatistics) && (httpPoolEnabled()))
+  {
+    js.addRaw("httpPool", renderHttpPoolStats());
+  }
+  if (regexCacheStatistics)
+  {
+    js.addRaw("regexCache", renderRegexCacheStats());
+  }
+  if (reqArenaStatistics)
+  {
+    js.addRaw("reqArena", renderReqArenaStats());
+  }
 
   // Unconditional stats
   int now = getCurrentTime();
@@ -28,6 +28,8 @@
 #include "common/statistics.h"
 #include "common/clockFunctions.h"
 #include "common/string.h"
+#include "common/limits.h"
+#include "common/RequestArena.h"
 
 #include "rest/ConnectionInfo.h"
 #include "rest/OrionError.h"
@@ -67,7 +69,7 @@
 *
 * 01. Fill in QueryContextRequest
 * 02. Call standard op postQueryContext
-* 03. Render Entities response
+* 03. Render Entities response (or stream it, if it is big)
 * 04. Cleanup and return result
 */
 std::string getEntities
@@ -311,13 +313,44 @@ std::string getEntities
   }
   else
   {
+    //
+    // The entities of a streamed response outlive the request, and so its arena (see
+    // EntitiesStream), so they are allocated from the heap
+    //
+    bool           stream = (parseDataP->qcrs.res.contextElementResponseVector.size() >= STREAM_RESPONSE_MIN_ENTITIES);
+    RequestArena*  arenaP = requestArenaGet();
+
+    if (stream)
+    {
+      requestArenaSet(NULL);
+    }
+
     entities.fill(&parseDataP->qcrs.res);
+    requestArenaSet(arenaP);
 
     if (entities.oe.code != SccNone)
     {
       TIMED_RENDER(answer = entities.oe.toJson());
       ciP->httpStatusCode = entities.oe.code;
     }
+    else if (stream)
+    {
+      //
+      // Big lists of entities are rendered while they are sent (see restReply), so they are
+      // never completely rendered in memory. The context elements they were filled from
+      // are not needed any longer.
+      //
+      // The stream takes the entities over (leaving 'entities' empty). It belongs to ciP
+      // until restReply hands it to the MHD response, which deletes it once the response
+      // has been sent or the connection closed, possibly after the request (and its arena)
+      // is gone.
+      //
+      parseDataP->qcrs.res.release();
+
+      ciP->responseStreamP = new EntitiesStream(&entities, ciP->uriParamOptions, ciP->uriParam);
+      ciP->httpStatusCode  = SccOk;
+      answer               = "";
+    }
     else
     {
       TIMED_RENDER(answer = entities.render(ciP->uriParamOptions, ciP->uriParam));
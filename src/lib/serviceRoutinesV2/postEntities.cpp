@@ -25,14 +25,19 @@
 #include <string>
 #include <vector>
 
+#include "common/globals.h"
+#include "common/string.h"
+#include "common/defaultValues.h"
 #include "common/statistics.h"
 #include "common/clockFunctions.h"
 
 #include "rest/ConnectionInfo.h"
+#include "rest/uriParamNames.h"
 #include "ngsi/ParseData.h"
 #include "apiTypesV2/Entities.h"
 #include "rest/EntityTypeInfo.h"
 #include "rest/OrionError.h"
+#include "mongoBackend/mongoCreateEntity.h"
 #include "serviceRoutinesV2/postEntities.h"
 #include "serviceRoutines/postUpdateContext.h"
 
@@ -54,6 +59,56 @@ static bool legalEntityLength(Entity* eP, const std::string& servicePath)
 
 
 
+/* ****************************************************************************
+*
+* createFastPath -
+*
+* Whether the entity can be created with mongoCreateEntity(), straight from the parsed
+* entity. Otherwise (e.g. several service paths, an invalid one), it goes through
+* postUpdateContext(), in charge of the errors of those cases.
+*
+* As in postUpdateContext(), an empty service path means the default one.
+*/
+static bool createFastPath(ConnectionInfo* ciP)
+{
+  if ((noCreateFastPath == true) || (ciP->servicePathV.size() != 1) || (ciP->uriParam[URI_PARAM_NOT_EXIST] != ""))
+  {
+    return false;
+  }
+
+  if (ciP->servicePathV[0] == "")
+  {
+    ciP->servicePathV[0] = DEFAULT_SERVICE_PATH_UPDATES;
+  }
+
+  return (servicePathCheck(ciP->servicePathV[0].c_str()) == "OK");
+}
+
+
+
+/* ****************************************************************************
+*
+* locationHeaderAdd -
+*/
+static void locationHeaderAdd(ConnectionInfo* ciP, Entity* eP)
+{
+  std::string location = "/v2/entities/" + eP->id;
+
+  if (eP->type != "" )
+  {
+    location += "?type=" + eP->type;
+  }
+  else
+  {
+    location += "?type=none";
+  }
+
+  ciP->httpHeader.push_back("Location");
+  ciP->httpHeaderValue.push_back(location);
+}
+
+
+
 /* ****************************************************************************
 *
 * postEntities - 
@@ -66,10 +121,11 @@ static bool legalEntityLength(Entity* eP, const std::string& servicePath)
 * URI parameters:
 *   options=keyValues
 *
-* 01. Fill in UpdateContextRequest
-* 02. Call standard op postUpdateContext
-* 03. Prepare HTTP headers
-* 04. Cleanup and return result
+* 01. Simple case: create the entity with mongoCreateEntity
+* 02. Otherwise, fill in UpdateContextRequest
+* 03. Call standard op postUpdateContext
+* 04. Prepare HTTP headers
+* 05. Cleanup and return result
 */
 std::string postEntities
 (
@@ -93,18 +149,47 @@ std::string postEntities
     return out;
   }
 
-  // 01. Fill in UpdateContextRequest
+  std::string  answer = "";
+
+  // 01. Simple case: create the entity with mongoCreateEntity
+  if (createFastPath(ciP))
+  {
+    OrionError oe;
+
+    TIMED_MONGO(mongoCreateEntity(eP,
+                                  &oe,
+                                  ciP->tenant,
+                                  ciP->servicePathV,
+                                  ciP->httpHeaders.xauthToken,
+                                  ciP->httpHeaders.correlator));
+
+    if (oe.code != SccNone)
+    {
+      TIMED_RENDER(answer = oe.toJson());
+      ciP->httpStatusCode = oe.code;
+    }
+    else
+    {
+      locationHeaderAdd(ciP, eP);
+      ciP->httpStatusCode = SccCreated;
+    }
+
+    eP->release();
+
+    return answer;
+  }
+
+  // 02. Fill in UpdateContextRequest
   parseDataP->upcr.res.fill(eP, "APPEND_STRICT");
 
 
-  // 02. Call standard op postUpdateContext
+  // 03. Call standard op postUpdateContext
   postUpdateContext(ciP, components, compV, parseDataP, NGSIV2_FLAVOUR_ONCREATE);
 
   //
-  // 03. Check error - 3 different ways to get an error from postUpdateContext ... :-(
+  // 04. Check error - 3 different ways to get an error from postUpdateContext ... :-(
   //     FIXME P4: make postUpdateContext have ONE way to return errors. See github issue #2763
   //
-  std::string  answer = "";
   if (parseDataP->upcrs.res.oe.code != SccNone)
   {
     TIMED_RENDER(answer = parseDataP->upcrs.res.oe.toJson());
@@ -119,22 +204,11 @@ std::string postEntities
   else
   {
     // Prepare HTTP headers
-    std::string location = "/v2/entities/" + eP->id;
-    if (eP->type != "" )
-    {
-      location += "?type=" + eP->type;
-    }
-    else
-    {
-      location += "?type=none";
-    }
-
-    ciP->httpHeader.push_back("Location");
-    ciP->httpHeaderValue.push_back(location);
+    locationHeaderAdd(ciP, eP);
     ciP->httpStatusCode = SccCreated;
   }
 
-  // 04. Cleanup and return result
+  // 05. Cleanup and return result
   eP->release();
 
   return answer;
@@ -0,0 +1,75 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <string>
+#include <vector>
+
+#include "logMsg/logMsg.h"
+#include "logMsg/traceLevels.h"
+
+#include "common/sem.h"
+#include "ngsi/ParseData.h"
+#include "rest/ConnectionInfo.h"
+#include "rest/OrionError.h"
+#include "mongoBackend/mongoTypesCatalog.h"
+#include "serviceRoutinesV2/postTypesCatalog.h"
+
+
+
+/* ****************************************************************************
+*
+* postTypesCatalog -
+*
+* POST /admin/typesCatalog
+*
+* Rebuilds the entity types catalog of the tenant from its entities collection.
+* Until it is built for the first time, GET /v2/types uses the entities collection.
+*/
+std::string postTypesCatalog
+(
+  ConnectionInfo*            ciP,
+  int                        components,
+  std::vector<std::string>&  compV,
+  ParseData*                 parseDataP
+)
+{
+  std::string  err;
+  bool         reqSemTaken = false;
+
+  reqSemTake(__FUNCTION__, "types catalog rebuild", SemWriteOp, &reqSemTaken);
+  bool ok = typesCatalogRebuild(ciP->tenant, &err);
+  reqSemGive(__FUNCTION__, "types catalog rebuild", reqSemTaken);
+
+  if (!ok)
+  {
+    OrionError oe(SccReceiverInternalError, err, "InternalServerError");
+
+    ciP->httpStatusCode = SccReceiverInternalError;
+
+    return oe.toJson();
+  }
+
+  ciP->httpStatusCode = SccNoContent;
+  return "";
+}
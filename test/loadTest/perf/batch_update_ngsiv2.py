@@ -0,0 +1,88 @@
+#!/usr/bin/python
+# -*- coding: latin-1 -*-
+# Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+#
+# This file is part of Orion Context Broker.
+#
+# Orion Context Broker is free software: you can redistribute it and/or
+# modify it under the terms of the GNU Affero General Public License as
+# published by the Free Software Foundation, either version 3 of the
+# License, or (at your option) any later version.
+#
+# Orion Context Broker is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+# General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+#
+# For those usages not covered by this license please contact with
+# iot_support at tid dot es
+
+__author__ = 'Orion dev team'
+
+# Sends POST /v2/op/update batches of different sizes and prints, for each size, the
+# mean latency of the request and the time waiting for MongoDB per entity. The broker
+# has to be run with -statTiming, so the mongoReadWait/mongoWriteWait times are
+# available in GET /statistics (they are reset before each batch size).
+#
+# The entities of each batch are different, half of them already existing (updated)
+# and half of them new (created), as in a typical IoT agent load.
+
+from requests import post, get, delete
+from random import randint
+import json
+import sys
+import time
+
+CB_ENDPOINT = 'http://localhost:1026'
+BATCH_SIZES = [1, 10, 50, 100, 500]
+BATCHES     = 20
+
+def statistics():
+    r = get(CB_ENDPOINT + '/statistics')
+    timing = r.json().get('timing', {}).get('accumulated', {})
+    return timing.get('mongoReadWait', 0.0), timing.get('mongoWriteWait', 0.0)
+
+def reset_statistics():
+    delete(CB_ENDPOINT + '/statistics')
+
+def batch(size, round):
+    entities = []
+    for i in range(0, size):
+        # Even entities exist since the previous round, odd ones are new in each round
+        if i % 2 == 0:
+            id = 'E%05d' % (i,)
+        else:
+            id = 'E%05d_%d' % (i, round)
+        entities.append({'id': id, 'type': 'T', 'A1': {'type': 'Number', 'value': randint(1, 80000)}})
+    return {'actionType': 'APPEND', 'entities': entities}
+
+def send(payload):
+    headers = {'content-type': 'application/json'}
+    start = time.time()
+    r = post(CB_ENDPOINT + '/v2/op/update', data=json.dumps(payload), headers=headers)
+    elapsed = time.time() - start
+    if r.status_code != 204:
+        print "ERROR sending batch, status code is: %d (%s)" % (r.status_code, r.text)
+    return elapsed
+
+if len(sys.argv) > 1:
+    CB_ENDPOINT = sys.argv[1]
+
+print "%8s %14s %20s %20s" % ('size', 'latency (ms)', 'read wait/ent (ms)', 'write wait/ent (ms)')
+
+for size in BATCH_SIZES:
+    # First round only to create the 'existing' entities
+    send(batch(size, 0))
+    reset_statistics()
+
+    elapsed = 0.0
+    for round in range(1, BATCHES + 1):
+        elapsed += send(batch(size, round))
+
+    read_wait, write_wait = statistics()
+    entities = float(size * BATCHES)
+
+    print "%8d %14.2f %20.4f %20.4f" % (size, elapsed * 1000 / BATCHES, read_wait * 1000 / entities, write_wait * 1000 / entities)
@@ -0,0 +1,73 @@
+#!/usr/bin/python
+# -*- coding: latin-1 -*-
+# Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+#
+# This file is part of Orion Context Broker.
+#
+# Orion Context Broker is free software: you can redistribute it and/or
+# modify it under the terms of the GNU Affero General Public License as
+# published by the Free Software Foundation, either version 3 of the
+# License, or (at your option) any later version.
+#
+# Orion Context Broker is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+# General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+#
+# For those usages not covered by this license please contact with
+# iot_support at tid dot es
+
+__author__ = 'Orion dev team'
+
+
+# Creates entities with POST /v2/entities, with different number of attributes, and
+# prints the number of creations per second for each size. It is intended to be run
+# twice, with the broker started with and without -noCreateFastPath, to compare the
+# direct creation path with the generic update one.
+#
+# Each run uses a new entity type, so the script can be run several times against the
+# same database without getting 422 (Already Exists) errors.
+
+from requests import post
+import json
+import sys
+import time
+
+CB_ENDPOINT = 'http://localhost:1026'
+ATTR_NUMBERS = [1, 5, 10, 50]
+ENTITIES     = 1000
+
+def entity(id, type, attrs):
+    e = {'id': id, 'type': type}
+    for i in range(0, attrs):
+        if i % 2 == 0:
+            e['A%d' % (i,)] = {'type': 'Number', 'value': i}
+        else:
+            e['A%d' % (i,)] = {'type': 'Text', 'value': 'value %d' % (i,), 'metadata': {'M': {'value': i}}}
+    return e
+
+def send(payload):
+    headers = {'content-type': 'application/json'}
+    r = post(CB_ENDPOINT + '/v2/entities', data=json.dumps(payload), headers=headers)
+    if r.status_code != 201:
+        print "ERROR creating entity, status code is: %d (%s)" % (r.status_code, r.text)
+
+if len(sys.argv) > 1:
+    CB_ENDPOINT = sys.argv[1]
+
+run = int(time.time())
+
+print "%8s %14s %14s" % ('attrs', 'creates/s', 'latency (ms)')
+
+for attrs in ATTR_NUMBERS:
+    type = 'T_%d_%d' % (run, attrs)
+
+    start = time.time()
+    for i in range(0, ENTITIES):
+        send(entity('E%06d' % (i,), type, attrs))
+    elapsed = time.time() - start
+
+    print "%8d %14.1f %14.3f" % (attrs, ENTITIES / elapsed, elapsed * 1000 / ENTITIES)
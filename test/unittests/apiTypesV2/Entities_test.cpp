@@ -22,6 +22,7 @@
 *
 * Author: Fermin Galan
 */
+#include "common/RequestArena.h"
 #include "apiTypesV2/Entities.h"
 #include "unittests/unittest.h"
 
@@ -85,3 +86,132 @@ TEST(Entities, check)
 
   utExit();
 }
+
+
+
+/* ****************************************************************************
+*
+* stream - the streamed entities are the same as the rendered ones
+*/
+TEST(Entities, stream)
+{
+  utInit();
+
+  std::map<std::string, bool>         uriParamOptions;
+  std::map<std::string, std::string>  uriParam;
+  Entities                            ens1;
+  Entities                            ens2;
+
+  for (int ix = 0; ix < 3; ++ix)
+  {
+    for (int eIx = 0; eIx < 2; ++eIx)
+    {
+      Entity* enP    = new Entity();
+      enP->id        = std::string("E") + (char) ('1' + ix);
+      enP->type      = "T";
+      enP->isPattern = "false";
+      enP->attributeVector.push_back(new ContextAttribute("A", "T", "val"));
+
+      ((eIx == 0)? &ens1 : &ens2)->vec.push_back(enP);
+    }
+  }
+
+  std::string      rendered = ens1.render(uriParamOptions, uriParam);
+  std::string      streamed;
+  std::string      chunk;
+  EntitiesStream*  streamP = new EntitiesStream(&ens2, uriParamOptions, uriParam);
+
+  EXPECT_EQ(0, ens2.vec.size());
+
+  while (streamP->next(&chunk))
+  {
+    streamed += chunk;
+  }
+
+  EXPECT_EQ(rendered, streamed);
+  EXPECT_FALSE(streamP->next(&chunk));
+
+  delete streamP;
+
+  // A stream deleted before the end releases the entities not sent
+  Entities ens3;
+
+  for (int ix = 0; ix < 3; ++ix)
+  {
+    Entity* enP    = new Entity();
+    enP->id        = "E";
+    enP->type      = "T";
+    enP->isPattern = "false";
+    ens3.vec.push_back(enP);
+  }
+
+  streamP = new EntitiesStream(&ens3, uriParamOptions, uriParam);
+  EXPECT_TRUE(streamP->next(&chunk));
+  delete streamP;
+
+  utExit();
+}
+
+
+
+/* ****************************************************************************
+*
+* streamArena -
+*
+* Entities built from the arena of the request are streamed after the arena is freed,
+* as it happens when MHD sends the response after the request is completed.
+*/
+TEST(Entities, streamArena)
+{
+  utInit();
+
+  std::map<std::string, bool>         uriParamOptions;
+  std::map<std::string, std::string>  uriParam;
+  Entities                            ens1;
+  Entities                            ens2;
+  RequestArena*                       arenaP = new RequestArena();
+
+  requestArenaSet(arenaP);
+
+  for (int ix = 0; ix < 3; ++ix)
+  {
+    for (int eIx = 0; eIx < 2; ++eIx)
+    {
+      Entity*           enP = new Entity();
+      ContextAttribute* caP = new ContextAttribute("C", "StructuredValue", "");
+
+      caP->valueType      = orion::ValueTypeObject;
+      caP->compoundValueP = new orion::CompoundValueNode(orion::ValueTypeObject);
+      caP->compoundValueP->add(orion::ValueTypeString, "x", std::string("y") + (char) ('1' + ix));
+
+      enP->id        = std::string("E") + (char) ('1' + ix);
+      enP->type      = "T";
+      enP->isPattern = "false";
+      enP->attributeVector.push_back(new ContextAttribute("A", "T", "val"));
+      enP->attributeVector.push_back(caP);
+
+      ((eIx == 0)? &ens1 : &ens2)->vec.push_back(enP);
+    }
+  }
+
+  std::string      rendered = ens1.render(uriParamOptions, uriParam);
+  std::string      streamed;
+  std::string      chunk;
+  EntitiesStream*  streamP  = new EntitiesStream(&ens2, uriParamOptions, uriParam);
+
+  // End of the request
+  requestArenaSet(NULL);
+  ens1.release();
+  delete arenaP;
+
+  while (streamP->next(&chunk))
+  {
+    streamed += chunk;
+  }
+
+  EXPECT_EQ(rendered, streamed);
+
+  delete streamP;
+
+  utExit();
+}
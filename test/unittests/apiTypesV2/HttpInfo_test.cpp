@@ -0,0 +1,90 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include "apiTypesV2/HttpInfo.h"
+#include "ngsi/ContextElement.h"
+
+
+
+/* ****************************************************************************
+*
+* templatesShared -
+*
+* Copies of an httpInfo share its compiled templates, that live until the last
+* copy is destroyed
+*/
+TEST(HttpInfo, templatesShared)
+{
+  ngsiv2::HttpInfo*  hiP = new ngsiv2::HttpInfo("http://localhost:1028/${type}/${id}");
+  ContextElement     ce("E1", "T1", "false");
+  std::string        url;
+
+  hiP->custom = true;
+  hiP->headers["X-${type}"] = "${id}";
+  hiP->templatesCompile();
+
+  ASSERT_TRUE(hiP->templatesP != NULL);
+  EXPECT_EQ(1, hiP->templatesP->refs);
+  EXPECT_EQ(1, hiP->templatesP->headers.size());
+
+  ngsiv2::HttpInfo  copy(*hiP);
+  ngsiv2::HttpInfo  assigned;
+
+  assigned = copy;
+
+  EXPECT_EQ(hiP->templatesP, copy.templatesP);
+  EXPECT_EQ(hiP->templatesP, assigned.templatesP);
+  EXPECT_EQ(3, hiP->templatesP->refs);
+
+  delete hiP;
+  EXPECT_EQ(2, copy.templatesP->refs);
+
+  copy.templatesRelease();
+  EXPECT_TRUE(copy.templatesP == NULL);
+  EXPECT_EQ(1, assigned.templatesP->refs);
+
+  EXPECT_TRUE(assigned.templatesP->url.expand(&url, ce));
+  EXPECT_EQ("http://localhost:1028/T1/E1", url);
+}
+
+
+
+/* ****************************************************************************
+*
+* notCustom -
+*
+* Only custom notifications use templates
+*/
+TEST(HttpInfo, notCustom)
+{
+  ngsiv2::HttpInfo hi("http://localhost:1028/notify");
+
+  hi.templatesCompile();
+
+  EXPECT_TRUE(hi.templatesP == NULL);
+}
@@ -34,6 +34,7 @@
 #include "ngsi/ContextAttribute.h"
 #include "cache/SubscriptionCache.h"
 #include "cache/subCache.h"
+#include "common/regexCache.h"
 
 #include "unittests/unittest.h"
 #include "unittests/testInit.h"
@@ -69,8 +70,8 @@ TEST(cache, SubscriptionCache)
   attributeV.push_back("attr2");
   attributeV.push_back("attr3");
 
-  regcomp(&ei1->entityIdPattern, "E1.*", 0);
-  regcomp(&ei2->entityIdPattern, "E2.*", 0);
+  ei1->entityIdPattern = regexCacheGet("E1.*", 0);
+  ei2->entityIdPattern = regexCacheGet("E2.*", 0);
 
   ei1->entityType = "at1";
   ei2->entityType = "at2";
@@ -0,0 +1,219 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "gtest/gtest.h"
+
+#include "common/clockFunctions.h"
+#include "cache/subCache.h"
+
+#include "unittests/unittest.h"
+
+
+
+/* ****************************************************************************
+*
+* cachedSubCreate -
+*/
+static CachedSubscription* cachedSubCreate
+(
+  const char*         tenant,
+  const char*         servicePath,
+  const char*         subscriptionId,
+  const std::string&  id,
+  const std::string&  type,
+  bool                isPattern,
+  bool                isTypePattern
+)
+{
+  CachedSubscription* cSubP = new CachedSubscription();
+
+  cSubP->tenant               = (tenant == NULL)? NULL : strdup(tenant);
+  cSubP->servicePath          = strdup(servicePath);
+  cSubP->subscriptionId       = strdup(subscriptionId);
+  cSubP->expirationTime       = 0;
+  cSubP->throttling           = -1;
+  cSubP->lastNotificationTime = 0;
+  cSubP->count                = 0;
+  cSubP->next                 = NULL;
+
+  cSubP->entityIdInfos.push_back(new EntityInfo(id, type, isPattern? "true" : "false", isTypePattern));
+
+  return cSubP;
+}
+
+
+
+/* ****************************************************************************
+*
+* matchIds - run subCacheMatch and return the ids of the matching subscriptions, sorted
+*/
+static std::string matchIds
+(
+  const char*  tenant,
+  const char*  servicePath,
+  const char*  entityId,
+  const char*  entityType,
+  const char*  attr
+)
+{
+  std::vector<CachedSubscription*>  subV;
+  std::vector<std::string>          idV;
+  std::string                       ids;
+
+  subCacheMatch(tenant, servicePath, entityId, entityType, attr, &subV);
+
+  for (unsigned int ix = 0; ix < subV.size(); ++ix)
+  {
+    idV.push_back(subV[ix]->subscriptionId);
+  }
+
+  std::sort(idV.begin(), idV.end());
+
+  for (unsigned int ix = 0; ix < idV.size(); ++ix)
+  {
+    ids += (ix == 0)? idV[ix] : std::string(",") + idV[ix];
+  }
+
+  return ids;
+}
+
+
+
+/* ****************************************************************************
+*
+* match -
+*/
+TEST(subCache, match)
+{
+  subCacheInit(true);
+
+  subCacheItemInsert(cachedSubCreate("t1", "/a",     "S1", "E1",   "T1", false, false));
+  subCacheItemInsert(cachedSubCreate("t1", "/a/#",   "S2", "E.*",  "T1", true,  false));
+  subCacheItemInsert(cachedSubCreate("t1", "/#",     "S3", "E1",   "",   false, false));
+  subCacheItemInsert(cachedSubCreate("t1", "/a/b",   "S4", "E1",   "T.*", false, true));
+  subCacheItemInsert(cachedSubCreate("t2", "/a",     "S5", "E1",   "T1", false, false));
+  subCacheItemInsert(cachedSubCreate("t1", "/ab/#",  "S6", "E1",   "T1", false, false));
+
+  CachedSubscription* cSubP = cachedSubCreate("t1", "/a", "S7", "E1", "T1", false, false);
+  cSubP->entityIdInfos.push_back(new EntityInfo("E.*", "T1", "true", false));
+  cSubP->notifyConditionV.push_back("A1");
+  subCacheItemInsert(cSubP);
+
+  EXPECT_EQ("S1,S2,S3,S7",    matchIds("t1", "/a",    "E1", "T1", "A1"));
+  EXPECT_EQ("S1,S2,S3",       matchIds("t1", "/a",    "E1", "T1", "A2"));
+  EXPECT_EQ("S2,S3,S4",       matchIds("t1", "/a/b",  "E1", "T1", "A2"));
+  EXPECT_EQ("S2",             matchIds("t1", "/a/b",  "E2", "T1", "A2"));
+  EXPECT_EQ("S3,S6",          matchIds("t1", "/ab",   "E1", "T1", "A2"));
+  EXPECT_EQ("S3",             matchIds("t1", "/a",    "E1", "T2", "A2"));
+  EXPECT_EQ("S5",             matchIds("t2", "/a",    "E1", "T1", "A2"));
+  EXPECT_EQ("",               matchIds("t3", "/a",    "E1", "T1", "A2"));
+  EXPECT_EQ("S1,S2,S3,S4,S6", matchIds("t1", "/#",    "E1", "T1", "A2"));
+
+  subCacheItemRemove(subCacheItemLookup("t1", "S2"));
+  subCacheItemRemove(subCacheItemLookup("t1", "S7"));
+
+  EXPECT_EQ("S1,S3",          matchIds("t1", "/a",    "E1", "T1", "A1"));
+  EXPECT_EQ(5,                subCacheItems());
+
+  subCacheDestroy();
+
+  EXPECT_EQ("",               matchIds("t1", "/a",    "E1", "T1", "A1"));
+}
+
+
+
+/* ****************************************************************************
+*
+* matchLatency -
+*
+* Not really a test, but a benchmark of subCacheMatch as the number of cached
+* subscriptions grows. Subscriptions are spread over 10 entity types and 100
+* service paths, with one patterned subscription every 100 subscriptions.
+*/
+TEST(subCache, matchLatency)
+{
+  const int  sizes[]   = { 1000, 10000, 80000 };
+  const int  matches   = 10000;
+
+  for (unsigned int sIx = 0; sIx < sizeof(sizes) / sizeof(sizes[0]); ++sIx)
+  {
+    subCacheInit(false);
+
+    for (int ix = 0; ix < sizes[sIx]; ++ix)
+    {
+      char  subId[32];
+      char  id[32];
+      char  type[32];
+      char  spath[32];
+      bool  isPattern = ((ix % 100) == 0);
+
+      snprintf(subId, sizeof(subId), "S%d", ix);
+      snprintf(id,    sizeof(id),    isPattern? "E%d.*" : "E%d", ix);
+      snprintf(type,  sizeof(type),  "T%d", ix % 10);
+      snprintf(spath, sizeof(spath), "/sp%d", ix % 100);
+
+      subCacheItemInsert(cachedSubCreate(NULL, spath, subId, id, type, isPattern, false));
+    }
+
+    struct timespec  start;
+    struct timespec  end;
+    struct timespec  diff;
+    int              found = 0;
+
+    clock_gettime(CLOCK_REALTIME, &start);
+
+    for (int ix = 0; ix < matches; ++ix)
+    {
+      std::vector<CachedSubscription*>  subV;
+      int                               n = ix % sizes[sIx];
+      char                              id[32];
+      char                              type[32];
+      char                              spath[32];
+
+      snprintf(id,    sizeof(id),    "E%d", n);
+      snprintf(type,  sizeof(type),  "T%d", n % 10);
+      snprintf(spath, sizeof(spath), "/sp%d", n % 100);
+
+      subCacheMatch(NULL, spath, id, type, "A1", &subV);
+      found += subV.size();
+    }
+
+    clock_gettime(CLOCK_REALTIME, &end);
+    clock_difftime(&end, &start, &diff);
+
+    double usecs = (diff.tv_sec * 1000000.0 + diff.tv_nsec / 1000.0) / matches;
+
+    printf("subCacheMatch: %6d cached subscriptions: %8.2f usecs per match\n", sizes[sIx], usecs);
+    EXPECT_GE(found, matches);
+
+    subCacheDestroy();
+  }
+}
@@ -0,0 +1,116 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <stdint.h>
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include "common/RequestArena.h"
+
+
+
+/* ****************************************************************************
+*
+* ArenaObject -
+*/
+class ArenaObject
+{
+ public:
+  REQUEST_ARENA_ALLOCATED
+
+  std::string  name;
+  double       value;
+
+  explicit ArenaObject(const std::string& _name): name(_name), value(0) {}
+};
+
+
+
+/* ****************************************************************************
+*
+* allocation -
+*/
+TEST(RequestArena, allocation)
+{
+  long long     arenaAllocs;
+  long long     heapAllocs;
+  long long     arenas;
+  long long     peakSize;
+  RequestArena* arenaP = new RequestArena();
+
+  requestArenaStatisticsReset();
+
+  // Without arena, from the heap
+  ArenaObject* heapP = new ArenaObject("heap");
+
+  requestArenaSet(arenaP);
+
+  ArenaObject* aP = new ArenaObject("a");
+  ArenaObject* bP = new ArenaObject("b");
+
+  // Aligned and contiguous
+  EXPECT_EQ(0, ((uintptr_t) aP) % 16);
+  EXPECT_EQ(0, ((uintptr_t) bP) % 16);
+  EXPECT_TRUE((char*) bP > (char*) aP);
+  EXPECT_TRUE(arenaP->size() >= 2 * sizeof(ArenaObject));
+
+  // Deleting runs the destructor, memory is freed with the arena
+  delete aP;
+
+  // An object created without arena can be deleted while an arena is set
+  delete heapP;
+
+  requestArenaSet(NULL);
+
+  EXPECT_EQ("b", bP->name);
+  delete bP;
+
+  size_t size = arenaP->size();
+  delete arenaP;
+
+  requestArenaStatisticsGet(&arenaAllocs, &heapAllocs, &arenas, &peakSize);
+  EXPECT_EQ(2, arenaAllocs);
+  EXPECT_EQ(1, heapAllocs);
+  EXPECT_EQ((long long) size, peakSize);
+}
+
+
+
+/* ****************************************************************************
+*
+* bigAllocation - bigger than a block
+*/
+TEST(RequestArena, bigAllocation)
+{
+  RequestArena arena;
+
+  char* p1 = (char*) arena.alloc(REQUEST_ARENA_BLOCK_SIZE * 2);
+  char* p2 = (char*) arena.alloc(10);
+
+  p1[REQUEST_ARENA_BLOCK_SIZE * 2 - 1] = 'x';
+  p2[9] = 'y';
+
+  EXPECT_EQ(REQUEST_ARENA_BLOCK_SIZE * 2 + 16, arena.size());
+}
@@ -56,3 +56,52 @@ TEST(commonSem, unique)
    EXPECT_EQ(0, s);
    EXPECT_TRUE(taken);
 }
+
+
+
+/* ****************************************************************************
+*
+* sharedPolicy -
+*
+* With the 'rw' policy (SemSharedOp), read operations share the 'req' lock while
+* write operations are exclusive.
+*/
+TEST(commonSem, sharedPolicy)
+{
+  bool  taken1;
+  bool  taken2;
+  int   s;
+
+  s = semInit(SemSharedOp);
+  EXPECT_EQ(0, s);
+  EXPECT_EQ(SemSharedOp, reqSemPolicyGet());
+  EXPECT_STREQ("free", reqSemGet());
+
+  // Two readers at the same time
+  s = reqSemTake(__FUNCTION__, "test", SemReadOp, &taken1);
+  EXPECT_EQ(0, s);
+  EXPECT_TRUE(taken1);
+
+  s = reqSemTake(__FUNCTION__, "test", SemReadOp, &taken2);
+  EXPECT_EQ(0, s);
+  EXPECT_TRUE(taken2);
+  EXPECT_STREQ("taken", reqSemGet());
+
+  // No writer while there are readers
+  EXPECT_EQ(-1, reqSemTryToTake());
+
+  reqSemGive(__FUNCTION__, "test", taken1);
+  reqSemGive(__FUNCTION__, "test", taken2);
+  EXPECT_STREQ("free", reqSemGet());
+
+  // Writer
+  s = reqSemTake(__FUNCTION__, "test", SemWriteOp, &taken1);
+  EXPECT_EQ(0, s);
+  EXPECT_TRUE(taken1);
+  EXPECT_STREQ("taken", reqSemGet());
+
+  reqSemGive(__FUNCTION__, "test", taken1);
+  EXPECT_STREQ("free", reqSemGet());
+
+  semInit();
+}
@@ -0,0 +1,135 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "gtest/gtest.h"
+
+#include "common/ServicePathTrie.h"
+
+
+
+/* ****************************************************************************
+*
+* isEmpty -
+*/
+static bool isEmpty(const std::string& entry)
+{
+  return entry.empty();
+}
+
+
+
+/* ****************************************************************************
+*
+* matchEntries - run match() and return the (non empty) entries found, sorted
+*/
+static std::string matchEntries(ServicePathTrie<std::string>* trieP, const std::string& servicePath)
+{
+  std::vector<std::string*>  entryV;
+  std::vector<std::string>   valueV;
+  std::string                out;
+
+  trieP->match(servicePath, &entryV);
+
+  for (unsigned int ix = 0; ix < entryV.size(); ++ix)
+  {
+    if (!entryV[ix]->empty())
+    {
+      valueV.push_back(*entryV[ix]);
+    }
+  }
+
+  std::sort(valueV.begin(), valueV.end());
+
+  for (unsigned int ix = 0; ix < valueV.size(); ++ix)
+  {
+    out += (ix == 0)? valueV[ix] : std::string(",") + valueV[ix];
+  }
+
+  return out;
+}
+
+
+
+/* ****************************************************************************
+*
+* match -
+*/
+TEST(commonServicePathTrie, match)
+{
+  ServicePathTrie<std::string>  trie;
+  const char*                   pathV[] = { "", "/", "/#", "/a", "/a/#", "/a/b", "/a/b/#", "/ab/#", "/a/b/c", "/x/y" };
+
+  for (unsigned int ix = 0; ix < sizeof(pathV) / sizeof(pathV[0]); ++ix)
+  {
+    *trie.entryGet(pathV[ix], true) = std::string("[") + pathV[ix] + "]";
+  }
+
+  EXPECT_EQ("[/#],[/],[]",                       matchEntries(&trie, ""));
+  EXPECT_EQ("[/#],[/]",                          matchEntries(&trie, "/"));
+  EXPECT_EQ("[/#],[/a/#],[/a]",                  matchEntries(&trie, "/a"));
+  EXPECT_EQ("[/#],[/a/#],[/a/b/#],[/a/b]",       matchEntries(&trie, "/a/b"));
+  EXPECT_EQ("[/#],[/a/#],[/a/b/#],[/a/b/c]",     matchEntries(&trie, "/a/b/c"));
+  EXPECT_EQ("[/#],[/a/#],[/a/b/#]",              matchEntries(&trie, "/a/b/d"));
+  EXPECT_EQ("[/#],[/ab/#]",                      matchEntries(&trie, "/ab"));
+  EXPECT_EQ("[/#]",                              matchEntries(&trie, "/a2"));
+  EXPECT_EQ("[/#]",                              matchEntries(&trie, "/x"));
+  EXPECT_EQ("[/#],[/x/y]",                       matchEntries(&trie, "/x/y"));
+  EXPECT_EQ("[/#],[/],[/a/#],[/a/b/#],[/a/b/c],[/a/b],[/a],[/ab/#],[/x/y],[]", matchEntries(&trie, "/#"));
+  EXPECT_EQ(7, trie.size());
+}
+
+
+
+/* ****************************************************************************
+*
+* prune -
+*/
+TEST(commonServicePathTrie, prune)
+{
+  ServicePathTrie<std::string> trie;
+
+  *trie.entryGet("/a/b/c", true) = "[/a/b/c]";
+  *trie.entryGet("/a/#",   true) = "[/a/#]";
+  EXPECT_EQ(4, trie.size());
+
+  // Not empty yet
+  trie.prune("/a/b/c", isEmpty);
+  EXPECT_EQ(4, trie.size());
+
+  // /a/b/c and /a/b are removed, /a is kept, as /a/# is not empty
+  trie.entryGet("/a/b/c", false)->clear();
+  trie.prune("/a/b/c", isEmpty);
+  EXPECT_EQ(2, trie.size());
+  EXPECT_TRUE(trie.entryGet("/a/b", false) == NULL);
+  EXPECT_EQ("[/a/#]", matchEntries(&trie, "/a/b/c"));
+
+  trie.entryGet("/a/#", false)->clear();
+  trie.prune("/a/#", isEmpty);
+  EXPECT_EQ(1, trie.size());
+  EXPECT_EQ("", matchEntries(&trie, "/#"));
+}
@@ -0,0 +1,199 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <stdio.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "gtest/gtest.h"
+
+#include "common/clockFunctions.h"
+#include "common/SyncQOverflow.h"
+#include "common/SyncQRing.h"
+
+
+
+/* ****************************************************************************
+*
+* BENCH_ITEMS - number of items going through the queue in each benchmark run
+*/
+#define BENCH_ITEMS  200000
+
+
+
+/* ****************************************************************************
+*
+* BenchParams -
+*/
+template <typename Queue>
+struct BenchParams
+{
+  Queue*         queueP;
+  int            items;
+  volatile long  sum;
+};
+
+
+
+/* ****************************************************************************
+*
+* producer -
+*
+* Pushes 'items' values (all of them 1), retrying while the queue is full.
+*/
+template <typename Queue>
+static void* producer(void* p)
+{
+  BenchParams<Queue>* paramsP = (BenchParams<Queue>*) p;
+
+  for (int ix = 0; ix < paramsP->items; ++ix)
+  {
+    while (!paramsP->queueP->try_push(1))
+    {
+      sched_yield();
+    }
+  }
+
+  return NULL;
+}
+
+
+
+/* ****************************************************************************
+*
+* consumer -
+*/
+template <typename Queue>
+static void* consumer(void* p)
+{
+  BenchParams<Queue>* paramsP = (BenchParams<Queue>*) p;
+
+  for (int ix = 0; ix < paramsP->items; ++ix)
+  {
+    __sync_fetch_and_add(&paramsP->sum, paramsP->queueP->pop());
+  }
+
+  return NULL;
+}
+
+
+
+/* ****************************************************************************
+*
+* benchRun - run 'threads' producers and 'threads' consumers, returns items per second
+*/
+template <typename Queue>
+static double benchRun(int threads)
+{
+  Queue                queue(100);
+  BenchParams<Queue>   params;
+  pthread_t*           tidV = new pthread_t[2 * threads];
+  struct timespec      start;
+  struct timespec      end;
+  struct timespec      diff;
+
+  params.queueP = &queue;
+  params.items  = BENCH_ITEMS / threads;
+  params.sum    = 0;
+
+  clock_gettime(CLOCK_REALTIME, &start);
+
+  for (int ix = 0; ix < threads; ++ix)
+  {
+    pthread_create(&tidV[ix],           NULL, consumer<Queue>, &params);
+    pthread_create(&tidV[threads + ix], NULL, producer<Queue>, &params);
+  }
+
+  for (int ix = 0; ix < 2 * threads; ++ix)
+  {
+    pthread_join(tidV[ix], NULL);
+  }
+
+  clock_gettime(CLOCK_REALTIME, &end);
+  clock_difftime(&end, &start, &diff);
+
+  EXPECT_EQ(params.items * threads, params.sum);
+  EXPECT_EQ(0, queue.size());
+
+  delete[] tidV;
+
+  return (params.items * threads) / (diff.tv_sec + diff.tv_nsec / 1E9);
+}
+
+
+
+/* ****************************************************************************
+*
+* contract - same try_push/pop/size behaviour as SyncQOverflow
+*/
+TEST(commonSyncQRing, contract)
+{
+  SyncQRing<int> queue(3);
+
+  EXPECT_EQ(0, queue.size());
+
+  // Several laps around the ring, to check cells are reused
+  for (int lap = 0; lap < 5; ++lap)
+  {
+    EXPECT_TRUE(queue.try_push(lap * 10 + 1));
+    EXPECT_TRUE(queue.try_push(lap * 10 + 2));
+    EXPECT_TRUE(queue.try_push(lap * 10 + 3));
+    EXPECT_FALSE(queue.try_push(lap * 10 + 4));
+    EXPECT_EQ(3, queue.size());
+
+    EXPECT_EQ(lap * 10 + 1, queue.pop());
+    EXPECT_EQ(2, queue.size());
+    EXPECT_TRUE(queue.try_push(lap * 10 + 5));
+
+    EXPECT_EQ(lap * 10 + 2, queue.pop());
+    EXPECT_EQ(lap * 10 + 3, queue.pop());
+    EXPECT_EQ(lap * 10 + 5, queue.pop());
+    EXPECT_EQ(0, queue.size());
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* throughput -
+*
+* Not really a test, but a benchmark comparing SyncQRing with SyncQOverflow, with the
+* same number of producers and consumers on a queue of 100 items (the default size
+* of the notification queue).
+*/
+TEST(commonSyncQRing, throughput)
+{
+  const int threadsV[] = { 1, 2, 4, 8, 16, 32, 64 };
+
+  for (unsigned int ix = 0; ix < sizeof(threadsV) / sizeof(threadsV[0]); ++ix)
+  {
+    double overflow = benchRun<SyncQOverflow<int> >(threadsV[ix]);
+    double ring     = benchRun<SyncQRing<int> >(threadsV[ix]);
+
+    printf("%2d producers/%2d consumers: SyncQOverflow %10.0f items/s, SyncQRing %10.0f items/s\n",
+           threadsV[ix], threadsV[ix], overflow, ring);
+  }
+}
@@ -0,0 +1,119 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <regex.h>
+
+#include "gtest/gtest.h"
+
+#include "common/regexCache.h"
+
+
+
+/* ****************************************************************************
+*
+* lru -
+*/
+TEST(regexCache, lru)
+{
+  int       hits;
+  int       misses;
+  int       evictions;
+  int       size;
+  regex_t*  reP;
+  regex_t*  re2P;
+
+  regexCacheInit(2);
+  regexCacheStatisticsReset();
+
+  reP = regexCacheGet("^E1.*", REG_EXTENDED);
+  ASSERT_TRUE(reP != NULL);
+  EXPECT_EQ(0, regexec(reP, "E12", 0, NULL, 0));
+  EXPECT_NE(0, regexec(reP, "F12", 0, NULL, 0));
+  regexCacheRelease(reP);
+
+  // Same pattern, same compiled regex
+  re2P = regexCacheGet("^E1.*", REG_EXTENDED);
+  EXPECT_EQ(reP, re2P);
+  regexCacheRelease(re2P);
+
+  // Different flags, different regex
+  re2P = regexCacheGet("^E1.*", 0);
+  EXPECT_NE(reP, re2P);
+  regexCacheRelease(re2P);
+
+  // '^E1.*' is the least recently used one, so it is evicted by a third pattern
+  regexCacheRelease(regexCacheGet("^E2.*", REG_EXTENDED));
+
+  regexCacheStatisticsGet(&hits, &misses, &evictions, &size);
+  EXPECT_EQ(1, hits);
+  EXPECT_EQ(3, misses);
+  EXPECT_EQ(1, evictions);
+  EXPECT_EQ(2, size);
+
+  // Invalid patterns are not cached
+  EXPECT_TRUE(regexCacheGet("(", REG_EXTENDED) == NULL);
+
+  regexCacheInit(REGEX_CACHE_DEFAULT_SIZE);
+}
+
+
+
+/* ****************************************************************************
+*
+* evictedInUse - a regex evicted while in use is valid until it is released
+*/
+TEST(regexCache, evictedInUse)
+{
+  int       hits;
+  int       misses;
+  int       evictions;
+  int       size;
+  regex_t*  reP;
+
+  // Empty the cache (from previous tests) and start again with room for only one regex
+  regexCacheInit(0);
+  regexCacheInit(1);
+  regexCacheStatisticsReset();
+
+  reP = regexCacheGet("^A$", REG_EXTENDED);
+  regexCacheRelease(regexCacheGet("^B$", REG_EXTENDED));
+
+  EXPECT_EQ(0, regexec(reP, "A", 0, NULL, 0));
+  regexCacheRelease(reP);
+
+  // No cache at all: compiled each time
+  regexCacheInit(0);
+
+  reP = regexCacheGet("^A$", REG_EXTENDED);
+  EXPECT_EQ(0, regexec(reP, "A", 0, NULL, 0));
+  regexCacheRelease(reP);
+
+  regexCacheStatisticsGet(&hits, &misses, &evictions, &size);
+  EXPECT_EQ(0, hits);
+  EXPECT_EQ(3, misses);
+  EXPECT_EQ(2, evictions);
+  EXPECT_EQ(0, size);
+
+  regexCacheInit(REGEX_CACHE_DEFAULT_SIZE);
+}
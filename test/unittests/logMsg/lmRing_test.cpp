@@ -0,0 +1,262 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include "logMsg/lmRing.h"
+
+
+
+/* ****************************************************************************
+*
+* push - push a line (a string) into the ring
+*/
+static bool push(LmRing* ringP, int index, const std::string& line)
+{
+  return lmRingPush(ringP, index, line.c_str(), line.size());
+}
+
+
+
+/* ****************************************************************************
+*
+* takeAll - take (and give back) all the lines in the ring, separated by '|'
+*/
+static std::string takeAll(LmRing* ringP)
+{
+  LmRingSlot*  slotV[3];
+  std::string  lines;
+  int          n;
+
+  // Slots are taken three by three, to check batches that go across the end of the ring
+  while ((n = lmRingTake(ringP, slotV, 3)) > 0)
+  {
+    for (int ix = 0; ix < n; ix++)
+    {
+      lines += (lines == "")? "" : "|";
+      lines += lmRingSlotLine(slotV[ix]);
+      EXPECT_EQ(strlen(lmRingSlotLine(slotV[ix])), (size_t) slotV[ix]->len);
+    }
+
+    lmRingGive(ringP, slotV, n);
+  }
+
+  return lines;
+}
+
+
+
+/* ****************************************************************************
+*
+* wrapAround -
+*
+* A ring of 4 lines is filled and emptied several times, so the positions go
+* around the end of the slots array.
+*/
+TEST(lmRing, wrapAround)
+{
+  LmRing ring;
+
+  EXPECT_TRUE(lmRingInit(&ring, 3));  // rounded up to 4
+  EXPECT_EQ(3, ring.mask);
+
+  EXPECT_TRUE(push(&ring, 0, "l1"));
+  EXPECT_TRUE(push(&ring, 0, "l2"));
+  EXPECT_TRUE(push(&ring, 1, "l3"));
+  EXPECT_EQ("l1|l2|l3", takeAll(&ring));
+
+  EXPECT_TRUE(push(&ring, 0, "l4"));
+  EXPECT_TRUE(push(&ring, 0, "l5"));
+  EXPECT_TRUE(push(&ring, 0, "l6"));
+  EXPECT_TRUE(push(&ring, 0, "l7"));
+  EXPECT_EQ("l4|l5|l6|l7", takeAll(&ring));
+
+  for (int lap = 0; lap < 10; lap++)
+  {
+    char line[16];
+
+    snprintf(line, sizeof(line), "lap%d", lap);
+    EXPECT_TRUE(push(&ring, 1, line));
+    EXPECT_EQ(line, takeAll(&ring));
+  }
+
+  EXPECT_EQ(0, ring.overflows);
+  EXPECT_EQ(ring.head, ring.tail);
+
+  lmRingRelease(&ring);
+}
+
+
+
+/* ****************************************************************************
+*
+* overflow -
+*
+* Lines pushed with the ring full are lost and counted. The slots taken by the
+* consumer are not free until they are given back.
+*/
+TEST(lmRing, overflow)
+{
+  LmRing       ring;
+  LmRingSlot*  slotV[2];
+
+  EXPECT_TRUE(lmRingInit(&ring, 4));
+
+  EXPECT_TRUE(push(&ring, 0, "l1"));
+  EXPECT_TRUE(push(&ring, 0, "l2"));
+  EXPECT_TRUE(push(&ring, 0, "l3"));
+  EXPECT_TRUE(push(&ring, 0, "l4"));
+  EXPECT_FALSE(push(&ring, 0, "l5"));
+  EXPECT_FALSE(push(&ring, 0, "l6"));
+  EXPECT_EQ(2, ring.overflows);
+
+  // Taken, but not given back yet
+  EXPECT_EQ(2, lmRingTake(&ring, slotV, 2));
+  EXPECT_STREQ("l1", lmRingSlotLine(slotV[0]));
+  EXPECT_STREQ("l2", lmRingSlotLine(slotV[1]));
+  EXPECT_FALSE(push(&ring, 0, "l7"));
+  EXPECT_EQ(3, ring.overflows);
+
+  lmRingGive(&ring, slotV, 2);
+  EXPECT_TRUE(push(&ring, 0, "l8"));
+  EXPECT_TRUE(push(&ring, 0, "l9"));
+  EXPECT_FALSE(push(&ring, 0, "l10"));
+  EXPECT_EQ(4, ring.overflows);
+
+  EXPECT_EQ("l3|l4|l8|l9", takeAll(&ring));
+
+  lmRingRelease(&ring);
+}
+
+
+
+/* ****************************************************************************
+*
+* longLine -
+*
+* Lines that don't fit in the ring storage are kept on the heap.
+*/
+TEST(lmRing, longLine)
+{
+  LmRing       ring;
+  LmRingSlot*  slotV[2];
+  std::string  longLine(LM_RING_TEXT_SIZE * 3, 'x');
+  std::string  maxLine(LM_RING_TEXT_SIZE - 1, 'y');
+
+  EXPECT_TRUE(lmRingInit(&ring, 2));
+
+  EXPECT_TRUE(push(&ring, 0, longLine));
+  EXPECT_TRUE(push(&ring, 1, maxLine));
+
+  EXPECT_EQ(2, lmRingTake(&ring, slotV, 2));
+  EXPECT_TRUE(slotV[0]->heapText != NULL);
+  EXPECT_EQ(longLine, lmRingSlotLine(slotV[0]));
+  EXPECT_TRUE(slotV[1]->heapText == NULL);
+  EXPECT_EQ(maxLine, lmRingSlotLine(slotV[1]));
+  EXPECT_EQ(1, slotV[1]->index);
+
+  lmRingGive(&ring, slotV, 2);
+  EXPECT_TRUE(ring.slots[0].heapText == NULL);
+
+  lmRingRelease(&ring);
+}
+
+
+
+/* ****************************************************************************
+*
+* PRODUCERS, PRODUCER_LINES -
+*/
+#define PRODUCERS       4
+#define PRODUCER_LINES  50000
+
+
+
+/* ****************************************************************************
+*
+* producer -
+*/
+static void* producer(void* vP)
+{
+  LmRing* ringP = (LmRing*) vP;
+
+  for (int ix = 0; ix < PRODUCER_LINES; ix++)
+  {
+    push(ringP, 0, "a log line");
+  }
+
+  return NULL;
+}
+
+
+
+/* ****************************************************************************
+*
+* concurrentProducers -
+*
+* Several threads push into a small ring while it is being drained: all the lines
+* are either taken by the consumer or counted as overflows.
+*/
+TEST(lmRing, concurrentProducers)
+{
+  LmRing     ring;
+  pthread_t  tid[PRODUCERS];
+  long       taken = 0;
+
+  EXPECT_TRUE(lmRingInit(&ring, 64));
+
+  for (int ix = 0; ix < PRODUCERS; ix++)
+  {
+    pthread_create(&tid[ix], NULL, producer, &ring);
+  }
+
+  while (taken + (long) ring.overflows < PRODUCERS * PRODUCER_LINES)
+  {
+    LmRingSlot*  slotV[16];
+    int          n = lmRingTake(&ring, slotV, 16);
+
+    for (int ix = 0; ix < n; ix++)
+    {
+      EXPECT_STREQ("a log line", lmRingSlotLine(slotV[ix]));
+    }
+
+    lmRingGive(&ring, slotV, n);
+    taken += n;
+  }
+
+  for (int ix = 0; ix < PRODUCERS; ix++)
+  {
+    pthread_join(tid[ix], NULL);
+  }
+
+  EXPECT_EQ(PRODUCERS * PRODUCER_LINES, taken + (long) ring.overflows);
+  EXPECT_EQ(ring.head, ring.tail);
+
+  lmRingRelease(&ring);
+}
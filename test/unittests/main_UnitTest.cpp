@@ -65,6 +65,8 @@ int           logFd                 = -1;
 int           fwdPort               = -1;
 int           subCacheInterval      = 10;
 unsigned int  cprForwardLimit       = 1000;
+long          cprForwardDeadline    = 0;
+bool          noCreateFastPath      = false;
 bool          noCache               = false;
 bool          insecureNotif         = false;
 char          fwdHost[64];
@@ -138,7 +140,7 @@ int main(int argC, char** argV)
   paParse(paArgs, argC, (char**) argV, 1, false);
 
   LM_M(("Init tests"));
-  orionInit(exitFunction, orionUnitTestVersion, SemReadWriteOp, false, false, false, false, false);
+  orionInit(exitFunction, orionUnitTestVersion, SemReadWriteOp, false, false, false, false, false, false, false, false);
   // Note that multitenancy and mutex time stats are disabled for unit test mongo init
   mongoInit(dbHost, rplSet, dbName, user, pwd, false, dbTimeout, writeConcern, dbPoolSize, false);
   alarmMgr.init(false);
@@ -0,0 +1,198 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <stdio.h>
+#include <pthread.h>
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include "metricsMgr/MetricsManager.h"
+
+
+
+/* ****************************************************************************
+*
+* ADDS - number of add() calls of the concurrent test (spread over the threads)
+*/
+#define ADDS  80000
+
+
+
+/* ****************************************************************************
+*
+* AdderParams -
+*/
+typedef struct AdderParams
+{
+  MetricsManager*  mgrP;
+  int              adds;
+  int              threadNo;
+} AdderParams;
+
+
+
+/* ****************************************************************************
+*
+* adder -
+*
+* Each thread adds to the metrics of 4 subservices of its own service, as a broker
+* thread serving requests of a few tenants would do.
+*/
+static void* adder(void* p)
+{
+  AdderParams*  paramsP = (AdderParams*) p;
+  char          srv[32];
+  std::string   subServV[] = { "/sp1", "/sp2", "/sp3", "/sp4" };
+
+  snprintf(srv, sizeof(srv), "s%d", paramsP->threadNo % 8);
+
+  for (int ix = 0; ix < paramsP->adds; ++ix)
+  {
+    paramsP->mgrP->add(srv, subServV[ix % 4], METRIC_TRANS_IN, 1);
+  }
+
+  return NULL;
+}
+
+
+
+/* ****************************************************************************
+*
+* addAndRender -
+*/
+TEST(MetricsManager, addAndRender)
+{
+  MetricsManager mgr;
+
+  mgr.init(true, false);
+
+  mgr.add("s1", "/sp1",   METRIC_TRANS_IN, 1);
+  mgr.add("s1", "/sp1/#", METRIC_TRANS_IN, 1);    // same subservice for metrics
+  mgr.add("s1", "/sp1",   METRIC_TRANS_IN_RESP_SIZE, 100);
+  mgr.add("s2", "",       METRIC_TRANS_IN, 3);
+  mgr.add("s 3", "/sp1",  METRIC_TRANS_IN, 1);    // invalid service, skipped
+
+  std::string expected =
+    "{\"services\":{"
+      "\"s1\":{\"subservs\":{\"sp1\":{\"incomingTransactionResponseSize\":100,\"incomingTransactions\":2}},"
+              "\"sum\":{\"incomingTransactionResponseSize\":100,\"incomingTransactions\":2}},"
+      "\"s2\":{\"subservs\":{\"root-subserv\":{\"incomingTransactions\":3}},"
+              "\"sum\":{\"incomingTransactions\":3}}},"
+    "\"sum\":{\"subservs\":{\"root-subserv\":{\"incomingTransactions\":3},"
+                          "\"sp1\":{\"incomingTransactionResponseSize\":100,\"incomingTransactions\":2}},"
+             "\"sum\":{\"incomingTransactionResponseSize\":100,\"incomingTransactions\":5}}}";
+
+  EXPECT_EQ(expected, mgr.toJson(true));
+  EXPECT_EQ("{\"services\":{},\"sum\":{\"subservs\":{},\"sum\":{}}}", mgr.toJson(false));
+
+  mgr.add("s2", "", METRIC_TRANS_IN, 1);
+  mgr.reset();
+  EXPECT_EQ("{\"services\":{},\"sum\":{\"subservs\":{},\"sum\":{}}}", mgr.toJson(false));
+
+  mgr.release();
+}
+
+
+
+/* ****************************************************************************
+*
+* concurrentAdds -
+*
+* No add() is lost when many threads add at the same time to the same blocks
+*/
+TEST(MetricsManager, concurrentAdds)
+{
+  const int       threads = 16;
+  AdderParams     paramsV[threads];
+  pthread_t       tidV[threads];
+  MetricsManager  mgr;
+  char            total[64];
+
+  mgr.init(true, false);
+
+  for (int ix = 0; ix < threads; ++ix)
+  {
+    paramsV[ix].mgrP     = &mgr;
+    paramsV[ix].adds     = ADDS / threads;
+    paramsV[ix].threadNo = ix;
+
+    pthread_create(&tidV[ix], NULL, adder, &paramsV[ix]);
+  }
+
+  for (int ix = 0; ix < threads; ++ix)
+  {
+    pthread_join(tidV[ix], NULL);
+  }
+
+  // All the adds are in the grand total
+  snprintf(total, sizeof(total), "\"sum\":{\"incomingTransactions\":%d}}}", (ADDS / threads) * threads);
+  EXPECT_NE(std::string::npos, mgr.toJson(false).find(total));
+
+  mgr.release();
+}
+
+
+
+/* ****************************************************************************
+*
+* managers -
+*
+* The blocks a thread keeps in its cache belong to a given manager: another manager
+* (or the same one after release()) does not use them.
+*/
+TEST(MetricsManager, managers)
+{
+  const char*     expected = "\"sum\":{\"incomingTransactions\":1}}}";
+  MetricsManager  mgr1;
+  MetricsManager* mgr2P = new MetricsManager();
+
+  mgr1.init(true, false);
+  mgr2P->init(true, false);
+
+  mgr1.add("s1", "/sp1", METRIC_TRANS_IN, 1);
+  mgr2P->add("s1", "/sp1", METRIC_TRANS_IN, 1);
+
+  EXPECT_NE(std::string::npos, mgr1.toJson(false).find(expected));
+  EXPECT_NE(std::string::npos, mgr2P->toJson(false).find(expected));
+
+  // A manager created where a deleted one was
+  mgr2P->release();
+  delete mgr2P;
+  mgr2P = new MetricsManager();
+  mgr2P->init(true, false);
+
+  mgr2P->add("s1", "/sp1", METRIC_TRANS_IN, 1);
+  EXPECT_NE(std::string::npos, mgr2P->toJson(false).find(expected));
+
+  mgr2P->release();
+  delete mgr2P;
+
+  // The same manager after release()
+  mgr1.release();
+  mgr1.add("s1", "/sp1", METRIC_TRANS_IN, 1);
+  EXPECT_NE(std::string::npos, mgr1.toJson(false).find(expected));
+
+  mgr1.release();
+}
@@ -0,0 +1,246 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "mongo/client/dbclient.h"
+
+#include "logMsg/logMsg.h"
+#include "logMsg/traceLevels.h"
+#include "common/globals.h"
+#include "orionTypes/OrionValueType.h"
+#include "parse/CompoundValueNode.h"
+#include "apiTypesV2/Entity.h"
+#include "rest/OrionError.h"
+#include "mongoBackend/MongoGlobal.h"
+#include "mongoBackend/mongoUpdateContext.h"
+#include "mongoBackend/mongoCreateEntity.h"
+#include "ngsi/Metadata.h"
+#include "ngsi10/UpdateContextRequest.h"
+#include "ngsi10/UpdateContextResponse.h"
+
+#include "unittests/unittest.h"
+
+
+
+/* ****************************************************************************
+*
+* USING
+*/
+using mongo::DBClientBase;
+using mongo::BSONObj;
+
+
+
+/* ****************************************************************************
+*
+* Tests
+*
+* - sameDocAsUpdateContext
+* - alreadyExists
+* - duplicatedAttribute
+*/
+
+
+
+/* ****************************************************************************
+*
+* prepareDatabase -
+*/
+static void prepareDatabase(void)
+{
+  setupDatabase();
+
+  DBClientBase* connection = getMongoConnection();
+
+  BSONObj en1 = BSON("_id" << BSON("id" << "E1" << "type" << "T1" << "servicePath" << "/") <<
+                     "attrNames" << BSON_ARRAY("A1") <<
+                     "attrs" << BSON("A1" << BSON("type" << "TA1" << "value" << "val1")));
+
+  connection->insert(ENTITIES_COLL, en1);
+}
+
+
+
+/* ****************************************************************************
+*
+* entityFill -
+*
+* An entity with the different kinds of attributes: with and without type, with
+* metadata, with compound value and with location.
+*/
+static void entityFill(Entity* eP)
+{
+  orion::CompoundValueNode*  cvP = new orion::CompoundValueNode(orion::ValueTypeVector);
+  ContextAttribute*          caP;
+
+  eP->id   = "E2";
+  eP->type = "T2";
+
+  caP = new ContextAttribute("A1", "TA1", "val1");
+  caP->typeGiven = true;
+  caP->metadataVector.push_back(new Metadata("M1", "TM1", "md1"));
+  eP->attributeVector.push_back(caP);
+
+  caP = new ContextAttribute("A2", "", 42.0);
+  eP->attributeVector.push_back(caP);
+
+  cvP->add(orion::ValueTypeString, "", "a");
+  cvP->add(orion::ValueTypeNumber, "", 1.5);
+  caP = new ContextAttribute("A3", "", cvP);
+  eP->attributeVector.push_back(caP);
+
+  caP = new ContextAttribute("A4", "geo:point", "40.4, -3.7");
+  caP->typeGiven = true;
+  eP->attributeVector.push_back(caP);
+}
+
+
+
+/* ****************************************************************************
+*
+* sameDocAsUpdateContext -
+*
+* The entity created by mongoCreateEntity() has to be exactly the one created by
+* mongoUpdateContext() (APPEND_STRICT on create, as POST /v2/entities did before).
+*/
+TEST(mongoCreateEntity, sameDocAsUpdateContext)
+{
+  UpdateContextRequest   req;
+  UpdateContextResponse  res;
+  Entity                 en1;
+  Entity                 en2;
+  OrionError             oe;
+  BSONObj                doc1;
+  BSONObj                doc2;
+
+  utInit();
+
+  prepareDatabase();
+
+  DBClientBase* connection = getMongoConnection();
+
+  /* Through mongoUpdateContext */
+  entityFill(&en1);
+  req.fill(&en1, "APPEND_STRICT");
+
+  servicePathVector.clear();
+  servicePathVector.push_back("/");
+  mongoUpdateContext(&req, &res, "", servicePathVector, uriParams, "", "", "", V2, NGSIV2_FLAVOUR_ONCREATE);
+
+  EXPECT_EQ(SccNone, res.oe.code);
+  doc1 = connection->findOne(ENTITIES_COLL, BSON("_id.id" << "E2")).getOwned();
+  connection->remove(ENTITIES_COLL, BSON("_id.id" << "E2"));
+
+  /* Through mongoCreateEntity */
+  entityFill(&en2);
+  mongoCreateEntity(&en2, &oe, "", servicePathVector, "", "");
+
+  EXPECT_EQ(SccNone, oe.code);
+  doc2 = connection->findOne(ENTITIES_COLL, BSON("_id.id" << "E2")).getOwned();
+
+  ASSERT_FALSE(doc1.isEmpty());
+  EXPECT_EQ(doc1.toString(), doc2.toString());
+  EXPECT_TRUE(doc2.hasField("location"));
+  EXPECT_EQ(2, connection->count(ENTITIES_COLL, BSONObj()));
+
+  req.release();
+  en1.release();
+  en2.release();
+
+  utExit();
+}
+
+
+
+/* ****************************************************************************
+*
+* alreadyExists -
+*/
+TEST(mongoCreateEntity, alreadyExists)
+{
+  Entity      en;
+  OrionError  oe;
+
+  utInit();
+
+  prepareDatabase();
+
+  en.id   = "E1";
+  en.type = "T1";
+  en.attributeVector.push_back(new ContextAttribute("A2", "TA2", "val2"));
+
+  servicePathVector.clear();
+  servicePathVector.push_back("/");
+  mongoCreateEntity(&en, &oe, "", servicePathVector, "", "");
+
+  EXPECT_EQ(SccInvalidModification, oe.code);
+  EXPECT_EQ("Already Exists", oe.details);
+  EXPECT_EQ("Unprocessable", oe.reasonPhrase);
+
+  DBClientBase* connection = getMongoConnection();
+  BSONObj       ent        = connection->findOne(ENTITIES_COLL, BSON("_id.id" << "E1"));
+
+  EXPECT_EQ(1, connection->count(ENTITIES_COLL, BSONObj()));
+  EXPECT_FALSE(ent.getField("attrs").embeddedObject().hasField("A2"));
+
+  en.release();
+
+  utExit();
+}
+
+
+
+/* ****************************************************************************
+*
+* duplicatedAttribute -
+*/
+TEST(mongoCreateEntity, duplicatedAttribute)
+{
+  Entity      en;
+  OrionError  oe;
+
+  utInit();
+
+  prepareDatabase();
+
+  en.id   = "E3";
+  en.type = "T3";
+  en.attributeVector.push_back(new ContextAttribute("A1", "TA1", "val1"));
+  en.attributeVector.push_back(new ContextAttribute("A1", "TA1", "val2"));
+
+  servicePathVector.clear();
+  servicePathVector.push_back("/");
+  mongoCreateEntity(&en, &oe, "", servicePathVector, "", "");
+
+  EXPECT_EQ(SccBadRequest, oe.code);
+  EXPECT_EQ("duplicated attribute /A1/", oe.details);
+  EXPECT_EQ(1, getMongoConnection()->count(ENTITIES_COLL, BSONObj()));
+
+  en.release();
+
+  utExit();
+}
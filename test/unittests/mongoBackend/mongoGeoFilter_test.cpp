@@ -0,0 +1,256 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <stdio.h>
+
+#include <set>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "mongo/client/dbclient.h"
+
+#include "logMsg/logMsg.h"
+#include "logMsg/traceLevels.h"
+
+#include "common/globals.h"
+#include "mongoBackend/MongoGlobal.h"
+#include "ngsi/Scope.h"
+#include "orionTypes/GeoFilter.h"
+
+#include "unittests/unittest.h"
+
+
+
+/* ****************************************************************************
+*
+* USING
+*/
+using mongo::DBClientBase;
+using mongo::DBClientCursor;
+using mongo::BSONObj;
+
+
+
+/* ****************************************************************************
+*
+* Tests
+*
+* The result of orion::GeoFilter (the in-memory georel check used for subscriptions)
+* is compared with the result of the equivalent query in MongoDB, for a grid of entities
+* around Madrid:
+*
+* - near
+* - polygon
+* - box
+* - point
+*/
+
+
+
+/* ****************************************************************************
+*
+* GRID_SIZE - the grid has GRID_SIZE x GRID_SIZE entities, 0.05 degrees apart
+*/
+#define GRID_SIZE  21
+
+
+
+/* ****************************************************************************
+*
+* gridLat, gridLon -
+*
+* Computed as a division so the coordinates are the same doubles that strtod() gets for
+* them (e.g. "40.05"), which allows to use grid points in the subscription coords.
+*/
+static double gridLat(int ix) { return (4000 + 5 * ix) / 100.0; }
+static double gridLon(int jx) { return (-420 + 5 * jx) / 100.0; }
+
+
+
+/* ****************************************************************************
+*
+* prepareDatabase -
+*/
+static void prepareDatabase(void)
+{
+  setupDatabase();
+
+  DBClientBase* connection = getMongoConnection();
+
+  connection->createIndex(ENTITIES_COLL, BSON("location.coords" << "2dsphere"));
+
+  for (int ix = 0; ix < GRID_SIZE; ++ix)
+  {
+    for (int jx = 0; jx < GRID_SIZE; ++jx)
+    {
+      char id[32];
+
+      snprintf(id, sizeof(id), "E_%02d_%02d", ix, jx);
+
+      BSONObj coords = BSON("type" << "Point" << "coordinates" << BSON_ARRAY(gridLon(jx) << gridLat(ix)));
+      BSONObj en     = BSON("_id" << BSON("id" << id << "type" << "T" << "servicePath" << "/") <<
+                            "attrNames" << BSON_ARRAY("location") <<
+                            "attrs" << BSON("location" << BSON("type" << "geo:point" << "value" << "")) <<
+                            "location" << BSON("attrName" << "location" << "coords" << coords));
+
+      connection->insert(ENTITIES_COLL, en);
+    }
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* checkAgainstDb -
+*
+* Returns the number of entities for which the in-memory result is undecided (that is,
+* the ones for which the DB would be queried).
+*/
+static int checkAgainstDb(const std::string& geometry, const std::string& coords, const std::string& georel)
+{
+  orion::GeoFilter       geoFilter;
+  Scope                  scope;
+  std::string            err;
+  BSONObj                areaFilter;
+  std::set<std::string>  dbMatches;
+  int                    undecided = 0;
+
+  EXPECT_TRUE(geoFilter.compile(geometry, coords, georel));
+  EXPECT_EQ(0, scope.fill(V2, geometry, coords, georel, &err));
+  EXPECT_TRUE(processAreaScopeV2(&scope, &areaFilter));
+  scope.release();
+
+  DBClientBase*                  connection = getMongoConnection();
+  std::auto_ptr<DBClientCursor>  cursor     = connection->query(ENTITIES_COLL, BSON("location.coords" << areaFilter));
+
+  while (cursor->more())
+  {
+    dbMatches.insert(cursor->next().getFieldDotted("_id.id").String());
+  }
+
+  for (int ix = 0; ix < GRID_SIZE; ++ix)
+  {
+    for (int jx = 0; jx < GRID_SIZE; ++jx)
+    {
+      char id[32];
+
+      snprintf(id, sizeof(id), "E_%02d_%02d", ix, jx);
+
+      orion::GeoFilterResult result = geoFilter.match(gridLat(ix), gridLon(jx));
+
+      if (result == orion::GeoUndecided)
+      {
+        ++undecided;
+        continue;
+      }
+
+      EXPECT_EQ(dbMatches.count(id) == 1, result == orion::GeoMatch) << id << " with " << geometry << " " << coords << " " << georel;
+    }
+  }
+
+  return undecided;
+}
+
+
+
+/* ****************************************************************************
+*
+* near -
+*/
+TEST(mongoGeoFilter, near)
+{
+  utInit();
+
+  prepareDatabase();
+
+  EXPECT_EQ(0, checkAgainstDb("point", "40.418889,-3.691944", "near;maxDistance:20000"));
+  EXPECT_EQ(0, checkAgainstDb("point", "40.418889,-3.691944", "near;minDistance:30000"));
+  EXPECT_EQ(0, checkAgainstDb("point", "40.418889,-3.691944", "near;maxDistance:40000;minDistance:10000"));
+
+  utExit();
+}
+
+
+
+/* ****************************************************************************
+*
+* polygon -
+*
+* Three entities are undecided: the first vertex of the polygon (a grid point) and two
+* more very close to its edges
+*/
+TEST(mongoGeoFilter, polygon)
+{
+  const char* coords = "40.1,-4.1;40.8,-4.03;40.63,-3.41;40.12,-3.55;40.1,-4.1";
+
+  utInit();
+
+  prepareDatabase();
+
+  EXPECT_EQ(3, checkAgainstDb("polygon", coords, "coveredBy"));
+  EXPECT_EQ(3, checkAgainstDb("polygon", coords, "intersects"));
+  EXPECT_EQ(3, checkAgainstDb("polygon", coords, "disjoint"));
+  EXPECT_EQ(0, checkAgainstDb("polygon", coords, "equals"));
+
+  utExit();
+}
+
+
+
+/* ****************************************************************************
+*
+* box -
+*/
+TEST(mongoGeoFilter, box)
+{
+  utInit();
+
+  prepareDatabase();
+
+  EXPECT_EQ(0, checkAgainstDb("box", "40.21,-4.02;40.77,-3.38", "coveredBy"));
+  EXPECT_EQ(0, checkAgainstDb("box", "40.21,-4.02;40.77,-3.38", "intersects"));
+  EXPECT_EQ(0, checkAgainstDb("box", "40.21,-4.02;40.77,-3.38", "disjoint"));
+
+  utExit();
+}
+
+
+
+/* ****************************************************************************
+*
+* point -
+*/
+TEST(mongoGeoFilter, point)
+{
+  utInit();
+
+  prepareDatabase();
+
+  EXPECT_EQ(0, checkAgainstDb("point", "40.5,-3.7", "equals"));
+  EXPECT_EQ(0, checkAgainstDb("point", "40.5,-3.7", "intersects"));
+  EXPECT_EQ(0, checkAgainstDb("point", "40.5,-3.7", "disjoint"));
+
+  utExit();
+}
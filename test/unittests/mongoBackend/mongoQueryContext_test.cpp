@@ -80,6 +80,11 @@ extern void setMongoConnectionForUnitTest(DBClientBase* _connection);
 * - paginationNonExisting
 * - paginationNonExistingOverlap
 * - paginationNonExistingDetails
+* - paginationCursor
+* - paginationCursorOrderBy
+* - paginationCursorInvalid
+* - paginationCursorMixedTypes
+* - paginationCursorReverseMixedTypes
 *
 * With servicePath:
 *
@@ -603,6 +608,73 @@ static void prepareDatabaseForPagination(void)
   connection->insert(ENTITIES_COLL, e06);
 }
 
+/* ****************************************************************************
+*
+* prepareDatabaseForCursorPagination -
+*
+*/
+static void prepareDatabaseForCursorPagination(void)
+{
+  /* Set database */
+  setupDatabase();
+
+  DBClientBase* connection = getMongoConnection();
+
+  /* We create the following entities, with values of different types for A1, or without A1:
+   *
+   * - E1:  { Type: T, Attribute: { A1, 3    } }
+   * - E2:  { Type: T, Attribute: { A1, "x"  } }
+   * - E3:  { Type: T, Attribute: { A2, 1    } }
+   * - E4:  { Type: T, Attribute: { A1, 10   } }
+   * - E5:  { Type: T, Attribute: { A1, true } }
+   * - E6:  { Type: T, Attribute: { A1, null } }
+   * - E7:  { Type: T, Attribute: { A1, "a"  } }
+   * - E8:  { Type: T, Attribute: { A2, 2    } }
+   *
+   */
+
+  BSONObj e01 = BSON("_id" << BSON("id" << "E1"  << "type" << "T") <<
+                     "attrNames" << BSON_ARRAY("A1") <<
+                     "attrs" << BSON("A1" << BSON("type" << "TA1" << "value" << 3.0)));
+
+  BSONObj e02 = BSON("_id" << BSON("id" << "E2"  << "type" << "T") <<
+                     "attrNames" << BSON_ARRAY("A1") <<
+                     "attrs" << BSON("A1" << BSON("type" << "TA1" << "value" << "x")));
+
+  BSONObj e03 = BSON("_id" << BSON("id" << "E3"  << "type" << "T") <<
+                     "attrNames" << BSON_ARRAY("A2") <<
+                     "attrs" << BSON("A2" << BSON("type" << "TA2" << "value" << 1.0)));
+
+  BSONObj e04 = BSON("_id" << BSON("id" << "E4"  << "type" << "T") <<
+                     "attrNames" << BSON_ARRAY("A1") <<
+                     "attrs" << BSON("A1" << BSON("type" << "TA1" << "value" << 10.0)));
+
+  BSONObj e05 = BSON("_id" << BSON("id" << "E5"  << "type" << "T") <<
+                     "attrNames" << BSON_ARRAY("A1") <<
+                     "attrs" << BSON("A1" << BSON("type" << "TA1" << "value" << true)));
+
+  BSONObj e06 = BSON("_id" << BSON("id" << "E6"  << "type" << "T") <<
+                     "attrNames" << BSON_ARRAY("A1") <<
+                     "attrs" << BSON("A1" << BSON("type" << "TA1" << "value" << BSONNULL)));
+
+  BSONObj e07 = BSON("_id" << BSON("id" << "E7"  << "type" << "T") <<
+                     "attrNames" << BSON_ARRAY("A1") <<
+                     "attrs" << BSON("A1" << BSON("type" << "TA1" << "value" << "a")));
+
+  BSONObj e08 = BSON("_id" << BSON("id" << "E8"  << "type" << "T") <<
+                     "attrNames" << BSON_ARRAY("A2") <<
+                     "attrs" << BSON("A2" << BSON("type" << "TA2" << "value" << 2.0)));
+
+  connection->insert(ENTITIES_COLL, e01);
+  connection->insert(ENTITIES_COLL, e02);
+  connection->insert(ENTITIES_COLL, e03);
+  connection->insert(ENTITIES_COLL, e04);
+  connection->insert(ENTITIES_COLL, e05);
+  connection->insert(ENTITIES_COLL, e06);
+  connection->insert(ENTITIES_COLL, e07);
+  connection->insert(ENTITIES_COLL, e08);
+}
+
 /* ****************************************************************************
 *
 * prepareDatabaseDifferentNativeTypes -
@@ -1153,6 +1225,246 @@ TEST(mongoQueryContextRequest, paginationNonExistingDetails)
     utExit();
 }
 
+/* ****************************************************************************
+*
+* paginationCursor -
+*
+* Walks all the entities in pages of 4, 4 and 2 entities, with the cursor returned by
+* each page. There is no cursor after the last (not full) page.
+*/
+TEST(mongoQueryContextRequest, paginationCursor)
+{
+    HttpStatusCode         ms;
+    QueryContextRequest   req;
+    QueryContextResponse  res1;
+    QueryContextResponse  res2;
+    std::string           nextCursor;
+
+    utInit();
+
+    /* Prepare database */
+    prepareDatabaseForPagination();
+
+    /* Forge the request (from "inside" to "outside") */
+    EntityId en("E.*", "T", "true");
+    req.entityIdVector.push_back(&en);
+    uriParams[URI_PARAM_PAGINATION_LIMIT] = "4";
+
+    /* Invoke the function in mongoBackend library (first page) */
+    ms = mongoQueryContext(&req, &res1, "", servicePathVector, uriParams, options, NULL, V2, &nextCursor);
+
+    /* Check response is as expected */
+    EXPECT_EQ(SccOk, ms);
+    EXPECT_EQ(SccNone, res1.errorCode.code);
+    ASSERT_EQ(4, res1.contextElementResponseVector.size());
+    EXPECT_EQ("E1", res1.contextElementResponseVector[0]->contextElement.entityId.id);
+    EXPECT_EQ("E4", res1.contextElementResponseVector[3]->contextElement.entityId.id);
+    EXPECT_NE("", nextCursor);
+
+    /* Invoke the function in mongoBackend library (second and last page) */
+    uriParams[URI_PARAM_PAGINATION_CURSOR] = nextCursor;
+    ms = mongoQueryContext(&req, &res2, "", servicePathVector, uriParams, options, NULL, V2, &nextCursor);
+
+    /* Check response is as expected */
+    EXPECT_EQ(SccOk, ms);
+    EXPECT_EQ(SccNone, res2.errorCode.code);
+    ASSERT_EQ(2, res2.contextElementResponseVector.size());
+    EXPECT_EQ("E5", res2.contextElementResponseVector[0]->contextElement.entityId.id);
+    EXPECT_EQ("E6", res2.contextElementResponseVector[1]->contextElement.entityId.id);
+    EXPECT_EQ("", nextCursor);
+
+    utExit();
+}
+
+/* ****************************************************************************
+*
+* paginationCursorOrderBy -
+*
+* Reverse order by attribute, in pages of 5 entities, so the last page is full and the
+* next one is empty.
+*/
+TEST(mongoQueryContextRequest, paginationCursorOrderBy)
+{
+    HttpStatusCode         ms;
+    QueryContextRequest   req;
+    QueryContextResponse  res1;
+    QueryContextResponse  res2;
+    QueryContextResponse  res3;
+    std::string           nextCursor;
+
+    utInit();
+
+    /* Prepare database */
+    prepareDatabaseForPagination();
+
+    /* Forge the request (from "inside" to "outside") */
+    EntityId en("E.*", "T", "true");
+    req.entityIdVector.push_back(&en);
+    uriParams[URI_PARAM_PAGINATION_LIMIT] = "5";
+    uriParams[URI_PARAM_SORTED]           = "!A1";
+
+    /* Invoke the function in mongoBackend library (first page) */
+    ms = mongoQueryContext(&req, &res1, "", servicePathVector, uriParams, options, NULL, V2, &nextCursor);
+
+    EXPECT_EQ(SccOk, ms);
+    ASSERT_EQ(5, res1.contextElementResponseVector.size());
+    EXPECT_EQ("E6", res1.contextElementResponseVector[0]->contextElement.entityId.id);
+    EXPECT_EQ("E2", res1.contextElementResponseVector[4]->contextElement.entityId.id);
+    EXPECT_NE("", nextCursor);
+
+    /* Second page */
+    uriParams[URI_PARAM_PAGINATION_CURSOR] = nextCursor;
+    ms = mongoQueryContext(&req, &res2, "", servicePathVector, uriParams, options, NULL, V2, &nextCursor);
+
+    EXPECT_EQ(SccOk, ms);
+    ASSERT_EQ(1, res2.contextElementResponseVector.size());
+    EXPECT_EQ("E1", res2.contextElementResponseVector[0]->contextElement.entityId.id);
+    EXPECT_EQ("", nextCursor);
+
+    /* The cursor of a query with a different orderBy is not valid */
+    uriParams[URI_PARAM_SORTED] = "A1";
+    ms = mongoQueryContext(&req, &res3, "", servicePathVector, uriParams, options, NULL, V2, &nextCursor);
+
+    EXPECT_EQ(SccOk, ms);
+    EXPECT_EQ(SccBadRequest, res3.errorCode.code);
+
+    uriParams[URI_PARAM_SORTED] = "";
+
+    utExit();
+}
+
+/* ****************************************************************************
+*
+* paginationCursorInvalid -
+*
+*/
+TEST(mongoQueryContextRequest, paginationCursorInvalid)
+{
+    HttpStatusCode         ms;
+    QueryContextRequest   req;
+    QueryContextResponse  res1;
+    QueryContextResponse  res2;
+    std::string           nextCursor;
+
+    utInit();
+
+    /* Prepare database */
+    prepareDatabaseForPagination();
+
+    /* Forge the request (from "inside" to "outside") */
+    EntityId en("E.*", "T", "true");
+    req.entityIdVector.push_back(&en);
+
+    /* Not a cursor */
+    uriParams[URI_PARAM_PAGINATION_CURSOR] = "0123456789abcdef";
+    ms = mongoQueryContext(&req, &res1, "", servicePathVector, uriParams, options, NULL, V2, &nextCursor);
+
+    EXPECT_EQ(SccOk, ms);
+    EXPECT_EQ(SccBadRequest, res1.errorCode.code);
+    EXPECT_EQ("Invalid pagination cursor (for the orderBy of this query)", res1.errorCode.details);
+    EXPECT_EQ(0, res1.contextElementResponseVector.size());
+
+    /* Cursor and offset */
+    uriParams[URI_PARAM_PAGINATION_CURSOR] = "";
+    uriParams[URI_PARAM_PAGINATION_OFFSET] = "2";
+    ms = mongoQueryContext(&req, &res2, "", servicePathVector, uriParams, options, NULL, V2, &nextCursor);
+
+    EXPECT_EQ(SccOk, ms);
+    EXPECT_EQ(SccBadRequest, res2.errorCode.code);
+    EXPECT_EQ("Incompatible parameters: offset, cursor", res2.errorCode.details);
+
+    utExit();
+}
+
+/* ****************************************************************************
+*
+* cursorPages -
+*
+* Walks all the entities of prepareDatabaseForCursorPagination with the given orderBy, in
+* pages of 3 entities, following the cursor returned by each page. The ids of the entities
+* are returned, with the pages separated by '|'.
+*/
+static std::string cursorPages(const std::string& orderBy)
+{
+    EntityId     en("E.*", "T", "true");
+    std::string  nextCursor;
+    std::string  pages;
+
+    uriParams[URI_PARAM_PAGINATION_LIMIT]  = "3";
+    uriParams[URI_PARAM_SORTED]            = orderBy;
+    uriParams[URI_PARAM_PAGINATION_CURSOR] = "";
+
+    for (int page = 0; page < 10; ++page)
+    {
+        QueryContextRequest   req;
+        QueryContextResponse  res;
+
+        req.entityIdVector.push_back(&en);
+
+        HttpStatusCode ms = mongoQueryContext(&req, &res, "", servicePathVector, uriParams, options, NULL, V2, &nextCursor);
+
+        EXPECT_EQ(SccOk, ms);
+        EXPECT_EQ(SccNone, res.errorCode.code);
+
+        pages += (page == 0)? "" : "|";
+        for (unsigned int ix = 0; ix < res.contextElementResponseVector.size(); ++ix)
+        {
+            pages += (ix == 0)? "" : ",";
+            pages += res.contextElementResponseVector[ix]->contextElement.entityId.id;
+        }
+
+        if (nextCursor == "")
+        {
+            break;
+        }
+
+        uriParams[URI_PARAM_PAGINATION_CURSOR] = nextCursor;
+    }
+
+    uriParams[URI_PARAM_SORTED]            = "";
+    uriParams[URI_PARAM_PAGINATION_CURSOR] = "";
+
+    return pages;
+}
+
+/* ****************************************************************************
+*
+* paginationCursorMixedTypes -
+*
+* MongoDB sorts the values of different types as null (or missing) < numbers < strings <
+* booleans. The pages must follow that order, also across the types.
+*/
+TEST(mongoQueryContextRequest, paginationCursorMixedTypes)
+{
+    utInit();
+
+    /* Prepare database */
+    prepareDatabaseForCursorPagination();
+
+    EXPECT_EQ("E3,E6,E8|E1,E4,E7|E2,E5", cursorPages("A1"));
+
+    utExit();
+}
+
+/* ****************************************************************************
+*
+* paginationCursorReverseMixedTypes -
+*
+* Reverse order: the entities with null or without the attribute go last, after the
+* numbers, and are not lost when the cursor of the previous page is not null.
+*/
+TEST(mongoQueryContextRequest, paginationCursorReverseMixedTypes)
+{
+    utInit();
+
+    /* Prepare database */
+    prepareDatabaseForCursorPagination();
+
+    EXPECT_EQ("E5,E2,E7|E4,E1,E8|E6,E3", cursorPages("!A1"));
+
+    utExit();
+}
+
 /* ****************************************************************************
 *
 * queryWithServicePathEntPatternType_2levels -
@@ -32,6 +32,7 @@
 #include "common/globals.h"
 #include "mongoBackend/MongoGlobal.h"
 #include "mongoBackend/mongoQueryTypes.h"
+#include "mongoBackend/mongoTypesCatalog.h"
 #include "orionTypes/EntityTypeVectorResponse.h"
 #include "orionTypes/EntityTypeResponse.h"
 
@@ -84,6 +85,10 @@ extern void setMongoConnectionForUnitTest(DBClientBase* _connection);
 * - queryGivenTypePaginationNonExistingOverlap
 * - queryGivenTypePaginationNonExistingDetails
 *
+* - queryAllTypeCatalog
+* - queryGivenTypeCatalog
+* - queryGivenTypeCatalogUpdated
+*
 * - queryAllDbException
 * - queryAllGenericException
 * - queryGivenTypeDbException
@@ -877,6 +882,176 @@ TEST(mongoQueryTypes, queryAllPaginationNonExistingDetails)
     utExit();
 }
 
+/* ****************************************************************************
+*
+* queryAllTypeCatalog -
+*
+* Same as queryAllType, but with the response taken from the entity types catalog
+*/
+TEST(mongoQueryTypes, queryAllTypeCatalog)
+{
+    HttpStatusCode            ms;
+    EntityTypeVectorResponse  res;
+    std::string               err;
+
+    utInit();
+
+    /* Prepare database */
+    prepareDatabase();
+    ASSERT_TRUE(typesCatalogRebuild("", &err));
+
+    /* Invoke the function in mongoBackend library */
+    ms = mongoEntityTypes(&res, "", servicePathVector, uriParams, V1, NULL, false);
+
+    /* Check response is as expected */
+    EXPECT_EQ(SccOk, ms);
+
+    EXPECT_EQ(SccOk, res.statusCode.code);
+    EXPECT_EQ("OK", res.statusCode.reasonPhrase);
+    EXPECT_EQ("", res.statusCode.details);
+
+    ASSERT_EQ(3, res.entityTypeVector.size());
+    ContextAttribute* ca;
+
+    /* Type # 1 */
+    EXPECT_EQ("Car", res.entityTypeVector[0]->type);
+    EXPECT_EQ(3, res.entityTypeVector[0]->count);
+    ASSERT_EQ(5, res.entityTypeVector[0]->contextAttributeVector.size());
+
+    ca = getAttr(res.entityTypeVector[0]->contextAttributeVector, "plate");
+    EXPECT_EQ("plate", ca->name);
+    EXPECT_EQ("plate_T", ca->type);
+
+    ca = getAttr(res.entityTypeVector[0]->contextAttributeVector, "colour");
+    EXPECT_EQ("colour", ca->name);
+    EXPECT_EQ("colour_T", ca->type);
+
+    /* Type # 2 */
+    EXPECT_EQ("Lamp", res.entityTypeVector[1]->type);
+    EXPECT_EQ(1, res.entityTypeVector[1]->count);
+    ASSERT_EQ(2, res.entityTypeVector[1]->contextAttributeVector.size());
+
+    ca = getAttr(res.entityTypeVector[1]->contextAttributeVector, "battery");
+    EXPECT_EQ("battery", ca->name);
+    EXPECT_EQ("battery_T", ca->type);
+
+    /* Type # 3 */
+    EXPECT_EQ("Room", res.entityTypeVector[2]->type);
+    EXPECT_EQ(2, res.entityTypeVector[2]->count);
+    ASSERT_EQ(3, res.entityTypeVector[2]->contextAttributeVector.size());
+
+    ca = getAttr(res.entityTypeVector[2]->contextAttributeVector, "humidity");
+    EXPECT_EQ("humidity", ca->name);
+    EXPECT_EQ("humidity_T", ca->type);
+
+    utExit();
+}
+
+/* ****************************************************************************
+*
+* queryGivenTypeCatalog -
+*
+* Same as queryGivenTypeBasic, but with the response taken from the entity types catalog,
+* in NGSIv2 (so both types of the plate attribute are included)
+*/
+TEST(mongoQueryTypes, queryGivenTypeCatalog)
+{
+    HttpStatusCode      ms;
+    EntityTypeResponse  res;
+    std::string         err;
+
+    utInit();
+
+    /* Prepare database */
+    prepareDatabase();
+    ASSERT_TRUE(typesCatalogRebuild("", &err));
+
+    /* Invoke the function in mongoBackend library */
+    ms = mongoAttributesForEntityType("Car", &res, "", servicePathVector, uriParams, false, V2);
+
+    /* Check response is as expected */
+    EXPECT_EQ(SccOk, ms);
+
+    EXPECT_EQ(SccOk, res.statusCode.code);
+    EXPECT_EQ("OK", res.statusCode.reasonPhrase);
+    EXPECT_EQ("", res.statusCode.details);
+
+    EXPECT_EQ(3, res.entityType.count);
+    ASSERT_EQ(6, res.entityType.contextAttributeVector.size());
+
+    EXPECT_EQ("colour",   res.entityType.contextAttributeVector[0]->name);
+    EXPECT_EQ("colour_T", res.entityType.contextAttributeVector[0]->type);
+    EXPECT_EQ("fuel",     res.entityType.contextAttributeVector[1]->name);
+    EXPECT_EQ("fuel_T",   res.entityType.contextAttributeVector[1]->type);
+    EXPECT_EQ("plate",    res.entityType.contextAttributeVector[2]->name);
+    EXPECT_EQ("plate_T",  res.entityType.contextAttributeVector[2]->type);
+    EXPECT_EQ("plate",    res.entityType.contextAttributeVector[3]->name);
+    EXPECT_EQ("plate_T2", res.entityType.contextAttributeVector[3]->type);
+    EXPECT_EQ("pos",      res.entityType.contextAttributeVector[4]->name);
+    EXPECT_EQ("pos_T",    res.entityType.contextAttributeVector[4]->type);
+    EXPECT_EQ("temp",     res.entityType.contextAttributeVector[5]->name);
+    EXPECT_EQ("temp_T",   res.entityType.contextAttributeVector[5]->type);
+
+    utExit();
+}
+
+/* ****************************************************************************
+*
+* queryGivenTypeCatalogUpdated -
+*
+* Car3 is removed and the attribute 'temp' of Car1 changes its type, as processContextElement()
+* would do with the catalog
+*/
+TEST(mongoQueryTypes, queryGivenTypeCatalogUpdated)
+{
+    HttpStatusCode      ms;
+    EntityTypeResponse  res;
+    std::string         err;
+    TypesCatalogDelta   delta;
+
+    utInit();
+
+    /* Prepare database */
+    prepareDatabase();
+    ASSERT_TRUE(typesCatalogRebuild("", &err));
+
+    BSONObj car1 = BSON("_id" << BSON("id" << "Car1" << "type" << "Car") <<
+                        "attrs" << BSON(
+                          "pos"   << BSON("type" << "pos_T" << "value" << "1") <<
+                          "temp"  << BSON("type" << "temp_T" << "value" << "2") <<
+                          "plate" << BSON("type" << "plate_T" << "value" << "3")));
+    BSONObj car3 = BSON("_id" << BSON("id" << "Car3" << "type" << "Car") <<
+                        "attrs" << BSON(
+                          "pos"    << BSON("type" << "pos_T" << "value" << "7") <<
+                          "colour" << BSON("type" << "colour_T" << "value" << "8")));
+
+    typesCatalogEntityDelta(&delta, car3, -1);
+    typesCatalogUpdateDelta(&delta, car1, BSON("$set" << BSON("attrs.temp" << BSON("type" << "temp_T2" << "value" << "20") <<
+                                                              "modDate"    << 1000)));
+    typesCatalogApply("", delta);
+
+    /* Invoke the function in mongoBackend library */
+    ms = mongoAttributesForEntityType("Car", &res, "", servicePathVector, uriParams, false, V2);
+
+    /* Check response is as expected */
+    EXPECT_EQ(SccOk, ms);
+    EXPECT_EQ(SccOk, res.statusCode.code);
+
+    EXPECT_EQ(2, res.entityType.count);
+    ASSERT_EQ(5, res.entityType.contextAttributeVector.size());
+
+    EXPECT_EQ("fuel",     res.entityType.contextAttributeVector[0]->name);
+    EXPECT_EQ("plate",    res.entityType.contextAttributeVector[1]->name);
+    EXPECT_EQ("plate",    res.entityType.contextAttributeVector[2]->name);
+    EXPECT_EQ("pos",      res.entityType.contextAttributeVector[3]->name);
+    EXPECT_EQ("temp",     res.entityType.contextAttributeVector[4]->name);
+    EXPECT_EQ("temp_T2",  res.entityType.contextAttributeVector[4]->type);
+
+    utExit();
+}
+
+
+
 /* ****************************************************************************
 *
 * queryAllDbException -
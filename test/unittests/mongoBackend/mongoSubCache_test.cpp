@@ -0,0 +1,328 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "mongo/client/dbclient.h"
+
+#include "logMsg/logMsg.h"
+#include "logMsg/traceLevels.h"
+#include "common/globals.h"
+#include "mongoBackend/MongoGlobal.h"
+#include "mongoBackend/mongoSubCache.h"
+#include "cache/subCache.h"
+
+#include "unittests/testInit.h"
+#include "unittests/commonMocks.h"
+#include "unittests/unittest.h"
+
+
+
+/* ****************************************************************************
+*
+* USING
+*/
+using mongo::DBClientBase;
+using mongo::BSONObj;
+using mongo::OID;
+using mongo::DBException;
+using ::testing::_;
+using ::testing::Throw;
+
+
+
+extern void setMongoConnectionForUnitTest(DBClientBase* _connection);
+
+
+
+/* ****************************************************************************
+*
+* Tests
+*
+* - syncModifiedInDb
+* - syncDeletedInDb
+* - syncDbError
+* - countersBulkUpdate
+*/
+
+
+
+/* ****************************************************************************
+*
+* Subscription IDs
+*/
+static const std::string SUB_OID1 = "51307b66f481db11bf860001";
+static const std::string SUB_OID2 = "51307b66f481db11bf860002";
+static const std::string SUB_OID3 = "51307b66f481db11bf860003";
+
+
+
+/* ****************************************************************************
+*
+* subDoc -
+*/
+static BSONObj subDoc(const std::string& subId, const std::string& reference, long long modDate)
+{
+  return BSON("_id"              << OID(subId) <<
+              "expiration"       << 2000000000 <<
+              "lastNotification" << (long long) 20000000 <<
+              "reference"        << reference <<
+              "entities"         << BSON_ARRAY(BSON("id" << "E1" << "type" << "T1" << "isPattern" << "false")) <<
+              "attrs"            << BSON_ARRAY("A1") <<
+              "conditions"       << BSON_ARRAY("A1") <<
+              "modDate"          << modDate);
+}
+
+
+
+/* ****************************************************************************
+*
+* prepareDatabase -
+*
+* Two subscriptions in DB, both of them loaded in the subscription cache.
+*/
+static void prepareDatabase(void)
+{
+  setupDatabase();
+
+  DBClientBase* connection = getMongoConnection();
+
+  connection->insert(SUBSCRIBECONTEXT_COLL, subDoc(SUB_OID1, "http://notify1.me", 1000));
+  connection->insert(SUBSCRIBECONTEXT_COLL, subDoc(SUB_OID2, "http://notify2.me", 1000));
+
+  noCache = false;
+  subCacheInit();
+  subCacheRefresh();
+}
+
+
+
+/* ****************************************************************************
+*
+* syncModifiedInDb -
+*
+* A subscription modified in DB (i.e. by another broker) is reloaded, keeping the
+* counters accumulated in the cache, that are flushed to DB. The one not modified is
+* kept as is.
+*/
+TEST(mongoSubCache, syncModifiedInDb)
+{
+  utInit();
+
+  prepareDatabase();
+
+  CachedSubscription* sub1P = subCacheItemLookup("", SUB_OID1.c_str());
+  CachedSubscription* sub2P = subCacheItemLookup("", SUB_OID2.c_str());
+
+  ASSERT_TRUE(sub1P != NULL);
+  ASSERT_TRUE(sub2P != NULL);
+  sub1P->count                = 3;
+  sub1P->lastNotificationTime = 30000000;
+
+  DBClientBase* connection = getMongoConnection();
+  connection->update(SUBSCRIBECONTEXT_COLL,
+                     BSON("_id" << OID(SUB_OID1)),
+                     BSON("$set" << BSON("reference" << "http://notify1b.me" << "modDate" << (long long) 2000)));
+
+  subCacheSync();
+
+  /* Check cache */
+  sub1P = subCacheItemLookup("", SUB_OID1.c_str());
+  ASSERT_TRUE(sub1P != NULL);
+  EXPECT_EQ("http://notify1b.me", sub1P->httpInfo.url);
+  EXPECT_EQ(2000, sub1P->modDate);
+  EXPECT_EQ(0, sub1P->count);
+  EXPECT_EQ(30000000, sub1P->lastNotificationTime);
+
+  EXPECT_EQ(sub2P, subCacheItemLookup("", SUB_OID2.c_str()));
+  EXPECT_EQ("http://notify2.me", sub2P->httpInfo.url);
+  EXPECT_EQ(2, subCacheItems());
+
+  /* Check DB */
+  BSONObj sub = connection->findOne(SUBSCRIBECONTEXT_COLL, BSON("_id" << OID(SUB_OID1)));
+  EXPECT_EQ(3, getIntOrLongFieldAsLongF(sub, "count"));
+  EXPECT_EQ(30000000, getIntOrLongFieldAsLongF(sub, "lastNotification"));
+  EXPECT_EQ(2000, getIntOrLongFieldAsLongF(sub, "modDate"));
+
+  subCacheDestroy();
+  utExit();
+}
+
+
+
+/* ****************************************************************************
+*
+* syncDeletedInDb -
+*
+* A subscription removed from DB is removed from the cache, and a subscription
+* created in DB is inserted in the cache.
+*/
+TEST(mongoSubCache, syncDeletedInDb)
+{
+  utInit();
+
+  prepareDatabase();
+
+  DBClientBase* connection = getMongoConnection();
+  connection->remove(SUBSCRIBECONTEXT_COLL, BSON("_id" << OID(SUB_OID1)));
+  connection->insert(SUBSCRIBECONTEXT_COLL, subDoc(SUB_OID3, "http://notify3.me", 3000));
+
+  subCacheSync();
+
+  EXPECT_TRUE(subCacheItemLookup("", SUB_OID1.c_str()) == NULL);
+  EXPECT_TRUE(subCacheItemLookup("", SUB_OID2.c_str()) != NULL);
+
+  CachedSubscription* sub3P = subCacheItemLookup("", SUB_OID3.c_str());
+  ASSERT_TRUE(sub3P != NULL);
+  EXPECT_EQ("http://notify3.me", sub3P->httpInfo.url);
+  EXPECT_EQ(2, subCacheItems());
+
+  subCacheDestroy();
+  utExit();
+}
+
+
+
+/* ****************************************************************************
+*
+* syncDbError -
+*
+* If the DB can't be queried, the cache is left untouched: the subscriptions are
+* not taken as removed and the counters are kept for the next sync.
+*/
+TEST(mongoSubCache, syncDbError)
+{
+  utInit();
+
+  prepareDatabase();
+
+  CachedSubscription* sub1P = subCacheItemLookup("", SUB_OID1.c_str());
+  CachedSubscription* sub2P = subCacheItemLookup("", SUB_OID2.c_str());
+
+  ASSERT_TRUE(sub1P != NULL);
+  ASSERT_TRUE(sub2P != NULL);
+  sub1P->count = 3;
+
+  /* Prepare mock */
+  const DBException e = DBException("boom!!", 33);
+  DBClientConnectionMock* connectionMock = new DBClientConnectionMock();
+  ON_CALL(*connectionMock, _query(_, _, _, _, _, _, _))
+      .WillByDefault(Throw(e));
+
+  /* Set MongoDB connection */
+  DBClientBase* connectionDb = getMongoConnection();
+  setMongoConnectionForUnitTest(connectionMock);
+
+  subCacheSync();
+
+  /* Restore real DB connection */
+  setMongoConnectionForUnitTest(connectionDb);
+
+  EXPECT_EQ(sub1P, subCacheItemLookup("", SUB_OID1.c_str()));
+  EXPECT_EQ(sub2P, subCacheItemLookup("", SUB_OID2.c_str()));
+  EXPECT_EQ(3, sub1P->count);
+  EXPECT_EQ(2, subCacheItems());
+
+  /* Release mock */
+  delete connectionMock;
+
+  subCacheDestroy();
+  utExit();
+}
+
+
+
+/* ****************************************************************************
+*
+* counters -
+*/
+static SubCountersDelta counters
+(
+  const std::string&  subId,
+  int64_t             count,
+  int64_t             lastNotificationTime,
+  int64_t             lastFailure,
+  int64_t             lastSuccess
+)
+{
+  SubCountersDelta delta;
+
+  delta.subscriptionId       = subId;
+  delta.count                = count;
+  delta.lastNotificationTime = lastNotificationTime;
+  delta.lastFailure          = lastFailure;
+  delta.lastSuccess          = lastSuccess;
+
+  return delta;
+}
+
+
+
+/* ****************************************************************************
+*
+* countersBulkUpdate -
+*
+* Several deltas for the same subscription in the same flush are merged in DB: the
+* counts are added and each timestamp ends up as the newest one (DB included).
+*/
+TEST(mongoSubCache, countersBulkUpdate)
+{
+  utInit();
+
+  setupDatabase();
+
+  DBClientBase* connection = getMongoConnection();
+
+  connection->insert(SUBSCRIBECONTEXT_COLL, BSON("_id"              << OID(SUB_OID1) <<
+                                                 "count"            << (long long) 10 <<
+                                                 "lastNotification" << (long long) 20000000 <<
+                                                 "lastFailure"      << (long long) 15000000));
+  connection->insert(SUBSCRIBECONTEXT_COLL, BSON("_id"              << OID(SUB_OID2)));
+
+  std::vector<SubCountersDelta> deltaV;
+
+  deltaV.push_back(counters(SUB_OID1, 2, 30000000, 0,        25000000));
+  deltaV.push_back(counters(SUB_OID1, 3, 25000000, 0,        0));
+  deltaV.push_back(counters(SUB_OID1, 0, 0,        10000000, 0));
+  deltaV.push_back(counters(SUB_OID2, 1, 0,        0,        0));
+  deltaV.push_back(counters("",       5, 40000000, 0,        0));  // skipped
+
+  mongoSubCountersBulkUpdate("", deltaV);
+
+  BSONObj sub1 = connection->findOne(SUBSCRIBECONTEXT_COLL, BSON("_id" << OID(SUB_OID1)));
+  EXPECT_EQ(15,       getIntOrLongFieldAsLongF(sub1, "count"));
+  EXPECT_EQ(30000000, getIntOrLongFieldAsLongF(sub1, "lastNotification"));
+  EXPECT_EQ(15000000, getIntOrLongFieldAsLongF(sub1, "lastFailure"));
+  EXPECT_EQ(25000000, getIntOrLongFieldAsLongF(sub1, "lastSuccess"));
+
+  BSONObj sub2 = connection->findOne(SUBSCRIBECONTEXT_COLL, BSON("_id" << OID(SUB_OID2)));
+  EXPECT_EQ(1,        getIntOrLongFieldAsLongF(sub2, "count"));
+  EXPECT_FALSE(sub2.hasField("lastNotification"));
+  EXPECT_FALSE(sub2.hasField("lastFailure"));
+  EXPECT_FALSE(sub2.hasField("lastSuccess"));
+
+  utExit();
+}
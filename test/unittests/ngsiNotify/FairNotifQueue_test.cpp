@@ -0,0 +1,238 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <string>
+#include <vector>
+#include <map>
+
+#include "gtest/gtest.h"
+
+#include "common/globals.h"
+#include "ngsiNotify/FairNotifQueue.h"
+
+
+
+/* ****************************************************************************
+*
+* paramsCreate - a queue element with one notification to 'host', of 'size' bytes
+*/
+static std::vector<SenderThreadParams*>* paramsCreate(const std::string& host, int size)
+{
+  std::vector<SenderThreadParams*>*  paramsV = new std::vector<SenderThreadParams*>();
+  SenderThreadParams*                params  = new SenderThreadParams();
+
+  params->ip       = host;
+  params->port     = 1028;
+  params->protocol = "http:";
+  params->content  = std::string(size, 'x');
+  clock_gettime(CLOCK_REALTIME, &params->timeStamp);
+
+  paramsV->push_back(params);
+
+  return paramsV;
+}
+
+
+
+/* ****************************************************************************
+*
+* hostOf - the host of a queue element, freeing it
+*/
+static std::string hostOf(std::vector<SenderThreadParams*>* paramsV)
+{
+  std::string host = (*paramsV)[0]->ip;
+
+  delete (*paramsV)[0];
+  delete paramsV;
+
+  return host;
+}
+
+
+
+/* ****************************************************************************
+*
+* sentHostOf - the host of a queue element, reporting it as sent and freeing it
+*/
+static std::string sentHostOf(FairNotifQueue* queueP, std::vector<SenderThreadParams*>* paramsV)
+{
+  queueP->done((*paramsV)[0]);
+
+  return hostOf(paramsV);
+}
+
+
+
+/* ****************************************************************************
+*
+* quota -
+*/
+TEST(FairNotifQueue, quota)
+{
+  FairNotifQueue                          queue(10, 2, 10);
+  std::vector<SenderThreadParams*>*       paramsV;
+  std::vector<SenderThreadParams*>*       rejectedV;
+  std::map<std::string, NotifDestStats>   stats;
+
+  EXPECT_TRUE(queue.try_push(paramsCreate("slow", 10)));
+  EXPECT_TRUE(queue.try_push(paramsCreate("slow", 10)));
+
+  // The quota of 'slow' is reached, but not the one of 'fast'
+  rejectedV = paramsCreate("slow", 10);
+  EXPECT_FALSE(queue.try_push(rejectedV));
+  hostOf(rejectedV);
+
+  EXPECT_TRUE(queue.try_push(paramsCreate("fast", 10)));
+  EXPECT_EQ(3, queue.size());
+
+  fairQueueStatisticsGet(&stats);
+  EXPECT_EQ(2, stats["http://slow:1028"].size);
+  EXPECT_EQ(1, stats["http://slow:1028"].reject);
+  EXPECT_EQ(1, stats["http://fast:1028"].in);
+
+  while (queue.try_pop(&paramsV))
+  {
+    hostOf(paramsV);
+  }
+
+  EXPECT_EQ(0, queue.size());
+  EXPECT_FALSE(queue.try_pop(&paramsV));
+}
+
+
+
+/* ****************************************************************************
+*
+* roundRobin -
+*
+* A destination with many notifications queued doesn't delay the ones of the others, and
+* destinations with bigger payloads get the same share of bytes, not of notifications.
+*/
+TEST(FairNotifQueue, roundRobin)
+{
+  FairNotifQueue  queue(100, 50, 100);
+  std::string     order;
+
+  for (int ix = 0; ix < 10; ++ix)
+  {
+    queue.try_push(paramsCreate("A", FAIR_QUEUE_QUANTUM));
+  }
+  queue.try_push(paramsCreate("B", FAIR_QUEUE_QUANTUM));
+  queue.try_push(paramsCreate("C", FAIR_QUEUE_QUANTUM / 2));
+  queue.try_push(paramsCreate("C", FAIR_QUEUE_QUANTUM / 2));
+  queue.try_push(paramsCreate("C", FAIR_QUEUE_QUANTUM / 2));
+
+  for (int ix = 0; ix < 8; ++ix)
+  {
+    order += sentHostOf(&queue, queue.pop());
+  }
+
+  EXPECT_EQ("ABCCACAA", order);
+
+  fairQueueStatisticsReset();
+
+  std::map<std::string, NotifDestStats> stats;
+
+  fairQueueStatisticsGet(&stats);
+  EXPECT_EQ(1, stats.size());   // only A has notifications queued
+  EXPECT_EQ(6, stats["http://A:1028"].size);
+  EXPECT_EQ(0, stats["http://A:1028"].out);
+
+  while (queue.size() > 0)
+  {
+    sentHostOf(&queue, queue.pop());
+  }
+}
+
+
+
+/* ****************************************************************************
+*
+* busyMax -
+*
+* A destination with the maximum of notifications being sent is skipped, until one of
+* them is done.
+*/
+TEST(FairNotifQueue, busyMax)
+{
+  FairNotifQueue                     queue(10, 10, 1);
+  std::vector<SenderThreadParams*>*  paramsV;
+  std::vector<SenderThreadParams*>*  busyV;
+
+  queue.try_push(paramsCreate("A", 10));
+  queue.try_push(paramsCreate("A", 10));
+  queue.try_push(paramsCreate("B", 10));
+
+  EXPECT_TRUE(queue.try_pop(&busyV));
+  EXPECT_EQ("A", (*busyV)[0]->ip);
+
+  EXPECT_TRUE(queue.try_pop(&paramsV));
+  EXPECT_EQ("B", sentHostOf(&queue, paramsV));
+
+  // The second notification of A waits for the first one
+  EXPECT_FALSE(queue.try_pop(&paramsV));
+  EXPECT_EQ(1, queue.size());
+
+  sentHostOf(&queue, busyV);
+
+  EXPECT_TRUE(queue.try_pop(&paramsV));
+  EXPECT_EQ("A", sentHostOf(&queue, paramsV));
+}
+
+
+
+/* ****************************************************************************
+*
+* idleSubQueues -
+*
+* Sub-queues are removed when nothing has been queued nor sent for a while, but not
+* while a notification of them is being sent.
+*/
+TEST(FairNotifQueue, idleSubQueues)
+{
+  FairNotifQueue                         queue(10, 10, 10);
+  std::vector<SenderThreadParams*>*      paramsV;
+  std::vector<SenderThreadParams*>*      busyV;
+  std::map<std::string, NotifDestStats>  stats;
+  int                                    now = getCurrentTime();
+
+  queue.try_push(paramsCreate("idle", 10));
+  queue.try_push(paramsCreate("busy", 10));
+
+  EXPECT_TRUE(queue.try_pop(&paramsV));
+  EXPECT_EQ("idle", sentHostOf(&queue, paramsV));
+  EXPECT_TRUE(queue.try_pop(&busyV));
+
+  queue.idlePurge(now + 1);
+  fairQueueStatisticsGet(&stats);
+  EXPECT_EQ(2, stats.size());
+
+  queue.idlePurge(now + FAIR_QUEUE_IDLE_TIMEOUT + 1);
+  stats.clear();
+  fairQueueStatisticsGet(&stats);
+  EXPECT_EQ(1, stats.size());
+  EXPECT_EQ(1, stats["http://busy:1028"].out);
+
+  sentHostOf(&queue, busyV);
+}
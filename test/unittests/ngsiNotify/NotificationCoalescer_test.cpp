@@ -0,0 +1,275 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "common/RequestArena.h"
+#include "apiTypesV2/HttpInfo.h"
+#include "ngsi/ContextElementResponse.h"
+#include "ngsi10/NotifyContextRequest.h"
+#include "ngsiNotify/Notifier.h"
+#include "ngsiNotify/NotificationCoalescer.h"
+
+
+
+/* ****************************************************************************
+*
+* NotifierRecord - keeps the number of entities of each notification sent
+*
+* For compound attributes, the value of the first item is also kept.
+*/
+class NotifierRecord : public Notifier
+{
+ public:
+  std::vector<int>          entitiesV;
+  std::vector<std::string>  tokenV;
+  std::vector<std::string>  compoundV;
+
+  void sendNotifyContextRequest(NotifyContextRequest*            ncrP,
+                                const ngsiv2::HttpInfo&          httpInfo,
+                                const std::string&               tenant,
+                                const std::string&               xauthToken,
+                                const std::string&               fiwareCorrelator,
+                                RenderFormat                     renderFormat,
+                                const std::vector<std::string>&  attrsOrder,
+                                const std::vector<std::string>&  metadataFilter,
+                                bool                             blackList)
+  {
+    entitiesV.push_back(ncrP->contextElementResponseVector.size());
+    tokenV.push_back(xauthToken);
+
+    for (unsigned int ix = 0; ix < ncrP->contextElementResponseVector.size(); ++ix)
+    {
+      ContextAttributeVector* cavP = &ncrP->contextElementResponseVector[ix]->contextElement.contextAttributeVector;
+
+      for (unsigned int aIx = 0; aIx < cavP->size(); ++aIx)
+      {
+        if ((*cavP)[aIx]->compoundValueP != NULL)
+        {
+          compoundV.push_back((*cavP)[aIx]->compoundValueP->childV[0]->stringValue);
+        }
+      }
+    }
+  }
+};
+
+
+
+/* ****************************************************************************
+*
+* coalesce - notifies entity 'id' for subscription 'subId' through the coalescer
+*/
+static bool coalesce
+(
+  NotificationCoalescer*  coalescerP,
+  const std::string&      subId,
+  const std::string&      id,
+  int64_t                 coalesceMs,
+  const std::string&      xauthToken = ""
+)
+{
+  NotifyContextRequest      ncr;
+  ContextElementResponse    cer;
+  ngsiv2::HttpInfo          httpInfo("");   // invalid URL, so notifications sent by stop() go nowhere
+  std::vector<std::string>  attrsOrder;
+  std::vector<std::string>  metadataFilter;
+  bool                      added;
+
+  cer.contextElement.entityId.fill(id, "T", "false");
+  cer.contextElement.contextAttributeVector.push_back(new ContextAttribute("A", "Text", "a"));
+  ncr.contextElementResponseVector.push_back(&cer);
+  ncr.subscriptionId.set(subId);
+
+  added = coalescerP->add(&ncr, coalesceMs, httpInfo, "", xauthToken, "", NGSI_V2_NORMALIZED, attrsOrder, metadataFilter, false);
+
+  // The coalescer has its own copy
+  cer.contextElement.contextAttributeVector.release();
+
+  return added;
+}
+
+
+
+/* ****************************************************************************
+*
+* window -
+*
+* The entities notified for a subscription in its window are sent together when it ends
+*/
+TEST(NotificationCoalescer, window)
+{
+  NotifierRecord         notifier;
+  NotificationCoalescer  coalescer(&notifier);
+
+  EXPECT_EQ(0, coalescer.start());
+
+  EXPECT_TRUE(coalesce(&coalescer, "S1", "E1", 100));
+  EXPECT_TRUE(coalesce(&coalescer, "S1", "E2", 100));
+  EXPECT_TRUE(coalesce(&coalescer, "S2", "E1", 100));
+  EXPECT_TRUE(coalesce(&coalescer, "S1", "E3", 100));
+
+  EXPECT_EQ(2, coalescer.size());
+  EXPECT_EQ(0, notifier.entitiesV.size());
+
+  usleep(500000);
+
+  EXPECT_EQ(0, coalescer.size());
+  ASSERT_EQ(2, notifier.entitiesV.size());
+  EXPECT_EQ(4, notifier.entitiesV[0] + notifier.entitiesV[1]);
+
+  coalescer.stop();
+}
+
+
+
+/* ****************************************************************************
+*
+* maxEntities -
+*
+* A notification is sent as soon as it gets COALESCE_MAX_ENTITIES entities
+*/
+TEST(NotificationCoalescer, maxEntities)
+{
+  NotifierRecord         notifier;
+  NotificationCoalescer  coalescer(&notifier);
+
+  EXPECT_EQ(0, coalescer.start());
+
+  for (int ix = 0; ix < COALESCE_MAX_ENTITIES + 1; ++ix)
+  {
+    coalesce(&coalescer, "S1", "E1", 10000);
+  }
+
+  ASSERT_EQ(1, notifier.entitiesV.size());
+  EXPECT_EQ(COALESCE_MAX_ENTITIES, notifier.entitiesV[0]);
+  EXPECT_EQ(1, coalescer.size());
+
+  coalescer.stop();
+}
+
+
+
+/* ****************************************************************************
+*
+* xauthToken -
+*
+* A notification with another X-Auth-Token closes the window of the subscription
+*/
+TEST(NotificationCoalescer, xauthToken)
+{
+  NotifierRecord         notifier;
+  NotificationCoalescer  coalescer(&notifier);
+
+  EXPECT_EQ(0, coalescer.start());
+
+  coalesce(&coalescer, "S1", "E1", 10000, "token1");
+  coalesce(&coalescer, "S1", "E2", 10000, "token1");
+  coalesce(&coalescer, "S1", "E3", 10000, "token2");
+
+  ASSERT_EQ(1, notifier.entitiesV.size());
+  EXPECT_EQ(2, notifier.entitiesV[0]);
+  EXPECT_EQ("token1", notifier.tokenV[0]);
+
+  coalescer.stop();
+}
+
+
+
+/* ****************************************************************************
+*
+* stop -
+*
+* Stopping sends what is buffered (not through the notifier but synchronously) and no
+* more notifications are accepted
+*/
+TEST(NotificationCoalescer, stop)
+{
+  NotifierRecord         notifier;
+  NotificationCoalescer  coalescer(&notifier);
+
+  EXPECT_EQ(0, coalescer.start());
+
+  EXPECT_TRUE(coalesce(&coalescer, "S1", "E1", 10000));
+  EXPECT_EQ(1, coalescer.size());
+
+  coalescer.stop();
+
+  EXPECT_EQ(0, coalescer.size());
+  EXPECT_EQ(0, notifier.entitiesV.size());
+  EXPECT_FALSE(coalesce(&coalescer, "S1", "E2", 10000));
+}
+
+
+
+/* ****************************************************************************
+*
+* arena -
+*
+* A notification built from the arena of a request is sent after the arena is freed
+*/
+TEST(NotificationCoalescer, arena)
+{
+  NotifierRecord            notifier;
+  NotificationCoalescer     coalescer(&notifier);
+  RequestArena*             arenaP = new RequestArena();
+  NotifyContextRequest      ncr;
+  ContextElementResponse    cer;
+  ngsiv2::HttpInfo          httpInfo("");
+  std::vector<std::string>  attrsOrder;
+  std::vector<std::string>  metadataFilter;
+
+  EXPECT_EQ(0, coalescer.start());
+
+  requestArenaSet(arenaP);
+
+  ContextAttribute* caP = new ContextAttribute("C", "StructuredValue", "");
+
+  caP->valueType      = orion::ValueTypeObject;
+  caP->compoundValueP = new orion::CompoundValueNode(orion::ValueTypeObject);
+  caP->compoundValueP->add(orion::ValueTypeString, "x", "y");
+
+  cer.contextElement.entityId.fill("E1", "T", "false");
+  cer.contextElement.contextAttributeVector.push_back(caP);
+  ncr.contextElementResponseVector.push_back(&cer);
+  ncr.subscriptionId.set("S1");
+
+  EXPECT_TRUE(coalescer.add(&ncr, 100, httpInfo, "", "", "", NGSI_V2_NORMALIZED, attrsOrder, metadataFilter, false));
+
+  // End of the request
+  requestArenaSet(NULL);
+  cer.contextElement.contextAttributeVector.release();
+  delete arenaP;
+
+  usleep(500000);
+
+  ASSERT_EQ(1, notifier.compoundV.size());
+  EXPECT_EQ("y", notifier.compoundV[0]);
+
+  coalescer.stop();
+}
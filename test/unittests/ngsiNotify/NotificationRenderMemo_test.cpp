@@ -0,0 +1,186 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "apiTypesV2/HttpInfo.h"
+#include "ngsi/ContextElementResponse.h"
+#include "ngsi10/NotifyContextRequest.h"
+#include "ngsiNotify/Notifier.h"
+#include "ngsiNotify/senderThread.h"
+#include "ngsiNotify/NotificationRenderMemo.h"
+
+
+
+/* ****************************************************************************
+*
+* NotifierBuild - gives access to the notifications a notifier would send
+*/
+class NotifierBuild : public Notifier
+{
+ public:
+  using Notifier::buildSenderParams;
+};
+
+
+
+/* ****************************************************************************
+*
+* payloadOf - the payload of the (only) notification built for a subscription, freeing it
+*/
+static std::string payloadOf(NotifyContextRequest* ncrP, const std::string& subId, RenderFormat renderFormat)
+{
+  ngsiv2::HttpInfo                   httpInfo("http://localhost:1028/notify");
+  std::vector<std::string>           attrsOrder;
+  std::vector<std::string>           metadataFilter;
+  std::vector<SenderThreadParams*>*  paramsV;
+  std::string                        payload;
+
+  ncrP->subscriptionId.set(subId);
+
+  paramsV = NotifierBuild::buildSenderParams(ncrP, httpInfo, "", "", "", renderFormat, attrsOrder, metadataFilter, false);
+
+  EXPECT_EQ(1, paramsV->size());
+  EXPECT_EQ(subId, (*paramsV)[0]->subscriptionId);
+  payload = (*paramsV)[0]->content;
+
+  delete (*paramsV)[0];
+  delete paramsV;
+
+  return payload;
+}
+
+
+
+/* ****************************************************************************
+*
+* threadMemo -
+*/
+TEST(NotificationRenderMemo, threadMemo)
+{
+  EXPECT_TRUE(notificationRenderMemoGet() == NULL);
+
+  {
+    NotificationRenderMemo  outer;
+
+    EXPECT_EQ(&outer, notificationRenderMemoGet());
+
+    {
+      NotificationRenderMemo  inner;
+
+      EXPECT_EQ(&inner, notificationRenderMemoGet());
+    }
+
+    EXPECT_EQ(&outer, notificationRenderMemoGet());
+  }
+
+  EXPECT_TRUE(notificationRenderMemoGet() == NULL);
+}
+
+
+
+/* ****************************************************************************
+*
+* sharedData -
+*
+* Notifications for different subscriptions with the same format render the 'data' once,
+* and get the same payloads than without memo
+*/
+TEST(NotificationRenderMemo, sharedData)
+{
+  NotifyContextRequest     ncr;
+  ContextElementResponse*  cerP = new ContextElementResponse();
+  std::string              payload1;
+  std::string              payload2;
+  std::string              keyValues;
+
+  cerP->contextElement.entityId.fill("E1", "T1", "false");
+  cerP->contextElement.contextAttributeVector.push_back(new ContextAttribute("A1", "Number", 23.0));
+  cerP->contextElement.contextAttributeVector.push_back(new ContextAttribute("A2", "Text", "foo"));
+  ncr.contextElementResponseVector.push_back(cerP);
+
+  payload1  = payloadOf(&ncr, "5a0000000000000000000001", NGSI_V2_NORMALIZED);
+  payload2  = payloadOf(&ncr, "5a0000000000000000000002", NGSI_V2_NORMALIZED);
+  keyValues = payloadOf(&ncr, "5a0000000000000000000001", NGSI_V2_KEYVALUES);
+
+  {
+    NotificationRenderMemo  memo;
+
+    EXPECT_EQ(payload1,  payloadOf(&ncr, "5a0000000000000000000001", NGSI_V2_NORMALIZED));
+    EXPECT_EQ(payload2,  payloadOf(&ncr, "5a0000000000000000000002", NGSI_V2_NORMALIZED));
+    EXPECT_EQ(keyValues, payloadOf(&ncr, "5a0000000000000000000001", NGSI_V2_KEYVALUES));
+
+    EXPECT_EQ(1, memo.hits());
+    EXPECT_EQ(2, memo.misses());
+
+    // The entity changes, so what was rendered is no longer valid
+    cerP->contextElement.contextAttributeVector[1]->stringValue = "bar";
+    memo.invalidate();
+
+    payload2 = payloadOf(&ncr, "5a0000000000000000000002", NGSI_V2_NORMALIZED);
+
+    EXPECT_EQ(1, memo.hits());
+    EXPECT_EQ(3, memo.misses());
+    EXPECT_TRUE(payload2.find("\"bar\"") != std::string::npos);
+  }
+
+  EXPECT_EQ(payload2, payloadOf(&ncr, "5a0000000000000000000002", NGSI_V2_NORMALIZED));
+
+  ncr.release();
+}
+
+
+
+/* ****************************************************************************
+*
+* keyFilters -
+*/
+TEST(NotificationRenderMemo, keyFilters)
+{
+  ContextElementResponseVector  cerV;
+  ContextElementResponse*       cerP = new ContextElementResponse();
+  std::vector<std::string>      attrsOrder;
+  std::vector<std::string>      metadataFilter;
+  std::string                   key;
+
+  cerP->contextElement.entityId.fill("E1", "T1", "false");
+  cerP->contextElement.contextAttributeVector.push_back(new ContextAttribute("A1", "Number", 23.0));
+  cerV.push_back(cerP);
+
+  key = NotificationRenderMemo::key(cerV, NGSI_V2_NORMALIZED, attrsOrder, metadataFilter, false);
+
+  EXPECT_EQ(key, NotificationRenderMemo::key(cerV, NGSI_V2_NORMALIZED, attrsOrder, metadataFilter, false));
+  EXPECT_NE(key, NotificationRenderMemo::key(cerV, NGSI_V2_VALUES, attrsOrder, metadataFilter, false));
+  EXPECT_NE(key, NotificationRenderMemo::key(cerV, NGSI_V2_NORMALIZED, attrsOrder, metadataFilter, true));
+
+  metadataFilter.push_back("A1");
+  EXPECT_NE(key, NotificationRenderMemo::key(cerV, NGSI_V2_NORMALIZED, attrsOrder, metadataFilter, false));
+  EXPECT_NE(NotificationRenderMemo::key(cerV, NGSI_V2_NORMALIZED, attrsOrder, metadataFilter, false),
+            NotificationRenderMemo::key(cerV, NGSI_V2_NORMALIZED, metadataFilter, attrsOrder, false));
+
+  cerV.release();
+}
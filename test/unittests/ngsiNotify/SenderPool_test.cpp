@@ -0,0 +1,263 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "common/globals.h"
+#include "common/statistics.h"
+#include "ngsiNotify/SenderPool.h"
+
+
+
+/* ****************************************************************************
+*
+* closedPortGet - a local port nobody listens to (connections to it are refused)
+*/
+static unsigned short closedPortGet(void)
+{
+  struct sockaddr_in  sa;
+  socklen_t           len = sizeof(sa);
+  int                 sd  = socket(AF_INET, SOCK_STREAM, 0);
+
+  memset(&sa, 0, sizeof(sa));
+  sa.sin_family      = AF_INET;
+  sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  sa.sin_port        = 0;
+
+  bind(sd, (struct sockaddr*) &sa, sizeof(sa));
+  getsockname(sd, (struct sockaddr*) &sa, &len);
+  close(sd);
+
+  return ntohs(sa.sin_port);
+}
+
+
+
+/* ****************************************************************************
+*
+* paramsCreate - a notification to a local port where nobody listens
+*/
+static std::vector<SenderThreadParams*>* paramsCreate(void)
+{
+  std::vector<SenderThreadParams*>*  paramsV = new std::vector<SenderThreadParams*>();
+  SenderThreadParams*                params  = new SenderThreadParams();
+
+  params->ip               = "127.0.0.1";
+  params->port             = closedPortGet();
+  params->protocol         = "http:";
+  params->verb             = "POST";
+  params->resource         = "/notify";
+  params->content_type     = "application/json";
+  params->content          = "{}";
+  params->mimeType         = JSON;
+  params->registration     = true;   // not a subscription, the subscription cache is not touched
+  params->transactionId[0] = 0;
+
+  paramsV->push_back(params);
+
+  return paramsV;
+}
+
+
+
+/* ****************************************************************************
+*
+* simulatedWait - waits (up to 2 seconds) for 'expected' simulated notifications
+*/
+static bool simulatedWait(int expected)
+{
+  for (int ix = 0; ix < 200; ++ix)
+  {
+    if (noOfSimulatedNotifications >= expected)
+    {
+      return true;
+    }
+
+    usleep(10000);
+  }
+
+  return false;
+}
+
+
+
+/* ****************************************************************************
+*
+* dispatchFunc - thread dispatching a notification to the pool, setting 'done' after it
+*
+* Note that pools are never freed in these tests: their sender threads are detached and
+* live until the end of the process, as in the broker.
+*/
+static SenderPool*    blockPoolP = NULL;
+static volatile bool  done       = false;
+
+static void* dispatchFunc(void* vP)
+{
+  blockPoolP->dispatch(paramsCreate());
+  done = true;
+
+  return NULL;
+}
+
+
+/* ****************************************************************************
+*
+* dropWhenBusy -
+*
+* With no sender ready, the notification is rejected and the caller keeps it
+*/
+TEST(SenderPool, dropWhenBusy)
+{
+  SenderPool*                        poolP   = new SenderPool(1, true);   // not started: no sender ready
+  std::vector<SenderThreadParams*>*  paramsV = paramsCreate();
+
+  EXPECT_FALSE(poolP->dispatch(paramsV));
+
+  delete (*paramsV)[0];
+  delete paramsV;
+}
+
+
+
+/* ****************************************************************************
+*
+* blockWhenBusy -
+*
+* With no sender ready, the caller waits until one gets ready
+*/
+TEST(SenderPool, blockWhenBusy)
+{
+  pthread_t  tid;
+
+  simulatedNotification      = true;
+  noOfSimulatedNotifications = 0;
+  done                       = false;
+  blockPoolP                 = new SenderPool(1, false);
+
+  pthread_create(&tid, NULL, dispatchFunc, NULL);
+  usleep(200000);
+  EXPECT_FALSE(done);
+
+  EXPECT_EQ(0, blockPoolP->start());
+
+  pthread_join(tid, NULL);
+  EXPECT_TRUE(done);
+  EXPECT_TRUE(simulatedWait(1));
+
+  simulatedNotification = false;
+}
+
+
+
+/* ****************************************************************************
+*
+* idleSender -
+*
+* Notifications are handed over to the idle senders, even with the drop policy
+*/
+TEST(SenderPool, idleSender)
+{
+  SenderPool*  poolP = new SenderPool(2, true);
+  int          sent  = 0;
+
+  simulatedNotification      = true;
+  noOfSimulatedNotifications = 0;
+
+  EXPECT_EQ(0, poolP->start());
+
+  // Senders get ready asynchronously after start()
+  for (int ix = 0; (ix < 200) && (sent < 4); ++ix)
+  {
+    std::vector<SenderThreadParams*>* paramsV = paramsCreate();
+
+    if (poolP->dispatch(paramsV))
+    {
+      ++sent;
+    }
+    else
+    {
+      delete (*paramsV)[0];
+      delete paramsV;
+      usleep(10000);
+    }
+  }
+
+  EXPECT_EQ(4, sent);
+  EXPECT_TRUE(simulatedWait(4));
+
+  simulatedNotification = false;
+}
+
+
+
+/* ****************************************************************************
+*
+* latencyPerMode -
+*
+* The time spent sending notifications is accumulated per notification mode
+*/
+TEST(SenderPool, latencyPerMode)
+{
+  SenderPool*  poolP = new SenderPool(1, false);
+  std::string  stats;
+
+  simulatedNotification = false;
+  timingStatistics      = true;
+  timingStatisticsReset();
+
+  EXPECT_EQ(std::string::npos, renderTimingStatistics().find("\"notif"));
+
+  // Sent by the calling thread, as the persistent mode workers do
+  senderParamsSend(paramsCreate(), NULL, NotifTimePersistent);
+
+  stats = renderTimingStatistics();
+  EXPECT_NE(std::string::npos, stats.find("\"notifPersistent\""));
+  EXPECT_EQ(std::string::npos, stats.find("\"notifTransient\""));
+
+  // Sent by a sender of the pool (transient mode)
+  EXPECT_EQ(0, poolP->start());
+  poolP->dispatch(paramsCreate());
+
+  for (int ix = 0; (ix < 200) && (stats.find("\"notifTransient\"") == std::string::npos); ++ix)
+  {
+    usleep(10000);
+    stats = renderTimingStatistics();
+  }
+
+  EXPECT_NE(std::string::npos, stats.find("\"notifTransient\""));
+  EXPECT_EQ(std::string::npos, stats.find("\"notifThreadpool\""));
+
+  timingStatisticsReset();
+  EXPECT_EQ(std::string::npos, renderTimingStatistics().find("\"notif"));
+
+  timingStatistics = false;
+}
@@ -0,0 +1,154 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "common/globals.h"
+#include "ngsiNotify/NotifQueue.h"
+#include "ngsiNotify/QueueStatistics.h"
+#include "ngsiNotify/asyncWorker.h"
+
+
+
+/* ****************************************************************************
+*
+* listenerCreate - a local listening socket that never accepts (nor answers)
+*/
+static int listenerCreate(unsigned short* portP)
+{
+  struct sockaddr_in  sa;
+  socklen_t           len = sizeof(sa);
+  int                 sd  = socket(AF_INET, SOCK_STREAM, 0);
+
+  memset(&sa, 0, sizeof(sa));
+  sa.sin_family      = AF_INET;
+  sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  sa.sin_port        = 0;
+
+  bind(sd, (struct sockaddr*) &sa, sizeof(sa));
+  listen(sd, 8);
+  getsockname(sd, (struct sockaddr*) &sa, &len);
+
+  *portP = ntohs(sa.sin_port);
+
+  return sd;
+}
+
+
+
+/* ****************************************************************************
+*
+* paramsCreate - a notification to a local port
+*/
+static SenderThreadParams* paramsCreate(unsigned short port)
+{
+  SenderThreadParams* params = new SenderThreadParams();
+
+  params->ip               = "127.0.0.1";
+  params->port             = port;
+  params->protocol         = "http:";
+  params->verb             = "POST";
+  params->resource         = "/notify";
+  params->content_type     = "application/json";
+  params->content          = "{}";
+  params->mimeType         = JSON;
+  params->registration     = true;   // not a subscription, the subscription cache is not touched
+  params->transactionId[0] = 0;
+
+  return params;
+}
+
+
+
+/* ****************************************************************************
+*
+* inFlightWait - waits (up to 2 seconds) for 'expected' notifications in flight
+*/
+static bool inFlightWait(int expected)
+{
+  for (int ix = 0; ix < 200; ++ix)
+  {
+    if (QueueStatistics::getInFlight() == expected)
+    {
+      return true;
+    }
+
+    usleep(10000);
+  }
+
+  return false;
+}
+
+
+
+/* ****************************************************************************
+*
+* inFlight -
+*
+* A single worker has the notifications to two receivers not answering on the wire at
+* the same time. Once their connections are reset, the requests are completed (as
+* errors) and are no longer in flight.
+*
+* Note that the worker (and so its queue) is never freed: it is a detached thread living
+* until the end of the process, as in the broker.
+*/
+TEST(asyncWorker, inFlight)
+{
+  NotifQueue*                        queueP   = new RingNotifQueue(10);
+  pthread_t                          tid;
+  unsigned short                     port1;
+  unsigned short                     port2;
+  int                                sd1      = listenerCreate(&port1);
+  int                                sd2      = listenerCreate(&port2);
+  int                                inFlight = QueueStatistics::getInFlight();
+  int                                errors   = QueueStatistics::getSentError();
+  std::vector<SenderThreadParams*>*  paramsV  = new std::vector<SenderThreadParams*>();
+
+  simulatedNotification = false;
+
+  paramsV->push_back(paramsCreate(port1));
+  paramsV->push_back(paramsCreate(port2));
+  EXPECT_TRUE(queueP->try_push(paramsV));
+
+  pthread_create(&tid, NULL, asyncWorkerFunc, queueP);
+  pthread_detach(tid);
+
+  EXPECT_TRUE(inFlightWait(inFlight + 2));
+  EXPECT_EQ(errors, QueueStatistics::getSentError());
+
+  // Closing the listeners resets the connections not accepted yet
+  close(sd1);
+  close(sd2);
+
+  EXPECT_TRUE(inFlightWait(inFlight));
+  EXPECT_EQ(errors + 2, QueueStatistics::getSentError());
+}
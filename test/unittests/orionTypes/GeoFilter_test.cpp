@@ -0,0 +1,152 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include "orionTypes/GeoFilter.h"
+
+
+
+using orion::GeoFilter;
+using orion::GeoMatch;
+using orion::GeoNoMatch;
+using orion::GeoUndecided;
+
+
+
+/* ****************************************************************************
+*
+* notCompiled -
+*
+* Areas that can't be checked in memory
+*/
+TEST(GeoFilter, notCompiled)
+{
+  GeoFilter gf;
+
+  // No geo expression
+  EXPECT_FALSE(gf.compile("", "", ""));
+
+  // Lines
+  EXPECT_FALSE(gf.compile("line", "40,-4;41,-3", "intersects"));
+
+  // Polygon crossing the antimeridian
+  EXPECT_FALSE(gf.compile("polygon", "10,170;10,-170;20,-170;20,170;10,170", "coveredBy"));
+
+  // Polygon close to the north pole
+  EXPECT_FALSE(gf.compile("polygon", "80,0;80,10;87,10;87,0;80,0", "coveredBy"));
+
+  // Self-intersecting polygon (a bowtie)
+  EXPECT_FALSE(gf.compile("polygon", "0,0;1,1;1,0;0,1;0,0", "coveredBy"));
+
+  // A not compiled filter is always undecided
+  EXPECT_FALSE(gf.isCompiled());
+  EXPECT_EQ(GeoUndecided, gf.match(0.5, 0.2));
+}
+
+
+
+/* ****************************************************************************
+*
+* point -
+*/
+TEST(GeoFilter, point)
+{
+  GeoFilter gf;
+
+  // Madrid-Alcobendas is about 13.7 km, Madrid-Leganes about 13.1 km
+  EXPECT_TRUE(gf.compile("point", "40.418889,-3.691944", "near;maxDistance:13500"));
+  EXPECT_EQ(GeoMatch,   gf.match(40.316667, -3.75));
+  EXPECT_EQ(GeoNoMatch, gf.match(40.533333, -3.633333));
+
+  EXPECT_TRUE(gf.compile("point", "40.418889,-3.691944", "near;minDistance:13500"));
+  EXPECT_EQ(GeoNoMatch, gf.match(40.316667, -3.75));
+  EXPECT_EQ(GeoMatch,   gf.match(40.533333, -3.633333));
+
+  EXPECT_TRUE(gf.compile("point", "40.418889,-3.691944", "equals"));
+  EXPECT_EQ(GeoMatch,   gf.match(40.418889, -3.691944));
+  EXPECT_EQ(GeoNoMatch, gf.match(40.316667, -3.75));
+
+  EXPECT_TRUE(gf.compile("point", "40.418889,-3.691944", "intersects"));
+  EXPECT_EQ(GeoMatch,     gf.match(40.418889, -3.691944));
+  EXPECT_EQ(GeoUndecided, gf.match(40.418889, -3.69194400001));
+  EXPECT_EQ(GeoNoMatch,   gf.match(40.316667, -3.75));
+
+  EXPECT_TRUE(gf.compile("point", "40.418889,-3.691944", "disjoint"));
+  EXPECT_EQ(GeoNoMatch, gf.match(40.418889, -3.691944));
+  EXPECT_EQ(GeoMatch,   gf.match(40.316667, -3.75));
+}
+
+
+
+/* ****************************************************************************
+*
+* polygon -
+*/
+TEST(GeoFilter, polygon)
+{
+  GeoFilter gf;
+
+  EXPECT_TRUE(gf.compile("polygon", "40.1,-4.1;40.8,-4.03;40.63,-3.41;40.12,-3.55;40.1,-4.1", "coveredBy"));
+  EXPECT_EQ(GeoMatch,     gf.match(40.4, -3.7));
+  EXPECT_EQ(GeoNoMatch,   gf.match(41, -3.7));     // out of the bounding box
+  EXPECT_EQ(GeoNoMatch,   gf.match(40.7, -3.5));   // in the bounding box, but out of the polygon
+  EXPECT_EQ(GeoUndecided, gf.match(40.1, -4.1));   // a vertex
+
+  EXPECT_TRUE(gf.compile("polygon", "40.1,-4.1;40.8,-4.03;40.63,-3.41;40.12,-3.55;40.1,-4.1", "intersects"));
+  EXPECT_EQ(GeoMatch,   gf.match(40.4, -3.7));
+  EXPECT_EQ(GeoNoMatch, gf.match(41, -3.7));
+
+  EXPECT_TRUE(gf.compile("polygon", "40.1,-4.1;40.8,-4.03;40.63,-3.41;40.12,-3.55;40.1,-4.1", "disjoint"));
+  EXPECT_EQ(GeoNoMatch,   gf.match(40.4, -3.7));
+  EXPECT_EQ(GeoMatch,     gf.match(41, -3.7));
+  EXPECT_EQ(GeoUndecided, gf.match(40.1, -4.1));
+
+  EXPECT_TRUE(gf.compile("polygon", "40.1,-4.1;40.8,-4.03;40.63,-3.41;40.12,-3.55;40.1,-4.1", "equals"));
+  EXPECT_EQ(GeoNoMatch, gf.match(40.4, -3.7));
+}
+
+
+
+/* ****************************************************************************
+*
+* boxGeodesicEdges -
+*
+* The north edge of the box (latitude 50) is a geodesic for MongoDB, that reaches about
+* latitude 50.094 in the middle, so a point in latitude 50.05 is inside the box for MongoDB,
+* although it is out of the box in the lon/lat plane.
+*/
+TEST(GeoFilter, boxGeodesicEdges)
+{
+  GeoFilter gf;
+
+  EXPECT_TRUE(gf.compile("box", "40,0;50,10", "coveredBy"));
+  EXPECT_EQ(GeoUndecided, gf.match(50.05, 5));
+  EXPECT_EQ(GeoNoMatch,   gf.match(50.5, 5));
+  EXPECT_EQ(GeoMatch,     gf.match(49.7, 5));
+  EXPECT_EQ(GeoMatch,     gf.match(40.3, 0.3));
+  EXPECT_EQ(GeoNoMatch,   gf.match(45, 10.3));
+}
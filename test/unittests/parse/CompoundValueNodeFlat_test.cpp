@@ -0,0 +1,298 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <stdio.h>
+#include <time.h>
+
+#include <string>
+
+#include "logMsg/logMsg.h"
+#include "logMsg/traceLevels.h"
+
+#include "common/clockFunctions.h"
+#include "orionTypes/OrionValueType.h"
+#include "parse/CompoundValueNode.h"
+
+#include "unittest.h"
+
+
+
+/* ****************************************************************************
+*
+* BENCH_POINTS - number of points of the polygon used in the 'largePayload' benchmark
+*/
+#define BENCH_POINTS  20000
+
+
+
+/* ****************************************************************************
+*
+* flatTreeNew -
+*
+* Builds, as a flat tree, the equivalent to the JSON v2 attribute value
+*   { "a": [ 1, "x", { "b": true, "b": null } ] }
+*/
+static orion::CompoundValueNode* flatTreeNew(void)
+{
+  orion::CompoundValueNode* tree = new orion::CompoundValueNode(orion::ValueTypeObject);
+
+  tree->flatInit(6);
+
+  tree->flatChildrenAdd(tree, 1);
+  orion::CompoundValueNode* a = tree->childV[0];
+  a->name      = "a";
+  a->valueType = orion::ValueTypeVector;
+
+  tree->flatChildrenAdd(a, 3);
+  a->childV[0]->valueType   = orion::ValueTypeNumber;
+  a->childV[0]->numberValue = 1;
+  a->childV[1]->valueType   = orion::ValueTypeString;
+  a->childV[1]->stringValue = "x";
+  a->childV[2]->valueType   = orion::ValueTypeObject;
+
+  orion::CompoundValueNode* obj = a->childV[2];
+  tree->flatChildrenAdd(obj, 2);
+  obj->childV[0]->name      = "b";
+  obj->childV[0]->valueType = orion::ValueTypeBoolean;
+  obj->childV[0]->boolValue = true;
+  obj->childV[1]->name      = "b";
+  obj->childV[1]->valueType = orion::ValueTypeNone;
+
+  return tree;
+}
+
+
+
+/* ****************************************************************************
+*
+* flatTree -
+*/
+TEST(CompoundValueNodeFlat, flatTree)
+{
+  utInit();
+
+  orion::CompoundValueNode*  tree = flatTreeNew();
+  orion::CompoundValueNode*  a    = tree->childV[0];
+  orion::CompoundValueNode*  obj  = a->childV[2];
+
+  // All the nodes in the array of the root, the children of each node next to each other
+  EXPECT_EQ(6, tree->nodeArrayP->nodesUsed);
+  EXPECT_EQ(&tree->nodeArrayP->nodeV[0], a);
+  EXPECT_EQ(&tree->nodeArrayP->nodeV[1], a->childV[0]);
+  EXPECT_EQ(a->childV[0] + 2, obj);
+  EXPECT_EQ(&tree->nodeArrayP->nodeV[4], obj->childV[0]);
+  EXPECT_EQ(obj->childV[0] + 1, obj->childV[1]);
+
+  EXPECT_EQ(a,    obj->container);
+  EXPECT_EQ(tree, obj->rootP);
+  EXPECT_EQ(2,    obj->siblingNo);
+  EXPECT_EQ(3,    obj->childV[1]->level());
+
+  // The path is not kept, but built as the JSON v2 parser has always reported it
+  EXPECT_EQ("/a/",        a->fullPath());
+  EXPECT_EQ("/a/[002]/",  obj->fullPath());
+  EXPECT_EQ("/a/[002]/b", obj->childV[1]->fullPath());
+
+  EXPECT_EQ("duplicated tag-name: /b/ in path: /a/[002]/", tree->finish());
+
+  obj->childV[1]->name = "c";
+  EXPECT_EQ("OK", tree->finish());
+  EXPECT_EQ("\"a\":[1,\"x\",{\"b\":true,\"c\":null}]", tree->toJson(true));
+
+  // Adding to a node of a flat tree
+  obj->add(orion::ValueTypeString, "d", "y");
+  ASSERT_EQ(3, obj->childV.size());
+  EXPECT_EQ(&tree->nodeArrayP->nodeV[4], obj->childV[0]);
+  EXPECT_EQ("/a/[002]/d", obj->childV[2]->fullPath());
+  EXPECT_EQ("\"a\":[1,\"x\",{\"b\":true,\"c\":null,\"d\":\"y\"}]", tree->toJson(true));
+
+  orion::CompoundValueNode* copy = tree->clone();
+
+  EXPECT_EQ(7, copy->nodeArrayP->nodesUsed);
+  EXPECT_TRUE(copy->childV[0]->childV[2]->childV[2]->flat);
+  EXPECT_EQ(tree->toJson(true), copy->toJson(true));
+
+  delete tree;
+  delete copy;
+
+  utExit();
+}
+
+
+
+/* ****************************************************************************
+*
+* noRoom - the children are created one by one if the node array is too small
+*/
+TEST(CompoundValueNodeFlat, noRoom)
+{
+  orion::CompoundValueNode* tree = new orion::CompoundValueNode(orion::ValueTypeVector);
+
+  utInit();
+
+  tree->flatInit(1);
+  tree->flatChildrenAdd(tree, 1);
+  tree->flatChildrenAdd(tree->childV[0], 2);
+
+  tree->childV[0]->valueType = orion::ValueTypeVector;
+  tree->childV[0]->childV[0]->valueType = orion::ValueTypeBoolean;
+  tree->childV[0]->childV[1]->valueType = orion::ValueTypeBoolean;
+
+  EXPECT_TRUE(tree->childV[0]->flat);
+  EXPECT_FALSE(tree->childV[0]->childV[1]->flat);
+  EXPECT_EQ(1, tree->childV[0]->childV[1]->siblingNo);
+  EXPECT_EQ("[false,false]", tree->toJson(true));
+
+  delete tree;
+
+  utExit();
+}
+
+
+
+/* ****************************************************************************
+*
+* msSince -
+*/
+static double msSince(const struct timespec* startP)
+{
+  struct timespec  end;
+  struct timespec  diff;
+
+  clock_gettime(CLOCK_REALTIME, &end);
+  clock_difftime(&end, startP, &diff);
+
+  return diff.tv_sec * 1000 + diff.tv_nsec / 1E6;
+}
+
+
+
+/* ****************************************************************************
+*
+* largePayload -
+*
+* Not really a test, but a benchmark building, checking, rendering and cloning a large
+* compound value, a GeoJSON polygon of BENCH_POINTS points (3 nodes per point), both node
+* by node (as the NGSIv1 parsers do) and as a flat tree (as the JSON v2 parsers and the
+* DB do).
+*/
+TEST(CompoundValueNodeFlat, largePayload)
+{
+  struct timespec  start;
+  double           nodeByNodeTime;
+  double           flatTime;
+  double           checkTime;
+  double           renderTime;
+  double           cloneTime;
+
+  utInit();
+
+  // Node by node
+  clock_gettime(CLOCK_REALTIME, &start);
+
+  orion::CompoundValueNode*  tree   = new orion::CompoundValueNode(orion::ValueTypeObject);
+  orion::CompoundValueNode*  coords;
+  orion::CompoundValueNode*  ring;
+
+  tree->add(orion::ValueTypeString, "type", "Polygon");
+  coords = tree->add(orion::ValueTypeVector, "coordinates", "");
+  ring   = coords->add(orion::ValueTypeVector, "item", "");
+
+  for (int ix = 0; ix < BENCH_POINTS; ++ix)
+  {
+    orion::CompoundValueNode* point = ring->add(orion::ValueTypeVector, "item", "");
+
+    point->add(orion::ValueTypeNumber, "item", -3.0 + ix / 1000000.0);
+    point->add(orion::ValueTypeNumber, "item", 40.0 + ix / 1000000.0);
+  }
+
+  nodeByNodeTime = msSince(&start);
+
+  // Flat
+  clock_gettime(CLOCK_REALTIME, &start);
+
+  orion::CompoundValueNode* flat = new orion::CompoundValueNode(orion::ValueTypeObject);
+
+  flat->flatInit(3 * BENCH_POINTS + 3);
+  flat->flatChildrenAdd(flat, 2);
+
+  flat->childV[0]->name        = "type";
+  flat->childV[0]->valueType   = orion::ValueTypeString;
+  flat->childV[0]->stringValue = "Polygon";
+
+  coords = flat->childV[1];
+  coords->name      = "coordinates";
+  coords->valueType = orion::ValueTypeVector;
+  flat->flatChildrenAdd(coords, 1);
+
+  ring = coords->childV[0];
+  ring->valueType = orion::ValueTypeVector;
+  flat->flatChildrenAdd(ring, BENCH_POINTS);
+
+  for (int ix = 0; ix < BENCH_POINTS; ++ix)
+  {
+    orion::CompoundValueNode* point = ring->childV[ix];
+
+    point->valueType = orion::ValueTypeVector;
+    flat->flatChildrenAdd(point, 2);
+
+    point->childV[0]->valueType   = orion::ValueTypeNumber;
+    point->childV[0]->numberValue = -3.0 + ix / 1000000.0;
+    point->childV[1]->valueType   = orion::ValueTypeNumber;
+    point->childV[1]->numberValue = 40.0 + ix / 1000000.0;
+  }
+
+  flatTime = msSince(&start);
+
+  clock_gettime(CLOCK_REALTIME, &start);
+  EXPECT_EQ("OK", flat->finish());
+  checkTime = msSince(&start);
+
+  clock_gettime(CLOCK_REALTIME, &start);
+  std::string rendered = flat->toJson(true);
+  renderTime = msSince(&start);
+
+  clock_gettime(CLOCK_REALTIME, &start);
+  orion::CompoundValueNode* copy = tree->clone();
+  cloneTime = msSince(&start);
+
+  EXPECT_EQ(tree->toJson(true), rendered);
+  EXPECT_EQ(rendered, copy->toJson(true));
+  EXPECT_EQ(3 * BENCH_POINTS + 3, copy->nodeArrayP->nodesUsed);
+
+  printf("%d nodes: build node by node %.3f ms, flat %.3f ms; check %.3f ms, render %.3f ms (%lu bytes), clone %.3f ms\n",
+         3 * BENCH_POINTS + 4,
+         nodeByNodeTime,
+         flatTime,
+         checkTime,
+         renderTime,
+         rendered.size(),
+         cloneTime);
+
+  delete tree;
+  delete flat;
+  delete copy;
+
+  utExit();
+}
@@ -50,7 +50,7 @@ TEST(CompoundValueNode, tree)
 
   for (int ix = 0; ix < 5; ++ix)
   {
-    vecItem = new orion::CompoundValueNode(vec, std::string("/vec/") + name, name, "a", ix, orion::ValueTypeString, 2);
+    vecItem = new orion::CompoundValueNode(vec, name, "a", ix, orion::ValueTypeString);
     vec->add(vecItem);
   }
 
@@ -65,7 +65,7 @@ TEST(CompoundValueNode, tree)
   ASSERT_EQ(6, copy->childV[0]->childV.size());
   ASSERT_STREQ("vecItem", copy->childV[0]->childV[0]->name.c_str());
   ASSERT_EQ(3, copy->childV[0]->childV[3]->siblingNo);
-  ASSERT_EQ(2, copy->childV[0]->childV[3]->level);
+  ASSERT_EQ(2, copy->childV[0]->childV[3]->level());
 
   delete tree;
   delete copy;
@@ -108,8 +108,8 @@ TEST(CompoundValueNode, vectorInvalidAndOk)
   lmTraceLevelSet(LmtCompoundValueAdd, true);
 
   orion::CompoundValueNode*  tree     = new orion::CompoundValueNode(orion::ValueTypeObject);
-  orion::CompoundValueNode*  vec      = new orion::CompoundValueNode(tree, "/vec", "vec", "", 0, orion::ValueTypeVector, 1);
-  orion::CompoundValueNode*  item1    = new orion::CompoundValueNode(vec, std::string("/vec/vecitem1"), "vecitem1",  "a", 0, orion::ValueTypeString, 2);
+  orion::CompoundValueNode*  vec      = new orion::CompoundValueNode(tree, "vec", "", 0, orion::ValueTypeVector);
+  orion::CompoundValueNode*  item1    = new orion::CompoundValueNode(vec, "vecitem1",  "a", 0, orion::ValueTypeString);
   const char*                outFile2 = "ngsi.compoundValue.vector.invalid.json";
 
   utInit();
@@ -118,12 +118,10 @@ TEST(CompoundValueNode, vectorInvalidAndOk)
   vec->add(item1);
   vec->add(orion::ValueTypeString, "vecitem", "a");
 
-  tree->finish();
-  EXPECT_STREQ("bad tag-name of vector item: /vecitem/, should be /vecitem1/", tree->error.c_str());
+  EXPECT_EQ("bad tag-name of vector item: /vecitem/, should be /vecitem1/", tree->finish());
 
   item1->name = "vecitem";
-  tree->finish();
-  EXPECT_STREQ("OK", tree->error.c_str());
+  EXPECT_EQ("OK", tree->finish());
 
   std::string rendered;
 
@@ -153,9 +151,9 @@ TEST(CompoundValueNode, structInvalidAndOk)
   lmTraceLevelSet(LmtCompoundValueAdd, true);
 
   orion::CompoundValueNode*  tree     = new orion::CompoundValueNode(orion::ValueTypeObject);
-  orion::CompoundValueNode*  str      = new orion::CompoundValueNode(tree, "/struct", "struct", "", 0, orion::ValueTypeObject, 1);
-  orion::CompoundValueNode*  item1    = new orion::CompoundValueNode(str, std::string("/struct/structitem"), "structitem", "a", 0, orion::ValueTypeString, 2);
-  orion::CompoundValueNode*  item2    = new orion::CompoundValueNode(str, std::string("/struct/structitem"), "structitem", "a", 1, orion::ValueTypeString, 2);
+  orion::CompoundValueNode*  str      = new orion::CompoundValueNode(tree, "struct", "", 0, orion::ValueTypeObject);
+  orion::CompoundValueNode*  item1    = new orion::CompoundValueNode(str, "structitem", "a", 0, orion::ValueTypeString);
+  orion::CompoundValueNode*  item2    = new orion::CompoundValueNode(str, "structitem", "a", 1, orion::ValueTypeString);
   const char*                outFile2 = "ngsi.compoundValue.struct.invalid.json";
 
   utInit();
@@ -164,12 +162,10 @@ TEST(CompoundValueNode, structInvalidAndOk)
   str->add(item1);
   str->add(item2);
 
-  tree->finish();
-  EXPECT_STREQ("duplicated tag-name: /structitem/ in path: /struct", tree->error.c_str());
+  EXPECT_EQ("duplicated tag-name: /structitem/ in path: /struct", tree->finish());
 
   item2->name = "structitem2";
-  tree->finish();
-  EXPECT_STREQ("OK", tree->error.c_str());
+  EXPECT_EQ("OK", tree->finish());
 
   std::string rendered;
 
@@ -124,9 +124,9 @@ TEST(compoundValue, updateOneStringJson)
   // The root should have exactly one child
   EXPECT_EQ(1, cvnRootP->childV.size());
 
-  EXPECT_EQ(0, cvnRootP->level);
+  EXPECT_EQ(0, cvnRootP->level());
   EXPECT_EQ(0, cvnRootP->siblingNo);
-  EXPECT_EQ("/", cvnRootP->path);
+  EXPECT_EQ("/", cvnRootP->fullPath());
 
   // The child
   childP = cvnRootP->childV[0];
@@ -139,8 +139,8 @@ TEST(compoundValue, updateOneStringJson)
   EXPECT_EQ(cvnRootP,                          childP->container);
   EXPECT_EQ(cvnRootP,                          childP->rootP);
 
-  EXPECT_EQ("/s1",                             childP->path);
-  EXPECT_EQ(1,                                 childP->level);
+  EXPECT_EQ("/s1",                             childP->fullPath());
+  EXPECT_EQ(1,                                 childP->level());
   EXPECT_EQ(0,                                 childP->siblingNo);
 
   utExit();
@@ -187,9 +187,9 @@ TEST(compoundValue, updateTwoStringsJson)
   // The root should have exactly two children
   EXPECT_EQ(2, cvnRootP->childV.size());
 
-  EXPECT_EQ(0, cvnRootP->level);
+  EXPECT_EQ(0, cvnRootP->level());
   EXPECT_EQ(0, cvnRootP->siblingNo);
-  EXPECT_EQ("/", cvnRootP->path);
+  EXPECT_EQ("/", cvnRootP->fullPath());
 
   // child 1
   childP = cvnRootP->childV[0];
@@ -202,8 +202,8 @@ TEST(compoundValue, updateTwoStringsJson)
   EXPECT_EQ(cvnRootP,                          childP->container);
   EXPECT_EQ(cvnRootP,                          childP->rootP);
 
-  EXPECT_EQ("/s1",                             childP->path);
-  EXPECT_EQ(1,                                 childP->level);
+  EXPECT_EQ("/s1",                             childP->fullPath());
+  EXPECT_EQ(1,                                 childP->level());
   EXPECT_EQ(0,                                 childP->siblingNo);
 
   // child 2
@@ -217,8 +217,8 @@ TEST(compoundValue, updateTwoStringsJson)
   EXPECT_EQ(cvnRootP,                          childP->container);
   EXPECT_EQ(cvnRootP,                          childP->rootP);
 
-  EXPECT_EQ("/s2",                             childP->path);
-  EXPECT_EQ(1,                                 childP->level);
+  EXPECT_EQ("/s2",                             childP->fullPath());
+  EXPECT_EQ(1,                                 childP->level());
   EXPECT_EQ(1,                                 childP->siblingNo);
 
   utExit();
@@ -291,9 +291,9 @@ TEST(compoundValue, updateContextValueVectorOneItemJson)
   // The root should have exactly one child
   EXPECT_EQ(1, cvnRootP->childV.size());
 
-  EXPECT_EQ(0, cvnRootP->level);
+  EXPECT_EQ(0, cvnRootP->level());
   EXPECT_EQ(0, cvnRootP->siblingNo);
-  EXPECT_EQ("/", cvnRootP->path);
+  EXPECT_EQ("/", cvnRootP->fullPath());
 
   // The child
   childP = cvnRootP->childV[0];
@@ -306,8 +306,8 @@ TEST(compoundValue, updateContextValueVectorOneItemJson)
   EXPECT_EQ(cvnRootP,                          childP->container);
   EXPECT_EQ(cvnRootP,                          childP->rootP);
 
-  EXPECT_EQ("/item",                           childP->path);
-  EXPECT_EQ(1,                                 childP->level);
+  EXPECT_EQ("/item",                           childP->fullPath());
+  EXPECT_EQ(1,                                 childP->level());
   EXPECT_EQ(0,                                 childP->siblingNo);
 
   utExit();
@@ -353,9 +353,9 @@ TEST(compoundValue, updateContextValueVectorFiveItemsJson)
   // The root should have five children
   EXPECT_EQ(5, cvnRootP->childV.size());
 
-  EXPECT_EQ(0, cvnRootP->level);
+  EXPECT_EQ(0, cvnRootP->level());
   EXPECT_EQ(0, cvnRootP->siblingNo);
-  EXPECT_EQ("/", cvnRootP->path);
+  EXPECT_EQ("/", cvnRootP->fullPath());
 
   // Child 1-5
   std::string value[] = { "1", "2", "3", "4", "5" };
@@ -371,8 +371,8 @@ TEST(compoundValue, updateContextValueVectorFiveItemsJson)
     EXPECT_EQ(cvnRootP,                          childP->container);
     EXPECT_EQ(cvnRootP,                          childP->rootP);
 
-    EXPECT_EQ("/item",                           childP->path);
-    EXPECT_EQ(1,                                 childP->level);
+    EXPECT_EQ("/item",                           childP->fullPath());
+    EXPECT_EQ(1,                                 childP->level());
     EXPECT_EQ(childIx,                           childP->siblingNo);
   }
 
@@ -429,9 +429,9 @@ TEST(compoundValue, updateTwoStructsJson)
   // The root should have two children
   EXPECT_EQ(2, cvnRootP->childV.size());
 
-  EXPECT_EQ(0, cvnRootP->level);
+  EXPECT_EQ(0, cvnRootP->level());
   EXPECT_EQ(0, cvnRootP->siblingNo);
-  EXPECT_EQ("/", cvnRootP->path);
+  EXPECT_EQ("/", cvnRootP->fullPath());
 
   // Now, child struct 1
   structP = cvnRootP->childV[0];
@@ -443,8 +443,8 @@ TEST(compoundValue, updateTwoStructsJson)
   EXPECT_EQ(cvnRootP,                          structP->container);
   EXPECT_EQ(cvnRootP,                          structP->rootP);
 
-  EXPECT_EQ("/struct1",                        structP->path);
-  EXPECT_EQ(1,                                 structP->level);
+  EXPECT_EQ("/struct1",                        structP->fullPath());
+  EXPECT_EQ(1,                                 structP->level());
   EXPECT_EQ(0,                                 structP->siblingNo);
 
   // Child 1 of struct1
@@ -458,8 +458,8 @@ TEST(compoundValue, updateTwoStructsJson)
   EXPECT_EQ(structP,                             childP->container);
   EXPECT_EQ(cvnRootP,                            childP->rootP);
 
-  EXPECT_EQ("/struct1/s1-1",                     childP->path);
-  EXPECT_EQ(2,                                   childP->level);
+  EXPECT_EQ("/struct1/s1-1",                     childP->fullPath());
+  EXPECT_EQ(2,                                   childP->level());
   EXPECT_EQ(0,                                   childP->siblingNo);
 
 
@@ -474,8 +474,8 @@ TEST(compoundValue, updateTwoStructsJson)
   EXPECT_EQ(structP,                             childP->container);
   EXPECT_EQ(cvnRootP,                            childP->rootP);
 
-  EXPECT_EQ("/struct1/s1-2",                     childP->path);
-  EXPECT_EQ(2,                                   childP->level);
+  EXPECT_EQ("/struct1/s1-2",                     childP->fullPath());
+  EXPECT_EQ(2,                                   childP->level());
   EXPECT_EQ(1,                                   childP->siblingNo);
 
 
@@ -490,8 +490,8 @@ TEST(compoundValue, updateTwoStructsJson)
   EXPECT_EQ(cvnRootP,                          structP->container);
   EXPECT_EQ(cvnRootP,                          structP->rootP);
 
-  EXPECT_EQ("/struct2",                        structP->path);
-  EXPECT_EQ(1,                                 structP->level);
+  EXPECT_EQ("/struct2",                        structP->fullPath());
+  EXPECT_EQ(1,                                 structP->level());
   EXPECT_EQ(1,                                 structP->siblingNo);
 
   // Child 1 of struct2
@@ -505,8 +505,8 @@ TEST(compoundValue, updateTwoStructsJson)
   EXPECT_EQ(structP,                             childP->container);
   EXPECT_EQ(cvnRootP,                            childP->rootP);
 
-  EXPECT_EQ("/struct2/s2-1",                     childP->path);
-  EXPECT_EQ(2,                                   childP->level);
+  EXPECT_EQ("/struct2/s2-1",                     childP->fullPath());
+  EXPECT_EQ(2,                                   childP->level());
   EXPECT_EQ(0,                                   childP->siblingNo);
 
 
@@ -521,8 +521,8 @@ TEST(compoundValue, updateTwoStructsJson)
   EXPECT_EQ(structP,                             childP->container);
   EXPECT_EQ(cvnRootP,                            childP->rootP);
 
-  EXPECT_EQ("/struct2/s2-2",                     childP->path);
-  EXPECT_EQ(2,                                   childP->level);
+  EXPECT_EQ("/struct2/s2-2",                     childP->fullPath());
+  EXPECT_EQ(2,                                   childP->level());
   EXPECT_EQ(1,                                   childP->siblingNo);
 
   utExit();
@@ -582,9 +582,9 @@ TEST(compoundValue, sixLevelsJson)
   // The root should have one child
   EXPECT_EQ(1, cvnRootP->childV.size());
 
-  EXPECT_EQ(0, cvnRootP->level);
+  EXPECT_EQ(0, cvnRootP->level());
   EXPECT_EQ(0, cvnRootP->siblingNo);
-  EXPECT_EQ("/", cvnRootP->path);
+  EXPECT_EQ("/", cvnRootP->fullPath());
 
 
   // Now, child 1: level1
@@ -598,8 +598,8 @@ TEST(compoundValue, sixLevelsJson)
   EXPECT_EQ(cvnRootP,                          level1->container);
   EXPECT_EQ(cvnRootP,                          level1->rootP);
 
-  EXPECT_EQ("/level1",                         level1->path);
-  EXPECT_EQ(1,                                 level1->level);
+  EXPECT_EQ("/level1",                         level1->fullPath());
+  EXPECT_EQ(1,                                 level1->level());
   EXPECT_EQ(0,                                 level1->siblingNo);
 
   // /level1/level == 1
@@ -613,8 +613,8 @@ TEST(compoundValue, sixLevelsJson)
   EXPECT_EQ(level1,                            childP->container);
   EXPECT_EQ(cvnRootP,                          childP->rootP);
 
-  EXPECT_EQ("/level1/level",                   childP->path);
-  EXPECT_EQ(2,                                 childP->level);
+  EXPECT_EQ("/level1/level",                   childP->fullPath());
+  EXPECT_EQ(2,                                 childP->level());
   EXPECT_EQ(0,                                 childP->siblingNo);
 
 
@@ -628,8 +628,8 @@ TEST(compoundValue, sixLevelsJson)
   EXPECT_EQ(level1,                            level2->container);
   EXPECT_EQ(cvnRootP,                          level2->rootP);
 
-  EXPECT_EQ("/level1/level2",                  level2->path);
-  EXPECT_EQ(2,                                 level2->level);
+  EXPECT_EQ("/level1/level2",                  level2->fullPath());
+  EXPECT_EQ(2,                                 level2->level());
   EXPECT_EQ(1,                                 level2->siblingNo);
 
 
@@ -644,8 +644,8 @@ TEST(compoundValue, sixLevelsJson)
   EXPECT_EQ(level2,                            childP->container);
   EXPECT_EQ(cvnRootP,                          childP->rootP);
 
-  EXPECT_EQ("/level1/level2/level",            childP->path);
-  EXPECT_EQ(3,                                 childP->level);
+  EXPECT_EQ("/level1/level2/level",            childP->fullPath());
+  EXPECT_EQ(3,                                 childP->level());
   EXPECT_EQ(0,                                 childP->siblingNo);
 
   // /level1/level2/level3 == Vector
@@ -658,8 +658,8 @@ TEST(compoundValue, sixLevelsJson)
   EXPECT_EQ(level2,                            level3->container);
   EXPECT_EQ(cvnRootP,                          level3->rootP);
 
-  EXPECT_EQ("/level1/level2/level3",           level3->path);
-  EXPECT_EQ(3,                                 level3->level);
+  EXPECT_EQ("/level1/level2/level3",           level3->fullPath());
+  EXPECT_EQ(3,                                 level3->level());
   EXPECT_EQ(1,                                 level3->siblingNo);
 
   // /level1/level2/level3/level4item[0]
@@ -672,8 +672,8 @@ TEST(compoundValue, sixLevelsJson)
   EXPECT_EQ(level3,                             vitemP->container);
   EXPECT_EQ(cvnRootP,                           vitemP->rootP);
 
-  EXPECT_EQ("/level1/level2/level3/item",       vitemP->path);
-  EXPECT_EQ(4,                                  vitemP->level);
+  EXPECT_EQ("/level1/level2/level3/item",       vitemP->fullPath());
+  EXPECT_EQ(4,                                  vitemP->level());
   EXPECT_EQ(0,                                  vitemP->siblingNo);
 
   // /level1/level2/level3/item[0]/level
@@ -687,8 +687,8 @@ TEST(compoundValue, sixLevelsJson)
   EXPECT_EQ(vitemP,                                   childP->container);
   EXPECT_EQ(cvnRootP,                                 childP->rootP);
 
-  EXPECT_EQ("/level1/level2/level3/item/level",       childP->path);
-  EXPECT_EQ(5,                                        childP->level);
+  EXPECT_EQ("/level1/level2/level3/item/level",       childP->fullPath());
+  EXPECT_EQ(5,                                        childP->level());
   EXPECT_EQ(0,                                        childP->siblingNo);
 
   // /level1/level2/level3/item[0]/struct1
@@ -701,8 +701,8 @@ TEST(compoundValue, sixLevelsJson)
   EXPECT_EQ(vitemP,                                     structP->container);
   EXPECT_EQ(cvnRootP,                                   structP->rootP);
 
-  EXPECT_EQ("/level1/level2/level3/item/struct1",       structP->path);
-  EXPECT_EQ(5,                                          structP->level);
+  EXPECT_EQ("/level1/level2/level3/item/struct1",       structP->fullPath());
+  EXPECT_EQ(5,                                          structP->level());
   EXPECT_EQ(1,                                          structP->siblingNo);
 
   // /level1/level2/level3/item[0]/struct1/level
@@ -716,8 +716,8 @@ TEST(compoundValue, sixLevelsJson)
   EXPECT_EQ(structP,                                          childP->container);
   EXPECT_EQ(cvnRootP,                                         childP->rootP);
 
-  EXPECT_EQ("/level1/level2/level3/item/struct1/level",       childP->path);
-  EXPECT_EQ(6,                                                childP->level);
+  EXPECT_EQ("/level1/level2/level3/item/struct1/level",       childP->fullPath());
+  EXPECT_EQ(6,                                                childP->level());
   EXPECT_EQ(0,                                                childP->siblingNo);
 
   // /level1/level2/level3/item[0]/struct1/s1-1
@@ -731,8 +731,8 @@ TEST(compoundValue, sixLevelsJson)
   EXPECT_EQ(structP,                                          childP->container);
   EXPECT_EQ(cvnRootP,                                         childP->rootP);
 
-  EXPECT_EQ("/level1/level2/level3/item/struct1/s1-1",        childP->path);
-  EXPECT_EQ(6,                                                childP->level);
+  EXPECT_EQ("/level1/level2/level3/item/struct1/s1-1",        childP->fullPath());
+  EXPECT_EQ(6,                                                childP->level());
   EXPECT_EQ(1,                                                childP->siblingNo);
 
   // /level1/level2/level3/item[0]/struct1/s1-2
@@ -746,8 +746,8 @@ TEST(compoundValue, sixLevelsJson)
   EXPECT_EQ(structP,                                          childP->container);
   EXPECT_EQ(cvnRootP,                                         childP->rootP);
 
-  EXPECT_EQ("/level1/level2/level3/item/struct1/s1-2",        childP->path);
-  EXPECT_EQ(6,                                                childP->level);
+  EXPECT_EQ("/level1/level2/level3/item/struct1/s1-2",        childP->fullPath());
+  EXPECT_EQ(6,                                                childP->level());
   EXPECT_EQ(2,                                                childP->siblingNo);
 
 
@@ -761,8 +761,8 @@ TEST(compoundValue, sixLevelsJson)
   EXPECT_EQ(level3,                             vitemP->container);
   EXPECT_EQ(cvnRootP,                           vitemP->rootP);
 
-  EXPECT_EQ("/level1/level2/level3/item",       vitemP->path);
-  EXPECT_EQ(4,                                  vitemP->level);
+  EXPECT_EQ("/level1/level2/level3/item",       vitemP->fullPath());
+  EXPECT_EQ(4,                                  vitemP->level());
   EXPECT_EQ(1,                                  vitemP->siblingNo);
 
   // /level1/level2/level3/item[1]/level
@@ -776,8 +776,8 @@ TEST(compoundValue, sixLevelsJson)
   EXPECT_EQ(vitemP,                                   childP->container);
   EXPECT_EQ(cvnRootP,                                 childP->rootP);
 
-  EXPECT_EQ("/level1/level2/level3/item/level",       childP->path);
-  EXPECT_EQ(5,                                        childP->level);
+  EXPECT_EQ("/level1/level2/level3/item/level",       childP->fullPath());
+  EXPECT_EQ(5,                                        childP->level());
   EXPECT_EQ(0,                                        childP->siblingNo);
 
   // /level1/level2/level3/item[1]/struct2
@@ -790,8 +790,8 @@ TEST(compoundValue, sixLevelsJson)
   EXPECT_EQ(vitemP,                                     structP->container);
   EXPECT_EQ(cvnRootP,                                   structP->rootP);
 
-  EXPECT_EQ("/level1/level2/level3/item/struct2",       structP->path);
-  EXPECT_EQ(5,                                          structP->level);
+  EXPECT_EQ("/level1/level2/level3/item/struct2",       structP->fullPath());
+  EXPECT_EQ(5,                                          structP->level());
   EXPECT_EQ(1,                                          structP->siblingNo);
 
   // /level1/level2/level3/item[1]/struct2/level
@@ -805,8 +805,8 @@ TEST(compoundValue, sixLevelsJson)
   EXPECT_EQ(structP,                                          childP->container);
   EXPECT_EQ(cvnRootP,                                         childP->rootP);
 
-  EXPECT_EQ("/level1/level2/level3/item/struct2/level",       childP->path);
-  EXPECT_EQ(6,                                                childP->level);
+  EXPECT_EQ("/level1/level2/level3/item/struct2/level",       childP->fullPath());
+  EXPECT_EQ(6,                                                childP->level());
   EXPECT_EQ(0,                                                childP->siblingNo);
 
   // /level1/level2/level3/item[1]/struct2/s2-1
@@ -820,8 +820,8 @@ TEST(compoundValue, sixLevelsJson)
   EXPECT_EQ(structP,                                          childP->container);
   EXPECT_EQ(cvnRootP,                                         childP->rootP);
 
-  EXPECT_EQ("/level1/level2/level3/item/struct2/s2-1",        childP->path);
-  EXPECT_EQ(6,                                                childP->level);
+  EXPECT_EQ("/level1/level2/level3/item/struct2/s2-1",        childP->fullPath());
+  EXPECT_EQ(6,                                                childP->level());
   EXPECT_EQ(1,                                                childP->siblingNo);
 
   // /level1/level2/level3/item[1]/struct2/s2-2
@@ -835,8 +835,8 @@ TEST(compoundValue, sixLevelsJson)
   EXPECT_EQ(structP,                                          childP->container);
   EXPECT_EQ(cvnRootP,                                         childP->rootP);
 
-  EXPECT_EQ("/level1/level2/level3/item/struct2/s2-2",        childP->path);
-  EXPECT_EQ(6,                                                childP->level);
+  EXPECT_EQ("/level1/level2/level3/item/struct2/s2-2",        childP->fullPath());
+  EXPECT_EQ(6,                                                childP->level());
   EXPECT_EQ(2,                                                childP->siblingNo);
 
   utExit();
@@ -882,9 +882,9 @@ TEST(compoundValue, updateOneStringAndOneVectorInSeparateContextValuesJson)
   // The root should have exactly one child
   EXPECT_EQ(1, cvnRootP->childV.size());
 
-  EXPECT_EQ(0, cvnRootP->level);
+  EXPECT_EQ(0, cvnRootP->level());
   EXPECT_EQ(0, cvnRootP->siblingNo);
-  EXPECT_EQ("/", cvnRootP->path);
+  EXPECT_EQ("/", cvnRootP->fullPath());
 
   // The child
   childP = cvnRootP->childV[0];
@@ -897,8 +897,8 @@ TEST(compoundValue, updateOneStringAndOneVectorInSeparateContextValuesJson)
   EXPECT_EQ(cvnRootP,                          childP->container);
   EXPECT_EQ(cvnRootP,                          childP->rootP);
 
-  EXPECT_EQ("/s1",                             childP->path);
-  EXPECT_EQ(1,                                 childP->level);
+  EXPECT_EQ("/s1",                             childP->fullPath());
+  EXPECT_EQ(1,                                 childP->level());
   EXPECT_EQ(0,                                 childP->siblingNo);
 
 
@@ -922,9 +922,9 @@ TEST(compoundValue, updateOneStringAndOneVectorInSeparateContextValuesJson)
   // The root should have four children
   EXPECT_EQ(4, cvnRootP->childV.size());
 
-  EXPECT_EQ(0, cvnRootP->level);
+  EXPECT_EQ(0, cvnRootP->level());
   EXPECT_EQ(0, cvnRootP->siblingNo);
-  EXPECT_EQ("/", cvnRootP->path);
+  EXPECT_EQ("/", cvnRootP->fullPath());
 
   // The children
   const char* value[] = { "I-0", "I-1", "I-2", "I-3" };
@@ -940,8 +940,8 @@ TEST(compoundValue, updateOneStringAndOneVectorInSeparateContextValuesJson)
     EXPECT_EQ(cvnRootP,                childP->container);
     EXPECT_EQ(cvnRootP,                childP->rootP);
 
-    EXPECT_EQ("/item",                 childP->path);
-    EXPECT_EQ(1,                       childP->level);
+    EXPECT_EQ("/item",                 childP->fullPath());
+    EXPECT_EQ(1,                       childP->level());
     EXPECT_EQ(ix,                      childP->siblingNo);
   }
 
@@ -0,0 +1,211 @@
+/*
+*
+* Copyright 2017 Telefonica Investigacion y Desarrollo, S.A.U
+*
+* This file is part of Orion Context Broker.
+*
+* Orion Context Broker is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* Orion Context Broker is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with Orion Context Broker. If not, see http://www.gnu.org/licenses/.
+*
+* For those usages not covered by this license please contact with
+* iot_support at tid dot es
+*
+* Author: Orion dev team
+*/
+#include <unistd.h>
+#include <pthread.h>
+
+#include <curl/curl.h>
+
+#include "gtest/gtest.h"
+
+#include "common/globals.h"
+#include "rest/httpPool.h"
+
+
+
+/* ****************************************************************************
+*
+* reuse -
+*
+* No request is sent, only the handle bookkeeping is checked.
+*/
+TEST(httpPool, reuse)
+{
+  int    hits;
+  int    misses;
+  int    evictions;
+  int    idle;
+  CURL*  curl1;
+  CURL*  curl2;
+  CURL*  curl3;
+
+  httpPoolInit(2, 30);
+  httpPoolSweep(getCurrentTime() + 3600);
+  httpPoolStatisticsReset();
+  EXPECT_TRUE(httpPoolEnabled());
+
+  std::string endpoint = httpPoolEndpoint("http:", "localhost", 1026);
+  EXPECT_EQ("http://localhost:1026", endpoint);
+
+  curl1 = httpPoolGet(endpoint);
+  curl2 = httpPoolGet(endpoint);
+  EXPECT_TRUE(curl1 != NULL);
+
+  // At the maximum per host
+  EXPECT_FALSE(httpPoolTryGet(endpoint, &curl3));
+
+  httpPoolRelease(endpoint, curl1, true);
+  httpPoolRelease(endpoint, curl2, true);
+
+  // The last handle given back is the first one to be reused, for the same endpoint only
+  EXPECT_EQ(curl2, httpPoolGet(endpoint));
+
+  std::string otherEndpoint = httpPoolEndpoint("https:", "localhost", 1026);
+  CURL*       other         = httpPoolGet(otherEndpoint);
+
+  EXPECT_TRUE(other != curl1);
+  httpPoolRelease(otherEndpoint, other, false);  // failed request, not kept
+
+  httpPoolStatisticsGet(&hits, &misses, &evictions, &idle);
+  EXPECT_EQ(1, hits);
+  EXPECT_EQ(3, misses);
+  EXPECT_EQ(0, evictions);
+  EXPECT_EQ(1, idle);
+
+  httpPoolRelease(endpoint, curl2, true);
+  httpPoolInit(0, 30);
+  EXPECT_FALSE(httpPoolEnabled());
+}
+
+
+
+/* ****************************************************************************
+*
+* getFunc - thread getting a handle for 'capEndpoint', setting 'capCurl' after it
+*/
+static std::string     capEndpoint;
+static CURL* volatile  capCurl = NULL;
+
+static void* getFunc(void* vP)
+{
+  capCurl = httpPoolGet(capEndpoint);
+
+  return NULL;
+}
+
+
+
+/* ****************************************************************************
+*
+* perHostCap -
+*
+* With the connections to an endpoint (in use plus idle) at the maximum, a request
+* to it waits until a handle is given back, while other endpoints are not affected.
+*/
+TEST(httpPool, perHostCap)
+{
+  pthread_t  tid;
+  CURL*      curl1;
+  CURL*      curl2;
+  CURL*      curl;
+
+  httpPoolInit(2, 30);
+  httpPoolSweep(getCurrentTime() + 3600);
+
+  capEndpoint = httpPoolEndpoint("http:", "localhost", 1030);
+  capCurl     = NULL;
+
+  curl1 = httpPoolGet(capEndpoint);
+  curl2 = httpPoolGet(capEndpoint);
+
+  pthread_create(&tid, NULL, getFunc, NULL);
+  usleep(200000);
+  EXPECT_TRUE(capCurl == NULL);
+
+  // Another endpoint
+  std::string otherEndpoint = httpPoolEndpoint("http:", "localhost", 1031);
+
+  EXPECT_TRUE(httpPoolTryGet(otherEndpoint, &curl));
+  httpPoolRelease(otherEndpoint, curl, true);
+
+  // A handle given back is taken by the waiting thread
+  httpPoolRelease(capEndpoint, curl1, true);
+  pthread_join(tid, NULL);
+  EXPECT_EQ(curl1, capCurl);
+
+  EXPECT_FALSE(httpPoolTryGet(capEndpoint, &curl));
+
+  // A failed request frees its connection too
+  httpPoolRelease(capEndpoint, curl2, false);
+  EXPECT_TRUE(httpPoolTryGet(capEndpoint, &curl));
+  EXPECT_TRUE(curl != NULL);
+
+  httpPoolRelease(capEndpoint, curl, true);
+  httpPoolRelease(capEndpoint, capCurl, true);
+  httpPoolInit(0, 30);
+}
+
+
+
+/* ****************************************************************************
+*
+* idleExpiry -
+*
+* The sweep closes the expired idle connections of all the endpoints, including those
+* not used anymore, and forgets the endpoints without connections
+*/
+TEST(httpPool, idleExpiry)
+{
+  int    hits;
+  int    misses;
+  int    evictions;
+  int    idle;
+  CURL*  curl;
+  int    now = getCurrentTime();
+
+  httpPoolInit(2, 30);
+  httpPoolSweep(now + 3600);
+  httpPoolStatisticsReset();
+
+  std::string endpoint1 = httpPoolEndpoint("http:", "host1", 1026);
+  std::string endpoint2 = httpPoolEndpoint("http:", "host2", 1026);
+
+  curl = httpPoolGet(endpoint1);
+  httpPoolRelease(endpoint1, curl, true);
+  curl = httpPoolGet(endpoint2);
+  httpPoolRelease(endpoint2, curl, true);
+
+  // In use, not expired
+  curl = httpPoolGet(endpoint2);
+
+  httpPoolSweep(now + 10);
+  httpPoolStatisticsGet(&hits, &misses, &evictions, &idle);
+  EXPECT_EQ(1, idle);
+  EXPECT_EQ(0, evictions);
+
+  httpPoolSweep(now + 40);
+  httpPoolStatisticsGet(&hits, &misses, &evictions, &idle);
+  EXPECT_EQ(0, idle);
+  EXPECT_EQ(1, evictions);
+
+  // The connection in use still counts for the maximum of its endpoint
+  CURL* curl2 = httpPoolGet(endpoint2);
+  CURL* curl3;
+
+  EXPECT_FALSE(httpPoolTryGet(endpoint2, &curl3));
+
+  httpPoolRelease(endpoint2, curl2, true);
+  httpPoolRelease(endpoint2, curl, true);
+  httpPoolInit(0, 30);
+}
@@ -75,6 +75,7 @@ void setupDatabase(void)
   connection->dropCollection(ENTITIES_COLL);
   connection->dropCollection(SUBSCRIBECONTEXT_COLL);
   connection->dropCollection(SUBSCRIBECONTEXTAVAIL_COLL);
+  connection->dropCollection(ENTITY_TYPES_COLL);
 
   setDbPrefix(DBPREFIX);
   setRegistrationsCollectionName("registrations");
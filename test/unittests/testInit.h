@@ -37,6 +37,7 @@
 #define ENTITIES_COLL               DBPREFIX ".entities"
 #define SUBSCRIBECONTEXT_COLL       DBPREFIX ".csubs"
 #define SUBSCRIBECONTEXTAVAIL_COLL  DBPREFIX ".casubs"
+#define ENTITY_TYPES_COLL           DBPREFIX ".entityTypes"
 
 
 